@@ -0,0 +1,56 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aUv;
+// Per emitter, advancing once every kParticlesPerEmitter instances.
+layout(location = 11) in vec4 aEmitter;      // xyz position, w seed
+layout(location = 12) in vec2 aEmitterTime;  // age, duration
+
+uniform mat4 uView;
+uniform mat4 uProj;
+uniform float uSparkLayer;
+uniform float uGlowLayer;
+
+out vec2 vUv;
+out vec3 vNormal;
+out vec3 vWorldPos;
+out vec3 vTint;
+flat out float vLayer;
+
+// Particle 0 is the fireball shell, 1 its glowing core and 2-9 the spark ring.
+const int kParticlesPerEmitter = 10;
+
+void main() {
+  int particle = gl_InstanceID % kParticlesPerEmitter;
+  float t = clamp(aEmitterTime.x / max(aEmitterTime.y, 0.001), 0.0, 1.0);
+  float grow = 0.45 + t * 3.5;
+  float fade = 1.0 - t;
+
+  vec3 offset;
+  vec3 scale;
+  vLayer = uSparkLayer;
+  if (particle == 0) {
+    offset = vec3(0.0, 0.2, 0.0);
+    scale = vec3(grow * 1.1, grow * 0.7, grow * 1.1);
+    vTint = vec3(1.0, 0.42 + fade * 0.25, 0.1 + fade * 0.1);
+  } else if (particle == 1) {
+    offset = vec3(0.0, 0.25, 0.0);
+    scale = vec3(grow * 0.7, grow * 0.5, grow * 0.7);
+    vTint = vec3(1.0, 0.84, 0.38);
+    vLayer = uGlowLayer;
+  } else {
+    float spark = float(particle - 2);
+    float angle = aEmitter.w + spark * 0.785398;
+    float ring = (1.0 + spark * 0.11) * (0.6 + t * 2.8);
+    offset = vec3(cos(angle) * ring, 0.2 + (0.35 + 0.06 * spark) * t * 3.1, sin(angle) * ring);
+    float sparkScale = max(0.04, 0.18 * fade);
+    scale = vec3(sparkScale, sparkScale, sparkScale * 1.5);
+    vTint = vec3(1.0, 0.74, 0.2);
+  }
+
+  vUv = aUv;
+  vec4 worldPos = vec4(aEmitter.xyz + offset + aPos * scale, 1.0);
+  vWorldPos = worldPos.xyz;
+  vNormal = normalize(aNormal / scale);
+  gl_Position = uProj * uView * worldPos;
+}
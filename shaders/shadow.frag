@@ -0,0 +1,5 @@
+#version 330 core
+
+// Depth-only pass; the shadow map framebuffer has no color attachment.
+void main() {
+}
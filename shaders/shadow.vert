@@ -0,0 +1,9 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 3) in mat4 aInstanceModel;
+
+uniform mat4 uLightViewProj;
+
+void main() {
+  gl_Position = uLightViewProj * aInstanceModel * vec4(aPos, 1.0);
+}
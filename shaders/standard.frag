@@ -2,8 +2,10 @@
 in vec2 vUv;
 in vec3 vNormal;
 in vec3 vWorldPos;
+in vec3 vTint;
+flat in float vLayer;
 
-uniform sampler2D uTexture;
+uniform sampler2DArray uTexture;
 uniform vec3 uTint;
 uniform vec3 uLightDir;
 uniform vec3 uLightColor;
@@ -13,11 +15,37 @@ uniform vec3 uRimColor;
 uniform float uRimPower;
 uniform float uSpecPower;
 uniform float uSpecIntensity;
+// Static casters are baked once per level into a world-sized map; dynamic casters are
+// redrawn every frame into a small map around the player. Matrices go straight to [0,1]
+// texture space.
+uniform sampler2DShadow uStaticShadow;
+uniform sampler2DShadow uDynamicShadow;
+uniform mat4 uStaticShadowMatrix;
+uniform mat4 uDynamicShadowMatrix;
+uniform float uStaticNormalOffset;
+uniform float uDynamicNormalOffset;
+uniform float uShadowStrength;
 
 out vec4 FragColor;
 
+// 3x3 PCF over hardware-filtered compares; points outside the map are lit.
+float ShadowVisibility(sampler2DShadow map, mat4 shadowMatrix, vec3 position) {
+  vec3 coord = (shadowMatrix * vec4(position, 1.0)).xyz;
+  if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0)))) {
+    return 1.0;
+  }
+  vec2 texel = 1.0 / vec2(textureSize(map, 0));
+  float lit = 0.0;
+  for (int y = -1; y <= 1; ++y) {
+    for (int x = -1; x <= 1; ++x) {
+      lit += texture(map, vec3(coord.xy + vec2(x, y) * texel, coord.z));
+    }
+  }
+  return lit / 9.0;
+}
+
 void main() {
-  vec3 baseColor = texture(uTexture, vUv).rgb * uTint;
+  vec3 baseColor = texture(uTexture, vec3(vUv, vLayer)).rgb * uTint * vTint;
   vec3 N = normalize(vNormal);
   vec3 L = normalize(-uLightDir);
   vec3 V = normalize(uViewPos - vWorldPos);
@@ -27,6 +55,11 @@ void main() {
   float spec = pow(max(dot(N, H), 0.0), uSpecPower) * uSpecIntensity;
   float rim = pow(1.0 - max(dot(N, V), 0.0), uRimPower);
 
-  vec3 lit = baseColor * (uAmbient + diff * uLightColor) + (uLightColor * spec) + (uRimColor * rim);
+  // Pushing the lookup out along the normal (about a texel) keeps lit faces from shadowing themselves.
+  float visibility = min(ShadowVisibility(uStaticShadow, uStaticShadowMatrix, vWorldPos + N * uStaticNormalOffset),
+                         ShadowVisibility(uDynamicShadow, uDynamicShadowMatrix, vWorldPos + N * uDynamicNormalOffset));
+  float shadow = mix(1.0, visibility, uShadowStrength);
+
+  vec3 lit = baseColor * (uAmbient + diff * shadow * uLightColor) + (uLightColor * spec * shadow) + (uRimColor * rim);
   FragColor = vec4(lit, 1.0);
 }
@@ -2,6 +2,10 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aUv;
+layout(location = 3) in mat4 aInstanceModel;
+layout(location = 7) in mat3 aInstanceNormal;
+layout(location = 10) in vec3 aInstanceTint;
+layout(location = 11) in float aInstanceLayer;
 
 uniform mat4 uModel;
 uniform mat4 uView;
@@ -11,11 +15,15 @@ uniform mat3 uNormalMatrix;
 out vec2 vUv;
 out vec3 vNormal;
 out vec3 vWorldPos;
+out vec3 vTint;
+flat out float vLayer;
 
 void main() {
   vUv = aUv;
-  vec4 worldPos = uModel * vec4(aPos, 1.0);
+  vTint = aInstanceTint;
+  vLayer = aInstanceLayer;
+  vec4 worldPos = uModel * aInstanceModel * vec4(aPos, 1.0);
   vWorldPos = worldPos.xyz;
-  vNormal = normalize(uNormalMatrix * aNormal);
+  vNormal = normalize(uNormalMatrix * aInstanceNormal * aNormal);
   gl_Position = uProj * uView * worldPos;
 }
@@ -9,16 +9,30 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <deque>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -32,16 +46,31 @@
 #include <cerrno>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VIBE_SIMD_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VIBE_SIMD_NEON 1
+#endif
+
 #include "miniaudio.h"
 
 #ifndef VIBE_SHADER_DIR
 #define VIBE_SHADER_DIR "shaders"
 #endif
 
+#ifndef VIBE_LEVEL_DIR
+#define VIBE_LEVEL_DIR "levels"
+#endif
+
 #ifdef _WIN32
 using SocketHandle = SOCKET;
 static constexpr SocketHandle kInvalidSocketHandle = INVALID_SOCKET;
@@ -52,11 +81,31 @@ static constexpr SocketHandle kInvalidSocketHandle = -1;
 
 struct MultiplayerConfig {
   bool enabled = false;
+  bool host = true;  // Hosts run the world and accept clients; clients connect to peerIp.
   int localPort = 7777;
   std::string peerIp = "127.0.0.1";
   int peerPort = 7778;
 };
 
+// --headless runs the sim with no window, GL, ImGui backends or audio for a fixed number
+// of steps under scripted input, then prints per-step timings.
+struct HeadlessConfig {
+  bool enabled = false;
+  std::uint32_t steps = 6000u;
+  int level = 1;
+  int cats = 0;   // Total population; 0 keeps the level as authored.
+  int dogs = 0;
+  int bombs = 0;  // Live bombs kept in flight on top of the mummy's own throws.
+  unsigned int seed = 1u;
+};
+
+// --record <file> logs every frame's input to a replay; --replay <file> feeds a logged
+// session back through the fixed-step sim instead of the keyboard and mouse.
+struct ReplayConfig {
+  std::string recordPath;
+  std::string replayPath;
+};
+
 struct InputBindings {
   int forward = GLFW_KEY_W;
   int backward = GLFW_KEY_S;
@@ -68,6 +117,34 @@ struct InputBindings {
   int pauseB = GLFW_KEY_P;
 };
 
+// Everything the frame loop reads from the player, sampled once per frame.
+struct FrameInput {
+  bool forward = false;
+  bool backward = false;
+  bool left = false;
+  bool right = false;
+  bool jump = false;
+  bool sprint = false;
+  bool pauseA = false;
+  bool pauseB = false;
+  bool useItem = false;  // Left mouse button.
+  bool dropItem = false;
+  bool orbit = false;    // Right mouse button.
+  double cursorX = 0.0;
+  double cursorY = 0.0;
+  float orbitYaw = 0.0f;  // Camera turn this frame in radians, from the cursor while orbiting.
+  float orbitPitch = 0.0f;
+  std::uint8_t actions = 0u;  // InputAction bits.
+};
+
+// Menu buttons that change game state. The UI queues them and the next frame applies them
+// with the rest of its input, so recordings and replays carry them like key presses.
+enum InputAction : std::uint8_t {
+  kInputActionResume = 1u << 0,
+  kInputActionResetPlayer = 1u << 1,
+  kInputActionRestartLevel = 1u << 2,
+};
+
 struct SettingsProfile {
   float uiScale = 2.8f;
   float mouseSensitivity = 0.005f;
@@ -79,24 +156,401 @@ struct SettingsProfile {
   bool showDebugHud = false;
   bool showMultiplayerWindow = true;
   bool highContrastHud = false;
+  float lodDistance = 30.0f;
+  bool vsync = true;
+  bool shadows = true;
+  int netTickRate = 30;
+  int netPlayoutDelayMs = 100;
   InputBindings keys;
 };
 
+// Fixed-capacity FIFO over inline storage; PushBack recycles the oldest slot once full, so
+// elements that own buffers keep their capacity. While only PushBack is used, Data() with
+// Offset() as the index of the oldest element is the in-place layout ImGui::PlotLines takes.
+template <typename T, std::size_t N>
+struct FixedRing {
+  T items[N] = {};
+  std::size_t first = 0;
+  std::size_t count = 0;
+
+  static constexpr std::size_t Capacity() { return N; }
+  std::size_t Size() const { return count; }
+  bool Empty() const { return count == 0; }
+  const T* Data() const { return items; }
+  std::size_t Offset() const { return first; }
+
+  T& operator[](std::size_t index) { return items[(first + index) % N]; }
+  const T& operator[](std::size_t index) const { return items[(first + index) % N]; }
+  T& Front() { return items[first]; }
+  T& Back() { return (*this)[count - 1]; }
+
+  T& PushBack() {
+    if (count == N) {
+      PopFront();
+    }
+    ++count;
+    return Back();
+  }
+  void PushBack(const T& value) { PushBack() = value; }
+  void PopFront() {
+    first = (first + 1) % N;
+    --count;
+  }
+  void Clear() {
+    first = 0;
+    count = 0;
+  }
+};
+
+// C++ heap allocations made by the calling thread, for the Debug window's per-frame
+// counter. Counts come from the replaced global operator new below; malloc calls made
+// by C libraries (GLFW, the GL driver, miniaudio, ImGui's allocator) are not seen.
+static thread_local std::uint64_t tHeapAllocations = 0;
+
+static std::uint64_t HeapAllocationCount() { return tHeapAllocations; }
+
+void* operator new(std::size_t size) {
+  ++tHeapAllocations;
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+// Bump allocator for scratch that lives for one frame: Reset() at the top of the frame
+// releases everything at once. A frame that outgrows the block falls back to the heap
+// (visible in the allocation counter) and the next Reset grows the block to the peak.
+struct FrameArena {
+  std::vector<unsigned char> block;
+  std::size_t used = 0;
+  std::size_t peak = 0;
+  std::vector<std::vector<unsigned char>> spills;
+
+  explicit FrameArena(std::size_t capacity) : block(capacity) {}
+
+  void Reset() {
+    if (!spills.empty()) {
+      spills.clear();
+      block.assign(peak + peak / 2, 0u);
+    }
+    used = 0;
+  }
+
+  void* Allocate(std::size_t bytes, std::size_t alignment) {
+    const std::size_t start = (used + alignment - 1) & ~(alignment - 1);
+    used = start + bytes;
+    peak = std::max(peak, used);
+    if (used <= block.size()) {
+      return block.data() + start;
+    }
+    spills.emplace_back(bytes + alignment);
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(spills.back().data());
+    return reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+  }
+
+  // Uninitialized storage for trivially destructible scratch; never freed individually.
+  template <typename T>
+  T* AllocateArray(std::size_t count) {
+    return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+  }
+};
+
+// Work-stealing pool for the data-parallel passes of a frame: animal AI and physics in the
+// sim step, animal model building in the render. ParallelFor cuts a range into tasks sized
+// from what the same pass cost per item last time and deals them onto one deque per
+// thread; a thread pops its own deque from the back and, once that is empty, steals from
+// the front of the others, so a task that runs long is evened out by the rest. The calling
+// thread works too and returns once every task is done, so each pass is still a plain
+// synchronous step of the frame. Tasks may only write state owned by their own range.
+struct JobSystem {
+  static constexpr std::size_t kMaxThreads = 16;    // Workers plus the calling thread.
+  static constexpr std::size_t kMaxTasks = 64;      // Per ParallelFor; sizes per-task outputs too.
+  static constexpr double kTaskTargetNs = 40000.0;  // Work per task; smaller passes run inline.
+
+  // Smoothed cost of one pass per item, measured on every run; each pass keeps its own.
+  struct Cost {
+    double nsPerItem = 0.0;
+    std::size_t lastTasks = 0;
+  };
+
+  struct Batch {
+    void (*run)(void* context, std::size_t begin, std::size_t end, std::size_t task) = nullptr;
+    void* context = nullptr;
+    std::atomic<std::size_t> remaining{0};
+    std::atomic<std::int64_t> busyNs{0};
+  };
+
+  struct Task {
+    Batch* batch = nullptr;
+    std::uint32_t begin = 0u;
+    std::uint32_t end = 0u;
+    std::uint32_t index = 0u;
+  };
+
+  // Fixed ring of tasks behind a mutex: one lock per task, far below the cost of a task.
+  struct alignas(64) TaskDeque {
+    std::mutex mutex;
+    Task tasks[kMaxTasks];
+    std::size_t head = 0;  // Oldest task, where thieves take from.
+    std::size_t size = 0;
+
+    void Push(const Task& task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks[(head + size) % kMaxTasks] = task;
+      ++size;
+    }
+
+    bool PopBack(Task& task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (size == 0) {
+        return false;
+      }
+      --size;
+      task = tasks[(head + size) % kMaxTasks];
+      return true;
+    }
+
+    bool StealFront(Task& task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (size == 0) {
+        return false;
+      }
+      task = tasks[head];
+      head = (head + 1) % kMaxTasks;
+      --size;
+      return true;
+    }
+  };
+
+  TaskDeque deques[kMaxThreads];  // deques[0] belongs to the calling thread.
+  std::vector<std::thread> workers;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<std::int64_t> queued{0};  // Tasks pushed and not yet taken; briefly negative.
+  std::atomic<std::uint64_t> steals{0};
+  std::size_t threadCount = 1;  // Fixed while workers run; they read it to pick victims.
+  bool quit = false;
+
+  ~JobSystem() { Shutdown(); }
+
+  // workerCount threads besides the caller; 0 runs every pass inline.
+  void Start(std::size_t workerCount) {
+    workerCount = std::min(workerCount, kMaxThreads - 1);
+    quit = false;
+    threadCount = workerCount + 1;
+    for (std::size_t i = 0; i < workerCount; ++i) {
+      workers.emplace_back([this, i] { WorkerLoop(i + 1); });
+    }
+  }
+
+  void Shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+    threadCount = 1;
+  }
+
+  std::size_t ThreadCount() const { return threadCount; }
+
+  // Calls fn(begin, end, task) over [0, count) in up to kMaxTasks ascending slices, task
+  // being the slice's position, and returns the number of slices. A pass with no
+  // measurement yet, or too little work to share, runs as one slice on the caller.
+  template <typename Fn>
+  std::size_t ParallelFor(Cost& cost, std::size_t count, Fn&& fn) {
+    std::size_t tasks = count == 0 ? 0 : 1;
+    if (threadCount > 1 && count > 1 && cost.nsPerItem > 0.0) {
+      const double estimate = cost.nsPerItem * static_cast<double>(count) / kTaskTargetNs;
+      tasks = static_cast<std::size_t>(std::clamp(estimate, 1.0, static_cast<double>(std::min(kMaxTasks, count))));
+    }
+    cost.lastTasks = tasks;
+    if (tasks == 0) {
+      return 0;
+    }
+
+    Batch batch;
+    batch.run = [](void* context, std::size_t begin, std::size_t end, std::size_t task) {
+      (*static_cast<std::remove_reference_t<Fn>*>(context))(begin, end, task);
+    };
+    batch.context = &fn;
+    batch.remaining.store(tasks);
+    if (tasks == 1) {
+      Run({&batch, 0u, static_cast<std::uint32_t>(count), 0u});
+    } else {
+      // Even slices by item count: the measured cost sets how many, stealing absorbs the
+      // spread within a pass (sleeping or culled animals are cheaper than the rest).
+      const std::size_t threads = ThreadCount();
+      for (std::size_t t = 0; t < tasks; ++t) {
+        deques[t % threads].Push({&batch, static_cast<std::uint32_t>(count * t / tasks),
+                                  static_cast<std::uint32_t>(count * (t + 1) / tasks), static_cast<std::uint32_t>(t)});
+      }
+      {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued += static_cast<std::int64_t>(tasks);
+      }
+      wake.notify_all();
+      Task task;
+      while (batch.remaining.load() > 0) {
+        if (Take(0, task)) {
+          Run(task);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    const double measured = static_cast<double>(batch.busyNs.load()) / static_cast<double>(count);
+    cost.nsPerItem = cost.nsPerItem > 0.0 ? cost.nsPerItem * 0.8 + measured * 0.2 : measured;
+    return tasks;
+  }
+
+  bool Take(std::size_t self, Task& task) {
+    const std::size_t threads = ThreadCount();
+    bool found = deques[self].PopBack(task);
+    for (std::size_t k = 1; !found && k < threads; ++k) {
+      found = deques[(self + k) % threads].StealFront(task);
+      if (found) {
+        steals.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (found) {
+      queued.fetch_sub(1);
+    }
+    return found;
+  }
+
+  void Run(const Task& task) {
+    const auto start = std::chrono::steady_clock::now();
+    task.batch->run(task.batch->context, task.begin, task.end, task.index);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    task.batch->busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    // Last touch of the batch: the caller's stack frame may be gone once this reaches zero.
+    task.batch->remaining.fetch_sub(1);
+  }
+
+  void WorkerLoop(std::size_t self) {
+    Task task;
+    for (;;) {
+      if (Take(self, task)) {
+        Run(task);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wake.wait(lock, [this] { return quit || queued.load() > 0; });
+      if (quit) {
+        return;
+      }
+    }
+  }
+};
+
+// Worker threads for the JobSystem: --jobs <n>, or one per core beside the main thread.
+static std::size_t ParseJobThreads(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string(argv[i]) == "--jobs") {
+      return static_cast<std::size_t>(std::max(0, std::atoi(argv[i + 1])));
+    }
+  }
+  const unsigned int cores = std::thread::hardware_concurrency();
+  return cores > 1 ? cores - 1 : 0;
+}
+
 struct PerformanceHistory {
-  std::deque<float> frameMs;
+  static constexpr std::size_t kFrames = 240;
+  FixedRing<float, kFrames> frameMs;
+  FixedRing<std::uint32_t, kFrames> frameAllocations;
   float emaFrameMs = 16.0f;
 };
 
-static constexpr const char* kSettingsFile = "vibe3d_settings.cfg";
+// Versioned binary settings profile; the old text profile is migrated from on first start.
+static constexpr const char* kSettingsFile = "vibe3d_settings.bin";
+static constexpr const char* kLegacySettingsFile = "vibe3d_settings.cfg";
+static constexpr std::uint32_t kSettingsMagic = 0x54533356u;  // "V3ST"
+// Bumped only when an existing field changes meaning, so LoadSettings can convert it; adding
+// a field just takes a new schema id.
+static constexpr std::uint32_t kSettingsVersion = 1u;
+
+// One discrete player action, resent in every snapshot until the peer acks its sequence.
+struct InputCommand {
+  std::uint32_t sequence = 0u;
+  std::uint8_t actions = 0u;   // kInputAction* bits.
+  std::uint8_t heldItem = 0u;  // ItemType at the moment of the action.
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float facing = 0.0f;
+};
+
+// Unacked commands carried by each snapshot: the most the 4-bit count on the wire holds.
+// A player who outruns it for a whole round trip loses the oldest unacked commands, which
+// the Multiplayer window counts.
+static constexpr std::size_t kMaxPendingInputCommands = 15;
+
+// Per-entity snapshot state. Each entity kind is a variable-length section on the wire,
+// sized by whatever the sending level holds.
+struct NetCatState {
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float vel[3] = {0.0f, 0.0f, 0.0f};
+  float facing = 0.0f;
+  float walkCycle = 0.0f;
+};
+
+struct NetDogState {
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float vel[3] = {0.0f, 0.0f, 0.0f};
+  float facing = 0.0f;
+  float walkCycle = 0.0f;
+  float blastTimer = 0.0f;
+};
+
+struct NetBombState {
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float vel[3] = {0.0f, 0.0f, 0.0f};
+  float timer = 0.0f;
+};
+
+struct NetExplosionState {
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float age = 0.0f;
+  float duration = 0.0f;
+  float seed = 0.0f;
+};
+
+struct NetWorldItemState {
+  std::uint8_t type = 0u;
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Another client's player as the host relays it; id is the client's session id.
+struct NetPlayerState {
+  std::uint8_t id = 0u;
+  float pos[3] = {0.0f, 0.0f, 0.0f};
+  float vel[3] = {0.0f, 0.0f, 0.0f};
+  float facing = 0.0f;
+  std::uint8_t heldItem = 0u;
+  std::uint8_t heldCharges = 0u;
+  std::uint8_t useSerial = 0u;  // Bumped per item use so receivers can replay the animation.
+  std::uint8_t useItem = 0u;
+};
 
 struct MultiplayerPacket {
   std::uint32_t magic = 0x56425033u;
-  std::uint16_t version = 1u;
+  std::uint16_t version = 6u;
   std::uint16_t level = 1u;
   std::uint32_t sequence = 0u;
+  std::uint32_t ackSequence = 0u;
+  std::uint32_t simTick = 0u;  // Sender's fixed-step tick when the snapshot was taken.
+  std::uint32_t sendTimeMs = 0u;  // Sender's clock when the snapshot went out; never 0.
+  // The peer's newest sendTimeMs plus how long the sender held it, 0 until one arrives.
+  // Subtracting it from the arrival time leaves the round trip.
+  std::uint32_t echoTimeMs = 0u;
   std::uint32_t flags = 0u;
-  std::uint32_t catsMask = 0u;
-  std::uint32_t dogsMask = 0u;
   std::int32_t collected = 0;
   std::int32_t lives = 0;
   float pos[3] = {0.0f, 0.0f, 0.0f};
@@ -112,30 +566,21 @@ struct MultiplayerPacket {
   float mummyFacing = 0.0f;
   float mummyWalkCycle = 0.0f;
   float mummyThrowCooldown = 0.0f;
-  float catPos[10][3] = {};
-  float catVel[10][3] = {};
-  float catFacing[10] = {};
-  float catWalkCycle[10] = {};
-  float dogPos[20][3] = {};
-  float dogVel[20][3] = {};
-  float dogFacing[20] = {};
-  float dogWalkCycle[20] = {};
-  float dogBlastTimer[20] = {};
-  std::uint32_t bombActiveMask = 0u;
-  float bombPos[12][3] = {};
-  float bombVel[12][3] = {};
-  float bombTimer[12] = {};
-  std::uint8_t explosionCount = 0u;
-  float explosionPos[16][3] = {};
-  float explosionAge[16] = {};
-  float explosionDuration[16] = {};
-  float explosionSeed[16] = {};
-  std::uint32_t worldItemActiveMask = 0u;
-  std::uint8_t worldItemType[16] = {};
-  float worldItemPos[16][3] = {};
+  std::vector<NetPlayerState> players;  // Other clients, in snapshots from a host only.
+  std::vector<NetCatState> cats;
+  std::vector<bool> catsCollected;  // One flag per entry of cats.
+  std::vector<NetDogState> dogs;
+  std::vector<bool> dogsCollected;
+  std::vector<NetBombState> bombs;
+  std::vector<bool> bombsActive;
+  std::vector<NetExplosionState> explosions;
+  std::vector<NetWorldItemState> worldItems;
+  std::vector<bool> worldItemsActive;
   std::uint8_t localHeldItemType = 0u;
   std::int32_t localHeldItemCharges = 0;
-  std::uint32_t inputActions = 0u;
+  std::uint8_t inputCommandCount = 0u;
+  InputCommand inputCommands[kMaxPendingInputCommands] = {};
+  std::uint32_t ackedInputCommand = 0u;  // Newest peer command this instance has applied.
   std::uint32_t enemyAliveMask = 0u;
   float enemyRespawnTimer[2] = {};
   float enemyStunTimer[2] = {};
@@ -147,1364 +592,6221 @@ static constexpr std::uint32_t kNetFlagAuthority = 0x4u;
 static constexpr std::uint32_t kInputActionUseItem = 0x1u;
 static constexpr std::uint32_t kInputActionDropItem = 0x2u;
 
-struct MultiplayerState {
-  bool active = false;
-  bool requested = false;
-#ifdef _WIN32
-  bool wsaReady = false;
-#endif
-  SocketHandle socket = kInvalidSocketHandle;
-  sockaddr_in peerAddr{};
-  MultiplayerPacket latest{};
-  MultiplayerPacket previous{};
-  bool hasRemote = false;
-  bool hasSequence = false;
-  float lastReceiveTime = 0.0f;
-  float previousReceiveTime = 0.0f;
-  std::uint32_t lastRemoteSequence = 0u;
-  std::uint32_t sendSequence = 0u;
-};
-
-struct Enemy;
-struct Cat;
-struct Dog;
-struct Bomb;
-struct Explosion;
-struct WorldItem;
-enum class ItemType : std::uint8_t;
-
-static void PackWorldEntities(MultiplayerPacket& packet,
-                              const Enemy& clown,
-                              float clownFacing,
-                              float clownWalkCycle,
-                              const Enemy& mummy,
-                              float mummyFacing,
-                              float mummyWalkCycle,
-                              float mummyThrowCooldown,
-                              const std::vector<Cat>& cats,
-                              const std::vector<Dog>& dogs,
-                              const std::vector<Bomb>& bombs,
-                              const std::vector<Explosion>& explosions,
-                              const std::vector<WorldItem>& worldItems,
-                              ItemType heldItem,
-                              int heldCharges,
-                              bool clownAlive,
-                              float clownRespawnTimer,
-                              float clownStunTimer,
-                              bool mummyAlive,
-                              float mummyRespawnTimer,
-                              float mummyStunTimer);
-
-static MultiplayerConfig ParseMultiplayerConfig(int argc, char** argv) {
-  MultiplayerConfig config;
-  for (int i = 1; i < argc; ++i) {
-    const std::string arg = argv[i];
-    if (arg == "--mp") {
-      config.enabled = true;
-    } else if (arg == "--mp-local-port" && (i + 1) < argc) {
-      config.enabled = true;
-      config.localPort = std::max(1, std::atoi(argv[++i]));
-    } else if (arg == "--mp-peer-ip" && (i + 1) < argc) {
-      config.enabled = true;
-      config.peerIp = argv[++i];
-    } else if (arg == "--mp-peer-port" && (i + 1) < argc) {
-      config.enabled = true;
-      config.peerPort = std::max(1, std::atoi(argv[++i]));
-    }
+// Single-producer/single-consumer queue from the receive thread to the main loop.
+struct SnapshotRing {
+  static constexpr std::size_t kCapacity = 64;  // Power of two.
+  struct Entry {
+    MultiplayerPacket packet;
+    double arrivalTime = 0.0;
+    std::uint8_t peer = 0u;  // Index into MultiplayerState::peers.
+    std::uint32_t generation = 0u;  // The peer slot's generation when it was decoded.
+  };
+  std::vector<Entry> entries;
+  std::atomic<std::size_t> head{0};  // Next slot the producer writes.
+  std::atomic<std::size_t> tail{0};  // Next slot the consumer reads.
+
+  void Reset() {
+    entries.assign(kCapacity, Entry{});
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
   }
-  return config;
-}
 
-static bool SetSocketNonBlocking(SocketHandle socket) {
-#ifdef _WIN32
-  u_long mode = 1;
-  return ioctlsocket(socket, FIONBIO, &mode) == 0;
-#else
-  const int flags = fcntl(socket, F_GETFL, 0);
-  if (flags < 0) {
-    return false;
+  bool Push(const Entry& entry) {
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= kCapacity) {
+      return false;
+    }
+    entries[h & (kCapacity - 1)] = entry;
+    head.store(h + 1, std::memory_order_release);
+    return true;
   }
-  return fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
-#endif
-}
-
-static void CloseSocketHandle(SocketHandle socket) {
-#ifdef _WIN32
-  closesocket(socket);
-#else
-  close(socket);
-#endif
-}
-
-static bool IsWouldBlockError() {
-#ifdef _WIN32
-  const int err = WSAGetLastError();
-  return err == WSAEWOULDBLOCK;
-#else
-  return errno == EWOULDBLOCK || errno == EAGAIN;
-#endif
-}
 
-static bool InitMultiplayer(const MultiplayerConfig& config, MultiplayerState& state) {
-  state.requested = config.enabled;
-  if (!config.enabled) {
+  bool Pop(Entry& out) {
+    const std::size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    out = entries[t & (kCapacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
     return true;
   }
+};
 
-  auto FailAndCleanup = [&]() {
-    if (state.socket != kInvalidSocketHandle) {
-      CloseSocketHandle(state.socket);
-      state.socket = kInvalidSocketHandle;
-    }
-#ifdef _WIN32
-    if (state.wsaReady) {
-      WSACleanup();
-      state.wsaReady = false;
+// Fixed-capacity pool for transient effects and projectiles. Slots never move, so a slot
+// index is a stable handle (snapshots address bombs by it). `order` holds every slot
+// index: the first liveCount entries are the dense live list and the rest are the free
+// list, so Acquire and the swap-remove in Release are O(1) and never allocate.
+// Range-for visits live objects only; use ReleaseIf to retire objects while iterating.
+template <typename T>
+struct ObjectPool {
+  template <typename Object>
+  struct Iterator {
+    Object* slots = nullptr;
+    const std::uint32_t* at = nullptr;
+    Object& operator*() const { return slots[*at]; }
+    Iterator& operator++() {
+      ++at;
+      return *this;
     }
-#endif
-    state.active = false;
-    return false;
+    bool operator!=(const Iterator& other) const { return at != other.at; }
   };
 
-#ifdef _WIN32
-  WSADATA wsaData{};
-  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-    return FailAndCleanup();
+  std::vector<T> slots;
+  std::vector<std::uint32_t> order;
+  std::vector<std::uint32_t> where;  // Position of each slot in order.
+  std::size_t liveCount = 0;
+  std::size_t highWater = 0;  // Most objects live at once.
+
+  explicit ObjectPool(std::size_t capacity = 0) { Reserve(capacity); }
+
+  std::size_t Capacity() const { return slots.size(); }
+  std::size_t Size() const { return liveCount; }
+  bool IsLive(std::size_t slot) const { return where[slot] < liveCount; }
+  std::size_t SlotOf(const T& object) const { return static_cast<std::size_t>(&object - slots.data()); }
+
+  // Gameplay stays inside the capacity given at construction; only snapshot resyncs
+  // from a peer with bigger pools grow it.
+  void Reserve(std::size_t capacity) {
+    for (std::size_t slot = slots.size(); slot < capacity; ++slot) {
+      slots.emplace_back();
+      where.push_back(static_cast<std::uint32_t>(order.size()));
+      order.push_back(static_cast<std::uint32_t>(slot));
+    }
   }
-  state.wsaReady = true;
-#endif
 
-  state.socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (state.socket == kInvalidSocketHandle) {
-    return FailAndCleanup();
+  // Returns a reset object, or nullptr when every slot is live.
+  T* Acquire() {
+    if (liveCount == slots.size()) {
+      return nullptr;
+    }
+    const std::uint32_t slot = order[liveCount];
+    SetLive(slot, true);
+    slots[slot] = T{};
+    return &slots[slot];
   }
 
-  sockaddr_in localAddr{};
-  localAddr.sin_family = AF_INET;
-  localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-  localAddr.sin_port = htons(static_cast<std::uint16_t>(config.localPort));
-  if (bind(state.socket, reinterpret_cast<sockaddr*>(&localAddr), sizeof(localAddr)) != 0) {
-    return FailAndCleanup();
+  // Moves the slot across the live/free boundary by swapping it with the entry there.
+  void SetLive(std::size_t slot, bool live) {
+    if (IsLive(slot) == live) {
+      return;
+    }
+    const std::size_t boundary = live ? liveCount : liveCount - 1;
+    const std::uint32_t displaced = order[boundary];
+    const std::uint32_t from = where[slot];
+    order[from] = displaced;
+    where[displaced] = from;
+    order[boundary] = static_cast<std::uint32_t>(slot);
+    where[slot] = static_cast<std::uint32_t>(boundary);
+    liveCount = live ? liveCount + 1 : liveCount - 1;
+    highWater = std::max(highWater, liveCount);
   }
 
-  if (!SetSocketNonBlocking(state.socket)) {
-    return FailAndCleanup();
+  void Release(std::size_t slot) { SetLive(slot, false); }
+
+  void Clear() { liveCount = 0; }
+
+  template <typename Fn>
+  void ReleaseIf(Fn&& shouldRelease) {
+    for (std::size_t i = 0; i < liveCount;) {
+      const std::uint32_t slot = order[i];
+      if (shouldRelease(slots[slot])) {
+        Release(slot);  // The last live entry now sits at i.
+      } else {
+        ++i;
+      }
+    }
   }
 
-  state.peerAddr = {};
-  state.peerAddr.sin_family = AF_INET;
-  state.peerAddr.sin_port = htons(static_cast<std::uint16_t>(config.peerPort));
-  if (inet_pton(AF_INET, config.peerIp.c_str(), &state.peerAddr.sin_addr) != 1) {
-    return FailAndCleanup();
+  Iterator<T> begin() { return {slots.data(), order.data()}; }
+  Iterator<T> end() { return {slots.data(), order.data() + liveCount}; }
+  Iterator<const T> begin() const { return {slots.data(), order.data()}; }
+  Iterator<const T> end() const { return {slots.data(), order.data() + liveCount}; }
+};
+
+// Snapshot wire format: a bit-packed header (magic, version, sequence, baseline, ack, tick,
+// send and echo timestamps)
+// followed by the body delta-coded against a baseline the peer has acknowledged.
+// Entity sections carry their count and a dirty bit per entity, and only entities that
+// differ from the baseline are written. Baseline 0 is a full snapshot coded against a
+// default packet. Encoded snapshots are split into MTU-sized fragments for sending.
+static constexpr std::size_t kSnapshotHistorySize = 32;
+static constexpr int kNetSectionCountBits = 16;
+static constexpr std::uint32_t kNetFragmentMagic = 0x56424647u;
+static constexpr std::size_t kNetFragmentHeaderBytes = 10;  // magic, sequence, index, count.
+static constexpr std::size_t kNetFragmentPayloadBytes = 1024;
+static constexpr std::size_t kMaxNetFragments = 64;  // Bits in FragmentAssembly::receivedMask.
+static constexpr std::size_t kMaxSnapshotBytes = kNetFragmentPayloadBytes * kMaxNetFragments;
+static constexpr std::size_t kFragmentAssemblySlots = 4;
+// A snapshot up to this many sequences behind the newest decoded one is still decoded and
+// slotted into the jitter buffer by sim tick; older ones and duplicates are dropped.
+static constexpr std::int32_t kNetReorderWindow = static_cast<std::int32_t>(kSnapshotHistorySize) - 1;
+
+// Sessions are a star around the authoritative host: each client talks only to the host,
+// which relays the other clients' players. A host serves up to kMaxNetPeers clients.
+static constexpr std::size_t kMaxNetPeers = 7;
+static constexpr std::size_t kMaxSessionPlayers = kMaxNetPeers + 1;
+static constexpr float kNetPeerFreshSeconds = 2.0f;  // A peer this quiet counts as offline.
+// A host stops sending to a client this quiet (counted from the claim if it never answered)
+// and lets an unknown address take its slot; the client's next snapshot resumes the stream.
+static constexpr double kNetPeerTimeout = 10.0;
+// Cats, dogs and bombs farther than this from a client are held at the client's acked copy.
+// Distances are taken from the center of the cell the client stands in, so clients sharing a
+// cell and a baseline share one encoding; the cell matches the 32 m world chunks.
+static constexpr float kNetInterestRadius = 64.0f;
+static constexpr float kNetInterestCell = 32.0f;
+
+// Snapshot parts whose encoded size the network stats break out.
+enum class NetSection : std::uint8_t {
+  Header,
+  Player,
+  Others,
+  Enemies,
+  Cats,
+  Dogs,
+  Bombs,
+  Explosions,
+  Items,
+  Count
+};
+
+static constexpr int kNetSectionCount = static_cast<int>(NetSection::Count);
+static constexpr const char* kNetSectionNames[kNetSectionCount] = {
+    "Header", "Player", "Others", "Enemies", "Cats", "Dogs", "Bombs", "Explosions", "Items"};
+static constexpr const char* kNetStatsFile = "vibe3d_netstats.csv";
+
+// One snapshot being put back together on the receive thread.
+struct FragmentAssembly {
+  std::uint32_t sequence = 0u;
+  std::uint32_t fragmentCount = 0u;
+  std::uint64_t receivedMask = 0u;
+  std::size_t size = 0;  // Known once the last fragment has arrived.
+  std::vector<std::uint8_t> bytes;
+};
+
+struct RemoteSnapshotSample {
+  MultiplayerPacket packet;
+  double arrivalTick = 0.0;  // Local sim tick, back-dated to the packet's arrival time.
+};
+
+// One second of link statistics; rates are per second over the sample window.
+struct NetStatsSample {
+  float time = 0.0f;
+  float packetsSent = 0.0f;
+  float packetsReceived = 0.0f;
+  float sentKiB = 0.0f;
+  float receivedKiB = 0.0f;
+  float outOfOrder = 0.0f;  // Fragments and snapshots dropped as duplicates or too late.
+  float lossPercent = 0.0f;
+  float rttMs = 0.0f;  // Worst peer's smoothed round trip.
+  float snapshotsSent = 0.0f;
+  float sectionBytes[kNetSectionCount] = {};  // Mean encoded bytes per sent snapshot.
+};
+
+// Running link totals. The receive thread's own counters are atomics in MultiplayerState.
+struct NetCounters {
+  std::uint64_t packetsSent = 0u;
+  std::uint64_t bytesSent = 0u;
+  std::uint64_t packetsReceived = 0u;
+  std::uint64_t bytesReceived = 0u;
+  std::uint64_t outOfOrder = 0u;
+  std::uint64_t snapshotsReceived = 0u;
+  std::uint64_t snapshotsLost = 0u;
+  std::uint64_t snapshotsSent = 0u;
+  std::uint64_t inputCommandsDropped = 0u;  // Pushed out of the pending queue before every peer acked them.
+  std::uint64_t sectionBits[kNetSectionCount] = {};
+};
+
+// Counter deltas taken once a second into a fixed history for the graphs and CSV export.
+struct NetStats {
+  static constexpr std::size_t kSamples = 120;
+  FixedRing<NetStatsSample, kSamples> history;
+  NetCounters totals;  // Main-thread counts; the receive-thread ones are filled in when sampling.
+  NetCounters windowTotals;
+  float windowStart = -1.0f;
+};
+
+// Snapshot positions are quantized to 16 bits per axis over a box derived from the loaded
+// world's platforms: their XZ extent plus kNetPositionMarginXZ, and from
+// kNetPositionMarginBelow under the lowest one to kNetPositionMarginAbove over the highest
+// (jumps, knockback and bomb arcs). Host and clients load the same world file, so both
+// ends derive the same box without sending it.
+static constexpr float kNetPositionMarginXZ = 16.0f;
+static constexpr float kNetPositionMarginBelow = 16.0f;
+static constexpr float kNetPositionMarginAbove = 40.0f;
+
+struct NetPositionRange {
+  glm::vec3 min{-256.0f, -16.0f, -256.0f};
+  glm::vec3 max{256.0f, 48.0f, 256.0f};
+
+  // lo and hi bound every platform in the world.
+  static NetPositionRange ForBounds(const glm::vec3& lo, const glm::vec3& hi) {
+    NetPositionRange range;
+    range.min = glm::vec3(lo.x - kNetPositionMarginXZ, lo.y - kNetPositionMarginBelow, lo.z - kNetPositionMarginXZ);
+    range.max = glm::vec3(hi.x + kNetPositionMarginXZ, hi.y + kNetPositionMarginAbove, hi.z + kNetPositionMarginXZ);
+    return range;
   }
+};
 
-  state.active = true;
-  state.hasRemote = false;
-  state.sendSequence = 0u;
-  return true;
-}
+// Which cats, dogs and bombs a host's delta sends to one client. One farther than the radius
+// from the client's interest cell, both now and in the baseline, stays at the client's copy
+// and costs one dirty bit. One that has come near since the baseline is sent even when it
+// has not changed, because the client's copy may be older than the baseline.
+struct NetInterest {
+  float center[2] = {0.0f, 0.0f};  // XZ center of the client's kNetInterestCell cell.
+  std::size_t culled = 0;  // Entities held back by the last encode.
+
+  static NetInterest ForPosition(const float (&pos)[3]) {
+    NetInterest interest;
+    interest.center[0] = (std::floor(pos[0] / kNetInterestCell) + 0.5f) * kNetInterestCell;
+    interest.center[1] = (std::floor(pos[2] / kNetInterestCell) + 0.5f) * kNetInterestCell;
+    return interest;
+  }
 
-static void ShutdownMultiplayer(MultiplayerState& state) {
-  if (state.socket != kInvalidSocketHandle) {
-    CloseSocketHandle(state.socket);
-    state.socket = kInvalidSocketHandle;
+  bool SameCell(const NetInterest& other) const {
+    return center[0] == other.center[0] && center[1] == other.center[1];
   }
-#ifdef _WIN32
-  if (state.wsaReady) {
-    WSACleanup();
-    state.wsaReady = false;
+
+  // The half diagonal keeps everything within the radius of any point in the cell.
+  bool Far(const float (&pos)[3]) const {
+    const float radius = kNetInterestRadius + kNetInterestCell * 0.70710678f;
+    const float dx = pos[0] - center[0];
+    const float dz = pos[2] - center[1];
+    return dx * dx + dz * dz > radius * radius;
   }
+};
+
+// One remote instance in the session: the host on a client, one client per slot on a host.
+struct NetPeer {
+  // A slot is claimed by storing the sender's address key (IPv4 << 16 | port, 0 while free)
+  // and then bumping the generation, which the main thread watches to reset its half.
+  // Clients and the host's configured peer are claimed by InitMultiplayer, the host's other
+  // slots by the receive thread when an unknown address sends to it.
+  std::atomic<std::uint64_t> addressKey{0u};
+  std::atomic<std::uint32_t> generation{0u};
+
+  // Main thread.
+  std::uint32_t seenGeneration = 0u;  // 0 until the slot is first claimed.
+  sockaddr_in addr{};
+  MultiplayerPacket latest{};
+  // `latest` with its moving entities resampled from the jitter buffer at the playout time.
+  MultiplayerPacket interpolated{};
+  bool hasRemote = false;
+  float lastReceiveTime = 0.0f;
+  // Jitter buffer, oldest first. Remote time is estimated as local tick + clockOffset and
+  // rendered playoutDelayTicks behind that, between the two bracketing snapshots.
+  FixedRing<RemoteSnapshotSample, 32> samples;
+  bool hasClockOffset = false;
+  double clockOffset = 0.0;
+  float jitterTicks = 0.0f;
+  float snapshotIntervalTicks = 0.0f;
+  float playoutDelayTicks = 0.0f;
+  std::uint32_t receivedCount = 0u;
+  std::uint32_t lostCount = 0u;
+  std::vector<InputCommand> newRemoteCommands;  // Peer commands first seen in the last poll, oldest first.
+  std::uint32_t lastRemoteCommand = 0u;
+  std::uint8_t useSerial = 0u;  // Item uses seen from this peer, relayed to the other clients.
+  std::uint8_t useItem = 0u;
+  // The relayed players each recent snapshot to this peer carried, by sequence %
+  // kSnapshotHistorySize. The rest of those snapshots is MultiplayerState::sentSnapshots.
+  struct SentPlayers {
+    std::uint32_t sequence = 0u;
+    std::vector<NetPlayerState> players;
+  };
+  std::vector<SentPlayers> sentPlayers;
+  std::size_t lastSnapshotBytes = 0;
+  std::size_t lastSnapshotFragments = 0;
+  std::size_t lastCulledEntities = 0;  // Entities held back by interest management.
+  bool hasRtt = false;
+  float rttMs = 0.0f;
+  std::uint32_t remoteSendTimeMs = 0u;  // Echoed back, plus the time held, in our next snapshot.
+  double remoteSendArrival = 0.0;
+
+  // Receive thread, apart from the atomics.
+  std::vector<MultiplayerPacket> receivedSnapshots;
+  FragmentAssembly assemblies[kFragmentAssemblySlots];
+  bool hasSequence = false;
+  std::uint32_t lastRemoteSequence = 0u;
+  double lastArrival = 0.0;
+  std::atomic<std::uint32_t> remoteAckSequence{0u};  // Newest remote sequence decoded; echoed as our ack.
+  std::atomic<std::uint32_t> peerAckedSequence{0u};  // Newest of our sequences the peer has decoded.
+};
+
+struct MultiplayerState {
+  bool active = false;
+  bool requested = false;
+  bool host = false;
+#ifdef _WIN32
+  bool wsaReady = false;
 #endif
-  state.active = false;
+  SocketHandle socket = kInvalidSocketHandle;
+  // Every slot exists for the whole session so the receive thread can claim one in place.
+  std::vector<NetPeer> peers = std::vector<NetPeer>(kMaxNetPeers);
+  // Main-thread scratch reused every poll and send so snapshot vectors keep their capacity.
+  SnapshotRing::Entry inboxEntry;
+  MultiplayerPacket outgoing{};  // The world snapshot every peer is sent this tick.
+  // One sequence for every peer, so the world snapshots sent each tick are stored once, by
+  // sequence % kSnapshotHistorySize, as the delta baselines of every peer that acks them.
+  std::uint32_t sendSequence = 0u;
+  std::vector<MultiplayerPacket> sentSnapshots;
+  // This tick's world parts: [0] is the full one, then one per distinct baseline and
+  // interest cell, so a send costs one world encode per group of peers rather than per peer.
+  struct WorldEncoding {
+    std::uint32_t baselineSequence = 0u;
+    bool hasInterest = false;
+    NetInterest interest;
+    std::vector<std::uint8_t> bytes;
+    std::size_t size = 0;
+    std::uint32_t sectionBits[kNetSectionCount] = {};
+  };
+  std::vector<WorldEncoding> worldEncodings;
+  std::size_t worldEncodingCount = 0;
+  std::vector<std::uint8_t> peerEncoding;  // The header and per-peer part for one peer.
+  MultiplayerPacket peerBaseline{};  // The relayed players one peer's part is coded against.
+  // Set from the loaded world before InitMultiplayer and left alone while a session runs,
+  // since the receive thread decodes with it.
+  NetPositionRange positionRange;
+  std::size_t lastFullSnapshotBytes = 0;  // The full world part.
+  NetStats stats;
+
+  // Receive thread. It owns the peers' receive halves; the rest is atomics and the ring.
+  std::thread receiveThread;
+  std::atomic<bool> receiveRunning{false};
+  SnapshotRing inbox;
+  std::atomic<std::uint32_t> droppedPackets{0u};  // Decoded packets lost to a full inbox.
+  std::atomic<std::uint64_t> packetsReceived{0u};
+  std::atomic<std::uint64_t> bytesReceived{0u};
+  std::atomic<std::uint64_t> staleReceived{0u};  // Duplicates, and fragments or snapshots past kNetReorderWindow.
+};
+
+static bool PeerIsFresh(const NetPeer& peer, float now) {
+  return peer.hasRemote && (now - peer.lastReceiveTime) < kNetPeerFreshSeconds;
 }
 
-static void PollMultiplayer(MultiplayerState& state, float currentTime) {
-  if (!state.active || state.socket == kInvalidSocketHandle) {
-    return;
+static std::uint64_t NetAddressKey(const sockaddr_in& address) {
+  return (static_cast<std::uint64_t>(ntohl(address.sin_addr.s_addr)) << 16) | ntohs(address.sin_port);
+}
+
+static sockaddr_in NetAddressFromKey(std::uint64_t key) {
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(static_cast<std::uint32_t>(key >> 16));
+  address.sin_port = htons(static_cast<std::uint16_t>(key & 0xFFFFu));
+  return address;
+}
+
+static constexpr float kNetVelocityMax = 48.0f;
+static constexpr float kNetTimerMax = 32.0f;
+// Common period of every walk-cycle harmonic the rigs use (x1, x1.45, x1.6, x2).
+static constexpr float kNetWalkCyclePeriod = 40.0f * 3.14159265f;
+
+struct SnapshotStream {
+  bool writing = true;
+  std::uint8_t* data = nullptr;
+  std::size_t capacity = 0;
+  std::size_t bytePos = 0;
+  std::uint64_t scratch = 0u;
+  int scratchBits = 0;
+  bool overflow = false;
+  NetPositionRange positionRange;  // Snapshot streams take MultiplayerState's.
+
+  static SnapshotStream Writer(std::uint8_t* buffer, std::size_t capacity) {
+    SnapshotStream stream;
+    stream.data = buffer;
+    stream.capacity = capacity;
+    return stream;
   }
 
-  while (true) {
-    MultiplayerPacket packet{};
-    sockaddr_in from{};
-#ifdef _WIN32
-    int fromLen = sizeof(from);
-#else
-    socklen_t fromLen = sizeof(from);
-#endif
-    const int bytes = recvfrom(state.socket,
-                               reinterpret_cast<char*>(&packet),
-                               static_cast<int>(sizeof(packet)),
-                               0,
-                               reinterpret_cast<sockaddr*>(&from),
-                               &fromLen);
-    if (bytes < 0) {
-      if (IsWouldBlockError()) {
-        break;
-      }
-      break;
-    }
+  static SnapshotStream Reader(std::uint8_t* buffer, std::size_t size) {
+    SnapshotStream stream = Writer(buffer, size);
+    stream.writing = false;
+    return stream;
+  }
 
-    if (bytes == static_cast<int>(sizeof(MultiplayerPacket)) &&
-        packet.magic == 0x56425033u &&
-        packet.version == 1u) {
-      if (state.hasSequence) {
-        const std::int32_t sequenceDelta = static_cast<std::int32_t>(packet.sequence - state.lastRemoteSequence);
-        if (sequenceDelta <= 0) {
-          continue;
+  void Bits(std::uint32_t& value, int bits) {
+    const std::uint64_t mask = (bits >= 32) ? 0xFFFFFFFFull : ((1ull << bits) - 1ull);
+    if (writing) {
+      scratch |= (static_cast<std::uint64_t>(value) & mask) << scratchBits;
+      scratchBits += bits;
+      while (scratchBits >= 8) {
+        if (bytePos >= capacity) {
+          overflow = true;
+          return;
         }
+        data[bytePos++] = static_cast<std::uint8_t>(scratch & 0xFFu);
+        scratch >>= 8;
+        scratchBits -= 8;
+      }
+      return;
+    }
+    while (scratchBits < bits) {
+      if (bytePos >= capacity) {
+        overflow = true;
+        value = 0u;
+        return;
       }
-      state.previous = state.latest;
-      state.previousReceiveTime = state.lastReceiveTime;
-      state.latest = packet;
-      state.hasRemote = true;
-      state.hasSequence = true;
-      state.lastRemoteSequence = packet.sequence;
-      state.lastReceiveTime = currentTime;
+      scratch |= static_cast<std::uint64_t>(data[bytePos++]) << scratchBits;
+      scratchBits += 8;
     }
+    value = static_cast<std::uint32_t>(scratch & mask);
+    scratch >>= bits;
+    scratchBits -= bits;
   }
-}
 
-static bool LoadSettings(SettingsProfile& settings) {
-  std::ifstream file(kSettingsFile);
-  if (!file) {
-    return false;
+  // Moves to the next byte boundary, so a byte-aligned block can follow or be skipped.
+  void Align() {
+    if (writing) {
+      Finish();
+    } else {
+      scratch = 0u;
+      scratchBits = 0;
+    }
   }
 
-  auto ParseBool = [](const std::string& v, bool fallback) {
-    if (v == "1" || v == "true" || v == "TRUE") {
-      return true;
+  // Bits written or read so far.
+  std::size_t BitPosition() const { return writing ? bytePos * 8 + scratchBits : bytePos * 8 - scratchBits; }
+
+  // Pads the last partial byte; returns the encoded size.
+  std::size_t Finish() {
+    if (writing && scratchBits > 0) {
+      std::uint32_t pad = 0u;
+      Bits(pad, 8 - scratchBits);
     }
-    if (v == "0" || v == "false" || v == "FALSE") {
-      return false;
+    return bytePos;
+  }
+
+  template <typename T>
+  void Integer(T& value, int bits) {
+    std::uint32_t raw = static_cast<std::uint32_t>(value);
+    if (writing) {
+      raw = std::min<std::uint32_t>(raw, (bits >= 32) ? 0xFFFFFFFFu : ((1u << bits) - 1u));
     }
-    return fallback;
-  };
+    Bits(raw, bits);
+    value = static_cast<T>(raw);
+  }
 
-  auto ParseFloat = [](const std::string& v, float fallback) {
-    try {
-      return std::stof(v);
-    } catch (...) {
-      return fallback;
+  // Writers round-trip the value in place so the sender keeps exactly what the peer decodes.
+  void Quantized(float& value, float minValue, float maxValue, int bits) {
+    const float steps = static_cast<float>((1u << bits) - 1u);
+    std::uint32_t q = 0u;
+    if (writing) {
+      const float t = (glm::clamp(value, minValue, maxValue) - minValue) / (maxValue - minValue);
+      q = static_cast<std::uint32_t>(std::lround(t * steps));
     }
-  };
+    Bits(q, bits);
+    value = minValue + (static_cast<float>(q) / steps) * (maxValue - minValue);
+  }
 
-  auto ParseInt = [](const std::string& v, int fallback) {
-    try {
-      return std::stoi(v);
-    } catch (...) {
-      return fallback;
+  void Angle(float& radians, int bits) {
+    if (writing) {
+      radians = std::remainder(radians, 2.0f * 3.14159265f);
     }
-  };
+    Quantized(radians, -3.14159265f, 3.14159265f, bits);
+  }
 
-  std::string line;
-  while (std::getline(file, line)) {
-    const std::size_t sep = line.find('=');
-    if (sep == std::string::npos) {
-      continue;
+  // Wraps modulo the period so the top code never aliases zero.
+  void WalkCycle(float& cycle) {
+    std::uint32_t q = 0u;
+    if (writing) {
+      float wrapped = std::fmod(cycle, kNetWalkCyclePeriod);
+      if (wrapped < 0.0f) {
+        wrapped += kNetWalkCyclePeriod;
+      }
+      q = static_cast<std::uint32_t>(std::lround(wrapped / kNetWalkCyclePeriod * 65536.0f)) & 0xFFFFu;
     }
-    const std::string key = line.substr(0, sep);
-    const std::string value = line.substr(sep + 1);
-
-    if (key == "uiScale") settings.uiScale = ParseFloat(value, settings.uiScale);
-    else if (key == "mouseSensitivity") settings.mouseSensitivity = ParseFloat(value, settings.mouseSensitivity);
-    else if (key == "musicVolume") settings.musicVolume = ParseFloat(value, settings.musicVolume);
-    else if (key == "sfxVolume") settings.sfxVolume = ParseFloat(value, settings.sfxVolume);
-    else if (key == "cameraDistance") settings.cameraDistance = ParseFloat(value, settings.cameraDistance);
-    else if (key == "difficulty") settings.difficulty = ParseInt(value, settings.difficulty);
-    else if (key == "invertLookY") settings.invertLookY = ParseBool(value, settings.invertLookY);
-    else if (key == "showDebugHud") settings.showDebugHud = ParseBool(value, settings.showDebugHud);
-    else if (key == "showMultiplayerWindow") settings.showMultiplayerWindow = ParseBool(value, settings.showMultiplayerWindow);
-    else if (key == "highContrastHud") settings.highContrastHud = ParseBool(value, settings.highContrastHud);
-    else if (key == "key_forward") settings.keys.forward = ParseInt(value, settings.keys.forward);
-    else if (key == "key_backward") settings.keys.backward = ParseInt(value, settings.keys.backward);
-    else if (key == "key_left") settings.keys.left = ParseInt(value, settings.keys.left);
-    else if (key == "key_right") settings.keys.right = ParseInt(value, settings.keys.right);
-    else if (key == "key_jump") settings.keys.jump = ParseInt(value, settings.keys.jump);
-    else if (key == "key_sprint") settings.keys.sprint = ParseInt(value, settings.keys.sprint);
-    else if (key == "key_pauseA") settings.keys.pauseA = ParseInt(value, settings.keys.pauseA);
-    else if (key == "key_pauseB") settings.keys.pauseB = ParseInt(value, settings.keys.pauseB);
+    Bits(q, 16);
+    cycle = (static_cast<float>(q) / 65536.0f) * kNetWalkCyclePeriod;
   }
 
-  settings.uiScale = glm::clamp(settings.uiScale, 0.85f, 2.8f);
-  settings.mouseSensitivity = glm::clamp(settings.mouseSensitivity, 0.0015f, 0.02f);
-  settings.musicVolume = glm::clamp(settings.musicVolume, 0.0f, 1.0f);
-  settings.sfxVolume = glm::clamp(settings.sfxVolume, 0.0f, 1.0f);
-  settings.cameraDistance = glm::clamp(settings.cameraDistance, 3.0f, 10.0f);
-  settings.difficulty = glm::clamp(settings.difficulty, 0, 2);
-  return true;
-}
+  void Timer(float& seconds) { Quantized(seconds, 0.0f, kNetTimerMax, 16); }
 
-static void SaveSettings(const SettingsProfile& settings) {
-  std::ofstream file(kSettingsFile, std::ios::trunc);
-  if (!file) {
-    return;
+  void Position(float (&v)[3]) {
+    for (int axis = 0; axis < 3; ++axis) {
+      Quantized(v[axis], positionRange.min[axis], positionRange.max[axis], 16);
+    }
   }
-  file << "uiScale=" << settings.uiScale << "\n";
-  file << "mouseSensitivity=" << settings.mouseSensitivity << "\n";
-  file << "musicVolume=" << settings.musicVolume << "\n";
-  file << "sfxVolume=" << settings.sfxVolume << "\n";
-  file << "cameraDistance=" << settings.cameraDistance << "\n";
-  file << "difficulty=" << settings.difficulty << "\n";
-  file << "invertLookY=" << (settings.invertLookY ? 1 : 0) << "\n";
-  file << "showDebugHud=" << (settings.showDebugHud ? 1 : 0) << "\n";
-  file << "showMultiplayerWindow=" << (settings.showMultiplayerWindow ? 1 : 0) << "\n";
-  file << "highContrastHud=" << (settings.highContrastHud ? 1 : 0) << "\n";
-  file << "key_forward=" << settings.keys.forward << "\n";
-  file << "key_backward=" << settings.keys.backward << "\n";
-  file << "key_left=" << settings.keys.left << "\n";
-  file << "key_right=" << settings.keys.right << "\n";
-  file << "key_jump=" << settings.keys.jump << "\n";
-  file << "key_sprint=" << settings.keys.sprint << "\n";
-  file << "key_pauseA=" << settings.keys.pauseA << "\n";
-  file << "key_pauseB=" << settings.keys.pauseB << "\n";
-}
 
-static void PushFrameSample(PerformanceHistory& perf, float frameMs) {
-  perf.emaFrameMs = glm::mix(perf.emaFrameMs, frameMs, 0.08f);
-  perf.frameMs.push_back(frameMs);
-  while (perf.frameMs.size() > 240) {
-    perf.frameMs.pop_front();
+  void Velocity(float (&v)[3]) {
+    for (float& axis : v) {
+      Quantized(axis, -kNetVelocityMax, kNetVelocityMax, 16);
+    }
   }
-}
 
-static void SendMultiplayerSnapshot(MultiplayerState& state,
-                                    const glm::vec3& position,
-                                    const glm::vec3& velocity,
-                                    float facing,
-                                    std::uint32_t inputActions,
-                                    std::uint16_t level,
-                                    bool isAuthority,
-                                    bool hasWon,
-                                    bool isDead,
-                                    std::uint32_t catsMask,
-                                    std::uint32_t dogsMask,
-                                    const Enemy& clown,
-                                    float clownFacing,
-                                    float clownWalkCycle,
-                                    const Enemy& mummy,
-                                    float mummyFacing,
-                                    float mummyWalkCycle,
-                                    float mummyThrowCooldown,
-                                    const std::vector<Cat>& cats,
-                                    const std::vector<Dog>& dogs,
-                                    const std::vector<Bomb>& bombs,
-                                    const std::vector<Explosion>& explosions,
-                                    const std::vector<WorldItem>& worldItems,
-                                    ItemType heldItem,
-                                    int heldCharges,
-                                    bool clownAlive,
-                                    float clownRespawnTimer,
-                                    float clownStunTimer,
-                                    bool mummyAlive,
-                                    float mummyRespawnTimer,
-                                    float mummyStunTimer,
-                                    int collected,
-                                    int lives) {
-  if (!state.active || state.socket == kInvalidSocketHandle) {
-    return;
+  void Flags(std::vector<bool>& flags, std::size_t count) {
+    if (writing) {
+      flags.resize(count, false);
+    } else {
+      flags.assign(count, false);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      std::uint32_t bit = flags[i] ? 1u : 0u;
+      Bits(bit, 1);
+      flags[i] = bit != 0u;
+    }
   }
 
-  MultiplayerPacket packet{};
-  packet.sequence = ++state.sendSequence;
-  packet.level = level;
-  packet.flags = (hasWon ? kNetFlagWon : 0u) |
-                 (isDead ? kNetFlagDead : 0u) |
-                 (isAuthority ? kNetFlagAuthority : 0u);
-  packet.catsMask = catsMask;
-  packet.dogsMask = dogsMask;
-  packet.collected = collected;
-  packet.lives = lives;
-  packet.pos[0] = position.x;
-  packet.pos[1] = position.y;
-  packet.pos[2] = position.z;
-  packet.vel[0] = velocity.x;
-  packet.vel[1] = velocity.y;
-  packet.vel[2] = velocity.z;
-  packet.facing = facing;
-  packet.inputActions = inputActions;
-  PackWorldEntities(packet,
-                    clown,
-                    clownFacing,
-                    clownWalkCycle,
-                    mummy,
-                    mummyFacing,
-                    mummyWalkCycle,
-                    mummyThrowCooldown,
-                    cats,
-                    dogs,
-                    bombs,
-                    explosions,
-                    worldItems,
-                    heldItem,
-                    heldCharges,
-                    clownAlive,
-                    clownRespawnTimer,
-                    clownStunTimer,
-                    mummyAlive,
-                    mummyRespawnTimer,
-                    mummyStunTimer);
+  void RawFloat(float& value) {
+    std::uint32_t raw = 0u;
+    std::memcpy(&raw, &value, sizeof(raw));
+    Bits(raw, 32);
+    std::memcpy(&value, &raw, sizeof(raw));
+  }
+};
 
-  sendto(state.socket,
-         reinterpret_cast<const char*>(&packet),
-         static_cast<int>(sizeof(packet)),
-         0,
-         reinterpret_cast<const sockaddr*>(&state.peerAddr),
-         sizeof(state.peerAddr));
+static bool FloatsDiffer(const float* a, const float* b, std::size_t count) {
+  return std::memcmp(a, b, count * sizeof(float)) != 0;
 }
 
-static std::string ReadFile(const std::string& path) {
-  std::ifstream file(path, std::ios::in | std::ios::binary);
-  if (!file) {
-    std::cerr << "Failed to open file: " << path << "\n";
-    return "";
-  }
-  std::ostringstream contents;
-  contents << file.rdbuf();
-  return contents.str();
+static void SerializeSnapshotHeader(SnapshotStream& stream, MultiplayerPacket& packet, std::uint32_t& baselineSequence) {
+  stream.Integer(packet.magic, 32);
+  stream.Integer(packet.version, 8);
+  stream.Integer(packet.sequence, 32);
+  stream.Integer(baselineSequence, 32);
+  stream.Integer(packet.ackSequence, 32);
+  stream.Integer(packet.simTick, 32);
+  stream.Integer(packet.sendTimeMs, 32);
+  stream.Integer(packet.echoTimeMs, 32);
 }
 
-struct Sound {
-  std::vector<float> samples;
-  ma_audio_buffer buffer{};
-  ma_sound sound{};
+// A snapshot is the header and the per-peer part (the sender's player and the players a host
+// relays), then the world part on a byte boundary. Hosts encode the world part once per
+// baseline and interest cell and send the same bytes to every client that shares both.
+enum class SnapshotPart : std::uint8_t {
+  Players = 0x1u,
+  World = 0x2u,
+  All = 0x3u,
 };
 
-struct AudioState {
-  ma_engine engine{};
-  bool ready = false;
-  Sound footstep;
-  Sound jump;
-  Sound land;
-  Sound ambient;
-  Sound chase;
-  Sound explosion;
-  Sound hurt;
-};
+// sectionBits, when given, receives the encoded size of each NetSection, the header included.
+// Readers always decode SnapshotPart::All; interest only applies to writers of the world part.
+static void SerializeSnapshotBody(SnapshotStream& stream,
+                                  MultiplayerPacket& packet,
+                                  const MultiplayerPacket& baseline,
+                                  std::uint32_t* sectionBits = nullptr,
+                                  SnapshotPart part = SnapshotPart::All,
+                                  NetInterest* interest = nullptr) {
+  const bool players = (static_cast<std::uint8_t>(part) & static_cast<std::uint8_t>(SnapshotPart::Players)) != 0u;
+  const bool world = (static_cast<std::uint8_t>(part) & static_cast<std::uint8_t>(SnapshotPart::World)) != 0u;
+  if (!stream.writing) {
+    MultiplayerPacket header = packet;
+    packet = baseline;
+    packet.magic = header.magic;
+    packet.version = header.version;
+    packet.sequence = header.sequence;
+    packet.ackSequence = header.ackSequence;
+    packet.simTick = header.simTick;
+    packet.sendTimeMs = header.sendTimeMs;
+    packet.echoTimeMs = header.echoTimeMs;
+  }
 
-static float RandomFloat(unsigned int& seed) {
-  seed = seed * 1664525u + 1013904223u;
-  return static_cast<float>((seed >> 8) & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
-}
+  std::size_t sectionStart = stream.BitPosition();
+  auto EndSection = [&](NetSection section) {
+    const std::size_t position = stream.BitPosition();
+    if (sectionBits) {
+      sectionBits[static_cast<int>(section)] = static_cast<std::uint32_t>(position - sectionStart);
+    }
+    sectionStart = position;
+  };
+  if (players) {
+    sectionStart = 0;
+    EndSection(NetSection::Header);
+  }
 
-static std::vector<float> GenerateFootstep(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.08f);
-  std::vector<float> data(frames);
-  unsigned int seed = 1337u;
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(frames);
-    const float env = std::exp(-t * 8.0f);
-    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.4f;
-    const float tone = std::sin(2.0f * 3.14159f * 110.0f * t) * 0.25f;
-    data[i] = (noise + tone) * env;
+  // Entities equal to the baseline are skipped; readers keep the baseline copy. Entities
+  // past the end of the baseline section are compared against a default entry.
+  auto DirtyArray = [&](std::size_t count, auto&& differs, auto&& serializeEntity) {
+    for (std::size_t i = 0; i < count; ++i) {
+      std::uint32_t dirty = (stream.writing && differs(i)) ? 1u : 0u;
+      stream.Bits(dirty, 1);
+      if (dirty != 0u) {
+        serializeEntity(i);
+      }
+    }
+  };
+
+  // Variable-length section: a count, then DirtyArray over the entries. Culled sections
+  // apply the writer's interest to entries the baseline has.
+  auto Section = [&](auto& entries, const auto& baseEntries, auto&& differs, auto&& serializeEntity, bool culled = false) {
+    using Entry = typename std::decay_t<decltype(entries)>::value_type;
+    static const Entry kDefaultEntry{};
+    std::uint32_t count = static_cast<std::uint32_t>(entries.size());
+    stream.Integer(count, kNetSectionCountBits);
+    entries.resize(count);  // Writers only shrink here if the count was clamped to the field.
+    DirtyArray(entries.size(),
+               [&](std::size_t i) {
+                 if (i >= baseEntries.size()) {
+                   return differs(entries[i], kDefaultEntry);
+                 }
+                 if (culled && interest) {
+                   const bool farNow = interest->Far(entries[i].pos);
+                   if (farNow && interest->Far(baseEntries[i].pos)) {
+                     ++interest->culled;
+                     return false;
+                   }
+                   if (!farNow && interest->Far(baseEntries[i].pos)) {
+                     return true;
+                   }
+                 }
+                 return differs(entries[i], baseEntries[i]);
+               },
+               [&](std::size_t i) { serializeEntity(entries[i]); });
+  };
+
+  if (players) {
+    stream.Integer(packet.level, 8);
+    stream.Integer(packet.flags, 8);
+    stream.Integer(packet.collected, 16);
+    stream.Integer(packet.lives, 8);
+    stream.Position(packet.pos);
+    stream.Velocity(packet.vel);
+    stream.Angle(packet.facing, 10);
+    stream.Integer(packet.localHeldItemType, 8);
+    stream.Integer(packet.localHeldItemCharges, 8);
+    stream.Integer(packet.inputCommandCount, 4);
+    packet.inputCommandCount = std::min<std::uint8_t>(packet.inputCommandCount, kMaxPendingInputCommands);
+    for (std::size_t i = 0; i < packet.inputCommandCount; ++i) {
+      InputCommand& command = packet.inputCommands[i];
+      stream.Integer(command.sequence, 32);
+      stream.Integer(command.actions, 2);
+      stream.Integer(command.heldItem, 8);
+      stream.Position(command.pos);
+      stream.Angle(command.facing, 10);
+    }
+    stream.Integer(packet.ackedInputCommand, 32);
+    stream.Integer(packet.enemyAliveMask, 2);
+    for (int i = 0; i < 2; ++i) {
+      stream.Timer(packet.enemyRespawnTimer[i]);
+      stream.Timer(packet.enemyStunTimer[i]);
+    }
+    EndSection(NetSection::Player);
+
+    Section(packet.players, baseline.players,
+            [](const NetPlayerState& other, const NetPlayerState& base) {
+              return other.id != base.id || FloatsDiffer(other.pos, base.pos, 3) || FloatsDiffer(other.vel, base.vel, 3) ||
+                     other.facing != base.facing || other.heldItem != base.heldItem ||
+                     other.heldCharges != base.heldCharges || other.useSerial != base.useSerial ||
+                     other.useItem != base.useItem;
+            },
+            [&](NetPlayerState& other) {
+              stream.Integer(other.id, 4);
+              stream.Position(other.pos);
+              stream.Velocity(other.vel);
+              stream.Angle(other.facing, 10);
+              stream.Integer(other.heldItem, 8);
+              stream.Integer(other.heldCharges, 8);
+              stream.Integer(other.useSerial, 8);
+              stream.Integer(other.useItem, 8);
+            });
+    EndSection(NetSection::Others);
+  }
+  if (players && world) {
+    stream.Align();
   }
-  return data;
-}
 
-static std::vector<float> GenerateJump(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.2f);
-  std::vector<float> data(frames);
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(frames);
-    const float freq = 240.0f + t * 420.0f;
-    const float env = std::exp(-t * 4.0f);
-    data[i] = std::sin(2.0f * 3.14159f * freq * t) * env * 0.35f;
+  if (world) {
+    DirtyArray(1,
+               [&](std::size_t) {
+                 return FloatsDiffer(packet.clownPos, baseline.clownPos, 3) ||
+                        FloatsDiffer(packet.clownVel, baseline.clownVel, 3) ||
+                        packet.clownFacing != baseline.clownFacing ||
+                        packet.clownWalkCycle != baseline.clownWalkCycle ||
+                        packet.clownJumpCooldown != baseline.clownJumpCooldown;
+               },
+               [&](std::size_t) {
+                 stream.Position(packet.clownPos);
+                 stream.Velocity(packet.clownVel);
+                 stream.Angle(packet.clownFacing, 10);
+                 stream.WalkCycle(packet.clownWalkCycle);
+                 stream.Timer(packet.clownJumpCooldown);
+               });
+    DirtyArray(1,
+               [&](std::size_t) {
+                 return FloatsDiffer(packet.mummyPos, baseline.mummyPos, 3) ||
+                        FloatsDiffer(packet.mummyVel, baseline.mummyVel, 3) ||
+                        packet.mummyFacing != baseline.mummyFacing ||
+                        packet.mummyWalkCycle != baseline.mummyWalkCycle ||
+                        packet.mummyThrowCooldown != baseline.mummyThrowCooldown;
+               },
+               [&](std::size_t) {
+                 stream.Position(packet.mummyPos);
+                 stream.Velocity(packet.mummyVel);
+                 stream.Angle(packet.mummyFacing, 10);
+                 stream.WalkCycle(packet.mummyWalkCycle);
+                 stream.Timer(packet.mummyThrowCooldown);
+               });
+    EndSection(NetSection::Enemies);
+
+    Section(packet.cats, baseline.cats,
+            [](const NetCatState& cat, const NetCatState& base) {
+              return FloatsDiffer(cat.pos, base.pos, 3) || FloatsDiffer(cat.vel, base.vel, 3) ||
+                     cat.facing != base.facing || cat.walkCycle != base.walkCycle;
+            },
+            [&](NetCatState& cat) {
+              stream.Position(cat.pos);
+              stream.Velocity(cat.vel);
+              stream.Angle(cat.facing, 10);
+              stream.WalkCycle(cat.walkCycle);
+            },
+            true);
+    stream.Flags(packet.catsCollected, packet.cats.size());
+    EndSection(NetSection::Cats);
+
+    Section(packet.dogs, baseline.dogs,
+            [](const NetDogState& dog, const NetDogState& base) {
+              return FloatsDiffer(dog.pos, base.pos, 3) || FloatsDiffer(dog.vel, base.vel, 3) ||
+                     dog.facing != base.facing || dog.walkCycle != base.walkCycle ||
+                     dog.blastTimer != base.blastTimer;
+            },
+            [&](NetDogState& dog) {
+              stream.Position(dog.pos);
+              stream.Velocity(dog.vel);
+              stream.Angle(dog.facing, 10);
+              stream.WalkCycle(dog.walkCycle);
+              stream.Timer(dog.blastTimer);
+            },
+            true);
+    stream.Flags(packet.dogsCollected, packet.dogs.size());
+    EndSection(NetSection::Dogs);
+
+    Section(packet.bombs, baseline.bombs,
+            [](const NetBombState& bomb, const NetBombState& base) {
+              return FloatsDiffer(bomb.pos, base.pos, 3) || FloatsDiffer(bomb.vel, base.vel, 3) ||
+                     bomb.timer != base.timer;
+            },
+            [&](NetBombState& bomb) {
+              stream.Position(bomb.pos);
+              stream.Velocity(bomb.vel);
+              stream.Timer(bomb.timer);
+            },
+            true);
+    stream.Flags(packet.bombsActive, packet.bombs.size());
+    EndSection(NetSection::Bombs);
+
+    Section(packet.explosions, baseline.explosions,
+            [](const NetExplosionState& explosion, const NetExplosionState& base) {
+              return FloatsDiffer(explosion.pos, base.pos, 3) || explosion.age != base.age ||
+                     explosion.duration != base.duration || explosion.seed != base.seed;
+            },
+            [&](NetExplosionState& explosion) {
+              stream.Position(explosion.pos);
+              stream.Timer(explosion.age);
+              stream.Timer(explosion.duration);
+              stream.RawFloat(explosion.seed);
+            });
+    EndSection(NetSection::Explosions);
+
+    Section(packet.worldItems, baseline.worldItems,
+            [](const NetWorldItemState& item, const NetWorldItemState& base) {
+              return item.type != base.type || FloatsDiffer(item.pos, base.pos, 3);
+            },
+            [&](NetWorldItemState& item) {
+              stream.Integer(item.type, 8);
+              stream.Position(item.pos);
+            });
+    stream.Flags(packet.worldItemsActive, packet.worldItems.size());
+    EndSection(NetSection::Items);
   }
-  return data;
 }
 
-static std::vector<float> GenerateLand(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.12f);
-  std::vector<float> data(frames);
-  unsigned int seed = 999u;
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(frames);
-    const float env = std::exp(-t * 10.0f);
-    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.25f;
-    const float tone = std::sin(2.0f * 3.14159f * 80.0f * t) * 0.4f;
-    data[i] = (noise + tone) * env;
+static const MultiplayerPacket* FindSnapshot(const std::vector<MultiplayerPacket>& history, std::uint32_t sequence) {
+  if (history.empty() || sequence == 0u) {
+    return nullptr;
   }
-  return data;
+  const MultiplayerPacket& slot = history[sequence % history.size()];
+  return (slot.sequence == sequence) ? &slot : nullptr;
 }
 
-static std::vector<float> GenerateAmbient(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 4.0f);
-  std::vector<float> data(frames);
-  unsigned int seed = 4242u;
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
-    const float hum = std::sin(2.0f * 3.14159f * 55.0f * t) * 0.12f +
-                      std::sin(2.0f * 3.14159f * 110.0f * t) * 0.07f;
-    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.02f;
-    data[i] = hum + noise;
+static void StoreSnapshot(std::vector<MultiplayerPacket>& history, const MultiplayerPacket& packet) {
+  if (!history.empty()) {
+    history[packet.sequence % history.size()] = packet;
   }
-  return data;
 }
 
-static std::vector<float> GenerateChase(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.45f);
-  std::vector<float> data(frames);
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(frames);
-    const float freq = 160.0f + t * 260.0f;
-    const float env = std::exp(-t * 3.5f);
-    data[i] = std::sin(2.0f * 3.14159f * freq * t) * env * 0.5f;
+struct Enemy;
+struct Cat;
+struct Dog;
+struct AnimalBodies;
+struct Bomb;
+struct Explosion;
+struct WorldItem;
+enum class ItemType : std::uint8_t;
+
+static void PackWorldEntities(MultiplayerPacket& packet,
+                              const Enemy& clown,
+                              float clownFacing,
+                              float clownWalkCycle,
+                              const Enemy& mummy,
+                              float mummyFacing,
+                              float mummyWalkCycle,
+                              float mummyThrowCooldown,
+                              const std::vector<Cat>& cats,
+                              const AnimalBodies& catBodies,
+                              const std::vector<Dog>& dogs,
+                              const AnimalBodies& dogBodies,
+                              const ObjectPool<Bomb>& bombs,
+                              const ObjectPool<Explosion>& explosions,
+                              const std::vector<WorldItem>& worldItems,
+                              ItemType heldItem,
+                              int heldCharges,
+                              bool clownAlive,
+                              float clownRespawnTimer,
+                              float clownStunTimer,
+                              bool mummyAlive,
+                              float mummyRespawnTimer,
+                              float mummyStunTimer);
+
+static MultiplayerConfig ParseMultiplayerConfig(int argc, char** argv) {
+  MultiplayerConfig config;
+  int role = -1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--mp") {
+      config.enabled = true;
+    } else if (arg == "--mp-local-port" && (i + 1) < argc) {
+      config.enabled = true;
+      config.localPort = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--mp-peer-ip" && (i + 1) < argc) {
+      config.enabled = true;
+      config.peerIp = argv[++i];
+    } else if (arg == "--mp-peer-port" && (i + 1) < argc) {
+      config.enabled = true;
+      config.peerPort = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--mp-host" || arg == "--mp-client") {
+      config.enabled = true;
+      role = (arg == "--mp-host") ? 1 : 0;
+    }
   }
-  return data;
+  // Without an explicit role the instance on the lower port hosts.
+  config.host = (role >= 0) ? (role == 1) : (config.localPort <= config.peerPort);
+  return config;
 }
 
-static std::vector<float> GenerateExplosion(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.55f);
-  std::vector<float> data(frames);
-  unsigned int seed = 31337u;
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
-    const float env = std::exp(-t * 8.2f);
-    const float low = std::sin(2.0f * 3.14159f * (42.0f + t * 35.0f) * t) * 0.7f;
-    const float crack = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 16.0f) * 0.6f;
-    const float hiss = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 5.0f) * 0.18f;
-    data[i] = (low + crack + hiss) * env;
+static HeadlessConfig ParseHeadlessConfig(int argc, char** argv) {
+  HeadlessConfig config;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--headless") {
+      config.enabled = true;
+    } else if (arg == "--steps" && (i + 1) < argc) {
+      config.steps = static_cast<std::uint32_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--level" && (i + 1) < argc) {
+      config.level = std::clamp(std::atoi(argv[++i]), 1, 2);
+    } else if (arg == "--cats" && (i + 1) < argc) {
+      config.cats = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--dogs" && (i + 1) < argc) {
+      config.dogs = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--bombs" && (i + 1) < argc) {
+      config.bombs = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--seed" && (i + 1) < argc) {
+      config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    }
   }
-  return data;
+  return config;
 }
 
-static std::vector<float> GenerateHurt(int sampleRate) {
-  const int frames = static_cast<int>(sampleRate * 0.16f);
-  std::vector<float> data(frames);
-  unsigned int seed = 7707u;
-  for (int i = 0; i < frames; ++i) {
-    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
-    const float env = std::exp(-t * 18.0f);
-    const float tone = std::sin(2.0f * 3.14159f * (290.0f - t * 140.0f) * t) * 0.45f;
-    const float grit = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 26.0f) * 0.25f;
-    data[i] = (tone + grit) * env;
+static ReplayConfig ParseReplayConfig(int argc, char** argv) {
+  ReplayConfig config;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--record" && (i + 1) < argc) {
+      config.recordPath = argv[++i];
+    } else if (arg == "--replay" && (i + 1) < argc) {
+      config.replayPath = argv[++i];
+    }
   }
-  return data;
+  return config;
 }
 
-static bool CreateSound(ma_engine& engine, Sound& sound, std::vector<float>&& samples, bool loop) {
-  sound.samples = std::move(samples);
-  ma_audio_buffer_config config = ma_audio_buffer_config_init(
-      ma_format_f32, 1, static_cast<ma_uint32>(sound.samples.size()), sound.samples.data(), nullptr);
-  if (ma_audio_buffer_init(&config, &sound.buffer) != MA_SUCCESS) {
-    return false;
-  }
-  if (ma_sound_init_from_data_source(&engine, &sound.buffer, MA_SOUND_FLAG_NO_SPATIALIZATION, nullptr, &sound.sound) != MA_SUCCESS) {
+static FrameInput ReadFrameInput(GLFWwindow* window, const InputBindings& bindings) {
+  FrameInput input;
+  input.forward = glfwGetKey(window, bindings.forward) == GLFW_PRESS;
+  input.backward = glfwGetKey(window, bindings.backward) == GLFW_PRESS;
+  input.left = glfwGetKey(window, bindings.left) == GLFW_PRESS;
+  input.right = glfwGetKey(window, bindings.right) == GLFW_PRESS;
+  input.jump = glfwGetKey(window, bindings.jump) == GLFW_PRESS;
+  input.sprint = glfwGetKey(window, bindings.sprint) == GLFW_PRESS;
+  input.pauseA = glfwGetKey(window, bindings.pauseA) == GLFW_PRESS;
+  input.pauseB = glfwGetKey(window, bindings.pauseB) == GLFW_PRESS;
+  input.useItem = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+  input.dropItem = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+  input.orbit = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+  glfwGetCursorPos(window, &input.cursorX, &input.cursorY);
+  return input;
+}
+
+static bool SetSocketNonBlocking(SocketHandle socket) {
+#ifdef _WIN32
+  u_long mode = 1;
+  return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+  const int flags = fcntl(socket, F_GETFL, 0);
+  if (flags < 0) {
     return false;
   }
-  ma_sound_set_looping(&sound.sound, loop ? MA_TRUE : MA_FALSE);
-  return true;
+  return fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
 }
 
-static void PlaySound(Sound& sound) {
-  ma_sound_seek_to_pcm_frame(&sound.sound, 0);
-  ma_sound_start(&sound.sound);
+static void CloseSocketHandle(SocketHandle socket) {
+#ifdef _WIN32
+  closesocket(socket);
+#else
+  close(socket);
+#endif
 }
 
-struct Shader {
-  GLuint id = 0;
-
-  bool Load(const std::string& vertPath, const std::string& fragPath) {
-    const std::string vertSrc = ReadFile(vertPath);
-    const std::string fragSrc = ReadFile(fragPath);
-    if (vertSrc.empty() || fragSrc.empty()) {
-      return false;
-    }
+static bool IsWouldBlockError() {
+#ifdef _WIN32
+  const int err = WSAGetLastError();
+  return err == WSAEWOULDBLOCK;
+#else
+  return errno == EWOULDBLOCK || errno == EAGAIN;
+#endif
+}
 
-    const char* vertCStr = vertSrc.c_str();
-    const char* fragCStr = fragSrc.c_str();
+// Whether a snapshot is still worth decoding: newer than any decoded so far, or a late one
+// inside kNetReorderWindow that has not been decoded yet. Receive thread.
+static bool WantsSnapshot(const NetPeer& peer, std::uint32_t sequence) {
+  if (!peer.hasSequence) {
+    return true;
+  }
+  const std::int32_t sequenceDelta = static_cast<std::int32_t>(sequence - peer.lastRemoteSequence);
+  if (sequenceDelta > 0) {
+    return true;
+  }
+  return sequenceDelta > -kNetReorderWindow && !FindSnapshot(peer.receivedSnapshots, sequence);
+}
 
-    GLuint vert = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vert, 1, &vertCStr, nullptr);
-    glCompileShader(vert);
+// Decodes one reassembled snapshot against the peer's received baselines and publishes it.
+// A late one is published too but leaves the newest sequence and the acks alone. Runs on
+// the receive thread.
+static void DecodeSnapshot(MultiplayerState* state,
+                           std::size_t peerIndex,
+                           std::uint8_t* data,
+                           std::size_t size,
+                           double arrivalTime) {
+  static const MultiplayerPacket kEmptySnapshot{};
+  NetPeer& peer = state->peers[peerIndex];
+  SnapshotStream stream = SnapshotStream::Reader(data, size);
+  stream.positionRange = state->positionRange;
+  SnapshotRing::Entry entry;
+  MultiplayerPacket& packet = entry.packet;
+  std::uint32_t baselineSequence = 0u;
+  SerializeSnapshotHeader(stream, packet, baselineSequence);
+  if (stream.overflow ||
+      packet.magic != 0x56425033u ||
+      packet.version != kEmptySnapshot.version) {
+    return;
+  }
+  if (!WantsSnapshot(peer, packet.sequence)) {
+    state->staleReceived.fetch_add(1u, std::memory_order_relaxed);
+    return;
+  }
+  const MultiplayerPacket* baseline = &kEmptySnapshot;
+  if (baselineSequence != 0u) {
+    baseline = FindSnapshot(peer.receivedSnapshots, baselineSequence);
+    if (!baseline) {
+      return;
+    }
+  }
+  SerializeSnapshotBody(stream, packet, *baseline);
+  if (stream.overflow) {
+    return;
+  }
+  StoreSnapshot(peer.receivedSnapshots, packet);
+  if (!peer.hasSequence || static_cast<std::int32_t>(packet.sequence - peer.lastRemoteSequence) > 0) {
+    peer.hasSequence = true;
+    peer.lastRemoteSequence = packet.sequence;
+    peer.remoteAckSequence.store(packet.sequence, std::memory_order_relaxed);
+    peer.peerAckedSequence.store(packet.ackSequence, std::memory_order_relaxed);
+  }
+  entry.arrivalTime = arrivalTime;
+  entry.peer = static_cast<std::uint8_t>(peerIndex);
+  entry.generation = peer.generation.load(std::memory_order_relaxed);
+  if (!state->inbox.Push(entry)) {
+    state->droppedPackets.fetch_add(1u, std::memory_order_relaxed);
+  }
+}
 
-    GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag, 1, &fragCStr, nullptr);
-    glCompileShader(frag);
+// Resets the receive thread's half of a peer slot and publishes its new address.
+static void ClaimNetPeer(NetPeer& peer, std::uint64_t addressKey, double now) {
+  for (MultiplayerPacket& snapshot : peer.receivedSnapshots) {
+    snapshot.sequence = 0u;
+  }
+  for (FragmentAssembly& assembly : peer.assemblies) {
+    assembly.receivedMask = 0u;
+    assembly.fragmentCount = 0u;
+  }
+  peer.hasSequence = false;
+  peer.lastRemoteSequence = 0u;
+  peer.lastArrival = now;
+  peer.remoteAckSequence.store(0u, std::memory_order_relaxed);
+  peer.peerAckedSequence.store(0u, std::memory_order_relaxed);
+  peer.addressKey.store(addressKey, std::memory_order_relaxed);
+  peer.generation.fetch_add(1u, std::memory_order_release);
+}
 
-    GLint success = 0;
-    glGetShaderiv(vert, GL_COMPILE_STATUS, &success);
-    if (!success) {
-      char log[512] = {};
-      glGetShaderInfoLog(vert, sizeof(log), nullptr, log);
-      std::cerr << "Vertex shader error: " << log << "\n";
-      return false;
+// The slot datagrams from `from` belong to. A host gives an unknown sender a free slot, or
+// the one quiet longest once it has timed out; a client only hears its host.
+static NetPeer* FindNetPeer(MultiplayerState* state, const sockaddr_in& from, double now, std::size_t& index) {
+  const std::uint64_t key = NetAddressKey(from);
+  for (std::size_t i = 0; i < state->peers.size(); ++i) {
+    if (state->peers[i].addressKey.load(std::memory_order_relaxed) == key) {
+      index = i;
+      return &state->peers[i];
+    }
+  }
+  if (!state->host) {
+    return nullptr;
+  }
+  std::size_t oldest = state->peers.size();
+  for (std::size_t i = 0; i < state->peers.size(); ++i) {
+    const NetPeer& peer = state->peers[i];
+    if (peer.addressKey.load(std::memory_order_relaxed) == 0u) {
+      oldest = i;
+      break;
     }
+    if (now - peer.lastArrival > kNetPeerTimeout &&
+        (oldest == state->peers.size() || peer.lastArrival < state->peers[oldest].lastArrival)) {
+      oldest = i;
+    }
+  }
+  if (oldest == state->peers.size()) {
+    return nullptr;
+  }
+  ClaimNetPeer(state->peers[oldest], key, now);
+  index = oldest;
+  return &state->peers[oldest];
+}
 
-    glGetShaderiv(frag, GL_COMPILE_STATUS, &success);
-    if (!success) {
-      char log[512] = {};
-      glGetShaderInfoLog(frag, sizeof(log), nullptr, log);
-      std::cerr << "Fragment shader error: " << log << "\n";
-      return false;
+// Multiplayer thread body: waits on the socket, reassembles fragmented snapshots and
+// decodes each complete one, stamped with the arrival time of its last fragment.
+static void ReceiveMultiplayerPackets(MultiplayerState* state) {
+  std::uint8_t buffer[kNetFragmentHeaderBytes + kNetFragmentPayloadBytes];
+  while (state->receiveRunning.load(std::memory_order_acquire)) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(state->socket, &readSet);
+    timeval timeout{};
+    timeout.tv_usec = 50000;  // Bounds how long shutdown waits for the join.
+    if (select(static_cast<int>(state->socket) + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+      continue;
     }
 
-    id = glCreateProgram();
-    glAttachShader(id, vert);
-    glAttachShader(id, frag);
-    glLinkProgram(id);
+    while (true) {
+      sockaddr_in from{};
+#ifdef _WIN32
+      int fromLen = sizeof(from);
+#else
+      socklen_t fromLen = sizeof(from);
+#endif
+      const int bytes = recvfrom(state->socket,
+                                 reinterpret_cast<char*>(buffer),
+                                 static_cast<int>(sizeof(buffer)),
+                                 0,
+                                 reinterpret_cast<sockaddr*>(&from),
+                                 &fromLen);
+      if (bytes < 0) {
+        if (IsWouldBlockError()) {
+          break;
+        }
+        break;
+      }
+      const double arrivalTime = glfwGetTime();
+      state->packetsReceived.fetch_add(1u, std::memory_order_relaxed);
+      state->bytesReceived.fetch_add(static_cast<std::uint64_t>(bytes), std::memory_order_relaxed);
+      if (static_cast<std::size_t>(bytes) <= kNetFragmentHeaderBytes) {
+        continue;
+      }
 
-    glGetProgramiv(id, GL_LINK_STATUS, &success);
-    if (!success) {
-      char log[512] = {};
-      glGetProgramInfoLog(id, sizeof(log), nullptr, log);
-      std::cerr << "Shader link error: " << log << "\n";
-      return false;
-    }
+      SnapshotStream header = SnapshotStream::Reader(buffer, kNetFragmentHeaderBytes);
+      std::uint32_t magic = 0u;
+      std::uint32_t sequence = 0u;
+      std::uint32_t index = 0u;
+      std::uint32_t count = 0u;
+      header.Integer(magic, 32);
+      header.Integer(sequence, 32);
+      header.Integer(index, 8);
+      header.Integer(count, 8);
+      if (magic != kNetFragmentMagic || count == 0u || count > kMaxNetFragments || index >= count) {
+        continue;
+      }
+      std::size_t peerIndex = 0;
+      NetPeer* peer = FindNetPeer(state, from, arrivalTime, peerIndex);
+      if (!peer) {
+        continue;
+      }
+      peer->lastArrival = arrivalTime;
+      if (!WantsSnapshot(*peer, sequence)) {
+        state->staleReceived.fetch_add(1u, std::memory_order_relaxed);
+        continue;
+      }
+      std::uint8_t* payload = buffer + kNetFragmentHeaderBytes;
+      const std::size_t payloadSize = static_cast<std::size_t>(bytes) - kNetFragmentHeaderBytes;
+      if (count == 1u) {
+        DecodeSnapshot(state, peerIndex, payload, payloadSize, arrivalTime);
+        continue;
+      }
 
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-    return true;
+      // Every fragment but the last is full, so offsets follow from the index alone.
+      FragmentAssembly& assembly = peer->assemblies[sequence % kFragmentAssemblySlots];
+      if (assembly.sequence != sequence && assembly.receivedMask != 0u &&
+          static_cast<std::int32_t>(assembly.sequence - sequence) > 0) {
+        // A late fragment never evicts a newer snapshot still being reassembled.
+        state->staleReceived.fetch_add(1u, std::memory_order_relaxed);
+        continue;
+      }
+      if (assembly.sequence != sequence || assembly.fragmentCount != count) {
+        assembly.sequence = sequence;
+        assembly.fragmentCount = count;
+        assembly.receivedMask = 0u;
+        assembly.size = 0;
+        assembly.bytes.resize(kMaxSnapshotBytes);
+      }
+      if (index + 1u < count && payloadSize != kNetFragmentPayloadBytes) {
+        continue;
+      }
+      std::memcpy(assembly.bytes.data() + index * kNetFragmentPayloadBytes, payload, payloadSize);
+      if (index + 1u == count) {
+        assembly.size = index * kNetFragmentPayloadBytes + payloadSize;
+      }
+      assembly.receivedMask |= (1ull << index);
+      const std::uint64_t completeMask = (count == 64u) ? ~0ull : ((1ull << count) - 1ull);
+      if (assembly.receivedMask == completeMask) {
+        DecodeSnapshot(state, peerIndex, assembly.bytes.data(), assembly.size, arrivalTime);
+        assembly.receivedMask = 0u;
+        assembly.fragmentCount = 0u;
+      }
+    }
   }
+}
 
-  void Use() const {
-    glUseProgram(id);
+// Resets the main thread's half of a peer slot after it has been (re)claimed at `now`.
+static void ResetNetPeerSession(NetPeer& peer, float now) {
+  static const MultiplayerPacket kEmptySnapshot{};
+  peer.addr = NetAddressFromKey(peer.addressKey.load(std::memory_order_relaxed));
+  peer.latest = kEmptySnapshot;
+  peer.interpolated = kEmptySnapshot;
+  peer.hasRemote = false;
+  peer.lastReceiveTime = now;  // Starts the timeout for a peer that never answers.
+  peer.samples.Clear();
+  peer.hasClockOffset = false;
+  peer.jitterTicks = 0.0f;
+  peer.snapshotIntervalTicks = 0.0f;
+  peer.playoutDelayTicks = 0.0f;
+  peer.receivedCount = 0u;
+  peer.lostCount = 0u;
+  peer.newRemoteCommands.clear();
+  peer.lastRemoteCommand = 0u;
+  for (NetPeer::SentPlayers& sent : peer.sentPlayers) {
+    sent.sequence = 0u;
   }
+  peer.lastSnapshotBytes = 0;
+  peer.lastSnapshotFragments = 0;
+  peer.lastCulledEntities = 0;
+  peer.hasRtt = false;
+  peer.rttMs = 0.0f;
+  peer.remoteSendTimeMs = 0u;
+}
 
-  void SetMat4(const char* name, const glm::mat4& value) const {
-    glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(value));
+// Picks up a slot the receive thread has claimed since the last call.
+static void RefreshNetPeer(NetPeer& peer, float now) {
+  const std::uint32_t generation = peer.generation.load(std::memory_order_acquire);
+  if (generation != peer.seenGeneration) {
+    ResetNetPeerSession(peer, now);
+    peer.seenGeneration = generation;
   }
+}
 
-  void SetVec3(const char* name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(id, name), 1, glm::value_ptr(value));
-  }
+// Whether a host still sends to this slot: claimed, and heard from within kNetPeerTimeout.
+static bool PeerIsServed(const NetPeer& peer, float now) {
+  return peer.seenGeneration != 0u && (now - peer.lastReceiveTime) <= kNetPeerTimeout;
+}
 
-  void SetMat3(const char* name, const glm::mat3& value) const {
-    glUniformMatrix3fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(value));
+static bool InitMultiplayer(const MultiplayerConfig& config, MultiplayerState& state) {
+  state.requested = config.enabled;
+  if (!config.enabled) {
+    return true;
   }
 
-  void SetInt(const char* name, int value) const {
-    glUniform1i(glGetUniformLocation(id, name), value);
-  }
-};
+  auto FailAndCleanup = [&]() {
+    if (state.socket != kInvalidSocketHandle) {
+      CloseSocketHandle(state.socket);
+      state.socket = kInvalidSocketHandle;
+    }
+#ifdef _WIN32
+    if (state.wsaReady) {
+      WSACleanup();
+      state.wsaReady = false;
+    }
+#endif
+    state.active = false;
+    return false;
+  };
 
-struct Player {
-  glm::vec3 position{0.0f, 2.0f, 0.0f};
-  glm::vec3 velocity{0.0f};
-  float halfSize = 0.5f;
-  bool onGround = false;
-  float blastTimer = 0.0f;
-  float hurtTimer = 0.0f;
-};
+#ifdef _WIN32
+  WSADATA wsaData{};
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    return FailAndCleanup();
+  }
+  state.wsaReady = true;
+#endif
 
-enum class ItemType : std::uint8_t {
-  None = 0,
-  Boomerang = 1,
-  SpeedBoots = 2,
-  Shotgun = 3,
-  Sword = 4,
-};
+  state.socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (state.socket == kInvalidSocketHandle) {
+    return FailAndCleanup();
+  }
 
-struct Enemy {
-  glm::vec3 position{4.0f, 0.0f, -4.0f};
-  glm::vec3 velocity{0.0f};
-  float halfSize = 0.45f;
-  float speed = 3.2f;
-  bool onGround = false;
-  float jumpCooldown = 0.0f;
-};
+  sockaddr_in localAddr{};
+  localAddr.sin_family = AF_INET;
+  localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  localAddr.sin_port = htons(static_cast<std::uint16_t>(config.localPort));
+  if (bind(state.socket, reinterpret_cast<sockaddr*>(&localAddr), sizeof(localAddr)) != 0) {
+    return FailAndCleanup();
+  }
 
-struct Platform {
-  glm::vec3 position;
-  glm::vec3 halfExtents;
-  glm::vec3 tint;
-};
+  if (!SetSocketNonBlocking(state.socket)) {
+    return FailAndCleanup();
+  }
 
-struct CloudPuff {
-  glm::vec3 offset;
-  glm::vec3 scale;
-};
+  sockaddr_in peerAddr{};
+  peerAddr.sin_family = AF_INET;
+  peerAddr.sin_port = htons(static_cast<std::uint16_t>(config.peerPort));
+  if (inet_pton(AF_INET, config.peerIp.c_str(), &peerAddr.sin_addr) != 1) {
+    return FailAndCleanup();
+  }
 
-struct CloudCluster {
-  glm::vec3 basePosition;
-  glm::vec2 driftDir;
-  float driftSpeed = 0.0f;
-  float hueOffset = 0.0f;
-  std::vector<CloudPuff> puffs;
-};
+  state.active = true;
+  state.host = config.host;
+  for (NetPeer& peer : state.peers) {
+    peer.addressKey.store(0u);
+    peer.generation.store(0u);
+    peer.seenGeneration = 0u;
+    peer.sentPlayers.assign(kSnapshotHistorySize, NetPeer::SentPlayers{});
+    peer.receivedSnapshots.assign(kSnapshotHistorySize, MultiplayerPacket{});
+    for (FragmentAssembly& assembly : peer.assemblies) {
+      assembly = FragmentAssembly{};
+    }
+    peer.hasSequence = false;
+    peer.lastRemoteSequence = 0u;
+    peer.lastArrival = 0.0;
+    peer.remoteAckSequence.store(0u);
+    peer.peerAckedSequence.store(0u);
+    ResetNetPeerSession(peer, 0.0f);
+  }
+  // A client's one peer is its host. A host starts out sending to the configured peer too;
+  // that slot is given to another client if it never answers.
+  ClaimNetPeer(state.peers[0], NetAddressKey(peerAddr), glfwGetTime());
+  state.droppedPackets.store(0u);
+  state.packetsReceived.store(0u);
+  state.bytesReceived.store(0u);
+  state.staleReceived.store(0u);
+  state.stats.history.Clear();
+  state.stats.totals = NetCounters{};
+  state.stats.windowStart = -1.0f;
+  state.lastFullSnapshotBytes = 0;
+  state.sendSequence = 0u;
+  state.sentSnapshots.assign(kSnapshotHistorySize, MultiplayerPacket{});
+  state.worldEncodings.resize(kMaxNetPeers + 1);
+  for (MultiplayerState::WorldEncoding& encoding : state.worldEncodings) {
+    encoding.bytes.assign(kMaxSnapshotBytes, 0u);
+  }
+  state.worldEncodingCount = 0;
+  state.peerEncoding.assign(kMaxSnapshotBytes, 0u);
+  state.inbox.Reset();
+  state.receiveRunning.store(true);
+  state.receiveThread = std::thread(ReceiveMultiplayerPackets, &state);
+  return true;
+}
 
-struct Cat {
-  glm::vec3 position;
-  glm::vec3 velocity = glm::vec3(0.0f);
-  bool collected = false;
-  
-  // AI state
-  enum class Behavior { Idle, Wandering, Following };
-  Behavior behavior = Behavior::Idle;
-  float behaviorTimer = 0.0f;
-  glm::vec3 wanderTarget = glm::vec3(0.0f);
-  enum class IdleAnim { None, Groom, Loaf, Roll, Groomed };
-  IdleAnim idleAnim = IdleAnim::None;
-  float idleAnimTimer = 0.0f;
-  float idleAnimPhase = 0.0f;
-  int groomTarget = -1;
-  float rollHold = 0.0f;
-  
-  // Personality
-  float moveSpeed = 3.0f;
-  float turnSpeed = 5.0f;
-  float facing = 0.0f;
-  float walkCycle = 0.0f;
-  unsigned int seed = 0;
-};
+static void ShutdownMultiplayer(MultiplayerState& state) {
+  state.receiveRunning.store(false);
+  if (state.receiveThread.joinable()) {
+    state.receiveThread.join();
+  }
+  if (state.socket != kInvalidSocketHandle) {
+    CloseSocketHandle(state.socket);
+    state.socket = kInvalidSocketHandle;
+  }
+#ifdef _WIN32
+  if (state.wsaReady) {
+    WSACleanup();
+    state.wsaReady = false;
+  }
+#endif
+  state.active = false;
+}
 
-struct Dog {
-  glm::vec3 position;
-  bool collected = false;
-  float bobOffset = 0.0f;
-  glm::vec3 velocity{0.0f};
-  bool onGround = false;
-  enum class Behavior { Idle, Wandering, Following };
-  Behavior behavior = Behavior::Idle;
-  float behaviorTimer = 0.0f;
-  glm::vec3 wanderTarget{0.0f};
-  float facing = 0.0f;
-  float walkCycle = 0.0f;
-  float moveSpeed = 2.8f;
-  float turnSpeed = 5.0f;
-  unsigned int seed = 0;
-  float blastTimer = 0.0f;
-};
+static void PollMultiplayer(MultiplayerState& state, float currentTime, double localTick, float secondsPerTick) {
+  for (NetPeer& peer : state.peers) {
+    peer.newRemoteCommands.clear();
+  }
+  if (!state.active) {
+    return;
+  }
+  for (NetPeer& peer : state.peers) {
+    RefreshNetPeer(peer, currentTime);
+  }
 
-struct WorldItem {
-  ItemType type = ItemType::None;
-  glm::vec3 position{0.0f};
-  bool active = true;
-};
+  SnapshotRing::Entry& entry = state.inboxEntry;
+  while (state.inbox.Pop(entry)) {
+    if (entry.peer >= state.peers.size()) {
+      continue;
+    }
+    NetPeer& peer = state.peers[entry.peer];
+    RefreshNetPeer(peer, currentTime);
+    if (entry.generation != peer.seenGeneration) {
+      continue;  // Decoded for the slot's previous occupant.
+    }
+    const MultiplayerPacket& packet = entry.packet;
+    // Overtaken by a newer snapshot on the way; the gap it left was counted as lost.
+    const bool late = peer.hasRemote && static_cast<std::int32_t>(packet.sequence - peer.latest.sequence) <= 0;
+    if (late) {
+      if (peer.lostCount > 0u) {
+        --peer.lostCount;
+      }
+      if (state.stats.totals.snapshotsLost > 0u) {
+        --state.stats.totals.snapshotsLost;
+      }
+    } else if (peer.hasRemote) {
+      const std::uint32_t gap = packet.sequence - peer.latest.sequence;
+      const std::uint32_t lost = (gap > 1u) ? gap - 1u : 0u;
+      peer.lostCount += lost;
+      state.stats.totals.snapshotsLost += lost;
+    }
+    ++peer.receivedCount;
+    ++state.stats.totals.snapshotsReceived;
+
+    // Back-date the arrival into sim ticks so a long frame does not skew the jitter estimate.
+    const float age = glm::max(0.0f, currentTime - static_cast<float>(entry.arrivalTime));
+    const double arrivalTick = localTick - static_cast<double>(age / secondsPerTick);
+
+    const double offset = static_cast<double>(packet.simTick) - arrivalTick;
+    const bool levelChanged = !peer.samples.Empty() && packet.level != peer.samples.Back().packet.level;
+    if (late) {
+      // Slots in by sim tick among the newer samples while it is still ahead of the playout
+      // point, which SamplePeerSnapshots keeps at the front sample. It feeds the jitter
+      // estimate but nothing else: latest, commands and the RTT echo already moved on.
+      if (peer.samples.Empty() || levelChanged || packet.simTick <= peer.samples.Front().packet.simTick) {
+        continue;
+      }
+      const double deviation = offset - peer.clockOffset;
+      peer.clockOffset += deviation * 0.05;
+      peer.jitterTicks += (static_cast<float>(std::abs(deviation)) - peer.jitterTicks) / 16.0f;
+      RemoteSnapshotSample& sample = peer.samples.PushBack();
+      sample.packet = packet;
+      sample.arrivalTick = arrivalTick;
+      for (std::size_t i = peer.samples.Size() - 1;
+           i > 0 && peer.samples[i - 1].packet.simTick > peer.samples[i].packet.simTick; --i) {
+        std::swap(peer.samples[i - 1], peer.samples[i]);
+      }
+      continue;
+    }
+    if (!peer.hasClockOffset || levelChanged) {
+      peer.clockOffset = offset;
+      peer.hasClockOffset = true;
+      peer.samples.Clear();
+    } else {
+      // RFC 3550 style jitter: smoothed absolute deviation of the one-way transit time.
+      const double deviation = offset - peer.clockOffset;
+      peer.clockOffset += deviation * 0.05;
+      peer.jitterTicks += (static_cast<float>(std::abs(deviation)) - peer.jitterTicks) / 16.0f;
+    }
+    if (!peer.samples.Empty()) {
+      const float interval = static_cast<float>(packet.simTick - peer.samples.Back().packet.simTick);
+      peer.snapshotIntervalTicks = (peer.snapshotIntervalTicks <= 0.0f)
+                                       ? interval
+                                       : peer.snapshotIntervalTicks + (interval - peer.snapshotIntervalTicks) * 0.1f;
+    }
+    // Overwrites the oldest sample once the buffer is full.
+    RemoteSnapshotSample& sample = peer.samples.PushBack();
+    sample.packet = packet;
+    sample.arrivalTick = arrivalTick;
+
+    // The echo is our own send time pushed forward by the peer's hold time, so what is left
+    // after subtracting it from the arrival is the round trip.
+    if (packet.echoTimeMs != 0u) {
+      const std::uint32_t arrivalMs = static_cast<std::uint32_t>(entry.arrivalTime * 1000.0);
+      const std::int32_t rtt = static_cast<std::int32_t>(arrivalMs - packet.echoTimeMs);
+      if (rtt >= 0) {
+        peer.rttMs = peer.hasRtt ? peer.rttMs + (static_cast<float>(rtt) - peer.rttMs) * 0.125f
+                                 : static_cast<float>(rtt);
+        peer.hasRtt = true;
+      }
+    }
+    peer.remoteSendTimeMs = packet.sendTimeMs;
+    peer.remoteSendArrival = entry.arrivalTime;
+
+    peer.latest = packet;
+    peer.hasRemote = true;
+    peer.lastReceiveTime = static_cast<float>(entry.arrivalTime);
+    for (std::size_t i = 0; i < packet.inputCommandCount; ++i) {
+      const InputCommand& command = packet.inputCommands[i];
+      if (static_cast<std::int32_t>(command.sequence - peer.lastRemoteCommand) > 0) {
+        peer.newRemoteCommands.push_back(command);
+        peer.lastRemoteCommand = command.sequence;
+        if ((command.actions & kInputActionUseItem) != 0u) {
+          ++peer.useSerial;
+          peer.useItem = command.heldItem;
+        }
+      }
+    }
+  }
+}
 
-struct ShotProjectile {
-  glm::vec3 position{0.0f};
-  glm::vec3 velocity{0.0f};
-  float lifetime = 0.0f;
-  bool active = false;
-};
+// Blends everything that moves between two snapshots; entities that jumped snap to `b`.
+static void BlendSnapshotMotion(MultiplayerPacket& out, const MultiplayerPacket& a, const MultiplayerPacket& b, float t) {
+  auto Position = [&](float (&dst)[3], const float (&pa)[3], const float (&pb)[3]) {
+    const glm::vec3 from(pa[0], pa[1], pa[2]);
+    const glm::vec3 to(pb[0], pb[1], pb[2]);
+    const glm::vec3 value = (glm::distance(from, to) > 4.0f) ? to : glm::mix(from, to, t);
+    dst[0] = value.x;
+    dst[1] = value.y;
+    dst[2] = value.z;
+  };
+  auto Velocity = [&](float (&dst)[3], const float (&va)[3], const float (&vb)[3]) {
+    for (int axis = 0; axis < 3; ++axis) {
+      dst[axis] = va[axis] + (vb[axis] - va[axis]) * t;
+    }
+  };
+  auto Angle = [&](float ra, float rb) {
+    return ra + std::remainder(rb - ra, 2.0f * 3.14159265f) * t;
+  };
+  auto Cycle = [&](float ca, float cb) {
+    float delta = cb - ca;
+    if (delta < -0.5f * kNetWalkCyclePeriod) {
+      delta += kNetWalkCyclePeriod;
+    }
+    return ca + delta * t;
+  };
 
-struct BoomerangProjectile {
-  bool active = false;
-  glm::vec3 position{0.0f};
-  glm::vec3 velocity{0.0f};
-  bool returning = false;
-  float timeAlive = 0.0f;
+  Position(out.pos, a.pos, b.pos);
+  Velocity(out.vel, a.vel, b.vel);
+  out.facing = Angle(a.facing, b.facing);
+
+  // Relayed players line up by slot while the same clients stay connected.
+  const std::size_t playerCount = std::min({out.players.size(), a.players.size(), b.players.size()});
+  for (std::size_t i = 0; i < playerCount; ++i) {
+    if (a.players[i].id == b.players[i].id) {
+      Position(out.players[i].pos, a.players[i].pos, b.players[i].pos);
+      Velocity(out.players[i].vel, a.players[i].vel, b.players[i].vel);
+      out.players[i].facing = Angle(a.players[i].facing, b.players[i].facing);
+    }
+  }
+
+  Position(out.clownPos, a.clownPos, b.clownPos);
+  Velocity(out.clownVel, a.clownVel, b.clownVel);
+  out.clownFacing = Angle(a.clownFacing, b.clownFacing);
+  out.clownWalkCycle = Cycle(a.clownWalkCycle, b.clownWalkCycle);
+
+  Position(out.mummyPos, a.mummyPos, b.mummyPos);
+  Velocity(out.mummyVel, a.mummyVel, b.mummyVel);
+  out.mummyFacing = Angle(a.mummyFacing, b.mummyFacing);
+  out.mummyWalkCycle = Cycle(a.mummyWalkCycle, b.mummyWalkCycle);
+
+  const std::size_t catCount = std::min({out.cats.size(), a.cats.size(), b.cats.size()});
+  for (std::size_t i = 0; i < catCount; ++i) {
+    Position(out.cats[i].pos, a.cats[i].pos, b.cats[i].pos);
+    Velocity(out.cats[i].vel, a.cats[i].vel, b.cats[i].vel);
+    out.cats[i].facing = Angle(a.cats[i].facing, b.cats[i].facing);
+    out.cats[i].walkCycle = Cycle(a.cats[i].walkCycle, b.cats[i].walkCycle);
+  }
+
+  const std::size_t dogCount = std::min({out.dogs.size(), a.dogs.size(), b.dogs.size()});
+  for (std::size_t i = 0; i < dogCount; ++i) {
+    Position(out.dogs[i].pos, a.dogs[i].pos, b.dogs[i].pos);
+    Velocity(out.dogs[i].vel, a.dogs[i].vel, b.dogs[i].vel);
+    out.dogs[i].facing = Angle(a.dogs[i].facing, b.dogs[i].facing);
+    out.dogs[i].walkCycle = Cycle(a.dogs[i].walkCycle, b.dogs[i].walkCycle);
+  }
+
+  const std::size_t bombCount = std::min({out.bombs.size(), a.bombsActive.size(), b.bombsActive.size()});
+  for (std::size_t i = 0; i < bombCount; ++i) {
+    if (a.bombsActive[i] && b.bombsActive[i]) {
+      Position(out.bombs[i].pos, a.bombs[i].pos, b.bombs[i].pos);
+      Velocity(out.bombs[i].vel, a.bombs[i].vel, b.bombs[i].vel);
+    }
+  }
+}
+
+// Resamples a peer's jitter buffer at the playout time into peer.interpolated.
+static void SamplePeerSnapshots(NetPeer& peer, double localTick, float minDelayTicks, float secondsPerTick) {
+  peer.interpolated = peer.latest;
+  if (peer.samples.Empty()) {
+    return;
+  }
+
+  // Ease toward enough delay to cover one snapshot interval plus the measured jitter.
+  const float targetDelay = glm::max(minDelayTicks, peer.snapshotIntervalTicks + 3.0f * peer.jitterTicks);
+  peer.playoutDelayTicks = (peer.playoutDelayTicks <= 0.0f)
+                               ? targetDelay
+                               : peer.playoutDelayTicks + (targetDelay - peer.playoutDelayTicks) * 0.02f;
+  const double renderTick = localTick + peer.clockOffset - static_cast<double>(peer.playoutDelayTicks);
+
+  while (peer.samples.Size() > 2 && static_cast<double>(peer.samples[1].packet.simTick) <= renderTick) {
+    peer.samples.PopFront();
+  }
+
+  const MultiplayerPacket& oldest = peer.samples.Front().packet;
+  const MultiplayerPacket& newest = peer.samples.Back().packet;
+  if (renderTick <= static_cast<double>(oldest.simTick)) {
+    BlendSnapshotMotion(peer.interpolated, oldest, oldest, 0.0f);
+    return;
+  }
+  if (renderTick >= static_cast<double>(newest.simTick)) {
+    // Buffer ran dry: hold the newest entities and extrapolate the player briefly.
+    BlendSnapshotMotion(peer.interpolated, newest, newest, 0.0f);
+    const float extrapolation = glm::min(static_cast<float>(renderTick - static_cast<double>(newest.simTick)) * secondsPerTick, 0.12f);
+    for (int axis = 0; axis < 3; ++axis) {
+      peer.interpolated.pos[axis] += newest.vel[axis] * extrapolation;
+    }
+    return;
+  }
+
+  const MultiplayerPacket& a = peer.samples[0].packet;
+  const MultiplayerPacket& b = peer.samples[1].packet;
+  const double span = glm::max(1.0, static_cast<double>(b.simTick) - static_cast<double>(a.simTick));
+  const float t = static_cast<float>(glm::clamp((renderTick - static_cast<double>(a.simTick)) / span, 0.0, 1.0));
+  BlendSnapshotMotion(peer.interpolated, a, b, t);
+}
+
+static void SampleRemoteSnapshots(MultiplayerState& state, double localTick, float minDelayTicks, float secondsPerTick) {
+  for (NetPeer& peer : state.peers) {
+    if (peer.hasRemote) {
+      SamplePeerSnapshots(peer, localTick, minDelayTicks, secondsPerTick);
+    }
+  }
+}
+
+// Settings schema: each field's stable id in the binary profile, its key in the legacy text
+// profile and the member it lives in. The file stores tagged records, so a build reading an
+// older file keeps defaults for fields it lacks and an older build skips ids it does not
+// know. Ids are never renumbered or reused; a new field takes the next free id.
+template <typename Profile, typename Visit>
+static void VisitSettingsSchema(Profile& settings, Visit&& visit) {
+  visit(1, "uiScale", settings.uiScale);
+  visit(2, "mouseSensitivity", settings.mouseSensitivity);
+  visit(3, "musicVolume", settings.musicVolume);
+  visit(4, "sfxVolume", settings.sfxVolume);
+  visit(5, "cameraDistance", settings.cameraDistance);
+  visit(6, "difficulty", settings.difficulty);
+  visit(7, "invertLookY", settings.invertLookY);
+  visit(8, "showDebugHud", settings.showDebugHud);
+  visit(9, "showMultiplayerWindow", settings.showMultiplayerWindow);
+  visit(10, "highContrastHud", settings.highContrastHud);
+  visit(11, "lodDistance", settings.lodDistance);
+  visit(12, "vsync", settings.vsync);
+  visit(13, "shadows", settings.shadows);
+  visit(14, "netTickRate", settings.netTickRate);
+  visit(15, "netPlayoutDelayMs", settings.netPlayoutDelayMs);
+  // Keybinds, with room below for more options.
+  visit(64, "key_forward", settings.keys.forward);
+  visit(65, "key_backward", settings.keys.backward);
+  visit(66, "key_left", settings.keys.left);
+  visit(67, "key_right", settings.keys.right);
+  visit(68, "key_jump", settings.keys.jump);
+  visit(69, "key_sprint", settings.keys.sprint);
+  visit(70, "key_pauseA", settings.keys.pauseA);
+  visit(71, "key_pauseB", settings.keys.pauseB);
+}
+
+enum class SettingType : std::uint8_t { Bool = 1, Int = 2, Float = 3 };
+
+template <typename T>
+static constexpr SettingType kSettingTypeOf = std::is_same<T, bool>::value  ? SettingType::Bool
+                                              : std::is_same<T, int>::value ? SettingType::Int
+                                                                            : SettingType::Float;
+
+// One field: id, SettingType and 32 bits of value (bools as 0/1, ints as int32, floats raw).
+struct SettingsRecord {
+  std::uint16_t id = 0u;
+  std::uint8_t type = 0u;
+  std::uint8_t reserved = 0u;
+  std::uint32_t value = 0u;
 };
 
-struct Bomb {
-  glm::vec3 position{0.0f};
-  glm::vec3 velocity{0.0f};
-  float timer = 0.0f;
-  bool active = false;
+struct SettingsFileHeader {
+  std::uint32_t magic = kSettingsMagic;
+  std::uint32_t version = kSettingsVersion;
+  std::uint32_t count = 0u;     // SettingsRecords that follow.
+  std::uint32_t checksum = 0u;  // FNV-1a over the records.
 };
 
-struct Explosion {
-  glm::vec3 position{0.0f};
-  float age = 0.0f;
-  float duration = 0.6f;
-  float seed = 0.0f;
-};
+static std::uint32_t SettingsChecksum(const SettingsRecord* records, std::size_t count) {
+  std::uint32_t hash = 2166136261u;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(records);
+  for (std::size_t i = 0; i < count * sizeof(SettingsRecord); ++i) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void ClampSettings(SettingsProfile& settings) {
+  settings.uiScale = glm::clamp(settings.uiScale, 0.85f, 2.8f);
+  settings.mouseSensitivity = glm::clamp(settings.mouseSensitivity, 0.0015f, 0.02f);
+  settings.musicVolume = glm::clamp(settings.musicVolume, 0.0f, 1.0f);
+  settings.sfxVolume = glm::clamp(settings.sfxVolume, 0.0f, 1.0f);
+  settings.cameraDistance = glm::clamp(settings.cameraDistance, 3.0f, 10.0f);
+  settings.difficulty = glm::clamp(settings.difficulty, 0, 2);
+  settings.lodDistance = glm::clamp(settings.lodDistance, 10.0f, 90.0f);
+  settings.netTickRate = glm::clamp(settings.netTickRate, 10, 120);
+  settings.netPlayoutDelayMs = glm::clamp(settings.netPlayoutDelayMs, 0, 500);
+}
+
+// Applies a whole binary profile or nothing. Records with an unknown id or a type that no
+// longer matches the schema are skipped, and non-finite floats keep their previous value.
+static bool ParseSettingsBinary(const std::string& bytes, SettingsProfile& settings) {
+  SettingsFileHeader header;
+  if (bytes.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  // A newer version means some field changed meaning there, so its records cannot be trusted.
+  if (header.magic != kSettingsMagic || header.version == 0u || header.version > kSettingsVersion ||
+      bytes.size() != sizeof(header) + static_cast<std::size_t>(header.count) * sizeof(SettingsRecord)) {
+    return false;
+  }
+  std::vector<SettingsRecord> records(header.count);
+  std::memcpy(records.data(), bytes.data() + sizeof(header), records.size() * sizeof(SettingsRecord));
+  if (SettingsChecksum(records.data(), records.size()) != header.checksum) {
+    return false;
+  }
+  SettingsProfile parsed = settings;
+  for (const SettingsRecord& record : records) {
+    VisitSettingsSchema(parsed, [&](std::uint16_t id, const char*, auto& value) {
+      using T = std::decay_t<decltype(value)>;
+      if (id != record.id || record.type != static_cast<std::uint8_t>(kSettingTypeOf<T>)) {
+        return;
+      }
+      if constexpr (std::is_same<T, bool>::value) {
+        value = record.value != 0u;
+      } else if constexpr (std::is_same<T, int>::value) {
+        value = static_cast<int>(static_cast<std::int32_t>(record.value));
+      } else {
+        float decoded = 0.0f;
+        std::memcpy(&decoded, &record.value, sizeof(decoded));
+        if (std::isfinite(decoded)) {
+          value = decoded;
+        }
+      }
+    });
+  }
+  settings = parsed;
+  return true;
+}
+
+// The key=value text profile written before the binary format; read once and migrated.
+static bool LoadLegacySettings(SettingsProfile& settings) {
+  std::ifstream file(kLegacySettingsFile);
+  if (!file) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    const std::size_t sep = line.find('=');
+    if (sep == std::string::npos) {
+      continue;
+    }
+    const std::string key = line.substr(0, sep);
+    const std::string text = line.substr(sep + 1);
+    VisitSettingsSchema(settings, [&](std::uint16_t, const char* name, auto& value) {
+      using T = std::decay_t<decltype(value)>;
+      if (key != name) {
+        return;
+      }
+      if constexpr (std::is_same<T, bool>::value) {
+        if (text == "1" || text == "true" || text == "TRUE") {
+          value = true;
+        } else if (text == "0" || text == "false" || text == "FALSE") {
+          value = false;
+        }
+      } else {
+        try {
+          if constexpr (std::is_same<T, int>::value) {
+            value = std::stoi(text);
+          } else {
+            value = std::stof(text);
+          }
+        } catch (...) {
+        }
+      }
+    });
+  }
+  return true;
+}
+
+// Legacy means the binary profile was unreadable (say, written by a newer build) and the text
+// one was used instead; neither file is rewritten until the player changes a setting.
+enum class SettingsSource { Defaults, Binary, Migrated, Legacy };
+
+// Fields absent from the file keep the values `settings` came in with.
+static SettingsSource LoadSettings(SettingsProfile& settings) {
+  SettingsSource source = SettingsSource::Defaults;
+  std::ifstream file(kSettingsFile, std::ios::in | std::ios::binary);
+  if (file) {
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    if (ParseSettingsBinary(contents.str(), settings)) {
+      source = SettingsSource::Binary;
+    } else if (LoadLegacySettings(settings)) {
+      std::cerr << kSettingsFile << " is not a settings profile this build can read; using " << kLegacySettingsFile << ".\n";
+      source = SettingsSource::Legacy;
+    } else {
+      std::cerr << kSettingsFile << " is not a settings profile this build can read; using defaults.\n";
+    }
+  } else if (LoadLegacySettings(settings)) {
+    source = SettingsSource::Migrated;
+  }
+  ClampSettings(settings);
+  return source;
+}
+
+// Written beside the final path and renamed over it, like the asset cache, so a crash
+// mid-write leaves the previous profile intact.
+static bool WriteSettingsFile(const SettingsProfile& settings) {
+  std::vector<SettingsRecord> records;
+  VisitSettingsSchema(settings, [&](std::uint16_t id, const char*, const auto& value) {
+    using T = std::decay_t<decltype(value)>;
+    SettingsRecord record;
+    record.id = id;
+    record.type = static_cast<std::uint8_t>(kSettingTypeOf<T>);
+    if constexpr (std::is_same<T, bool>::value) {
+      record.value = value ? 1u : 0u;
+    } else if constexpr (std::is_same<T, int>::value) {
+      record.value = static_cast<std::uint32_t>(static_cast<std::int32_t>(value));
+    } else {
+      std::memcpy(&record.value, &value, sizeof(record.value));
+    }
+    records.push_back(record);
+  });
+  SettingsFileHeader header;
+  header.count = static_cast<std::uint32_t>(records.size());
+  header.checksum = SettingsChecksum(records.data(), records.size());
+
+  const std::string tempPath = std::string(kSettingsFile) + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() * sizeof(SettingsRecord)));
+    if (!file) {
+      std::cerr << "Failed to write settings " << tempPath << "\n";
+      file.close();
+      std::remove(tempPath.c_str());
+      return false;
+    }
+  }
+  std::remove(kSettingsFile);  // rename() does not replace an existing file on Windows.
+  if (std::rename(tempPath.c_str(), kSettingsFile) != 0) {
+    std::cerr << "Failed to replace " << kSettingsFile << "\n";
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Saves the profile on a background thread. The game thread keeps reading its own settings
+// and only hands the writer a copy: Save holds the lock for that copy alone and never waits
+// on the disk. Saves that arrive while a write is in progress collapse into one.
+struct SettingsWriter {
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  SettingsProfile pending;
+  bool hasPending = false;
+  bool quit = false;
+
+  SettingsWriter() = default;
+  SettingsWriter(const SettingsWriter&) = delete;
+  SettingsWriter& operator=(const SettingsWriter&) = delete;
+  ~SettingsWriter() { Shutdown(); }
+
+  // Game thread only; the writer thread starts with the first save.
+  void Save(const SettingsProfile& settings) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending = settings;
+      hasPending = true;
+    }
+    if (!thread.joinable()) {
+      thread = std::thread([this]() { WriterLoop(); });
+    }
+    wake.notify_one();
+  }
+
+  // Finishes any pending save before the thread exits.
+  void Shutdown() {
+    if (!thread.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+  }
+
+  void WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [this]() { return hasPending || quit; });
+      if (!hasPending) {
+        return;
+      }
+      const SettingsProfile profile = pending;
+      hasPending = false;
+      lock.unlock();
+      WriteSettingsFile(profile);
+      lock.lock();
+    }
+  }
+};
+
+static void PushFrameSample(PerformanceHistory& perf, float frameMs, std::uint64_t allocations) {
+  perf.emaFrameMs = glm::mix(perf.emaFrameMs, frameMs, 0.08f);
+  perf.frameMs.PushBack(frameMs);
+  perf.frameAllocations.PushBack(static_cast<std::uint32_t>(std::min<std::uint64_t>(allocations, 0xFFFFFFFFu)));
+}
+
+// Named timing zones for the frame profiler. GPU zones also get a GL_TIME_ELAPSED query
+// pair; timer queries cannot nest, so GPU zones must not overlap each other.
+enum class ProfileZone : std::uint8_t {
+  Sim,
+  NetReceive,
+  NetSend,
+  EntityBuild,
+  Shadows,
+  WorldRender,
+  Ui,
+  Present,
+  Count
+};
+
+static constexpr int kProfileZoneCount = static_cast<int>(ProfileZone::Count);
+static constexpr const char* kProfileZoneNames[kProfileZoneCount] = {
+    "Sim", "Net receive", "Net send", "Entity build", "Shadows", "World render", "UI", "Present"};
+static constexpr bool kProfileZoneGpu[kProfileZoneCount] = {false, false, false, true, true, true, true, false};
+static constexpr const char* kTraceFile = "vibe3d_trace.json";
+
+struct ProfileTraceEvent {
+  const char* name = "";
+  bool gpu = false;
+  double startUs = 0.0;
+  double durationUs = 0.0;
+};
+
+struct ProfilePercentiles {
+  float p50 = 0.0f;
+  float p95 = 0.0f;
+  float p99 = 0.0f;
+};
+
+// Per-zone CPU times summed over each frame (a zone entered several times, like one sim
+// step each, adds up), plus GPU times read back kGpuLatencyFrames later so the readback
+// never waits on the driver. Optionally records a Chrome trace (chrome://tracing, Perfetto).
+struct FrameProfiler {
+  using Clock = std::chrono::steady_clock;
+  static constexpr int kHistoryFrames = 240;
+  static constexpr int kGpuLatencyFrames = 3;
+
+  Clock::time_point epoch = Clock::now();
+  Clock::time_point frameStart;
+  Clock::time_point zoneStart[kProfileZoneCount];
+  float frameCpuMs[kProfileZoneCount] = {};
+  // Row kProfileZoneCount holds whole-frame time.
+  float cpuHistory[kProfileZoneCount + 1][kHistoryFrames] = {};
+  float gpuHistory[kProfileZoneCount][kHistoryFrames] = {};
+  int cpuHead = 0;
+  int cpuCount = 0;
+  int gpuHead = 0;
+  int gpuCount = 0;
+
+  bool gpuTimers = false;
+  GLuint queries[kGpuLatencyFrames][kProfileZoneCount] = {};
+  bool queryIssued[kGpuLatencyFrames][kProfileZoneCount] = {};
+  double queryStartUs[kGpuLatencyFrames][kProfileZoneCount] = {};
+  int activeGpuZone = -1;
+  std::uint64_t frameIndex = 0;
+
+  std::vector<ProfileTraceEvent> trace;
+  int captureFramesLeft = 0;
+  int captureDrainFrames = 0;
+  int capturedFrames = 0;
+  double captureStartUs = 0.0;
+  int lastTraceFrames = 0;
+
+  // Needs a current GL context; without one only CPU zones are timed.
+  void Init() {
+    glGenQueries(kGpuLatencyFrames * kProfileZoneCount, &queries[0][0]);
+    gpuTimers = true;
+  }
+
+  void Shutdown() {
+    if (gpuTimers) {
+      glDeleteQueries(kGpuLatencyFrames * kProfileZoneCount, &queries[0][0]);
+      gpuTimers = false;
+    }
+  }
+
+  double ToUs(Clock::time_point time) const { return std::chrono::duration<double, std::micro>(time - epoch).count(); }
+  bool Capturing() const { return captureFramesLeft > 0 || captureDrainFrames > 0; }
+  int GpuSlot() const { return static_cast<int>(frameIndex % kGpuLatencyFrames); }
+
+  void BeginFrame() {
+    frameStart = Clock::now();
+    std::fill(std::begin(frameCpuMs), std::end(frameCpuMs), 0.0f);
+    if (gpuTimers) {
+      ResolveGpu(GpuSlot());
+    }
+  }
+
+  void Begin(ProfileZone zone) {
+    const int index = static_cast<int>(zone);
+    zoneStart[index] = Clock::now();
+    const int slot = GpuSlot();
+    if (gpuTimers && kProfileZoneGpu[index] && activeGpuZone < 0 && !queryIssued[slot][index]) {
+      glBeginQuery(GL_TIME_ELAPSED, queries[slot][index]);
+      queryIssued[slot][index] = true;
+      queryStartUs[slot][index] = ToUs(zoneStart[index]);
+      activeGpuZone = index;
+    }
+  }
+
+  void End(ProfileZone zone) {
+    const int index = static_cast<int>(zone);
+    const Clock::time_point now = Clock::now();
+    if (activeGpuZone == index) {
+      glEndQuery(GL_TIME_ELAPSED);
+      activeGpuZone = -1;
+    }
+    const double startUs = ToUs(zoneStart[index]);
+    const double durationUs = ToUs(now) - startUs;
+    frameCpuMs[index] += static_cast<float>(durationUs * 0.001);
+    if (captureFramesLeft > 0) {
+      trace.push_back({kProfileZoneNames[index], false, startUs, durationUs});
+    }
+  }
+
+  void EndFrame() {
+    const Clock::time_point now = Clock::now();
+    for (int zone = 0; zone < kProfileZoneCount; ++zone) {
+      cpuHistory[zone][cpuHead] = frameCpuMs[zone];
+    }
+    const double startUs = ToUs(frameStart);
+    const double durationUs = ToUs(now) - startUs;
+    cpuHistory[kProfileZoneCount][cpuHead] = static_cast<float>(durationUs * 0.001);
+    cpuHead = (cpuHead + 1) % kHistoryFrames;
+    cpuCount = std::min(cpuCount + 1, kHistoryFrames);
+
+    if (captureFramesLeft > 0) {
+      trace.push_back({"Frame", false, startUs, durationUs});
+      ++capturedFrames;
+      if (--captureFramesLeft == 0) {
+        // Keep collecting until the last captured frame's GPU queries have been read.
+        captureDrainFrames = gpuTimers ? kGpuLatencyFrames : 0;
+      }
+    } else if (captureDrainFrames > 0) {
+      --captureDrainFrames;
+    }
+    if (capturedFrames > 0 && !Capturing()) {
+      WriteTrace();
+    }
+    ++frameIndex;
+  }
+
+  // A query the driver has not finished after kGpuLatencyFrames repeats the zone's last
+  // sample rather than recording a false 0 ms; zones that did not run this frame record 0.
+  void ResolveGpu(int slot) {
+    const int previous = (gpuHead + kHistoryFrames - 1) % kHistoryFrames;
+    for (int zone = 0; zone < kProfileZoneCount; ++zone) {
+      float elapsedMs = 0.0f;
+      if (queryIssued[slot][zone]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][zone], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) {
+          elapsedMs = gpuCount > 0 ? gpuHistory[zone][previous] : 0.0f;
+        } else {
+          GLuint64 elapsedNs = 0;
+          glGetQueryObjectui64v(queries[slot][zone], GL_QUERY_RESULT, &elapsedNs);
+          elapsedMs = static_cast<float>(static_cast<double>(elapsedNs) * 1.0e-6);
+          if (Capturing() && queryStartUs[slot][zone] >= captureStartUs) {
+            trace.push_back({kProfileZoneNames[zone], true, queryStartUs[slot][zone], elapsedMs * 1000.0});
+          }
+        }
+        queryIssued[slot][zone] = false;
+      }
+      gpuHistory[zone][gpuHead] = elapsedMs;
+    }
+    gpuHead = (gpuHead + 1) % kHistoryFrames;
+    gpuCount = std::min(gpuCount + 1, kHistoryFrames);
+  }
+
+  void StartCapture(int frames) {
+    trace.clear();
+    trace.reserve(static_cast<std::size_t>(frames) * (kProfileZoneCount * 2 + 8));
+    captureFramesLeft = std::max(1, frames);
+    captureDrainFrames = 0;
+    capturedFrames = 0;
+    captureStartUs = ToUs(Clock::now());
+  }
+
+  // Sorts a copy of the history in frame scratch memory.
+  static ProfilePercentiles Percentiles(FrameArena& arena, const float* history, int count) {
+    ProfilePercentiles result;
+    if (count <= 0) {
+      return result;
+    }
+    float* sorted = arena.AllocateArray<float>(static_cast<std::size_t>(count));
+    std::copy(history, history + count, sorted);
+    std::sort(sorted, sorted + count);
+    auto At = [&](float fraction) {
+      return sorted[std::min(count - 1, static_cast<int>(fraction * static_cast<float>(count)))];
+    };
+    result.p50 = At(0.5f);
+    result.p95 = At(0.95f);
+    result.p99 = At(0.99f);
+    return result;
+  }
+
+  ProfilePercentiles CpuPercentiles(FrameArena& arena, int zone) const {
+    return Percentiles(arena, cpuHistory[zone], cpuCount);
+  }
+  ProfilePercentiles FramePercentiles(FrameArena& arena) const {
+    return Percentiles(arena, cpuHistory[kProfileZoneCount], cpuCount);
+  }
+  ProfilePercentiles GpuPercentiles(FrameArena& arena, int zone) const {
+    return Percentiles(arena, gpuHistory[zone], gpuCount);
+  }
+
+  // Chrome trace event format: CPU zones on tid 1, GPU zones on tid 2 placed at their
+  // CPU submission time.
+  void WriteTrace() {
+    std::ofstream file(kTraceFile, std::ios::trunc);
+    if (!file) {
+      std::cerr << "Failed to write " << kTraceFile << "\n";
+    } else {
+      file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+      file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+      file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+      char line[160];
+      for (const ProfileTraceEvent& event : trace) {
+        std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                      event.name, event.gpu ? 2 : 1, event.startUs, event.durationUs);
+        file << line;
+      }
+      file << "\n]}\n";
+      std::cout << "Wrote " << capturedFrames << "-frame trace to " << kTraceFile << "\n";
+      lastTraceFrames = capturedFrames;
+    }
+    trace.clear();
+    capturedFrames = 0;
+  }
+};
+
+struct ProfileScope {
+  FrameProfiler& profiler;
+  ProfileZone zone;
+
+  ProfileScope(FrameProfiler& owner, ProfileZone scopeZone) : profiler(owner), zone(scopeZone) { profiler.Begin(zone); }
+  ~ProfileScope() { profiler.End(zone); }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// The players a host relays to peer `target`: every other live client as it last reported.
+static void GatherRelayedPlayers(const MultiplayerState& state,
+                                 std::size_t target,
+                                 float now,
+                                 std::vector<NetPlayerState>& players) {
+  players.clear();
+  for (std::size_t i = 0; i < state.peers.size(); ++i) {
+    const NetPeer& peer = state.peers[i];
+    if (i == target || !PeerIsFresh(peer, now)) {
+      continue;
+    }
+    NetPlayerState& player = players.emplace_back();
+    player.id = static_cast<std::uint8_t>(i + 1);
+    std::memcpy(player.pos, peer.latest.pos, sizeof(player.pos));
+    std::memcpy(player.vel, peer.latest.vel, sizeof(player.vel));
+    player.facing = peer.latest.facing;
+    player.heldItem = peer.latest.localHeldItemType;
+    player.heldCharges = static_cast<std::uint8_t>(std::clamp(peer.latest.localHeldItemCharges, 0, 255));
+    player.useSerial = peer.useSerial;
+    player.useItem = peer.useItem;
+  }
+}
+
+static void SendMultiplayerSnapshot(MultiplayerState& state,
+                                    const glm::vec3& position,
+                                    const glm::vec3& velocity,
+                                    float facing,
+                                    const std::deque<InputCommand>& pendingCommands,
+                                    std::uint32_t simTick,
+                                    std::uint16_t level,
+                                    bool isAuthority,
+                                    bool hasWon,
+                                    bool isDead,
+                                    const Enemy& clown,
+                                    float clownFacing,
+                                    float clownWalkCycle,
+                                    const Enemy& mummy,
+                                    float mummyFacing,
+                                    float mummyWalkCycle,
+                                    float mummyThrowCooldown,
+                                    const std::vector<Cat>& cats,
+                                    const AnimalBodies& catBodies,
+                                    const std::vector<Dog>& dogs,
+                                    const AnimalBodies& dogBodies,
+                                    const ObjectPool<Bomb>& bombs,
+                                    const ObjectPool<Explosion>& explosions,
+                                    const std::vector<WorldItem>& worldItems,
+                                    ItemType heldItem,
+                                    int heldCharges,
+                                    bool clownAlive,
+                                    float clownRespawnTimer,
+                                    float clownStunTimer,
+                                    bool mummyAlive,
+                                    float mummyRespawnTimer,
+                                    float mummyStunTimer,
+                                    int collected,
+                                    int lives) {
+  if (!state.active || state.socket == kInvalidSocketHandle) {
+    return;
+  }
+
+  // Assigning the empty snapshot resets every field but leaves the section vectors' capacity.
+  static const MultiplayerPacket kEmptySnapshot{};
+  MultiplayerPacket& world = state.outgoing;
+  world = kEmptySnapshot;
+  world.level = level;
+  world.flags = (hasWon ? kNetFlagWon : 0u) |
+                (isDead ? kNetFlagDead : 0u) |
+                (isAuthority ? kNetFlagAuthority : 0u);
+  world.collected = collected;
+  world.lives = lives;
+  world.pos[0] = position.x;
+  world.pos[1] = position.y;
+  world.pos[2] = position.z;
+  world.vel[0] = velocity.x;
+  world.vel[1] = velocity.y;
+  world.vel[2] = velocity.z;
+  world.facing = facing;
+  const std::size_t commandCount = std::min(pendingCommands.size(), kMaxPendingInputCommands);
+  world.inputCommandCount = static_cast<std::uint8_t>(commandCount);
+  for (std::size_t i = 0; i < commandCount; ++i) {
+    world.inputCommands[i] = pendingCommands[pendingCommands.size() - commandCount + i];
+  }
+  world.simTick = simTick;
+  PackWorldEntities(world,
+                    clown,
+                    clownFacing,
+                    clownWalkCycle,
+                    mummy,
+                    mummyFacing,
+                    mummyWalkCycle,
+                    mummyThrowCooldown,
+                    cats,
+                    catBodies,
+                    dogs,
+                    dogBodies,
+                    bombs,
+                    explosions,
+                    worldItems,
+                    heldItem,
+                    heldCharges,
+                    clownAlive,
+                    clownRespawnTimer,
+                    clownStunTimer,
+                    mummyAlive,
+                    mummyRespawnTimer,
+                    mummyStunTimer);
+  if (!state.host) {
+    // The host only reads collection and item flags from clients, so their entity motion
+    // stays at the defaults and delta-codes to one dirty bit per entity.
+    for (NetCatState& cat : world.cats) {
+      cat = NetCatState{};
+    }
+    for (NetDogState& dog : world.dogs) {
+      dog = NetDogState{};
+    }
+    for (NetBombState& bomb : world.bombs) {
+      bomb = NetBombState{};
+    }
+    world.explosions.clear();
+  }
+
+  // The full world part is encoded first, which also quantizes the world in place, and is
+  // stored once as the baseline for every peer that acks this sequence.
+  world.sequence = ++state.sendSequence;
+  state.worldEncodingCount = 0;
+  MultiplayerState::WorldEncoding& full = state.worldEncodings[state.worldEncodingCount++];
+  full.baselineSequence = 0u;
+  full.hasInterest = false;
+  std::fill(std::begin(full.sectionBits), std::end(full.sectionBits), 0u);
+  SnapshotStream fullStream = SnapshotStream::Writer(full.bytes.data(), full.bytes.size());
+  fullStream.positionRange = state.positionRange;
+  SerializeSnapshotBody(fullStream, world, kEmptySnapshot, full.sectionBits, SnapshotPart::World);
+  full.size = fullStream.Finish();
+  if (fullStream.overflow) {
+    std::cerr << "Multiplayer snapshot exceeded " << kMaxSnapshotBytes << " bytes\n";
+    return;
+  }
+  state.lastFullSnapshotBytes = full.size;
+  StoreSnapshot(state.sentSnapshots, world);
+
+  // The world part encoded against `baseline` for `interest`, reusing this tick's encoding
+  // from an earlier peer with the same baseline and cell; falls back to the full one when
+  // the delta is no smaller.
+  auto WorldPart = [&](const MultiplayerPacket& baseline, const NetInterest* interest) -> const MultiplayerState::WorldEncoding& {
+    for (std::size_t i = 1; i < state.worldEncodingCount; ++i) {
+      const MultiplayerState::WorldEncoding& encoding = state.worldEncodings[i];
+      if (encoding.baselineSequence == baseline.sequence && encoding.hasInterest == (interest != nullptr) &&
+          (!interest || encoding.interest.SameCell(*interest))) {
+        return (encoding.size < full.size) ? encoding : full;
+      }
+    }
+    if (state.worldEncodingCount == state.worldEncodings.size()) {
+      return full;
+    }
+    MultiplayerState::WorldEncoding& encoding = state.worldEncodings[state.worldEncodingCount++];
+    encoding.baselineSequence = baseline.sequence;
+    encoding.hasInterest = interest != nullptr;
+    encoding.interest = interest ? *interest : NetInterest{};
+    encoding.interest.culled = 0;
+    std::fill(std::begin(encoding.sectionBits), std::end(encoding.sectionBits), 0u);
+    SnapshotStream delta = SnapshotStream::Writer(encoding.bytes.data(), encoding.bytes.size());
+    delta.positionRange = state.positionRange;
+    SerializeSnapshotBody(delta, world, baseline, encoding.sectionBits, SnapshotPart::World,
+                          encoding.hasInterest ? &encoding.interest : nullptr);
+    encoding.size = delta.Finish();
+    if (delta.overflow) {
+      encoding.size = kMaxSnapshotBytes;
+    }
+    return (encoding.size < full.size) ? encoding : full;
+  };
+
+  // Same clock as the receive thread's arrival stamps.
+  const double sendTime = glfwGetTime();
+  for (std::size_t peerIndex = 0; peerIndex < state.peers.size(); ++peerIndex) {
+    NetPeer& peer = state.peers[peerIndex];
+    // A client keeps sending to its host, which is how it joins; a host drops quiet clients.
+    if (peer.seenGeneration == 0u || (state.host && !PeerIsServed(peer, static_cast<float>(sendTime)))) {
+      continue;
+    }
+    world.ackSequence = peer.remoteAckSequence.load(std::memory_order_relaxed);
+    world.ackedInputCommand = peer.lastRemoteCommand;
+    world.sendTimeMs = std::max(1u, static_cast<std::uint32_t>(sendTime * 1000.0));
+    world.echoTimeMs = 0u;
+    if (peer.remoteSendTimeMs != 0u) {
+      world.echoTimeMs = peer.remoteSendTimeMs +
+                         static_cast<std::uint32_t>(glm::max(0.0, sendTime - peer.remoteSendArrival) * 1000.0);
+    }
+    if (state.host) {
+      GatherRelayedPlayers(state, peerIndex, static_cast<float>(sendTime), world.players);
+    }
+
+    // A baseline needs both the shared world snapshot and the players this peer was sent.
+    const MultiplayerPacket* baseline = nullptr;
+    const NetPeer::SentPlayers* baselinePlayers = nullptr;
+    const std::uint32_t peerAckedSequence = peer.peerAckedSequence.load(std::memory_order_relaxed);
+    if (world.sequence - peerAckedSequence < kSnapshotHistorySize) {
+      baseline = FindSnapshot(state.sentSnapshots, peerAckedSequence);
+      const NetPeer::SentPlayers& sent = peer.sentPlayers[peerAckedSequence % peer.sentPlayers.size()];
+      baselinePlayers = (sent.sequence == peerAckedSequence) ? &sent : nullptr;
+    }
+    const MultiplayerState::WorldEncoding* worldPart = &full;
+    if (baseline && baselinePlayers) {
+      NetInterest interest;
+      const bool culls = state.host && peer.hasRemote;
+      if (culls) {
+        interest = NetInterest::ForPosition(peer.latest.pos);
+      }
+      worldPart = &WorldPart(*baseline, culls ? &interest : nullptr);
+    }
+    peer.lastCulledEntities = worldPart->hasInterest ? worldPart->interest.culled : 0;
+
+    // The per-peer part is only delta-coded when the world part is, so the header names one
+    // baseline for both.
+    MultiplayerPacket& playersBaseline = state.peerBaseline;
+    playersBaseline.players.clear();
+    std::uint32_t baselineSequence = 0u;
+    if (worldPart != &full) {
+      playersBaseline.players = baselinePlayers->players;
+      baselineSequence = worldPart->baselineSequence;
+    }
+    std::uint32_t sectionBits[kNetSectionCount] = {};
+    SnapshotStream prefix = SnapshotStream::Writer(state.peerEncoding.data(), state.peerEncoding.size());
+    prefix.positionRange = state.positionRange;
+    SerializeSnapshotHeader(prefix, world, baselineSequence);
+    SerializeSnapshotBody(prefix, world, playersBaseline, sectionBits, SnapshotPart::Players);
+    const std::size_t prefixSize = prefix.Finish();
+    if (prefix.overflow || prefixSize + worldPart->size > kMaxSnapshotBytes) {
+      std::cerr << "Multiplayer snapshot exceeded " << kMaxSnapshotBytes << " bytes\n";
+      continue;
+    }
+    NetPeer::SentPlayers& sentPlayers = peer.sentPlayers[world.sequence % peer.sentPlayers.size()];
+    sentPlayers.sequence = world.sequence;
+    sentPlayers.players = world.players;
+
+    // Fragment so no datagram outgrows a typical MTU; the receiver reassembles by sequence.
+    // Fragments are cut from the per-peer bytes followed by the shared world part.
+    const std::size_t wireSize = prefixSize + worldPart->size;
+    const std::size_t fragmentCount = (wireSize + kNetFragmentPayloadBytes - 1) / kNetFragmentPayloadBytes;
+    std::uint8_t datagram[kNetFragmentHeaderBytes + kNetFragmentPayloadBytes];
+    for (std::size_t index = 0; index < fragmentCount; ++index) {
+      SnapshotStream header = SnapshotStream::Writer(datagram, kNetFragmentHeaderBytes);
+      std::uint32_t magic = kNetFragmentMagic;
+      std::uint32_t fragmentIndex = static_cast<std::uint32_t>(index);
+      std::uint32_t fragments = static_cast<std::uint32_t>(fragmentCount);
+      header.Integer(magic, 32);
+      header.Integer(world.sequence, 32);
+      header.Integer(fragmentIndex, 8);
+      header.Integer(fragments, 8);
+      const std::size_t offset = index * kNetFragmentPayloadBytes;
+      const std::size_t payloadSize = std::min(kNetFragmentPayloadBytes, wireSize - offset);
+      std::uint8_t* payload = datagram + kNetFragmentHeaderBytes;
+      const std::size_t fromPrefix = (offset < prefixSize) ? std::min(payloadSize, prefixSize - offset) : 0;
+      std::memcpy(payload, state.peerEncoding.data() + offset, fromPrefix);
+      if (payloadSize > fromPrefix) {
+        std::memcpy(payload + fromPrefix, worldPart->bytes.data() + (offset + fromPrefix - prefixSize),
+                    payloadSize - fromPrefix);
+      }
+      const int sent = sendto(state.socket,
+                              reinterpret_cast<const char*>(datagram),
+                              static_cast<int>(kNetFragmentHeaderBytes + payloadSize),
+                              0,
+                              reinterpret_cast<const sockaddr*>(&peer.addr),
+                              sizeof(peer.addr));
+      if (sent > 0) {
+        ++state.stats.totals.packetsSent;
+        state.stats.totals.bytesSent += static_cast<std::uint64_t>(sent);
+      }
+    }
+    ++state.stats.totals.snapshotsSent;
+    for (int section = 0; section < kNetSectionCount; ++section) {
+      state.stats.totals.sectionBits[section] += sectionBits[section] + worldPart->sectionBits[section];
+    }
+    peer.lastSnapshotBytes = wireSize;
+    peer.lastSnapshotFragments = fragmentCount;
+  }
+}
+
+// Closes the current one-second window into the stats history. Call once a frame.
+static void SampleNetStats(MultiplayerState& state, float now) {
+  NetStats& stats = state.stats;
+  if (!state.active) {
+    return;
+  }
+  NetCounters& totals = stats.totals;
+  totals.packetsReceived = state.packetsReceived.load(std::memory_order_relaxed);
+  totals.bytesReceived = state.bytesReceived.load(std::memory_order_relaxed);
+  totals.outOfOrder = state.staleReceived.load(std::memory_order_relaxed);
+  if (stats.windowStart < 0.0f) {
+    stats.windowStart = now;
+    stats.windowTotals = totals;
+    return;
+  }
+  const float elapsed = now - stats.windowStart;
+  if (elapsed < 1.0f) {
+    return;
+  }
+
+  const NetCounters& start = stats.windowTotals;
+  auto Rate = [&](std::uint64_t current, std::uint64_t previous) {
+    return static_cast<float>(current - previous) / elapsed;
+  };
+  NetStatsSample& sample = stats.history.PushBack();
+  sample.time = now;
+  sample.packetsSent = Rate(totals.packetsSent, start.packetsSent);
+  sample.packetsReceived = Rate(totals.packetsReceived, start.packetsReceived);
+  sample.sentKiB = Rate(totals.bytesSent, start.bytesSent) / 1024.0f;
+  sample.receivedKiB = Rate(totals.bytesReceived, start.bytesReceived) / 1024.0f;
+  sample.outOfOrder = Rate(totals.outOfOrder, start.outOfOrder);
+  const std::uint64_t received = totals.snapshotsReceived - start.snapshotsReceived;
+  const std::uint64_t lost = totals.snapshotsLost - start.snapshotsLost;
+  sample.lossPercent = (received + lost) > 0u ? 100.0f * static_cast<float>(lost) / static_cast<float>(received + lost) : 0.0f;
+  sample.rttMs = 0.0f;
+  for (const NetPeer& peer : state.peers) {
+    if (peer.hasRtt && PeerIsFresh(peer, now)) {
+      sample.rttMs = glm::max(sample.rttMs, peer.rttMs);
+    }
+  }
+  sample.snapshotsSent = Rate(totals.snapshotsSent, start.snapshotsSent);
+  const std::uint64_t snapshots = totals.snapshotsSent - start.snapshotsSent;
+  for (int section = 0; section < kNetSectionCount; ++section) {
+    const std::uint64_t bits = totals.sectionBits[section] - start.sectionBits[section];
+    sample.sectionBytes[section] = snapshots > 0u ? static_cast<float>(bits) / (8.0f * static_cast<float>(snapshots)) : 0.0f;
+  }
+  stats.windowStart = now;
+  stats.windowTotals = totals;
+}
+
+static bool WriteNetStatsCsv(const NetStats& stats) {
+  std::ofstream file(kNetStatsFile, std::ios::trunc);
+  if (!file) {
+    std::cerr << "Failed to write " << kNetStatsFile << "\n";
+    return false;
+  }
+  file << "time_s,packets_sent_per_s,packets_received_per_s,sent_kib_per_s,received_kib_per_s,"
+          "out_of_order_per_s,loss_percent,rtt_ms,snapshots_sent_per_s";
+  for (const char* name : kNetSectionNames) {
+    file << ",bytes_";
+    for (const char* c = name; *c != '\0'; ++c) {
+      file << static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+    }
+  }
+  file << "\n";
+  char line[96];
+  for (std::size_t i = 0; i < stats.history.Size(); ++i) {
+    const NetStatsSample& sample = stats.history[i];
+    std::snprintf(line, sizeof(line), "%.3f,%.1f,%.1f,%.3f,%.3f,%.1f,%.2f,%.2f,%.1f", sample.time, sample.packetsSent,
+                  sample.packetsReceived, sample.sentKiB, sample.receivedKiB, sample.outOfOrder, sample.lossPercent,
+                  sample.rttMs, sample.snapshotsSent);
+    file << line;
+    for (float bytes : sample.sectionBytes) {
+      std::snprintf(line, sizeof(line), ",%.1f", bytes);
+      file << line;
+    }
+    file << "\n";
+  }
+  std::cout << "Wrote " << stats.history.Size() << " network samples to " << kNetStatsFile << "\n";
+  return true;
+}
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    std::cerr << "Failed to open file: " << path << "\n";
+    return "";
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// Samples are borrowed from ProceduralAssets, which outlives the audio engine.
+struct Sound {
+  ma_audio_buffer buffer{};
+  ma_sound sound{};
+};
+
+// A fixed set of voices over one effect's samples, so overlapping plays layer instead of
+// restarting each other. Every voice owns an ma_audio_buffer over the shared samples (a
+// data source has a single read cursor) and an ma_sound, all made at startup: playing
+// never allocates and a pool never has more than its voices running on the mixing
+// thread. Positional pools are placed in 3D and attenuated by miniaudio's inverse
+// distance model. A play's priority is how loud it would be; one that is too faint, or
+// quieter than every voice a Steal::Quietest pool could give up, is culled instead.
+struct SoundPool {
+  enum class Steal { Oldest, Quietest };
+  static constexpr int kMaxVoices = 8;
+
+  struct Voice {
+    ma_audio_buffer buffer{};
+    ma_sound sound{};
+    float audibility = 0.0f;    // Volume times distance attenuation at the start.
+    std::uint64_t started = 0;  // Play order, for Steal::Oldest.
+  };
+
+  Voice voices[kMaxVoices];
+  int voiceCount = 0;
+  ma_uint64 frames = 0;
+  Steal steal = Steal::Oldest;
+  float volume = 1.0f;
+  float minDistance = 1.0f;  // Full volume inside this radius.
+  float maxDistance = 0.0f;  // Plays beyond this are culled; 0 makes the pool non-positional.
+  std::uint64_t plays = 0;
+  int stolen = 0;
+  int culled = 0;
+};
+
+struct AudioState {
+  ma_engine engine{};
+  ma_sound_group sfx{};       // Every effect; the SFX volume slider sets its volume.
+  glm::vec3 listener{0.0f};  // Camera position last given to the engine.
+  bool ready = false;
+  SoundPool footstep;
+  SoundPool jump;
+  SoundPool land;
+  Sound ambient;
+  Sound chase;
+  SoundPool explosion;
+  SoundPool hurt;
+};
+
+static float RandomFloat(unsigned int& seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return static_cast<float>((seed >> 8) & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+}
+
+// Stand-in player for headless runs: holds a random WASD heading for one to two seconds,
+// sprints some of the time, hops regularly and uses its held item every few seconds.
+// Fully determined by the seed, so runs with the same arguments simulate the same game.
+struct InputScript {
+  unsigned int seed = 1u;
+  std::uint32_t nextChange = 0u;
+  FrameInput held;
+
+  FrameInput Next(std::uint32_t step) {
+    if (step >= nextChange) {
+      held = FrameInput{};
+      held.forward = RandomFloat(seed) < 0.75f;
+      held.backward = !held.forward && RandomFloat(seed) < 0.5f;
+      const float strafe = RandomFloat(seed);
+      held.left = strafe < 0.3f;
+      held.right = strafe > 0.7f;
+      held.sprint = RandomFloat(seed) < 0.4f;
+      nextChange = step + 120u + static_cast<std::uint32_t>(RandomFloat(seed) * 120.0f);
+    }
+    FrameInput input = held;
+    input.jump = (step % 150u) < 4u;
+    input.useItem = (step % 420u) == 300u;
+    return input;
+  }
+};
+
+static constexpr std::uint32_t kInputReplayMagic = 0x50523356u;  // "V3RP"
+static constexpr std::uint32_t kInputReplayVersion = 1u;
+
+// Everything besides per-frame input that shapes a session: the clock it started at, the
+// personality seed streams, the starting difficulty and the scenario (level 1 as authored
+// for windowed play).
+struct InputReplayHeader {
+  std::uint32_t magic = kInputReplayMagic;
+  std::uint32_t version = kInputReplayVersion;
+  float startTime = 0.0f;
+  std::uint32_t catSeed = 42u;
+  std::uint32_t dogSeed = 9001u;
+  std::uint32_t difficulty = 0u;
+  std::uint32_t level = 1u;
+  std::uint32_t cats = 0u;
+  std::uint32_t dogs = 0u;
+  std::uint32_t bombs = 0u;
+  std::uint32_t scenarioSeed = 1u;
+};
+
+// One loop iteration: the frame clock it read (level timers, camera smoothing, animation), how
+// many fixed steps it ran, the difficulty in force and the input it read.
+struct ReplayFrame {
+  float time = 0.0f;
+  std::uint32_t simSteps = 0u;
+  std::uint32_t difficulty = 0u;
+  FrameInput input;
+};
+
+// Replay logs are bit-packed with the snapshot stream, so they read the same on any host.
+// Floats go out raw, which is what makes a replay bit-exact; a frame is 7 bytes, 15 while
+// the camera orbits.
+static void SerializeReplayHeader(SnapshotStream& stream, InputReplayHeader& header) {
+  stream.Bits(header.magic, 32);
+  stream.Bits(header.version, 8);
+  stream.RawFloat(header.startTime);
+  stream.Bits(header.catSeed, 32);
+  stream.Bits(header.dogSeed, 32);
+  stream.Integer(header.difficulty, 2);
+  stream.Integer(header.level, 2);
+  stream.Bits(header.cats, 32);
+  stream.Bits(header.dogs, 32);
+  stream.Bits(header.bombs, 32);
+  stream.Bits(header.scenarioSeed, 32);
+}
+
+static void SerializeReplayFrame(SnapshotStream& stream, ReplayFrame& frame) {
+  FrameInput& input = frame.input;
+  bool* const buttons[] = {&input.forward, &input.backward, &input.left,    &input.right,
+                           &input.jump,    &input.sprint,   &input.pauseA,  &input.pauseB,
+                           &input.useItem, &input.dropItem, &input.orbit};
+  for (bool* button : buttons) {
+    std::uint32_t bit = *button ? 1u : 0u;
+    stream.Bits(bit, 1);
+    *button = bit != 0u;
+  }
+  std::uint32_t turned = (input.orbitYaw != 0.0f || input.orbitPitch != 0.0f) ? 1u : 0u;
+  stream.Bits(turned, 1);
+  stream.Integer(frame.simSteps, 3);
+  stream.Integer(frame.difficulty, 2);
+  stream.Integer(input.actions, 3);
+  stream.RawFloat(frame.time);
+  if (turned != 0u) {
+    stream.RawFloat(input.orbitYaw);
+    stream.RawFloat(input.orbitPitch);
+  } else {
+    input.orbitYaw = 0.0f;
+    input.orbitPitch = 0.0f;
+  }
+}
+
+// Appends each frame as it happens, so a session that crashes still leaves a replayable
+// prefix. Frames go through the stream's buffer, which keeps the frame loop allocation-free.
+struct InputRecorder {
+  std::ofstream file;
+
+  bool Active() const { return file.is_open(); }
+
+  bool Open(const std::string& path, InputReplayHeader header) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "Failed to open replay log " << path << " for writing\n";
+      return false;
+    }
+    std::uint8_t bytes[64];
+    SnapshotStream stream = SnapshotStream::Writer(bytes, sizeof(bytes));
+    SerializeReplayHeader(stream, header);
+    file.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(stream.Finish()));
+    return true;
+  }
+
+  void Write(ReplayFrame frame) {
+    std::uint8_t bytes[16];
+    SnapshotStream stream = SnapshotStream::Writer(bytes, sizeof(bytes));
+    SerializeReplayFrame(stream, frame);
+    file.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(stream.Finish()));
+  }
+};
+
+static bool LoadInputReplay(const std::string& path, InputReplayHeader& header, std::vector<ReplayFrame>& frames) {
+  std::string bytes = ReadFile(path);
+  if (bytes.empty()) {
+    return false;
+  }
+  std::uint8_t* data = reinterpret_cast<std::uint8_t*>(&bytes[0]);
+  SnapshotStream stream = SnapshotStream::Reader(data, bytes.size());
+  SerializeReplayHeader(stream, header);
+  if (stream.overflow || header.magic != kInputReplayMagic || header.version != kInputReplayVersion) {
+    std::cerr << path << " is not a replay log from this version\n";
+    return false;
+  }
+  std::size_t offset = stream.Finish();
+  frames.clear();
+  while (offset < bytes.size()) {
+    SnapshotStream frameStream = SnapshotStream::Reader(data + offset, bytes.size() - offset);
+    ReplayFrame frame;
+    SerializeReplayFrame(frameStream, frame);
+    if (frameStream.overflow) {
+      break;  // Cut off mid-frame by a crash; everything before it still replays.
+    }
+    frames.push_back(frame);
+    offset += frameStream.bytePos;
+  }
+  return true;
+}
+
+static std::vector<float> GenerateFootstep(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.08f);
+  std::vector<float> data(frames);
+  unsigned int seed = 1337u;
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(frames);
+    const float env = std::exp(-t * 8.0f);
+    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.4f;
+    const float tone = std::sin(2.0f * 3.14159f * 110.0f * t) * 0.25f;
+    data[i] = (noise + tone) * env;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateJump(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.2f);
+  std::vector<float> data(frames);
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(frames);
+    const float freq = 240.0f + t * 420.0f;
+    const float env = std::exp(-t * 4.0f);
+    data[i] = std::sin(2.0f * 3.14159f * freq * t) * env * 0.35f;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateLand(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.12f);
+  std::vector<float> data(frames);
+  unsigned int seed = 999u;
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(frames);
+    const float env = std::exp(-t * 10.0f);
+    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.25f;
+    const float tone = std::sin(2.0f * 3.14159f * 80.0f * t) * 0.4f;
+    data[i] = (noise + tone) * env;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateAmbient(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 4.0f);
+  std::vector<float> data(frames);
+  unsigned int seed = 4242u;
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
+    const float hum = std::sin(2.0f * 3.14159f * 55.0f * t) * 0.12f +
+                      std::sin(2.0f * 3.14159f * 110.0f * t) * 0.07f;
+    const float noise = (RandomFloat(seed) * 2.0f - 1.0f) * 0.02f;
+    data[i] = hum + noise;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateChase(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.45f);
+  std::vector<float> data(frames);
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(frames);
+    const float freq = 160.0f + t * 260.0f;
+    const float env = std::exp(-t * 3.5f);
+    data[i] = std::sin(2.0f * 3.14159f * freq * t) * env * 0.5f;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateExplosion(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.55f);
+  std::vector<float> data(frames);
+  unsigned int seed = 31337u;
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
+    const float env = std::exp(-t * 8.2f);
+    const float low = std::sin(2.0f * 3.14159f * (42.0f + t * 35.0f) * t) * 0.7f;
+    const float crack = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 16.0f) * 0.6f;
+    const float hiss = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 5.0f) * 0.18f;
+    data[i] = (low + crack + hiss) * env;
+  }
+  return data;
+}
+
+static std::vector<float> GenerateHurt(int sampleRate) {
+  const int frames = static_cast<int>(sampleRate * 0.16f);
+  std::vector<float> data(frames);
+  unsigned int seed = 7707u;
+  for (int i = 0; i < frames; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
+    const float env = std::exp(-t * 18.0f);
+    const float tone = std::sin(2.0f * 3.14159f * (290.0f - t * 140.0f) * t) * 0.45f;
+    const float grit = (RandomFloat(seed) * 2.0f - 1.0f) * std::exp(-t * 26.0f) * 0.25f;
+    data[i] = (tone + grit) * env;
+  }
+  return data;
+}
+
+static bool CreateSound(ma_engine& engine, ma_sound_group* group, Sound& sound, const float* samples,
+                        std::size_t frames, bool loop) {
+  ma_audio_buffer_config config = ma_audio_buffer_config_init(
+      ma_format_f32, 1, static_cast<ma_uint32>(frames), samples, nullptr);
+  if (ma_audio_buffer_init(&config, &sound.buffer) != MA_SUCCESS) {
+    return false;
+  }
+  if (ma_sound_init_from_data_source(&engine, &sound.buffer, MA_SOUND_FLAG_NO_SPATIALIZATION, group, &sound.sound) != MA_SUCCESS) {
+    return false;
+  }
+  ma_sound_set_looping(&sound.sound, loop ? MA_TRUE : MA_FALSE);
+  return true;
+}
+
+static void PlaySound(Sound& sound) {
+  ma_sound_seek_to_pcm_frame(&sound.sound, 0);
+  ma_sound_start(&sound.sound);
+}
+
+// Expects steal, volume and the distances to be set; voices that fail to initialize are
+// left out of the pool.
+static void CreateSoundPool(ma_engine& engine, ma_sound_group& group, SoundPool& pool, const float* samples,
+                            std::size_t frames, int voiceCount) {
+  const bool positional = pool.maxDistance > 0.0f;
+  pool.frames = frames;
+  pool.voiceCount = 0;
+  for (int i = 0; i < std::min(voiceCount, SoundPool::kMaxVoices); ++i) {
+    SoundPool::Voice& voice = pool.voices[pool.voiceCount];
+    ma_audio_buffer_config config = ma_audio_buffer_config_init(
+        ma_format_f32, 1, static_cast<ma_uint32>(frames), samples, nullptr);
+    if (ma_audio_buffer_init(&config, &voice.buffer) != MA_SUCCESS) {
+      break;
+    }
+    const ma_uint32 flags = positional ? 0u : static_cast<ma_uint32>(MA_SOUND_FLAG_NO_SPATIALIZATION);
+    if (ma_sound_init_from_data_source(&engine, &voice.buffer, flags, &group, &voice.sound) != MA_SUCCESS) {
+      ma_audio_buffer_uninit(&voice.buffer);
+      break;
+    }
+    ma_sound_set_volume(&voice.sound, pool.volume);
+    if (positional) {
+      ma_sound_set_attenuation_model(&voice.sound, ma_attenuation_model_inverse);
+      ma_sound_set_rolloff(&voice.sound, 1.0f);
+      ma_sound_set_min_distance(&voice.sound, pool.minDistance);
+      ma_sound_set_max_distance(&voice.sound, pool.maxDistance);
+    }
+    ++pool.voiceCount;
+  }
+}
+
+static void DestroySoundPool(SoundPool& pool) {
+  for (int i = 0; i < pool.voiceCount; ++i) {
+    ma_sound_uninit(&pool.voices[i].sound);
+    ma_audio_buffer_uninit(&pool.voices[i].buffer);
+  }
+  pool.voiceCount = 0;
+}
+
+static int PlayingVoices(const SoundPool& pool) {
+  int playing = 0;
+  for (int i = 0; i < pool.voiceCount; ++i) {
+    playing += ma_sound_is_playing(&pool.voices[i].sound) ? 1 : 0;
+  }
+  return playing;
+}
+
+// The gain miniaudio's inverse model (rolloff 1) gives a voice at this distance.
+static float SoundPoolGain(const SoundPool& pool, float distance) {
+  if (pool.maxDistance <= 0.0f) {
+    return pool.volume;
+  }
+  const float clamped = glm::clamp(distance, pool.minDistance, pool.maxDistance);
+  return pool.volume * pool.minDistance / clamped;
+}
+
+// Plays below this gain (about -30 dB) are not worth a voice.
+static constexpr float kMinAudibleGain = 0.03f;
+
+static void PlaySoundAt(SoundPool& pool, const glm::vec3& position, const glm::vec3& listener) {
+  const bool positional = pool.maxDistance > 0.0f;
+  const float distance = positional ? glm::distance(position, listener) : 0.0f;
+  const float audibility = SoundPoolGain(pool, distance);
+  if (pool.voiceCount == 0 || distance > pool.maxDistance || audibility < kMinAudibleGain) {
+    ++pool.culled;
+    return;
+  }
+
+  SoundPool::Voice* target = nullptr;
+  SoundPool::Voice* victim = nullptr;
+  float victimLevel = 0.0f;
+  for (int i = 0; i < pool.voiceCount && target == nullptr; ++i) {
+    SoundPool::Voice& voice = pool.voices[i];
+    if (!ma_sound_is_playing(&voice.sound)) {
+      target = &voice;
+    } else if (pool.steal == SoundPool::Steal::Oldest) {
+      if (victim == nullptr || voice.started < victim->started) {
+        victim = &voice;
+      }
+    } else {
+      // The procedural effects decay over their length, so scale by what is left to play.
+      ma_uint64 cursor = 0;
+      ma_sound_get_cursor_in_pcm_frames(&voice.sound, &cursor);
+      const float remaining = 1.0f - static_cast<float>(cursor) / static_cast<float>(std::max<ma_uint64>(pool.frames, 1));
+      const float level = voice.audibility * glm::clamp(remaining, 0.0f, 1.0f);
+      if (victim == nullptr || level < victimLevel) {
+        victim = &voice;
+        victimLevel = level;
+      }
+    }
+  }
+  if (target == nullptr) {
+    if (pool.steal == SoundPool::Steal::Quietest && audibility <= victimLevel) {
+      ++pool.culled;
+      return;
+    }
+    ma_sound_stop(&victim->sound);
+    target = victim;
+    ++pool.stolen;
+  }
+
+  target->audibility = audibility;
+  target->started = ++pool.plays;
+  if (positional) {
+    ma_sound_set_position(&target->sound, position.x, position.y, position.z);
+  }
+  ma_sound_seek_to_pcm_frame(&target->sound, 0);
+  ma_sound_start(&target->sound);
+}
+
+// For non-positional pools: the player's own sounds.
+static void PlaySound(SoundPool& pool) { PlaySoundAt(pool, glm::vec3(0.0f), glm::vec3(0.0f)); }
+
+struct UniformHandle {
+  GLint location = -1;
+};
+
+struct Shader {
+  GLuint id = 0;
+  UniformHandle model;
+  UniformHandle normalMatrix;
+  UniformHandle tint;
+  // Filled from the program's active uniforms after linking; unknown names are added on first use.
+  mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+  bool Load(const std::string& vertPath, const std::string& fragPath) {
+    const std::string vertSrc = ReadFile(vertPath);
+    const std::string fragSrc = ReadFile(fragPath);
+    if (vertSrc.empty() || fragSrc.empty()) {
+      return false;
+    }
+
+    const char* vertCStr = vertSrc.c_str();
+    const char* fragCStr = fragSrc.c_str();
+
+    GLuint vert = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vert, 1, &vertCStr, nullptr);
+    glCompileShader(vert);
+
+    GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(frag, 1, &fragCStr, nullptr);
+    glCompileShader(frag);
+
+    GLint success = 0;
+    glGetShaderiv(vert, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      char log[512] = {};
+      glGetShaderInfoLog(vert, sizeof(log), nullptr, log);
+      std::cerr << "Vertex shader error: " << log << "\n";
+      return false;
+    }
+
+    glGetShaderiv(frag, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      char log[512] = {};
+      glGetShaderInfoLog(frag, sizeof(log), nullptr, log);
+      std::cerr << "Fragment shader error: " << log << "\n";
+      return false;
+    }
+
+    id = glCreateProgram();
+    glAttachShader(id, vert);
+    glAttachShader(id, frag);
+    glLinkProgram(id);
+
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    if (!success) {
+      char log[512] = {};
+      glGetProgramInfoLog(id, sizeof(log), nullptr, log);
+      std::cerr << "Shader link error: " << log << "\n";
+      return false;
+    }
+
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    CacheUniforms();
+    return true;
+  }
+
+  void CacheUniforms() {
+    uniformLocations.clear();
+    GLint count = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+      char name[128] = {};
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(id, static_cast<GLuint>(i), sizeof(name), &length, &size, &type, name);
+      std::string uniformName(name, static_cast<std::size_t>(length));
+      const std::size_t bracket = uniformName.find('[');
+      if (bracket != std::string::npos) {
+        uniformName.resize(bracket);
+      }
+      uniformLocations[uniformName] = glGetUniformLocation(id, uniformName.c_str());
+    }
+    model.location = Location("uModel");
+    normalMatrix.location = Location("uNormalMatrix");
+    tint.location = Location("uTint");
+  }
+
+  GLint Location(const char* name) const {
+    const auto it = uniformLocations.find(name);
+    if (it != uniformLocations.end()) {
+      return it->second;
+    }
+    // Not an active uniform (misspelled or optimized out). Log once and cache the answer.
+    const GLint location = glGetUniformLocation(id, name);
+    std::cerr << "Shader uniform '" << name << "' is not active (location " << location << ")\n";
+    uniformLocations.emplace(name, location);
+    return location;
+  }
+
+  void Use() const {
+    glUseProgram(id);
+  }
+
+  void SetMat4(UniformHandle handle, const glm::mat4& value) const {
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+  }
+
+  void SetVec3(UniformHandle handle, const glm::vec3& value) const {
+    glUniform3fv(handle.location, 1, glm::value_ptr(value));
+  }
+
+  void SetMat3(UniformHandle handle, const glm::mat3& value) const {
+    glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+  }
+
+  void SetFloat(UniformHandle handle, float value) const {
+    glUniform1f(handle.location, value);
+  }
+
+  void SetMat4(const char* name, const glm::mat4& value) const {
+    glUniformMatrix4fv(Location(name), 1, GL_FALSE, glm::value_ptr(value));
+  }
+
+  void SetVec3(const char* name, const glm::vec3& value) const {
+    glUniform3fv(Location(name), 1, glm::value_ptr(value));
+  }
+
+  void SetMat3(const char* name, const glm::mat3& value) const {
+    glUniformMatrix3fv(Location(name), 1, GL_FALSE, glm::value_ptr(value));
+  }
+
+  void SetInt(const char* name, int value) const {
+    glUniform1i(Location(name), value);
+  }
+
+  void SetFloat(const char* name, float value) const {
+    glUniform1f(Location(name), value);
+  }
+};
+
+// Layer of the shared TextureArray; materials are selected per instance by layer, never by bind.
+using TextureLayer = std::uint32_t;
+
+// RGB8 pixels of one square procedural texture.
+struct TextureImage {
+  int size = 0;
+  std::vector<unsigned char> pixels;
+};
+
+// Every procedural texture packed into one GL_TEXTURE_2D_ARRAY, bound once per frame.
+// Smaller images are upsampled by pixel replication to kLayerSize, which keeps their
+// texel grid (and look) unchanged, and byte-identical images share a layer.
+struct TextureArray {
+  static constexpr int kLayerSize = 128;
+
+  GLuint id = 0;
+  std::vector<TextureImage> layers;
+
+  TextureLayer Add(int size, const unsigned char* pixels) {
+    TextureImage image{kLayerSize, std::vector<unsigned char>(kLayerSize * kLayerSize * 3)};
+    const int scale = kLayerSize / size;
+    for (int y = 0; y < kLayerSize; ++y) {
+      for (int x = 0; x < kLayerSize; ++x) {
+        const unsigned char* src = &pixels[((y / scale) * size + x / scale) * 3];
+        std::copy(src, src + 3, &image.pixels[(y * kLayerSize + x) * 3]);
+      }
+    }
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+      if (layers[i].pixels == image.pixels) {
+        return static_cast<TextureLayer>(i);
+      }
+    }
+    layers.push_back(std::move(image));
+    return static_cast<TextureLayer>(layers.size() - 1);
+  }
+
+  void Upload() {
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, kLayerSize, kLayerSize, static_cast<GLsizei>(layers.size()), 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), kLayerSize, kLayerSize, 1, GL_RGB,
+                      GL_UNSIGNED_BYTE, layers[i].pixels.data());
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    layers.clear();
+  }
+
+  void Shutdown() {
+    glDeleteTextures(1, &id);
+    id = 0;
+  }
+};
+
+struct CubeInstance {
+  glm::mat4 model;
+  glm::mat3 normalMatrix;
+  glm::vec3 tint;
+  float layer = 0.0f;
+};
+
+static glm::mat3 RotationX(float angle) {
+  const float c = std::cos(angle);
+  const float s = std::sin(angle);
+  return glm::mat3(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, c, s), glm::vec3(0.0f, -s, c));
+}
+
+static glm::mat3 RotationY(float angle) {
+  const float c = std::cos(angle);
+  const float s = std::sin(angle);
+  return glm::mat3(glm::vec3(c, 0.0f, -s), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(s, 0.0f, c));
+}
+
+static glm::mat3 RotationZ(float angle) {
+  const float c = std::cos(angle);
+  const float s = std::sin(angle);
+  return glm::mat3(glm::vec3(c, s, 0.0f), glm::vec3(-s, c, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+// Rigid joint frame (rotation + translation) in an articulated model's hierarchy. A model
+// builds its root once and each child composes onto its parent with the same post-multiply
+// order as glm::translate/glm::rotate. Cubes hang off a joint with a per-axis scale, so
+// their model is rotation * scale and the normal matrix, inverse(R * S)^T = R * S^-1, is
+// the rotation's columns divided by the scale rather than a general 3x3 inverse.
+struct JointTransform {
+  glm::mat3 rotation{1.0f};
+  glm::vec3 translation{0.0f};
+
+  static JointTransform At(const glm::vec3& position) {
+    JointTransform joint;
+    joint.translation = position;
+    return joint;
+  }
+
+  JointTransform Translated(const glm::vec3& offset) const { return {rotation, translation + rotation * offset}; }
+  JointTransform RotatedX(float angle) const { return {rotation * RotationX(angle), translation}; }
+  JointTransform RotatedY(float angle) const { return {rotation * RotationY(angle), translation}; }
+  JointTransform RotatedZ(float angle) const { return {rotation * RotationZ(angle), translation}; }
+  // Same order as three glm::rotate calls: X, then Y, then Z.
+  JointTransform RotatedXYZ(const glm::vec3& angles) const {
+    return {rotation * RotationX(angles.x) * RotationY(angles.y) * RotationZ(angles.z), translation};
+  }
+
+  // Offsets measured in a scaled child's space, as glm::translate after glm::scale would.
+  JointTransform TranslatedScaled(const glm::vec3& scale, const glm::vec3& offset) const {
+    return Translated(scale * offset);
+  }
+};
+
+static CubeInstance MakeCubeInstance(const JointTransform& joint, const glm::vec3& scale, const glm::vec3& tint,
+                                     TextureLayer layer) {
+  CubeInstance instance;
+  instance.model = glm::mat4(1.0f);
+  for (int axis = 0; axis < 3; ++axis) {
+    instance.model[axis] = glm::vec4(joint.rotation[axis] * scale[axis], 0.0f);
+    instance.normalMatrix[axis] = joint.rotation[axis] / scale[axis];
+  }
+  instance.model[3] = glm::vec4(joint.translation, 1.0f);
+  instance.tint = tint;
+  instance.layer = static_cast<float>(layer);
+  return instance;
+}
+
+// Collects every cube drawn during a frame and submits them as one instanced draw. Materials
+// are TextureArray layers carried per instance, so nothing is sorted or split by texture.
+struct RenderQueue {
+  static constexpr int kMaxCasterRanges = 8;
+
+  struct Range {
+    std::size_t first = 0;
+    std::size_t count = 0;
+  };
+
+  GLuint instanceVbo = 0;
+  std::size_t instanceCapacity = 0;
+  std::vector<CubeInstance> entries;
+  // Spans of entries that also render into the dynamic shadow map, marked while building.
+  Range casterRanges[kMaxCasterRanges];
+  int casterRangeCount = 0;
+  std::size_t casterStart = 0;
+  int lastDrawCalls = 0;
+  int lastInstanceCount = 0;
+
+  // Instance attributes: model matrix at locations 3-6, normal matrix at 7-9, tint at 10, layer at 11.
+  void BindInstanceAttributes() const {
+    const GLsizei stride = static_cast<GLsizei>(sizeof(CubeInstance));
+    for (GLuint column = 0; column < 4; ++column) {
+      glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride,
+                            reinterpret_cast<void*>(offsetof(CubeInstance, model) + column * sizeof(glm::vec4)));
+    }
+    for (GLuint column = 0; column < 3; ++column) {
+      glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, stride,
+                            reinterpret_cast<void*>(offsetof(CubeInstance, normalMatrix) + column * sizeof(glm::vec3)));
+    }
+    glVertexAttribPointer(10, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(CubeInstance, tint)));
+    glVertexAttribPointer(11, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(CubeInstance, layer)));
+  }
+
+  void Init(GLuint vao) {
+    glGenBuffers(1, &instanceVbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    for (GLuint location = 3; location <= 11; ++location) {
+      glEnableVertexAttribArray(location);
+      glVertexAttribDivisor(location, 1);
+    }
+    BindInstanceAttributes();
+    glBindVertexArray(0);
+  }
+
+  void Shutdown() {
+    glDeleteBuffers(1, &instanceVbo);
+    instanceVbo = 0;
+    instanceCapacity = 0;
+  }
+
+  void Push(const JointTransform& joint, const glm::vec3& scale, const glm::vec3& tint, TextureLayer layer) {
+    entries.push_back(MakeCubeInstance(joint, scale, tint, layer));
+  }
+
+  void Append(const std::vector<CubeInstance>& instances) {
+    entries.insert(entries.end(), instances.begin(), instances.end());
+  }
+
+  void BeginCasters() { casterStart = entries.size(); }
+
+  void EndCasters() {
+    const std::size_t end = entries.size();
+    if (end == casterStart) {
+      return;
+    }
+    Range* last = casterRangeCount > 0 ? &casterRanges[casterRangeCount - 1] : nullptr;
+    if (last != nullptr && (last->first + last->count == casterStart || casterRangeCount == kMaxCasterRanges)) {
+      // Adjacent, or out of ranges: widen the last one (any non-casters between just cast too).
+      last->count = end - last->first;
+      return;
+    }
+    casterRanges[casterRangeCount++] = {casterStart, end - casterStart};
+  }
+
+  // Uploads this frame's entries so the shadow pass can draw caster ranges before Draw.
+  void Upload() {
+    lastInstanceCount = static_cast<int>(entries.size());
+    if (entries.empty()) {
+      return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    if (entries.size() > instanceCapacity) {
+      instanceCapacity = glm::max<std::size_t>(entries.size(), instanceCapacity * 2);
+    }
+    // Orphan the previous frame's storage so the driver does not stall on in-flight draws.
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instanceCapacity * sizeof(CubeInstance)), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(entries.size() * sizeof(CubeInstance)), entries.data());
+  }
+
+  // Expects Upload to have run and the cube VAO and TextureArray to be bound.
+  void Draw(const Shader& shader) {
+    lastDrawCalls = 0;
+    casterRangeCount = 0;
+    if (entries.empty()) {
+      return;
+    }
+    shader.SetMat4(shader.model, glm::mat4(1.0f));
+    shader.SetMat3(shader.normalMatrix, glm::mat3(1.0f));
+    shader.SetVec3(shader.tint, glm::vec3(1.0f));
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(entries.size()));
+    lastDrawCalls = 1;
+    entries.clear();
+  }
+};
+
+// Backdrop geometry that never moves, pre-transformed to world space when the world is compiled.
+// Each world chunk uploads into its own VBO while it is streamed in; vertices are pos3, normal3,
+// uv2, tint3, layer1, drawn as one range per chunk.
+struct StaticScene {
+  static constexpr int kFloatsPerVertex = 12;
+
+  struct ChunkMesh {
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLsizei vertexCount = 0;
+    int cubeCount = 0;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+  };
+
+  std::vector<CubeInstance> pending;
+  std::vector<ChunkMesh> chunks;      // Indexed by world chunk.
+  std::vector<std::uint32_t> loaded;  // Chunks holding a mesh, in upload order.
+  int lastDrawCalls = 0;
+  int lastCubeCount = 0;
+
+  void Add(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& tint, TextureLayer layer) {
+    pending.push_back(MakeCubeInstance(JointTransform::At(position), scale, tint, layer));
+  }
+
+  // Flattens the pending cubes into world-space vertices; needs no GL context.
+  std::vector<float> BakeVertices(const float* cubeVertices, int cubeVertexCount) {
+    std::vector<float> vertices;
+    vertices.reserve(pending.size() * static_cast<std::size_t>(cubeVertexCount) * kFloatsPerVertex);
+    for (const CubeInstance& instance : pending) {
+      for (int v = 0; v < cubeVertexCount; ++v) {
+        const float* src = cubeVertices + v * 8;
+        const glm::vec3 worldPos = glm::vec3(instance.model * glm::vec4(src[0], src[1], src[2], 1.0f));
+        const glm::vec3 worldNormal = glm::normalize(instance.normalMatrix * glm::vec3(src[3], src[4], src[5]));
+        const float packed[kFloatsPerVertex] = {worldPos.x, worldPos.y, worldPos.z,
+                                                worldNormal.x, worldNormal.y, worldNormal.z,
+                                                src[6], src[7],
+                                                instance.tint.r, instance.tint.g, instance.tint.b,
+                                                instance.layer};
+        vertices.insert(vertices.end(), packed, packed + kFloatsPerVertex);
+      }
+    }
+    pending.clear();
+    return vertices;
+  }
+
+  // Sizes the chunk table for a new world. Call after Clear so no GL objects leak.
+  void Reset(std::size_t chunkCount) {
+    chunks.assign(chunkCount, ChunkMesh{});
+    loaded.clear();
+    loaded.reserve(chunkCount);
+  }
+
+  // Vertices arrive with their texture layers already resolved by the streamer.
+  void Upload(std::uint32_t chunk, const float* vertices, std::size_t count, int cubes, const glm::vec3& boundsMin,
+              const glm::vec3& boundsMax) {
+    ChunkMesh& mesh = chunks[chunk];
+    if (mesh.vao == 0) {
+      glGenVertexArrays(1, &mesh.vao);
+      glGenBuffers(1, &mesh.vbo);
+      glBindVertexArray(mesh.vao);
+      glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+      const GLsizei stride = kFloatsPerVertex * sizeof(float);
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+      glEnableVertexAttribArray(1);
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
+      glEnableVertexAttribArray(2);
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+      glEnableVertexAttribArray(10);
+      glVertexAttribPointer(10, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(8 * sizeof(float)));
+      glEnableVertexAttribArray(11);
+      glVertexAttribPointer(11, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(11 * sizeof(float)));
+      glBindVertexArray(0);
+      loaded.push_back(chunk);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(count * kFloatsPerVertex * sizeof(float)), vertices,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mesh.vertexCount = static_cast<GLsizei>(count);
+    mesh.cubeCount = cubes;
+    mesh.boundsMin = boundsMin;
+    mesh.boundsMax = boundsMax;
+  }
+
+  // Frees the chunk's buffers; the streamer reloads it from the world file when it comes back.
+  void Evict(std::uint32_t chunk) {
+    ChunkMesh& mesh = chunks[chunk];
+    if (mesh.vao == 0) {
+      return;
+    }
+    glDeleteVertexArrays(1, &mesh.vao);
+    glDeleteBuffers(1, &mesh.vbo);
+    mesh = ChunkMesh{};
+    loaded.erase(std::find(loaded.begin(), loaded.end(), chunk));
+  }
+
+  // Expects the TextureArray to be bound. visible(boundsMin, boundsMax) culls whole chunks.
+  template <typename Visible>
+  void Draw(const Shader& shader, Visible&& visible) {
+    lastDrawCalls = 0;
+    lastCubeCount = 0;
+    if (loaded.empty()) {
+      return;
+    }
+    // Instance attributes are disabled here, so feed identity through the constant attribute values.
+    glVertexAttrib4f(3, 1.0f, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(4, 0.0f, 1.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(5, 0.0f, 0.0f, 1.0f, 0.0f);
+    glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 1.0f);
+    glVertexAttrib3f(7, 1.0f, 0.0f, 0.0f);
+    glVertexAttrib3f(8, 0.0f, 1.0f, 0.0f);
+    glVertexAttrib3f(9, 0.0f, 0.0f, 1.0f);
+    shader.SetMat4(shader.model, glm::mat4(1.0f));
+    shader.SetMat3(shader.normalMatrix, glm::mat3(1.0f));
+    shader.SetVec3(shader.tint, glm::vec3(1.0f));
+    for (const std::uint32_t chunk : loaded) {
+      const ChunkMesh& mesh = chunks[chunk];
+      if (!visible(mesh.boundsMin, mesh.boundsMax)) {
+        continue;
+      }
+      glBindVertexArray(mesh.vao);
+      glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+      ++lastDrawCalls;
+      lastCubeCount += mesh.cubeCount;
+    }
+  }
+
+  void Clear() {
+    for (ChunkMesh& mesh : chunks) {
+      if (mesh.vao != 0) {
+        glDeleteVertexArrays(1, &mesh.vao);
+        glDeleteBuffers(1, &mesh.vbo);
+      }
+      mesh = ChunkMesh{};
+    }
+    loaded.clear();
+  }
+};
+
+struct ParticleEmitter {
+  glm::vec4 positionSeed{0.0f};
+  float age = 0.0f;
+  float duration = 1.0f;
+};
+
+// Explosion fireballs and sparks, animated entirely in particles.vert from each emitter's
+// age and seed. The emitter attributes advance once per kParticlesPerEmitter instances,
+// so every visible explosion in the frame goes out in a single instanced draw and the CPU
+// only writes one ParticleEmitter per blast.
+struct ParticleSystem {
+  static constexpr GLuint kParticlesPerEmitter = 10;  // Must match particles.vert.
+
+  Shader shader;
+  GLuint vao = 0;
+  GLuint emitterVbo = 0;
+  std::size_t emitterCapacity = 0;
+  std::vector<ParticleEmitter> emitters;
+  int lastEmitterCount = 0;
+
+  bool Init(const std::string& shaderDir, GLuint cubeVbo) {
+    if (!shader.Load(shaderDir + "/particles.vert", shaderDir + "/particles.frag")) {
+      return false;
+    }
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &emitterVbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(6 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, emitterVbo);
+    const GLsizei stride = static_cast<GLsizei>(sizeof(ParticleEmitter));
+    glEnableVertexAttribArray(11);
+    glVertexAttribPointer(11, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ParticleEmitter, positionSeed)));
+    glVertexAttribDivisor(11, kParticlesPerEmitter);
+    glEnableVertexAttribArray(12);
+    glVertexAttribPointer(12, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ParticleEmitter, age)));
+    glVertexAttribDivisor(12, kParticlesPerEmitter);
+    glBindVertexArray(0);
+    return true;
+  }
+
+  void Emit(const glm::vec3& position, float seed, float age, float duration) {
+    ParticleEmitter emitter;
+    emitter.positionSeed = glm::vec4(position, seed);
+    emitter.age = age;
+    emitter.duration = duration;
+    emitters.push_back(emitter);
+  }
+
+  // Expects `shader` to be bound with the scene uniforms set, and the TextureArray bound.
+  void Flush(TextureLayer sparkLayer, TextureLayer glowLayer) {
+    lastEmitterCount = static_cast<int>(emitters.size());
+    if (emitters.empty()) {
+      return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, emitterVbo);
+    if (emitters.size() > emitterCapacity) {
+      emitterCapacity = glm::max<std::size_t>(emitters.size(), emitterCapacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(emitterCapacity * sizeof(ParticleEmitter)), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(emitters.size() * sizeof(ParticleEmitter)),
+                    emitters.data());
+
+    shader.SetFloat("uSparkLayer", static_cast<float>(sparkLayer));
+    shader.SetFloat("uGlowLayer", static_cast<float>(glowLayer));
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(emitters.size() * kParticlesPerEmitter));
+    glBindVertexArray(0);
+    emitters.clear();
+  }
+
+  void Shutdown() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &emitterVbo);
+    glDeleteProgram(shader.id);
+    vao = 0;
+    emitterVbo = 0;
+    emitterCapacity = 0;
+  }
+};
+
+// Directional shadows for the fixed sun. Static casters (platforms, the level's car and the
+// baked backdrop) render once into a large map fitted around a bounded region of the world
+// centered near the player, re-baked when the world or level changes or the player nears
+// the region's edge; dynamic casters re-render every frame into a small map that follows
+// the player. standard.frag takes the darker of the two lookups.
+struct ShadowMaps {
+  static constexpr GLsizei kStaticSize = 4096;
+  // The static region spans 2 * kStaticHalfExtent in XZ (under 5 cm per texel), centered on
+  // a kStaticSnap grid so small moves do not re-bake; casters within kStaticMargin outside
+  // it are drawn too so shadows falling in from just outside are kept.
+  static constexpr float kStaticHalfExtent = 96.0f;
+  static constexpr float kStaticSnap = 32.0f;
+  static constexpr float kStaticMargin = 24.0f;
+  static constexpr GLsizei kDynamicSize = 1024;
+  static constexpr float kDynamicHalfWidth = 24.0f;  // Light-space half extents of the dynamic map, m.
+  static constexpr float kDynamicHalfDepth = 60.0f;
+
+  struct BackdropRange {
+    std::uint32_t firstVertex = 0u;
+    std::uint32_t vertexCount = 0u;
+  };
+
+  struct Map {
+    GLuint texture = 0;
+    GLuint fbo = 0;
+    GLsizei size = 0;
+    glm::mat4 lightViewProj{1.0f};
+    float texelWorld = 0.0f;  // World-space width of one texel, for the normal-offset bias.
+  };
+
+  // Shadow uniforms of the program that samples the maps, resolved once by BindReceiver so
+  // the per-frame Apply does no name lookups.
+  struct Receiver {
+    UniformHandle staticMatrix;
+    UniformHandle dynamicMatrix;
+    UniformHandle staticNormalOffset;
+    UniformHandle dynamicNormalOffset;
+    UniformHandle strength;
+  };
+
+  Shader shader;
+  GLuint vao = 0;
+  glm::mat4 lightView{1.0f};
+  Receiver receiver;
+  Map staticMap;
+  Map dynamicMap;
+  int bakedLevel = -1;  // Level whose static casters are in staticMap; -1 bakes on the next frame.
+  glm::vec2 bakedCenter{0.0f};  // XZ center of the baked region.
+  int staticBakes = 0;
+  int lastStaticInstances = 0;
+  int lastBackdropVertices = 0;
+  int lastCasterInstances = 0;
+  int lastCasterRanges = 0;
+
+  bool Init(const std::string& shaderDir, GLuint cubeVbo, const glm::vec3& lightDir) {
+    if (!shader.Load(shaderDir + "/shadow.vert", shaderDir + "/shadow.frag")) {
+      return false;
+    }
+    // Any up axis well away from the light direction will do for an orthographic light.
+    lightView = glm::lookAt(glm::vec3(0.0f), lightDir, glm::vec3(1.0f, 0.0f, 0.0f));
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(0));
+    for (GLuint location = 3; location <= 6; ++location) {
+      glEnableVertexAttribArray(location);
+      glVertexAttribDivisor(location, 1);
+    }
+    glBindVertexArray(0);
+    return CreateMap(staticMap, kStaticSize) && CreateMap(dynamicMap, kDynamicSize);
+  }
+
+  static bool CreateMap(Map& map, GLsizei size) {
+    map.size = size;
+    glGenTextures(1, &map.texture);
+    glBindTexture(GL_TEXTURE_2D, map.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, nullptr);
+    // Linear filtering with compare mode gives a 2x2 PCF per lookup for free.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glGenFramebuffers(1, &map.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, map.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, map.texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!complete) {
+      std::cerr << "Shadow map framebuffer is incomplete (" << size << "x" << size << ")\n";
+    }
+    return complete;
+  }
+
+  // The light view looks down -z, so the near plane is at the box's largest z.
+  void SetProjection(Map& map, const glm::vec3& lightMin, const glm::vec3& lightMax) {
+    map.lightViewProj = glm::ortho(lightMin.x, lightMax.x, lightMin.y, lightMax.y, -lightMax.z, -lightMin.z) * lightView;
+    map.texelWorld = glm::max(lightMax.x - lightMin.x, lightMax.y - lightMin.y) / static_cast<float>(map.size);
+  }
+
+  void FitStatic(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 lightMin(std::numeric_limits<float>::max());
+    glm::vec3 lightMax(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 8; ++corner) {
+      const glm::vec3 world((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+                            (corner & 4) ? boundsMax.z : boundsMin.z);
+      const glm::vec3 light(lightView * glm::vec4(world, 1.0f));
+      lightMin = glm::min(lightMin, light);
+      lightMax = glm::max(lightMax, light);
+    }
+    SetProjection(staticMap, lightMin, lightMax);
+  }
+
+  static glm::vec2 StaticCenter(const glm::vec3& focus) {
+    return glm::vec2(std::round(focus.x / kStaticSnap), std::round(focus.z / kStaticSnap)) * kStaticSnap;
+  }
+
+  // Re-bakes once the focus is half way from the region's center to its edge.
+  bool NeedsStaticBake(int level, const glm::vec3& focus) const {
+    const float offset = glm::max(std::abs(focus.x - bakedCenter.x), std::abs(focus.z - bakedCenter.y));
+    return bakedLevel != level || offset > kStaticHalfExtent * 0.5f;
+  }
+
+  // Snapped to whole texels in light space so shadow edges do not crawl as the player moves.
+  void FitDynamic(const glm::vec3& focus) {
+    glm::vec3 center(lightView * glm::vec4(focus, 1.0f));
+    const float texel = kDynamicHalfWidth * 2.0f / static_cast<float>(kDynamicSize);
+    center.x = std::floor(center.x / texel) * texel;
+    center.y = std::floor(center.y / texel) * texel;
+    const glm::vec3 halfExtents(kDynamicHalfWidth, kDynamicHalfWidth, kDynamicHalfDepth);
+    SetProjection(dynamicMap, center - halfExtents, center + halfExtents);
+  }
+
+  void BeginPass(const Map& map) {
+    glBindFramebuffer(GL_FRAMEBUFFER, map.fbo);
+    glViewport(0, 0, map.size, map.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Slope-scaled depth bias; standard.frag adds a normal offset on the receiving side.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    shader.Use();
+    shader.SetMat4("uLightViewProj", map.lightViewProj);
+  }
+
+  // The caller restores its own viewport.
+  void EndPass() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // GL 3.3 has no base instance, so the model matrix (locations 3-6) is re-pointed at `first`.
+  void DrawInstances(GLuint buffer, std::size_t first, std::size_t count) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    const GLsizei stride = static_cast<GLsizei>(sizeof(CubeInstance));
+    const std::size_t base = first * sizeof(CubeInstance) + offsetof(CubeInstance, model);
+    for (GLuint column = 0; column < 4; ++column) {
+      glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride,
+                            reinterpret_cast<void*>(base + column * sizeof(glm::vec4)));
+    }
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(count));
+  }
+
+  // Backdrop vertices are the world file's baked static mesh (StaticScene layout, already in
+  // world space); only the vertex ranges of the chunks in the region are read,
+  // so the bake touches no more of the mapped file than streaming those chunks would. The
+  // buffers only live for the bake.
+  void BakeStatic(const std::vector<CubeInstance>& casters,
+                  const float* backdrop,
+                  const std::vector<BackdropRange>& backdropRanges,
+                  int level,
+                  const glm::vec2& center) {
+    std::size_t backdropVertices = 0;
+    for (const BackdropRange& range : backdropRanges) {
+      backdropVertices += range.vertexCount;
+    }
+    BeginPass(staticMap);
+    GLuint buffers[2] = {};
+    glGenBuffers(2, buffers);
+    if (!casters.empty()) {
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(casters.size() * sizeof(CubeInstance)), casters.data(),
+                   GL_STATIC_DRAW);
+      DrawInstances(buffers[0], 0, casters.size());
+    }
+    if (backdropVertices > 0) {
+      GLuint backdropVao = 0;
+      glGenVertexArrays(1, &backdropVao);
+      glBindVertexArray(backdropVao);
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+      const GLsizei stride = StaticScene::kFloatsPerVertex * sizeof(float);
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(backdropVertices * stride), nullptr, GL_STATIC_DRAW);
+      std::size_t uploaded = 0;
+      for (const BackdropRange& range : backdropRanges) {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(uploaded * stride),
+                        static_cast<GLsizeiptr>(range.vertexCount * stride),
+                        backdrop + static_cast<std::size_t>(range.firstVertex) * StaticScene::kFloatsPerVertex);
+        uploaded += range.vertexCount;
+      }
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+      glVertexAttrib4f(3, 1.0f, 0.0f, 0.0f, 0.0f);
+      glVertexAttrib4f(4, 0.0f, 1.0f, 0.0f, 0.0f);
+      glVertexAttrib4f(5, 0.0f, 0.0f, 1.0f, 0.0f);
+      glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 1.0f);
+      glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(backdropVertices));
+      glBindVertexArray(0);
+      glDeleteVertexArrays(1, &backdropVao);
+    }
+    glDeleteBuffers(2, buffers);
+    EndPass();
+    bakedLevel = level;
+    bakedCenter = center;
+    ++staticBakes;
+    lastStaticInstances = static_cast<int>(casters.size());
+    lastBackdropVertices = static_cast<int>(backdropVertices);
+  }
+
+  // Expects queue.Upload to have run this frame.
+  void DrawDynamic(const RenderQueue& queue, const glm::vec3& focus) {
+    FitDynamic(focus);
+    BeginPass(dynamicMap);
+    lastCasterInstances = 0;
+    lastCasterRanges = queue.casterRangeCount;
+    for (int range = 0; range < queue.casterRangeCount; ++range) {
+      DrawInstances(queue.instanceVbo, queue.casterRanges[range].first, queue.casterRanges[range].count);
+      lastCasterInstances += static_cast<int>(queue.casterRanges[range].count);
+    }
+    EndPass();
+  }
+
+  void BindReceiver(const Shader& target) {
+    receiver.staticMatrix.location = target.Location("uStaticShadowMatrix");
+    receiver.dynamicMatrix.location = target.Location("uDynamicShadowMatrix");
+    receiver.staticNormalOffset.location = target.Location("uStaticNormalOffset");
+    receiver.dynamicNormalOffset.location = target.Location("uDynamicNormalOffset");
+    receiver.strength.location = target.Location("uShadowStrength");
+  }
+
+  // Binds the maps to texture units 1 and 2 and sets the receiver uniforms on the bound
+  // program, which must be the one passed to BindReceiver.
+  void Apply(const Shader& target, bool enabled) const {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, staticMap.texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, dynamicMap.texture);
+    glActiveTexture(GL_TEXTURE0);
+    // Clip space to [0,1] texture space.
+    glm::mat4 toTexture(0.5f);
+    toTexture[3] = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    target.SetMat4(receiver.staticMatrix, toTexture * staticMap.lightViewProj);
+    target.SetMat4(receiver.dynamicMatrix, toTexture * dynamicMap.lightViewProj);
+    target.SetFloat(receiver.staticNormalOffset, staticMap.texelWorld * 1.5f);
+    target.SetFloat(receiver.dynamicNormalOffset, dynamicMap.texelWorld * 1.5f);
+    target.SetFloat(receiver.strength, enabled ? 1.0f : 0.0f);
+  }
+
+  void Shutdown() {
+    for (Map* map : {&staticMap, &dynamicMap}) {
+      glDeleteFramebuffers(1, &map->fbo);
+      glDeleteTextures(1, &map->texture);
+      *map = Map{};
+    }
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(shader.id);
+    vao = 0;
+  }
+};
+
+// View frustum planes pulled from proj * view, normalized so plane distances are in world units.
+struct Frustum {
+  glm::vec4 planes[6];
+
+  void Extract(const glm::mat4& viewProj) {
+    const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for (glm::vec4& plane : planes) {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  bool IntersectsAabb(const glm::vec3& center, const glm::vec3& halfExtents) const {
+    for (const glm::vec4& plane : planes) {
+      const glm::vec3 normal(plane);
+      const float radius = glm::dot(glm::abs(normal), halfExtents);
+      if (glm::dot(normal, center) + plane.w < -radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+struct CullStats {
+  int tested = 0;
+  int culled = 0;
+  int lod = 0;
+
+  void Add(const CullStats& other) {
+    tested += other.tested;
+    culled += other.culled;
+    lod += other.lod;
+  }
+};
+
+// Cubes and cull counts from one model-building job. Jobs fill their own batch and the
+// batches are appended to the RenderQueue in job order, so the instance order matches a
+// serial build. Batches keep their capacity between frames.
+struct InstanceBatch {
+  std::vector<CubeInstance> entries;
+  CullStats stats;
+
+  void Clear() {
+    entries.clear();
+    stats = CullStats{};
+  }
+
+  void Push(const JointTransform& joint, const glm::vec3& scale, const glm::vec3& tint, TextureLayer layer) {
+    entries.push_back(MakeCubeInstance(joint, scale, tint, layer));
+  }
+};
+
+struct Player {
+  glm::vec3 position{0.0f, 2.0f, 0.0f};
+  glm::vec3 velocity{0.0f};
+  float halfSize = 0.5f;
+  bool onGround = false;
+  float blastTimer = 0.0f;
+  float hurtTimer = 0.0f;
+};
+
+enum class ItemType : std::uint8_t {
+  None = 0,
+  Boomerang = 1,
+  SpeedBoots = 2,
+  Shotgun = 3,
+  Sword = 4,
+};
+
+struct Enemy {
+  glm::vec3 position{4.0f, 0.0f, -4.0f};
+  glm::vec3 velocity{0.0f};
+  float halfSize = 0.45f;
+  float speed = 3.2f;
+  bool onGround = false;
+  float jumpCooldown = 0.0f;
+};
+
+struct Platform {
+  glm::vec3 position;
+  glm::vec3 halfExtents;
+  glm::vec3 tint;
+};
+
+// Uniform XZ grid over the static platforms. Each cell lists, in ascending order, every
+// platform whose footprint grown by kMargin overlaps it, so a probe no wider than the
+// margin only has to test the platforms of the one cell it stands in. platforms[0] is
+// the ground slab that every caller handles on its own, so it is left out.
+struct PlatformGrid {
+  static constexpr float kCellSize = 16.0f;
+  static constexpr float kMargin = 1.0f;
+
+  struct Range {
+    const std::uint32_t* first = nullptr;
+    const std::uint32_t* last = nullptr;
+    const std::uint32_t* begin() const { return first; }
+    const std::uint32_t* end() const { return last; }
+  };
+
+  glm::vec2 origin{0.0f};
+  int width = 0;
+  int depth = 0;
+  std::vector<std::uint32_t> cellStart;  // width * depth + 1 offsets into indices.
+  std::vector<std::uint32_t> indices;
+
+  void Build(const std::vector<Platform>& platforms) {
+    origin = glm::vec2(0.0f);
+    width = 1;
+    depth = 1;
+    cellStart.assign(2, 0u);
+    indices.clear();
+    if (platforms.size() < 2) {
+      // Ground-only level: one empty cell, so the grid is never zero-sized and a compiled
+      // world carrying it still passes WorldFile's layout checks.
+      return;
+    }
+    glm::vec2 minCorner(std::numeric_limits<float>::max());
+    glm::vec2 maxCorner(std::numeric_limits<float>::lowest());
+    for (size_t i = 1; i < platforms.size(); ++i) {
+      const glm::vec2 center(platforms[i].position.x, platforms[i].position.z);
+      const glm::vec2 extent(platforms[i].halfExtents.x + kMargin, platforms[i].halfExtents.z + kMargin);
+      minCorner = glm::min(minCorner, center - extent);
+      maxCorner = glm::max(maxCorner, center + extent);
+    }
+    origin = minCorner;
+    width = static_cast<int>(std::floor((maxCorner.x - minCorner.x) / kCellSize)) + 1;
+    depth = static_cast<int>(std::floor((maxCorner.y - minCorner.y) / kCellSize)) + 1;
+
+    auto ForEachCovered = [&](const Platform& platform, auto&& fn) {
+      const int x0 = CellX(platform.position.x - platform.halfExtents.x - kMargin);
+      const int x1 = CellX(platform.position.x + platform.halfExtents.x + kMargin);
+      const int z0 = CellZ(platform.position.z - platform.halfExtents.z - kMargin);
+      const int z1 = CellZ(platform.position.z + platform.halfExtents.z + kMargin);
+      for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+          fn(static_cast<size_t>(z * width + x));
+        }
+      }
+    };
+
+    const size_t cellCount = static_cast<size_t>(width * depth);
+    cellStart.assign(cellCount + 1, 0u);
+    for (size_t i = 1; i < platforms.size(); ++i) {
+      ForEachCovered(platforms[i], [&](size_t cell) { ++cellStart[cell + 1]; });
+    }
+    for (size_t cell = 0; cell < cellCount; ++cell) {
+      cellStart[cell + 1] += cellStart[cell];
+    }
+    indices.resize(cellStart[cellCount]);
+    std::vector<std::uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 1; i < platforms.size(); ++i) {
+      ForEachCovered(platforms[i], [&](size_t cell) { indices[cursor[cell]++] = static_cast<std::uint32_t>(i); });
+    }
+  }
+
+  // Installs cells a previous Build produced, e.g. the copy stored in a compiled world.
+  void Assign(const glm::vec2& gridOrigin, int gridWidth, int gridDepth, const std::uint32_t* cells, std::size_t cellCount,
+              const std::uint32_t* cellIndices, std::size_t indexCount) {
+    origin = gridOrigin;
+    width = gridWidth;
+    depth = gridDepth;
+    cellStart.assign(cells, cells + cellCount);
+    indices.assign(cellIndices, cellIndices + indexCount);
+  }
+
+  int CellX(float x) const {
+    return glm::clamp(static_cast<int>(std::floor((x - origin.x) / kCellSize)), 0, width - 1);
+  }
+  int CellZ(float z) const {
+    return glm::clamp(static_cast<int>(std::floor((z - origin.y) / kCellSize)), 0, depth - 1);
+  }
+
+  // Platforms a probe of half-width <= kMargin centered at position could touch.
+  Range Near(const glm::vec3& position) const {
+    if (width == 0 || position.x < origin.x || position.z < origin.y ||
+        position.x >= origin.x + width * kCellSize || position.z >= origin.y + depth * kCellSize) {
+      return {};
+    }
+    const size_t cell = static_cast<size_t>(CellZ(position.z) * width + CellX(position.x));
+    return {indices.data() + cellStart[cell], indices.data() + cellStart[cell + 1]};
+  }
+};
+
+struct CloudPuff {
+  glm::vec3 offset;
+  glm::vec3 scale;
+};
+
+struct CloudCluster {
+  glm::vec3 basePosition;
+  glm::vec2 driftDir;
+  float driftSpeed = 0.0f;
+  float hueOffset = 0.0f;
+  std::vector<CloudPuff> puffs;
+};
+
+// AI and animation state of a cat; position, velocity and walk cycle live in the cats'
+// AnimalBodies at the same index.
+struct Cat {
+  glm::vec3 previousPosition = glm::vec3(0.0f);  // Position before the last sim step, for render interpolation.
+  bool collected = false;
+  
+  // AI state
+  enum class Behavior { Idle, Wandering, Following };
+  Behavior behavior = Behavior::Idle;
+  float behaviorTimer = 0.0f;
+  glm::vec3 wanderTarget = glm::vec3(0.0f);
+  enum class IdleAnim { None, Groom, Loaf, Roll, Groomed };
+  IdleAnim idleAnim = IdleAnim::None;
+  float idleAnimTimer = 0.0f;
+  float idleAnimPhase = 0.0f;
+  int groomTarget = -1;
+  float rollHold = 0.0f;
+  bool asleep = false;  // In a sleeping world chunk: AI and physics are skipped.
+  
+  // Personality
+  float moveSpeed = 3.0f;
+  float turnSpeed = 5.0f;
+  float facing = 0.0f;
+  unsigned int seed = 0;
+  // Render bounds around position + (0, kBoundsHalfHeight, 0); XZ covers every facing, tail included.
+  static constexpr float kBoundsHalfWidth = 0.72f;
+  static constexpr float kBoundsHalfHeight = 0.36f;
+};
+
+// What the cat AI pass lets a cat see of the others: their state from before the pass,
+// so cats updated in parallel never read a neighbour halfway through its own update.
+struct CatView {
+  glm::vec3 position{0.0f};
+  glm::vec3 velocity{0.0f};
+  bool asleep = false;
+};
+
+// A groom's effect on its target, recorded by the groomer's AI step and applied after the
+// pass in groomer order.
+struct GroomContact {
+  int target = -1;
+  glm::vec3 direction{0.0f};  // Flat unit vector from groomer to target.
+};
+
+// Same split as Cat: the kinematic state is in the dogs' AnimalBodies.
+struct Dog {
+  bool collected = false;
+  float bobOffset = 0.0f;
+  bool onGround = false;
+  enum class Behavior { Idle, Wandering, Following };
+  Behavior behavior = Behavior::Idle;
+  float behaviorTimer = 0.0f;
+  glm::vec3 wanderTarget{0.0f};
+  float facing = 0.0f;
+  float moveSpeed = 2.8f;
+  float turnSpeed = 5.0f;
+  unsigned int seed = 0;
+  float blastTimer = 0.0f;
+  glm::vec3 previousPosition{0.0f};
+  bool asleep = false;  // In a sleeping world chunk: AI and physics are skipped.
+  static constexpr float kBoundsHalfWidth = 1.45f;
+  static constexpr float kBoundsHalfHeight = 0.6f;
+};
+
+// Personalities come from a shared LCG stream so every cat (and dog) differs but a
+// given level always rolls the same ones.
+static void InitCatPersonality(Cat& cat, unsigned int& seedStream) {
+  cat.seed = seedStream;
+  seedStream = seedStream * 1664525u + 1013904223u;
+  cat.moveSpeed = 2.5f + RandomFloat(cat.seed) * 2.0f; // 2.5-4.5 speed
+  cat.turnSpeed = 4.0f + RandomFloat(cat.seed) * 3.0f; // 4-7 turn rate
+  cat.facing = RandomFloat(cat.seed) * 6.28318f;
+  cat.behaviorTimer = RandomFloat(cat.seed) * 3.0f;
+  cat.behavior = Cat::Behavior::Idle;
+  cat.idleAnimTimer = 0.5f + RandomFloat(cat.seed) * 2.0f;
+}
+
+static void InitDogPersonality(Dog& dog, const glm::vec3& position, unsigned int& seedStream) {
+  dog.seed = seedStream;
+  seedStream = seedStream * 1664525u + 1013904223u;
+  dog.moveSpeed = 2.4f + RandomFloat(dog.seed) * 1.6f;
+  dog.turnSpeed = 4.0f + RandomFloat(dog.seed) * 2.5f;
+  dog.behaviorTimer = 0.6f + RandomFloat(dog.seed) * 2.2f;
+  dog.facing = RandomFloat(dog.seed) * 6.28318f;
+  dog.wanderTarget = position;
+}
+
+struct WorldItem {
+  ItemType type = ItemType::None;
+  glm::vec3 position{0.0f};
+  bool active = true;
+};
+
+struct ShotProjectile {
+  glm::vec3 position{0.0f};
+  glm::vec3 velocity{0.0f};
+  float lifetime = 0.0f;
+  std::uint32_t command = 0u;  // InputCommand that fired it, for hit prediction.
+};
+
+struct BoomerangProjectile {
+  bool active = false;
+  glm::vec3 position{0.0f};
+  glm::vec3 velocity{0.0f};
+  bool returning = false;
+  float timeAlive = 0.0f;
+  std::uint32_t command = 0u;
+};
+
+// A hit on the enemy this client simulated ahead of the host. It is layered over host
+// snapshots until the host acks the command, after which the host's verdict stands.
+struct PredictedEnemyHit {
+  std::uint32_t command = 0u;
+  bool kill = false;
+  std::uint32_t tick = 0u;
+  float duration = 0.0f;
+};
+
+struct PredictedItemDrop {
+  std::uint32_t command = 0u;
+  std::size_t index = 0;
+  WorldItem item;
+};
+
+// Another player in the session as this instance shows it, indexed by session id (0 is the
+// host, then one per host client slot): a peer's own player or, on a client, one the host
+// relays.
+struct RemotePlayer {
+  bool online = false;
+  bool wasOnline = false;
+  std::uint16_t level = 1u;
+  glm::vec3 position{0.0f};
+  glm::vec3 velocity{0.0f};
+  float facing = 0.0f;
+  ItemType heldItem = ItemType::None;
+  int heldCharges = 0;
+  std::uint8_t useSerial = 0u;
+  float walkCycle = 0.0f;
+  float boomerangUseAnimTimer = 0.0f;
+  float shotgunUseAnimTimer = 0.0f;
+  float swordUseAnimTimer = 0.0f;
+
+  void StartUseAnimation(ItemType item) {
+    if (item == ItemType::Boomerang) {
+      boomerangUseAnimTimer = 0.28f;
+    } else if (item == ItemType::Shotgun) {
+      shotgunUseAnimTimer = 0.22f;
+    } else if (item == ItemType::Sword) {
+      swordUseAnimTimer = 0.32f;
+    }
+  }
+
+  void ClearItem() {
+    heldItem = ItemType::None;
+    heldCharges = 0;
+    boomerangUseAnimTimer = 0.0f;
+    shotgunUseAnimTimer = 0.0f;
+    swordUseAnimTimer = 0.0f;
+  }
+};
+
+struct Bomb {
+  glm::vec3 position{0.0f};
+  glm::vec3 velocity{0.0f};
+  float timer = 0.0f;
+};
+
+struct Explosion {
+  glm::vec3 position{0.0f};
+  float age = 0.0f;
+  float duration = 0.6f;
+  float seed = 0.0f;
+};
+
+// Cell lists for the moving entities, rebuilt from scratch at the top of every sim step
+// with a counting sort. Positions outside the bounds clamp to the border cells, so each
+// entity sits in exactly one cell and a range query never reports it twice. Entities
+// move during the step after the rebuild, so queries pad their radius by kSlack and
+// callers still test the exact distance.
+struct EntityGrid {
+  enum class Kind : std::uint8_t { Cat, Dog, Bomb, Item };
+  struct Entry {
+    Kind kind = Kind::Cat;
+    std::uint32_t index = 0;
+  };
+
+  static constexpr float kCellSize = 8.0f;
+  static constexpr float kSlack = 1.0f;
+
+  glm::vec2 origin{0.0f};
+  int width = 1;
+  int depth = 1;
+  std::vector<std::uint32_t> cellStart{0u, 0u};
+  std::vector<Entry> entries;
+  std::vector<Entry> pending;
+  std::vector<std::uint32_t> pendingCell;
+
+  void Configure(const glm::vec2& minCorner, const glm::vec2& maxCorner) {
+    origin = minCorner;
+    width = glm::max(1, static_cast<int>(std::ceil((maxCorner.x - minCorner.x) / kCellSize)));
+    depth = glm::max(1, static_cast<int>(std::ceil((maxCorner.y - minCorner.y) / kCellSize)));
+    cellStart.assign(static_cast<size_t>(width * depth) + 1, 0u);
+    entries.clear();
+  }
+
+  int CellX(float x) const {
+    return glm::clamp(static_cast<int>(std::floor((x - origin.x) / kCellSize)), 0, width - 1);
+  }
+  int CellZ(float z) const {
+    return glm::clamp(static_cast<int>(std::floor((z - origin.y) / kCellSize)), 0, depth - 1);
+  }
+
+  void Begin() {
+    pending.clear();
+    pendingCell.clear();
+  }
+
+  void Add(Kind kind, size_t index, const glm::vec3& position) {
+    pending.push_back({kind, static_cast<std::uint32_t>(index)});
+    pendingCell.push_back(static_cast<std::uint32_t>(CellZ(position.z) * width + CellX(position.x)));
+  }
+
+  void End() {
+    std::fill(cellStart.begin(), cellStart.end(), 0u);
+    for (const std::uint32_t cell : pendingCell) {
+      ++cellStart[cell + 1];
+    }
+    for (size_t cell = 1; cell < cellStart.size(); ++cell) {
+      cellStart[cell] += cellStart[cell - 1];
+    }
+    entries.resize(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+      // cellStart[cell] doubles as the fill cursor and ends up at the next cell's start;
+      // the shift below puts it back.
+      entries[cellStart[pendingCell[i]]++] = pending[i];
+    }
+    for (size_t cell = cellStart.size() - 1; cell > 0; --cell) {
+      cellStart[cell] = cellStart[cell - 1];
+    }
+    cellStart[0] = 0u;
+  }
+
+  // Calls fn(index) for every entity of the given kind whose cell lies within radius
+  // (plus kSlack) of position on XZ.
+  template <typename Fn>
+  void ForEachNear(Kind kind, const glm::vec3& position, float radius, Fn&& fn) const {
+    const float reach = radius + kSlack;
+    const int x0 = CellX(position.x - reach);
+    const int x1 = CellX(position.x + reach);
+    const int z0 = CellZ(position.z - reach);
+    const int z1 = CellZ(position.z + reach);
+    for (int z = z0; z <= z1; ++z) {
+      for (int x = x0; x <= x1; ++x) {
+        const size_t cell = static_cast<size_t>(z * width + x);
+        for (std::uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+          if (entries[i].kind == kind) {
+            fn(static_cast<size_t>(entries[i].index));
+          }
+        }
+      }
+    }
+  }
+};
+
+// Four packed floats: SSE2 on x86, NEON on AArch64, plain arrays anywhere else. Only
+// what the body passes below need.
+struct Float4 {
+  static constexpr size_t kWidth = 4;
+#if defined(VIBE_SIMD_SSE2)
+  __m128 v;
+  static Float4 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+  static Float4 Splat(float x) { return {_mm_set1_ps(x)}; }
+  void Store(float* p) const { _mm_storeu_ps(p, v); }
+  friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+  friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+  friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+  static Float4 Sqrt(Float4 a) { return {_mm_sqrt_ps(a.v)}; }
+#elif defined(VIBE_SIMD_NEON)
+  float32x4_t v;
+  static Float4 Load(const float* p) { return {vld1q_f32(p)}; }
+  static Float4 Splat(float x) { return {vdupq_n_f32(x)}; }
+  void Store(float* p) const { vst1q_f32(p, v); }
+  friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+  friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+  friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+  static Float4 Sqrt(Float4 a) { return {vsqrtq_f32(a.v)}; }
+#else
+  float v[kWidth];
+  template <typename Op>
+  static Float4 Map(Float4 a, Float4 b, Op op) {
+    Float4 r;
+    for (size_t i = 0; i < kWidth; ++i) {
+      r.v[i] = op(a.v[i], b.v[i]);
+    }
+    return r;
+  }
+  static Float4 Load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+  static Float4 Splat(float x) { return {{x, x, x, x}}; }
+  void Store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+  friend Float4 operator+(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x + y; }); }
+  friend Float4 operator-(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x - y; }); }
+  friend Float4 operator*(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x * y; }); }
+  static Float4 Sqrt(Float4 a) { return Map(a, a, [](float x, float) { return std::sqrt(x); }); }
+#endif
+};
+
+// Kinematic state of the cats or of the dogs as parallel float arrays: the canonical copy,
+// indexed like the Cat or Dog records that keep the AI and animation state. Lanes grow a
+// whole Float4 at a time and the tail stays zero, so the passes below run over any
+// Float4-aligned range with no scalar remainder and no gather or scatter.
+struct AnimalBodies {
+  std::vector<float> px, py, pz;
+  std::vector<float> vx, vy, vz;
+  std::vector<float> targetX, targetZ;  // Horizontal velocity the AI wants.
+  std::vector<float> steer;             // Blend rate toward the target this step, 0 = coast.
+  std::vector<float> step;              // Time this lane integrates over; 0 while asleep.
+  std::vector<float> walkCycle;         // Horizontal distance covered, for walk animation.
+  size_t count = 0;
+
+  size_t Lanes() const { return px.size(); }
+
+  void Clear() { Truncate(0); }
+
+  // Appends a body at rest at position.
+  void Add(const glm::vec3& position) {
+    if (count == Lanes()) {
+      for (std::vector<float>* lane : Fields()) {
+        lane->resize(count + Float4::kWidth, 0.0f);
+      }
+    }
+    SetPosition(count, position);
+    ++count;
+  }
+
+  // Drops every body from newCount on, zeroing the lanes they leave behind.
+  void Truncate(size_t newCount) {
+    newCount = std::min(newCount, count);
+    const size_t lanes = (newCount + Float4::kWidth - 1) / Float4::kWidth * Float4::kWidth;
+    for (std::vector<float>* lane : Fields()) {
+      lane->resize(newCount);
+      lane->resize(lanes, 0.0f);
+    }
+    count = newCount;
+  }
+
+  glm::vec3 Position(size_t i) const { return glm::vec3(px[i], py[i], pz[i]); }
+  glm::vec3 Velocity(size_t i) const { return glm::vec3(vx[i], vy[i], vz[i]); }
+  void SetPosition(size_t i, const glm::vec3& position) {
+    px[i] = position.x;
+    py[i] = position.y;
+    pz[i] = position.z;
+  }
+  void SetVelocity(size_t i, const glm::vec3& velocity) {
+    vx[i] = velocity.x;
+    vy[i] = velocity.y;
+    vz[i] = velocity.z;
+  }
+
+  // AI output for the next physics pass. A sleeping body stops steering and integrating.
+  void Steer(size_t i, const glm::vec3& desiredVelocity, float rate, float deltaTime) {
+    targetX[i] = desiredVelocity.x;
+    targetZ[i] = desiredVelocity.z;
+    steer[i] = rate;
+    step[i] = deltaTime;
+  }
+  void Sleep(size_t i) { Steer(i, glm::vec3(0.0f), 0.0f, 0.0f); }
+
+  std::array<std::vector<float>*, 11> Fields() {
+    return {&px, &py, &pz, &vx, &vy, &vz, &targetX, &targetZ, &steer, &step, &walkCycle};
+  }
+};
+
+// The passes take lanes [begin, end), both multiples of Float4::kWidth, so parallel
+// ranges never share a packed store.
+static void ApplyBodyGravity(AnimalBodies& bodies, size_t begin, size_t end, float gravity) {
+  const Float4 g = Float4::Splat(gravity);
+  for (size_t i = begin; i < end; i += Float4::kWidth) {
+    (Float4::Load(&bodies.vy[i]) + Float4::Load(&bodies.step[i]) * g).Store(&bodies.vy[i]);
+  }
+}
+
+// Blends horizontal velocity toward the AI target, integrates and advances the walk cycle.
+static void SteerAndIntegrateBodies(AnimalBodies& bodies, size_t begin, size_t end, float strideScale) {
+  const Float4 scale = Float4::Splat(strideScale);
+  for (size_t i = begin; i < end; i += Float4::kWidth) {
+    const Float4 dt = Float4::Load(&bodies.step[i]);
+    const Float4 steer = Float4::Load(&bodies.steer[i]);
+    Float4 vx = Float4::Load(&bodies.vx[i]);
+    Float4 vz = Float4::Load(&bodies.vz[i]);
+    const Float4 vy = Float4::Load(&bodies.vy[i]);
+    vx = vx + (Float4::Load(&bodies.targetX[i]) - vx) * steer;
+    vz = vz + (Float4::Load(&bodies.targetZ[i]) - vz) * steer;
+    vx.Store(&bodies.vx[i]);
+    vz.Store(&bodies.vz[i]);
+    (Float4::Load(&bodies.px[i]) + vx * dt).Store(&bodies.px[i]);
+    (Float4::Load(&bodies.py[i]) + vy * dt).Store(&bodies.py[i]);
+    (Float4::Load(&bodies.pz[i]) + vz * dt).Store(&bodies.pz[i]);
+    (Float4::Load(&bodies.walkCycle[i]) + Float4::Sqrt(vx * vx + vz * vz) * (dt * scale)).Store(&bodies.walkCycle[i]);
+  }
+}
+
+// Lifts a body whose center dropped below floorY back onto it; true where it was caught.
+static bool ClampBodyToFloor(AnimalBodies& bodies, size_t i, float floorY) {
+  if (!(bodies.py[i] < floorY)) {
+    return false;
+  }
+  bodies.py[i] = floorY;
+  bodies.vy[i] = 0.0f;
+  return true;
+}
+
+struct CollectSprite {
+  glm::vec3 position{0.0f};
+  ItemType itemType = ItemType::None;
+  float age = 0.0f;
+  float duration = 0.8f;
+};
+
+static void WriteVec3(float out[3], const glm::vec3& value) {
+  out[0] = value.x;
+  out[1] = value.y;
+  out[2] = value.z;
+}
+
+static glm::vec3 ReadVec3(const float in[3]) {
+  return glm::vec3(in[0], in[1], in[2]);
+}
+
+static int ApplyCollectedCatFlags(std::vector<Cat>& cats, const std::vector<bool>& collectedFlags) {
+  int count = 0;
+  for (std::size_t i = 0; i < cats.size(); ++i) {
+    const bool collected = i < collectedFlags.size() && collectedFlags[i];
+    cats[i].collected = cats[i].collected || collected;
+    if (cats[i].collected) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static int ApplyCollectedDogFlags(std::vector<Dog>& dogs, const std::vector<bool>& collectedFlags) {
+  int count = 0;
+  for (std::size_t i = 0; i < dogs.size(); ++i) {
+    const bool collected = i < collectedFlags.size() && collectedFlags[i];
+    dogs[i].collected = dogs[i].collected || collected;
+    if (dogs[i].collected) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Gameplay coordinates are authored on a small grid and spread over the map by this factor
+// in X and Z; AI ranges are expressed in the same units.
+static constexpr float kMapScale = 10.0f;
+
+static glm::vec3 ScaleXZ(const glm::vec3& value, float scale) {
+  return glm::vec3(value.x * scale, value.y, value.z * scale);
+}
+
+static glm::vec3 ScaleExtentXZ(const glm::vec3& value, float scale) {
+  return glm::vec3(value.x * scale, value.y, value.z * scale);
+}
+
+static const char* ItemTypeName(ItemType type) {
+  switch (type) {
+    case ItemType::Boomerang:
+      return "Boomerang";
+    case ItemType::SpeedBoots:
+      return "Speed Boots";
+    case ItemType::Shotgun:
+      return "Shotgun";
+    case ItemType::Sword:
+      return "Sword";
+    default:
+      return "None";
+  }
+}
+
+static glm::vec3 ItemTypeTint(ItemType type) {
+  switch (type) {
+    case ItemType::Boomerang:
+      return glm::vec3(0.95f, 0.72f, 0.24f);
+    case ItemType::SpeedBoots:
+      return glm::vec3(0.24f, 0.74f, 1.0f);
+    case ItemType::Shotgun:
+      return glm::vec3(0.55f, 0.55f, 0.62f);
+    case ItemType::Sword:
+      return glm::vec3(0.85f, 0.85f, 0.95f);
+    default:
+      return glm::vec3(0.8f, 0.8f, 0.8f);
+  }
+}
+
+static void PackWorldEntities(MultiplayerPacket& packet,
+                              const Enemy& clown,
+                              float clownFacing,
+                              float clownWalkCycle,
+                              const Enemy& mummy,
+                              float mummyFacing,
+                              float mummyWalkCycle,
+                              float mummyThrowCooldown,
+                              const std::vector<Cat>& cats,
+                              const AnimalBodies& catBodies,
+                              const std::vector<Dog>& dogs,
+                              const AnimalBodies& dogBodies,
+                              const ObjectPool<Bomb>& bombs,
+                              const ObjectPool<Explosion>& explosions,
+                              const std::vector<WorldItem>& worldItems,
+                              ItemType heldItem,
+                              int heldCharges,
+                              bool clownAlive,
+                              float clownRespawnTimer,
+                              float clownStunTimer,
+                              bool mummyAlive,
+                              float mummyRespawnTimer,
+                              float mummyStunTimer) {
+  WriteVec3(packet.clownPos, clown.position);
+  WriteVec3(packet.clownVel, clown.velocity);
+  packet.clownFacing = clownFacing;
+  packet.clownWalkCycle = clownWalkCycle;
+  packet.clownJumpCooldown = clown.jumpCooldown;
+
+  WriteVec3(packet.mummyPos, mummy.position);
+  WriteVec3(packet.mummyVel, mummy.velocity);
+  packet.mummyFacing = mummyFacing;
+  packet.mummyWalkCycle = mummyWalkCycle;
+  packet.mummyThrowCooldown = mummyThrowCooldown;
+
+  packet.cats.resize(cats.size());
+  packet.catsCollected.resize(cats.size());
+  for (std::size_t i = 0; i < cats.size(); ++i) {
+    NetCatState& cat = packet.cats[i];
+    WriteVec3(cat.pos, catBodies.Position(i));
+    WriteVec3(cat.vel, catBodies.Velocity(i));
+    cat.facing = cats[i].facing;
+    cat.walkCycle = catBodies.walkCycle[i];
+    packet.catsCollected[i] = cats[i].collected;
+  }
+
+  packet.dogs.resize(dogs.size());
+  packet.dogsCollected.resize(dogs.size());
+  for (std::size_t i = 0; i < dogs.size(); ++i) {
+    NetDogState& dog = packet.dogs[i];
+    WriteVec3(dog.pos, dogBodies.Position(i));
+    WriteVec3(dog.vel, dogBodies.Velocity(i));
+    dog.facing = dogs[i].facing;
+    dog.walkCycle = dogBodies.walkCycle[i];
+    dog.blastTimer = dogs[i].blastTimer;
+    packet.dogsCollected[i] = dogs[i].collected;
+  }
+
+  // Bombs are addressed by pool slot so deltas line up across snapshots.
+  packet.bombs.resize(bombs.Capacity());
+  packet.bombsActive.resize(bombs.Capacity());
+  for (std::size_t i = 0; i < bombs.Capacity(); ++i) {
+    NetBombState& bomb = packet.bombs[i];
+    WriteVec3(bomb.pos, bombs.slots[i].position);
+    WriteVec3(bomb.vel, bombs.slots[i].velocity);
+    bomb.timer = bombs.slots[i].timer;
+    packet.bombsActive[i] = bombs.IsLive(i);
+  }
+
+  packet.explosions.clear();
+  packet.explosions.reserve(explosions.Size());
+  for (const Explosion& source : explosions) {
+    NetExplosionState explosion;
+    WriteVec3(explosion.pos, source.position);
+    explosion.age = source.age;
+    explosion.duration = source.duration;
+    explosion.seed = source.seed;
+    packet.explosions.push_back(explosion);
+  }
+
+  packet.worldItems.resize(worldItems.size());
+  packet.worldItemsActive.resize(worldItems.size());
+  for (std::size_t i = 0; i < worldItems.size(); ++i) {
+    packet.worldItems[i].type = static_cast<std::uint8_t>(worldItems[i].type);
+    WriteVec3(packet.worldItems[i].pos, worldItems[i].position);
+    packet.worldItemsActive[i] = worldItems[i].active;
+  }
+
+  packet.localHeldItemType = static_cast<std::uint8_t>(heldItem);
+  packet.localHeldItemCharges = heldCharges;
+
+  packet.enemyAliveMask = (clownAlive ? 0x1u : 0u) | (mummyAlive ? 0x2u : 0u);
+  packet.enemyRespawnTimer[0] = clownRespawnTimer;
+  packet.enemyRespawnTimer[1] = mummyRespawnTimer;
+  packet.enemyStunTimer[0] = clownStunTimer;
+  packet.enemyStunTimer[1] = mummyStunTimer;
+}
+
+static void ApplyWorldEntities(const MultiplayerPacket& packet,
+                               Enemy& clown,
+                               float& clownFacing,
+                               float& clownWalkCycle,
+                               Enemy& mummy,
+                               float& mummyFacing,
+                               float& mummyWalkCycle,
+                               float& mummyThrowCooldown,
+                               std::vector<Cat>& cats,
+                               AnimalBodies& catBodies,
+                               std::vector<Dog>& dogs,
+                               AnimalBodies& dogBodies,
+                               ObjectPool<Bomb>& bombs,
+                               ObjectPool<Explosion>& explosions,
+                               std::vector<WorldItem>& worldItems,
+                               ItemType& remoteHeldItem,
+                               int& remoteHeldCharges,
+                               bool& clownAlive,
+                               float& clownRespawnTimer,
+                               float& clownStunTimer,
+                               bool& mummyAlive,
+                               float& mummyRespawnTimer,
+                               float& mummyStunTimer) {
+  clown.position = ReadVec3(packet.clownPos);
+  clown.velocity = ReadVec3(packet.clownVel);
+  clownFacing = packet.clownFacing;
+  clownWalkCycle = packet.clownWalkCycle;
+  clown.jumpCooldown = packet.clownJumpCooldown;
+
+  mummy.position = ReadVec3(packet.mummyPos);
+  mummy.velocity = ReadVec3(packet.mummyVel);
+  mummyFacing = packet.mummyFacing;
+  mummyWalkCycle = packet.mummyWalkCycle;
+  mummyThrowCooldown = packet.mummyThrowCooldown;
+
+  // Cats and dogs come from the local level definition; only the overlap is mirrored.
+  for (std::size_t i = 0; i < cats.size() && i < packet.cats.size(); ++i) {
+    const NetCatState& cat = packet.cats[i];
+    catBodies.SetPosition(i, ReadVec3(cat.pos));
+    catBodies.SetVelocity(i, ReadVec3(cat.vel));
+    cats[i].facing = cat.facing;
+    catBodies.walkCycle[i] = cat.walkCycle;
+  }
+
+  for (std::size_t i = 0; i < dogs.size() && i < packet.dogs.size(); ++i) {
+    const NetDogState& dog = packet.dogs[i];
+    dogBodies.SetPosition(i, ReadVec3(dog.pos));
+    dogBodies.SetVelocity(i, ReadVec3(dog.vel));
+    dogs[i].facing = dog.facing;
+    dogBodies.walkCycle[i] = dog.walkCycle;
+    dogs[i].blastTimer = dog.blastTimer;
+  }
+
+  // Bombs are pure host state and mirror the host's pool slot for slot.
+  bombs.Reserve(packet.bombs.size());
+  for (std::size_t i = 0; i < bombs.Capacity(); ++i) {
+    const bool live = i < packet.bombs.size() && packet.bombsActive[i];
+    bombs.SetLive(i, live);
+    if (live) {
+      const NetBombState& bomb = packet.bombs[i];
+      bombs.slots[i].position = ReadVec3(bomb.pos);
+      bombs.slots[i].velocity = ReadVec3(bomb.vel);
+      bombs.slots[i].timer = bomb.timer;
+    }
+  }
+
+  explosions.Clear();
+  explosions.Reserve(packet.explosions.size());
+  for (const NetExplosionState& state : packet.explosions) {
+    Explosion* explosion = explosions.Acquire();
+    explosion->position = ReadVec3(state.pos);
+    explosion->age = state.age;
+    explosion->duration = state.duration;
+    explosion->seed = state.seed;
+  }
+
+  // Items only grow: local slots past the host's count are unacked predicted drops.
+  if (worldItems.size() < packet.worldItems.size()) {
+    worldItems.resize(packet.worldItems.size());
+  }
+  for (std::size_t i = 0; i < packet.worldItems.size(); ++i) {
+    worldItems[i].active = packet.worldItemsActive[i];
+    worldItems[i].type = static_cast<ItemType>(packet.worldItems[i].type);
+    worldItems[i].position = ReadVec3(packet.worldItems[i].pos);
+  }
+
+  remoteHeldItem = static_cast<ItemType>(packet.localHeldItemType);
+  remoteHeldCharges = packet.localHeldItemCharges;
+
+  clownAlive = (packet.enemyAliveMask & 0x1u) != 0u;
+  mummyAlive = (packet.enemyAliveMask & 0x2u) != 0u;
+  clownRespawnTimer = packet.enemyRespawnTimer[0];
+  mummyRespawnTimer = packet.enemyRespawnTimer[1];
+  clownStunTimer = packet.enemyStunTimer[0];
+  mummyStunTimer = packet.enemyStunTimer[1];
+}
+
+static void FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
+  (void)window;
+  glViewport(0, 0, width, height);
+}
+
+static TextureImage BuildCheckerTexture() {
+  const int size = 64;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int idx = (y * size + x) * 3;
+      const bool odd = ((x / 8) + (y / 8)) % 2 == 1;
+      const unsigned char color = odd ? 220 : 40;
+      pixels[idx + 0] = color;
+      pixels[idx + 1] = color;
+      pixels[idx + 2] = color;
+    }
+  }
+
+  return {size, std::move(pixels)};
+}
+
+static TextureImage BuildStripeTexture(unsigned char a, unsigned char b) {
+  const int size = 64;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int idx = (y * size + x) * 3;
+      const bool odd = ((x / 6) % 2) == 1;
+      const unsigned char color = odd ? a : b;
+      pixels[idx + 0] = color;
+      pixels[idx + 1] = color;
+      pixels[idx + 2] = color;
+    }
+  }
+
+  return {size, std::move(pixels)};
+}
+
+static TextureImage BuildDotsTexture(unsigned char base, unsigned char dot) {
+  const int size = 64;
+  std::vector<unsigned char> pixels(size * size * 3, base);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int cellX = x % 16;
+      const int cellY = y % 16;
+      const int dx = cellX - 8;
+      const int dy = cellY - 8;
+      if (dx * dx + dy * dy <= 16) {
+        const int idx = (y * size + x) * 3;
+        pixels[idx + 0] = dot;
+        pixels[idx + 1] = dot;
+        pixels[idx + 2] = dot;
+      }
+    }
+  }
+
+  return {size, std::move(pixels)};
+}
 
-struct CollectSprite {
-  glm::vec3 position{0.0f};
-  ItemType itemType = ItemType::None;
-  float age = 0.0f;
-  float duration = 0.8f;
-};
+static TextureImage BuildCatTexture() {
+  const int size = 128;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const float fx = static_cast<float>(x) / static_cast<float>(size - 1);
+      const float fy = static_cast<float>(y) / static_cast<float>(size - 1);
+      const float stripe = 0.04f * std::sin(fx * 10.0f + fy * 6.0f) +
+                           0.03f * std::sin(fx * 22.0f - fy * 4.0f);
+      const int cellX = (x + 8) % 32;
+      const int cellY = (y + 12) % 32;
+      const int dx = cellX - 16;
+      const int dy = cellY - 16;
+      const float spot = (dx * dx + dy * dy <= 40) ? -0.12f : 0.0f;
+      float base = 0.86f + stripe + spot + 0.04f * (0.5f - fy);
+      base = glm::clamp(base, 0.65f, 1.0f);
+      const int idx = (y * size + x) * 3;
+      pixels[idx + 0] = static_cast<unsigned char>(base * 240.0f + 10.0f);
+      pixels[idx + 1] = static_cast<unsigned char>(base * 220.0f + 8.0f);
+      pixels[idx + 2] = static_cast<unsigned char>(base * 210.0f + 6.0f);
+    }
+  }
 
-static void WriteVec3(float out[3], const glm::vec3& value) {
-  out[0] = value.x;
-  out[1] = value.y;
-  out[2] = value.z;
+  return {size, std::move(pixels)};
 }
 
-static glm::vec3 ReadVec3(const float in[3]) {
-  return glm::vec3(in[0], in[1], in[2]);
+static TextureImage BuildPlankTexture() {
+  const int size = 128;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const float fx = static_cast<float>(x) / static_cast<float>(size);
+      const float fy = static_cast<float>(y) / static_cast<float>(size);
+      const int plank = (x / 16) % 2;
+      const float grain = 0.12f * std::sin(fy * 40.0f + fx * 6.0f);
+      const float edge = (x % 16 == 0 || x % 16 == 15) ? -0.25f : 0.0f;
+      float base = 0.55f + grain + edge + (plank ? 0.05f : -0.03f);
+      base = glm::clamp(base, 0.2f, 0.9f);
+      const unsigned char r = static_cast<unsigned char>(base * 140.0f + 60.0f);
+      const unsigned char g = static_cast<unsigned char>(base * 110.0f + 50.0f);
+      const unsigned char b = static_cast<unsigned char>(base * 80.0f + 40.0f);
+      const int idx = (y * size + x) * 3;
+      pixels[idx + 0] = r;
+      pixels[idx + 1] = g;
+      pixels[idx + 2] = b;
+    }
+  }
+
+  return {size, std::move(pixels)};
 }
 
-static std::uint32_t BuildCollectedCatMask(const std::vector<Cat>& cats) {
-  std::uint32_t mask = 0u;
-  for (std::size_t i = 0; i < cats.size() && i < 32; ++i) {
-    if (cats[i].collected) {
-      mask |= (1u << static_cast<std::uint32_t>(i));
+static TextureImage BuildFabricTexture(unsigned char base, unsigned char stripe) {
+  const int size = 128;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int idx = (y * size + x) * 3;
+      const bool band = ((x / 10) % 2) == 0;
+      const int weave = ((x % 4) == 0 || (y % 4) == 0) ? -8 : 0;
+      const unsigned char c = static_cast<unsigned char>(glm::clamp<int>(base + (band ? stripe : 0) + weave, 20, 230));
+      pixels[idx + 0] = c;
+      pixels[idx + 1] = static_cast<unsigned char>(glm::clamp<int>(c - 10, 0, 255));
+      pixels[idx + 2] = static_cast<unsigned char>(glm::clamp<int>(c - 20, 0, 255));
     }
   }
-  return mask;
+
+  return {size, std::move(pixels)};
 }
 
-static std::uint32_t BuildCollectedDogMask(const std::vector<Dog>& dogs) {
-  std::uint32_t mask = 0u;
-  for (std::size_t i = 0; i < dogs.size() && i < 32; ++i) {
-    if (dogs[i].collected) {
-      mask |= (1u << static_cast<std::uint32_t>(i));
+static TextureImage BuildSkinTexture() {
+  const int size = 64;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const float fx = static_cast<float>(x) / static_cast<float>(size);
+      const float fy = static_cast<float>(y) / static_cast<float>(size);
+      const float vignette = 0.85f + 0.2f * (1.0f - std::abs(fx - 0.5f) * 2.0f);
+      const float freckles = ((x + y * 7) % 17 == 0) ? -0.08f : 0.0f;
+      float base = 0.86f * vignette + freckles;
+      base = glm::clamp(base, 0.6f, 0.95f);
+      const int idx = (y * size + x) * 3;
+      pixels[idx + 0] = static_cast<unsigned char>(base * 230.0f + 10.0f);
+      pixels[idx + 1] = static_cast<unsigned char>(base * 190.0f + 15.0f);
+      pixels[idx + 2] = static_cast<unsigned char>(base * 160.0f + 20.0f);
     }
   }
-  return mask;
+
+  return {size, std::move(pixels)};
 }
 
-static int ApplyCollectedCatMask(std::vector<Cat>& cats, std::uint32_t mask) {
-  int count = 0;
-  for (std::size_t i = 0; i < cats.size() && i < 32; ++i) {
-    const bool collected = (mask & (1u << static_cast<std::uint32_t>(i))) != 0u;
-    cats[i].collected = cats[i].collected || collected;
-    if (cats[i].collected) {
-      ++count;
+static TextureImage BuildMetalTexture() {
+  const int size = 64;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const float fx = static_cast<float>(x) / static_cast<float>(size);
+      const float streak = 0.1f * std::sin(fx * 24.0f) + 0.05f * std::sin(fx * 60.0f);
+      float base = 0.75f + streak;
+      base = glm::clamp(base, 0.55f, 0.9f);
+      const int idx = (y * size + x) * 3;
+      pixels[idx + 0] = static_cast<unsigned char>(base * 220.0f);
+      pixels[idx + 1] = static_cast<unsigned char>(base * 220.0f);
+      pixels[idx + 2] = static_cast<unsigned char>(base * 235.0f);
     }
   }
-  return count;
+
+  return {size, std::move(pixels)};
 }
 
-static int ApplyCollectedDogMask(std::vector<Dog>& dogs, std::uint32_t mask) {
-  int count = 0;
-  for (std::size_t i = 0; i < dogs.size() && i < 32; ++i) {
-    const bool collected = (mask & (1u << static_cast<std::uint32_t>(i))) != 0u;
-    dogs[i].collected = dogs[i].collected || collected;
-    if (dogs[i].collected) {
-      ++count;
+static TextureImage BuildCloudTexture() {
+  const int size = 128;
+  std::vector<unsigned char> pixels(size * size * 3);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const float fx = static_cast<float>(x) / static_cast<float>(size - 1);
+      const float fy = static_cast<float>(y) / static_cast<float>(size - 1);
+      const float dx = (fx - 0.5f) * 2.0f;
+      const float dy = (fy - 0.5f) * 2.0f;
+      const float puff = std::exp(-(dx * dx * 1.6f + dy * dy * 3.0f));
+      const float wisps = 0.08f * std::sin(fx * 20.0f) + 0.06f * std::sin((fx + fy) * 16.0f);
+      float shade = 0.72f + puff * 0.24f + wisps;
+      shade = glm::clamp(shade, 0.62f, 1.0f);
+      const int idx = (y * size + x) * 3;
+      pixels[idx + 0] = static_cast<unsigned char>(shade * 245.0f);
+      pixels[idx + 1] = static_cast<unsigned char>(shade * 242.0f);
+      pixels[idx + 2] = static_cast<unsigned char>(shade * 236.0f);
     }
   }
-  return count;
+
+  return {size, std::move(pixels)};
 }
 
-static std::uint32_t BuildActiveWorldItemMask(const std::vector<WorldItem>& worldItems) {
-  std::uint32_t mask = 0u;
-  for (std::size_t i = 0; i < worldItems.size() && i < 32; ++i) {
-    if (worldItems[i].active) {
-      mask |= (1u << static_cast<std::uint32_t>(i));
+// Read-only view of a whole file, memory-mapped so cached buffers are paged in on demand
+// and never copied through a read buffer.
+struct MappedFile {
+  const unsigned char* data = nullptr;
+  std::size_t size = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+  ~MappedFile() { Close(); }
+
+  // The mapping itself stays where it is, so pointers into data survive the move.
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      Close();
+      data = other.data;
+      size = other.size;
+      other.data = nullptr;
+      other.size = 0;
+#ifdef _WIN32
+      file = other.file;
+      mapping = other.mapping;
+      other.file = INVALID_HANDLE_VALUE;
+      other.mapping = nullptr;
+#endif
+    }
+    return *this;
+  }
+
+  bool Open(const char* path) {
+    Close();
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER length{};
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+      Close();
+      return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+      Close();
+      return false;
+    }
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<std::size_t>(length.QuadPart);
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info {};
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (view == MAP_FAILED) {
+      return false;
+    }
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<std::size_t>(info.st_size);
+#endif
+    return true;
+  }
+
+  void Close() {
+#ifdef _WIN32
+    if (data != nullptr) {
+      UnmapViewOfFile(data);
     }
+    if (mapping != nullptr) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data != nullptr) {
+      munmap(const_cast<unsigned char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+  }
+};
+
+enum class TextureAsset : std::uint8_t {
+  Plank,
+  PlayerFabric,
+  Skin,
+  ClownFabric,
+  ClownDots,
+  Metal,
+  Cat,
+  Cloud,
+  Count,
+};
+
+enum class SoundAsset : std::uint8_t {
+  Footstep,
+  Jump,
+  Land,
+  Ambient,
+  Chase,
+  Explosion,
+  Hurt,
+  Count,
+};
+
+static constexpr std::size_t kTextureAssetCount = static_cast<std::size_t>(TextureAsset::Count);
+static constexpr std::size_t kSoundAssetCount = static_cast<std::size_t>(SoundAsset::Count);
+static constexpr std::size_t kAssetCount = kTextureAssetCount + kSoundAssetCount;
+static constexpr int kAudioSampleRate = 48000;
+
+static constexpr const char* kAssetCacheFile = "vibe3d_assets.cache";
+static constexpr std::uint32_t kAssetCacheMagic = 0x43413356u;  // "V3AC"
+// Bump whenever a Build*Texture or Generate* function changes its output. The string is
+// hashed into the cache key, so caches written by older generators are rebuilt, not trusted.
+static constexpr const char* kAssetGeneratorVersion = "procedural-assets/1";
+
+static TextureImage GenerateTextureAsset(TextureAsset asset) {
+  switch (asset) {
+    case TextureAsset::Plank: return BuildPlankTexture();
+    case TextureAsset::PlayerFabric: return BuildFabricTexture(90, 70);
+    case TextureAsset::Skin: return BuildSkinTexture();
+    case TextureAsset::ClownFabric: return BuildFabricTexture(160, 40);
+    case TextureAsset::ClownDots: return BuildDotsTexture(220, 60);
+    case TextureAsset::Metal: return BuildMetalTexture();
+    case TextureAsset::Cat: return BuildCatTexture();
+    case TextureAsset::Cloud: return BuildCloudTexture();
+    case TextureAsset::Count: break;
   }
-  return mask;
+  return {};
 }
 
-static glm::vec3 ScaleXZ(const glm::vec3& value, float scale) {
-  return glm::vec3(value.x * scale, value.y, value.z * scale);
+static std::vector<float> GenerateSoundAsset(SoundAsset asset, int sampleRate) {
+  switch (asset) {
+    case SoundAsset::Footstep: return GenerateFootstep(sampleRate);
+    case SoundAsset::Jump: return GenerateJump(sampleRate);
+    case SoundAsset::Land: return GenerateLand(sampleRate);
+    case SoundAsset::Ambient: return GenerateAmbient(sampleRate);
+    case SoundAsset::Chase: return GenerateChase(sampleRate);
+    case SoundAsset::Explosion: return GenerateExplosion(sampleRate);
+    case SoundAsset::Hurt: return GenerateHurt(sampleRate);
+    case SoundAsset::Count: break;
+  }
+  return {};
 }
 
-static glm::vec3 ScaleExtentXZ(const glm::vec3& value, float scale) {
-  return glm::vec3(value.x * scale, value.y, value.z * scale);
+// FNV-1a over the generator version and every input that shapes the generated buffers.
+static std::uint64_t AssetCacheKey(int sampleRate) {
+  std::uint64_t hash = 14695981039346656037ull;
+  auto Mix = [&](const void* bytes, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      hash = (hash ^ static_cast<const unsigned char*>(bytes)[i]) * 1099511628211ull;
+    }
+  };
+  Mix(kAssetGeneratorVersion, std::strlen(kAssetGeneratorVersion));
+  Mix(&sampleRate, sizeof(sampleRate));
+  const std::uint32_t counts[2] = {static_cast<std::uint32_t>(kTextureAssetCount),
+                                   static_cast<std::uint32_t>(kSoundAssetCount)};
+  Mix(counts, sizeof(counts));
+  return hash;
 }
 
-static const char* ItemTypeName(ItemType type) {
-  switch (type) {
-    case ItemType::Boomerang:
-      return "Boomerang";
-    case ItemType::SpeedBoots:
-      return "Speed Boots";
-    case ItemType::Shotgun:
-      return "Shotgun";
-    case ItemType::Sword:
-      return "Sword";
-    default:
-      return "None";
+// Cache layout, native byte order (the file is machine-local): header, one entry per asset
+// (textures, then sounds), then payloads on 16-byte boundaries so float views stay aligned.
+struct AssetCacheHeader {
+  std::uint32_t magic = kAssetCacheMagic;
+  std::uint32_t count = 0;
+  std::uint64_t key = 0;
+};
+
+struct AssetCacheEntry {
+  std::uint64_t offset = 0;
+  std::uint64_t bytes = 0;
+  std::uint32_t size = 0;  // Texture edge in pixels; unused for sounds.
+  std::uint32_t reserved = 0;
+};
+
+// Procedural textures and sounds for startup. Start() either maps a valid cache or fans the
+// generators out over worker threads, so synthesis overlaps window and GL setup; Finish()
+// joins them and republishes fresh output to the cache. Either way the accessors hand out
+// views, into the mapping or into the generated vectors, valid for this object's lifetime.
+struct ProceduralAssets {
+  struct Blob {
+    const unsigned char* data = nullptr;
+    std::size_t bytes = 0;
+    int size = 0;
+  };
+
+  MappedFile cache;
+  std::vector<TextureImage> textures;
+  std::vector<std::vector<float>> sounds;
+  Blob blobs[kAssetCount];
+  std::vector<std::thread> workers;
+  std::atomic<std::size_t> nextJob{0};
+  std::uint64_t key = 0;
+  int sampleRate = 0;
+  bool fromCache = false;
+
+  ProceduralAssets() = default;
+  ProceduralAssets(const ProceduralAssets&) = delete;
+  ProceduralAssets& operator=(const ProceduralAssets&) = delete;
+  ~ProceduralAssets() { JoinWorkers(); }
+
+  void Start(int rate) {
+    sampleRate = rate;
+    key = AssetCacheKey(rate);
+    if (MapCache()) {
+      fromCache = true;
+      return;
+    }
+    textures.assign(kTextureAssetCount, TextureImage{});
+    sounds.assign(kSoundAssetCount, std::vector<float>{});
+    const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t workerCount = std::min<std::size_t>(kAssetCount, hardware);
+    for (std::size_t i = 0; i < workerCount; ++i) {
+      workers.emplace_back([this]() {
+        for (std::size_t job = nextJob.fetch_add(1); job < kAssetCount; job = nextJob.fetch_add(1)) {
+          if (job < kTextureAssetCount) {
+            textures[job] = GenerateTextureAsset(static_cast<TextureAsset>(job));
+          } else {
+            const std::size_t sound = job - kTextureAssetCount;
+            sounds[sound] = GenerateSoundAsset(static_cast<SoundAsset>(sound), sampleRate);
+          }
+        }
+      });
+    }
   }
-}
 
-static glm::vec3 ItemTypeTint(ItemType type) {
-  switch (type) {
-    case ItemType::Boomerang:
-      return glm::vec3(0.95f, 0.72f, 0.24f);
-    case ItemType::SpeedBoots:
-      return glm::vec3(0.24f, 0.74f, 1.0f);
-    case ItemType::Shotgun:
-      return glm::vec3(0.55f, 0.55f, 0.62f);
-    case ItemType::Sword:
-      return glm::vec3(0.85f, 0.85f, 0.95f);
-    default:
-      return glm::vec3(0.8f, 0.8f, 0.8f);
+  void Finish() {
+    if (fromCache) {
+      return;
+    }
+    JoinWorkers();
+    for (std::size_t i = 0; i < kTextureAssetCount; ++i) {
+      blobs[i].data = textures[i].pixels.data();
+      blobs[i].bytes = textures[i].pixels.size();
+      blobs[i].size = textures[i].size;
+    }
+    for (std::size_t i = 0; i < kSoundAssetCount; ++i) {
+      Blob& blob = blobs[kTextureAssetCount + i];
+      blob.data = reinterpret_cast<const unsigned char*>(sounds[i].data());
+      blob.bytes = sounds[i].size() * sizeof(float);
+    }
+    WriteCache();
   }
-}
 
-static void PackWorldEntities(MultiplayerPacket& packet,
-                              const Enemy& clown,
-                              float clownFacing,
-                              float clownWalkCycle,
-                              const Enemy& mummy,
-                              float mummyFacing,
-                              float mummyWalkCycle,
-                              float mummyThrowCooldown,
-                              const std::vector<Cat>& cats,
-                              const std::vector<Dog>& dogs,
-                              const std::vector<Bomb>& bombs,
-                              const std::vector<Explosion>& explosions,
-                              const std::vector<WorldItem>& worldItems,
-                              ItemType heldItem,
-                              int heldCharges,
-                              bool clownAlive,
-                              float clownRespawnTimer,
-                              float clownStunTimer,
-                              bool mummyAlive,
-                              float mummyRespawnTimer,
-                              float mummyStunTimer) {
-  WriteVec3(packet.clownPos, clown.position);
-  WriteVec3(packet.clownVel, clown.velocity);
-  packet.clownFacing = clownFacing;
-  packet.clownWalkCycle = clownWalkCycle;
-  packet.clownJumpCooldown = clown.jumpCooldown;
+  int TextureSize(TextureAsset asset) const { return blobs[static_cast<std::size_t>(asset)].size; }
+  const unsigned char* TexturePixels(TextureAsset asset) const { return blobs[static_cast<std::size_t>(asset)].data; }
+  const float* SoundSamples(SoundAsset asset) const {
+    return reinterpret_cast<const float*>(blobs[kTextureAssetCount + static_cast<std::size_t>(asset)].data);
+  }
+  std::size_t SoundFrames(SoundAsset asset) const {
+    return blobs[kTextureAssetCount + static_cast<std::size_t>(asset)].bytes / sizeof(float);
+  }
 
-  WriteVec3(packet.mummyPos, mummy.position);
-  WriteVec3(packet.mummyVel, mummy.velocity);
-  packet.mummyFacing = mummyFacing;
-  packet.mummyWalkCycle = mummyWalkCycle;
-  packet.mummyThrowCooldown = mummyThrowCooldown;
+  void JoinWorkers() {
+    for (std::thread& worker : workers) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+    workers.clear();
+  }
 
-  for (std::size_t i = 0; i < cats.size() && i < 10; ++i) {
-    WriteVec3(packet.catPos[i], cats[i].position);
-    WriteVec3(packet.catVel[i], cats[i].velocity);
-    packet.catFacing[i] = cats[i].facing;
-    packet.catWalkCycle[i] = cats[i].walkCycle;
+  bool MapCache() {
+    if (!cache.Open(kAssetCacheFile)) {
+      return false;
+    }
+    AssetCacheHeader header;
+    const std::size_t tableBytes = sizeof(header) + kAssetCount * sizeof(AssetCacheEntry);
+    if (cache.size < tableBytes) {
+      cache.Close();
+      return false;
+    }
+    std::memcpy(&header, cache.data, sizeof(header));
+    if (header.magic != kAssetCacheMagic || header.key != key || header.count != kAssetCount) {
+      cache.Close();
+      return false;
+    }
+    for (std::size_t i = 0; i < kAssetCount; ++i) {
+      AssetCacheEntry entry;
+      std::memcpy(&entry, cache.data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+      const bool texture = i < kTextureAssetCount;
+      const bool inBounds = entry.offset >= tableBytes && entry.offset <= cache.size &&
+                            entry.bytes <= cache.size - entry.offset;
+      const bool wellFormed = texture ? (entry.size > 0 && entry.size <= static_cast<std::uint32_t>(TextureArray::kLayerSize) &&
+                                         TextureArray::kLayerSize % entry.size == 0 &&
+                                         entry.bytes == static_cast<std::uint64_t>(entry.size) * entry.size * 3)
+                                      : (entry.bytes % sizeof(float) == 0 && entry.offset % alignof(float) == 0);
+      if (!inBounds || !wellFormed) {
+        std::cerr << "Asset cache " << kAssetCacheFile << " is corrupt; regenerating.\n";
+        cache.Close();
+        return false;
+      }
+      blobs[i].data = cache.data + entry.offset;
+      blobs[i].bytes = static_cast<std::size_t>(entry.bytes);
+      blobs[i].size = static_cast<int>(entry.size);
+    }
+    return true;
   }
 
-  for (std::size_t i = 0; i < dogs.size() && i < 20; ++i) {
-    WriteVec3(packet.dogPos[i], dogs[i].position);
-    WriteVec3(packet.dogVel[i], dogs[i].velocity);
-    packet.dogFacing[i] = dogs[i].facing;
-    packet.dogWalkCycle[i] = dogs[i].walkCycle;
-    packet.dogBlastTimer[i] = dogs[i].blastTimer;
-  }
+  // Written beside the final path and renamed over it, so a crash mid-write never leaves a
+  // truncated cache for the next start to map.
+  void WriteCache() const {
+    AssetCacheHeader header;
+    header.count = static_cast<std::uint32_t>(kAssetCount);
+    header.key = key;
+    AssetCacheEntry entries[kAssetCount];
+    std::uint64_t offset = sizeof(header) + sizeof(entries);
+    for (std::size_t i = 0; i < kAssetCount; ++i) {
+      offset = (offset + 15u) & ~std::uint64_t{15u};
+      entries[i].offset = offset;
+      entries[i].bytes = blobs[i].bytes;
+      entries[i].size = static_cast<std::uint32_t>(blobs[i].size);
+      offset += blobs[i].bytes;
+    }
 
-  packet.bombActiveMask = 0u;
-  for (std::size_t i = 0; i < bombs.size() && i < 12; ++i) {
-    if (bombs[i].active) {
-      packet.bombActiveMask |= (1u << static_cast<std::uint32_t>(i));
+    const std::string tempPath = std::string(kAssetCacheFile) + ".tmp";
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        return;
+      }
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+      std::uint64_t written = sizeof(header) + sizeof(entries);
+      const char padding[16] = {};
+      for (std::size_t i = 0; i < kAssetCount; ++i) {
+        file.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+        file.write(reinterpret_cast<const char*>(blobs[i].data), static_cast<std::streamsize>(blobs[i].bytes));
+        written = entries[i].offset + entries[i].bytes;
+      }
+      if (!file) {
+        std::cerr << "Failed to write asset cache " << tempPath << "\n";
+        file.close();
+        std::remove(tempPath.c_str());
+        return;
+      }
+    }
+    std::remove(kAssetCacheFile);  // rename() does not replace an existing file on Windows.
+    if (std::rename(tempPath.c_str(), kAssetCacheFile) != 0) {
+      std::remove(tempPath.c_str());
     }
-    WriteVec3(packet.bombPos[i], bombs[i].position);
-    WriteVec3(packet.bombVel[i], bombs[i].velocity);
-    packet.bombTimer[i] = bombs[i].timer;
   }
+};
 
-  packet.explosionCount = static_cast<std::uint8_t>(std::min<std::size_t>(explosions.size(), 16));
-  for (std::size_t i = 0; i < packet.explosionCount; ++i) {
-    WriteVec3(packet.explosionPos[i], explosions[i].position);
-    packet.explosionAge[i] = explosions[i].age;
-    packet.explosionDuration[i] = explosions[i].duration;
-    packet.explosionSeed[i] = explosions[i].seed;
-  }
+// Worlds are authored as text (levels/*.level, described in world.level itself) and compiled
+// into a flat binary beside the asset cache. Later starts map that binary and read platforms,
+// spawn tables, the platform grid and the baked backdrop mesh in place, so load time no longer
+// grows with parsing or backdrop baking.
+static constexpr const char* kWorldBinaryFile = "vibe3d_world.bin";
+static constexpr std::uint32_t kWorldFileMagic = 0x44573356u;  // "V3WD"
+// Bump whenever the compiler's output for the same source changes; like the asset generator
+// version it is hashed into the key, so older binaries are recompiled rather than trusted.
+static constexpr const char* kWorldCompilerVersion = "world/2";
+// Side of the square XZ chunks the world is streamed and simulated in. The backdrop mesh is
+// stored chunk by chunk so each one can be loaded on its own.
+static constexpr float kWorldChunkSize = 32.0f;
+
+struct WorldDogSpawn {
+  glm::vec3 position{0.0f};
+  float bobOffset = 0.0f;
+};
 
-  packet.worldItemActiveMask = BuildActiveWorldItemMask(worldItems);
-  for (std::size_t i = 0; i < worldItems.size() && i < 16; ++i) {
-    packet.worldItemType[i] = static_cast<std::uint8_t>(worldItems[i].type);
-    WriteVec3(packet.worldItemPos[i], worldItems[i].position);
-  }
+struct WorldItemSpawn {
+  std::uint32_t type = 0u;  // ItemType.
+  glm::vec3 position{0.0f};
+};
 
-  packet.localHeldItemType = static_cast<std::uint8_t>(heldItem);
-  packet.localHeldItemCharges = heldCharges;
+struct WorldCloud {
+  glm::vec3 basePosition{0.0f};
+  glm::vec2 driftDir{0.0f};
+  float driftSpeed = 0.0f;
+  float hueOffset = 0.0f;
+  std::uint32_t firstPuff = 0u;
+  std::uint32_t puffCount = 0u;
+};
 
-  packet.enemyAliveMask = (clownAlive ? 0x1u : 0u) | (mummyAlive ? 0x2u : 0u);
-  packet.enemyRespawnTimer[0] = clownRespawnTimer;
-  packet.enemyRespawnTimer[1] = mummyRespawnTimer;
-  packet.enemyStunTimer[0] = clownStunTimer;
-  packet.enemyStunTimer[1] = mummyStunTimer;
+struct WorldChunk {
+  std::uint32_t firstVertex = 0u;  // Backdrop vertices of cubes centered in this chunk.
+  std::uint32_t vertexCount = 0u;
+  std::uint32_t cubeCount = 0u;
+  glm::vec3 boundsMin{0.0f};  // Around those vertices, which may spill into neighbours.
+  glm::vec3 boundsMax{0.0f};
+};
+
+struct WorldLayout {
+  glm::vec3 levelOneSpawn{0.0f};
+  glm::vec3 levelTwoSpawn{0.0f};
+  glm::vec3 carPositionLevel1{0.0f};
+  glm::vec3 carPositionLevel2{0.0f};
+  glm::vec2 clownStart{0.0f};  // XZ; enemies stand on the ground slab.
+  glm::vec2 mummyStart{0.0f};
+  glm::vec2 gridOrigin{0.0f};
+  std::int32_t gridWidth = 0;
+  std::int32_t gridDepth = 0;
+  std::uint32_t staticCubeCount = 0u;
+  glm::vec2 chunkOrigin{0.0f};
+  std::int32_t chunkWidth = 0;
+  std::int32_t chunkDepth = 0;
+};
+
+enum WorldSection : std::uint32_t {
+  kWorldSectionLayout,
+  kWorldSectionPlatforms,
+  kWorldSectionCats,
+  kWorldSectionDogs,
+  kWorldSectionItems,
+  kWorldSectionClouds,
+  kWorldSectionCloudPuffs,
+  kWorldSectionGridCells,
+  kWorldSectionGridIndices,
+  kWorldSectionStaticMesh,
+  kWorldSectionChunks,
+  kWorldSectionCount,
+};
+
+// Same conventions as the asset cache: native byte order, sections on 16-byte boundaries.
+struct WorldSectionEntry {
+  std::uint64_t offset = 0;
+  std::uint64_t bytes = 0;
+};
+
+struct WorldFileHeader {
+  std::uint32_t magic = kWorldFileMagic;
+  std::uint32_t sectionCount = kWorldSectionCount;
+  std::uint64_t key = 0;
+  WorldSectionEntry sections[kWorldSectionCount];
+};
+
+struct CompiledWorld {
+  WorldLayout layout;
+  std::vector<Platform> platforms;
+  std::vector<glm::vec3> cats;
+  std::vector<WorldDogSpawn> dogs;
+  std::vector<WorldItemSpawn> items;
+  std::vector<WorldCloud> clouds;
+  std::vector<CloudPuff> cloudPuffs;
+  PlatformGrid grid;
+  std::vector<float> staticMesh;
+  std::vector<WorldChunk> chunks;
+};
+
+template <typename T>
+struct WorldView {
+  const T* data = nullptr;
+  std::size_t count = 0;
+
+  const T* begin() const { return data; }
+  const T* end() const { return data + count; }
+  std::size_t size() const { return count; }
+  const T& operator[](std::size_t i) const { return data[i]; }
+};
+
+static std::uint64_t WorldKey(const std::string& source) {
+  std::uint64_t hash = 14695981039346656037ull;
+  auto Mix = [&](const void* bytes, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      hash = (hash ^ static_cast<const unsigned char*>(bytes)[i]) * 1099511628211ull;
+    }
+  };
+  Mix(kWorldCompilerVersion, std::strlen(kWorldCompilerVersion));
+  Mix(source.data(), source.size());
+  return hash;
 }
 
-static void ApplyWorldEntities(const MultiplayerPacket& packet,
-                               Enemy& clown,
-                               float& clownFacing,
-                               float& clownWalkCycle,
-                               Enemy& mummy,
-                               float& mummyFacing,
-                               float& mummyWalkCycle,
-                               float& mummyThrowCooldown,
-                               std::vector<Cat>& cats,
-                               std::vector<Dog>& dogs,
-                               std::vector<Bomb>& bombs,
-                               std::vector<Explosion>& explosions,
-                               std::vector<WorldItem>& worldItems,
-                               ItemType& remoteHeldItem,
-                               int& remoteHeldCharges,
-                               bool& clownAlive,
-                               float& clownRespawnTimer,
-                               float& clownStunTimer,
-                               bool& mummyAlive,
-                               float& mummyRespawnTimer,
-                               float& mummyStunTimer) {
-  clown.position = ReadVec3(packet.clownPos);
-  clown.velocity = ReadVec3(packet.clownVel);
-  clownFacing = packet.clownFacing;
-  clownWalkCycle = packet.clownWalkCycle;
-  clown.jumpCooldown = packet.clownJumpCooldown;
+// Backdrop prefabs expand into cubes whose layer slot holds the TextureAsset; StaticScene::Upload
+// resolves it against the texture array.
+static bool CompileWorld(const std::string& sourcePath, const std::string& source, const float* cubeVertices,
+                         int cubeVertexCount, CompiledWorld& world) {
+  StaticScene backdrop;
+  const TextureLayer plankMaterial = static_cast<TextureLayer>(TextureAsset::Plank);
+  const TextureLayer catMaterial = static_cast<TextureLayer>(TextureAsset::Cat);
+  const TextureLayer cloudMaterial = static_cast<TextureLayer>(TextureAsset::Cloud);
+  const TextureLayer metalMaterial = static_cast<TextureLayer>(TextureAsset::Metal);
+
+  auto AddTree = [&](const glm::vec3& pos, float trunkHeight, float crownScale, const glm::vec3& crownTint) {
+    backdrop.Add(pos + glm::vec3(0.0f, trunkHeight * 0.5f, 0.0f),
+                 glm::vec3(0.22f, trunkHeight * 0.5f, 0.22f),
+                 glm::vec3(0.5f, 0.35f, 0.2f), plankMaterial);
+    backdrop.Add(pos + glm::vec3(0.0f, trunkHeight + crownScale * 0.45f, 0.0f),
+                 glm::vec3(crownScale, crownScale * 0.6f, crownScale),
+                 crownTint, catMaterial);
+    backdrop.Add(pos + glm::vec3(0.0f, trunkHeight + crownScale * 0.9f, 0.0f),
+                 glm::vec3(crownScale * 0.72f, crownScale * 0.45f, crownScale * 0.72f),
+                 crownTint * glm::vec3(1.06f, 1.05f, 1.06f), catMaterial);
+  };
 
-  mummy.position = ReadVec3(packet.mummyPos);
-  mummy.velocity = ReadVec3(packet.mummyVel);
-  mummyFacing = packet.mummyFacing;
-  mummyWalkCycle = packet.mummyWalkCycle;
-  mummyThrowCooldown = packet.mummyThrowCooldown;
+  std::istringstream lines(source);
+  std::string text;
+  int lineNumber = 0;
+  bool haveSpawn[2] = {false, false};
+  bool haveCar[2] = {false, false};
+  bool haveClown = false;
+  bool haveMummy = false;
+  auto Fail = [&](const std::string& message) {
+    std::cerr << sourcePath << ":" << lineNumber << ": " << message << "\n";
+    return false;
+  };
+  while (std::getline(lines, text)) {
+    ++lineNumber;
+    const std::size_t comment = text.find('#');
+    if (comment != std::string::npos) {
+      text.erase(comment);
+    }
+    std::istringstream line(text);
+    std::string keyword;
+    if (!(line >> keyword)) {
+      continue;
+    }
+    std::string name;
+    if (keyword == "item") {
+      line >> name;
+    }
+    float v[10] = {};
+    auto Read = [&](int count) {
+      for (int i = 0; i < count; ++i) {
+        if (!(line >> v[i])) {
+          return false;
+        }
+      }
+      return true;
+    };
+    auto Vec3At = [&](int i) { return glm::vec3(v[i], v[i + 1], v[i + 2]); };
+    const std::size_t arity = keyword == "platform" ? 9u
+                              : (keyword == "cube") ? 9u
+                              : (keyword == "tree") ? 8u
+                              : (keyword == "cloud") ? 7u
+                              : (keyword == "puff" || keyword == "cabin" || keyword == "shrub") ? 6u
+                              : (keyword == "hill" || keyword == "pine") ? 5u
+                              : (keyword == "spawn" || keyword == "car" || keyword == "dog") ? 4u
+                              : (keyword == "cat" || keyword == "item" || keyword == "tower" || keyword == "lantern") ? 3u
+                              : (keyword == "clown" || keyword == "mummy") ? 2u
+                                                                            : 0u;
+    if (arity == 0u) {
+      return Fail("unknown directive '" + keyword + "'");
+    }
+    if (!Read(static_cast<int>(arity))) {
+      return Fail("'" + keyword + "' expects " + std::to_string(arity) + " numbers");
+    }
+    if (keyword == "cube") {
+      line >> name;
+    }
+    std::string extra;
+    if (line >> extra) {
+      return Fail("unexpected '" + extra + "' after '" + keyword + "'");
+    }
 
-  for (std::size_t i = 0; i < cats.size() && i < 10; ++i) {
-    cats[i].position = ReadVec3(packet.catPos[i]);
-    cats[i].velocity = ReadVec3(packet.catVel[i]);
-    cats[i].facing = packet.catFacing[i];
-    cats[i].walkCycle = packet.catWalkCycle[i];
+    if (keyword == "platform") {
+      world.platforms.push_back({ScaleXZ(Vec3At(0), kMapScale), ScaleExtentXZ(Vec3At(3), kMapScale), Vec3At(6)});
+    } else if (keyword == "spawn" || keyword == "car") {
+      const int level = static_cast<int>(v[0]);
+      if (v[0] != static_cast<float>(level) || level < 1 || level > 2) {
+        return Fail("'" + keyword + "' needs level 1 or 2");
+      }
+      const glm::vec3 position = ScaleXZ(Vec3At(1), kMapScale);
+      if (keyword == "spawn") {
+        (level == 1 ? world.layout.levelOneSpawn : world.layout.levelTwoSpawn) = position;
+        haveSpawn[level - 1] = true;
+      } else {
+        (level == 1 ? world.layout.carPositionLevel1 : world.layout.carPositionLevel2) = position;
+        haveCar[level - 1] = true;
+      }
+    } else if (keyword == "clown" || keyword == "mummy") {
+      const glm::vec2 start(v[0] * kMapScale, v[1] * kMapScale);
+      if (keyword == "clown") {
+        world.layout.clownStart = start;
+        haveClown = true;
+      } else {
+        world.layout.mummyStart = start;
+        haveMummy = true;
+      }
+    } else if (keyword == "cat") {
+      world.cats.push_back(ScaleXZ(Vec3At(0), kMapScale));
+    } else if (keyword == "dog") {
+      world.dogs.push_back({ScaleXZ(Vec3At(0), kMapScale), v[3]});
+    } else if (keyword == "item") {
+      const ItemType type = name == "boomerang"     ? ItemType::Boomerang
+                            : name == "speed_boots" ? ItemType::SpeedBoots
+                            : name == "shotgun"     ? ItemType::Shotgun
+                            : name == "sword"       ? ItemType::Sword
+                                                    : ItemType::None;
+      if (type == ItemType::None) {
+        return Fail("unknown item '" + name + "'");
+      }
+      world.items.push_back({static_cast<std::uint32_t>(type), ScaleXZ(Vec3At(0), kMapScale)});
+    } else if (keyword == "cloud") {
+      WorldCloud cloud;
+      cloud.basePosition = Vec3At(0);
+      const glm::vec2 drift(v[3], v[4]);
+      if (glm::dot(drift, drift) <= 1e-8f) {
+        return Fail("cloud drift direction is zero");
+      }
+      cloud.driftDir = glm::normalize(drift);
+      cloud.driftSpeed = v[5];
+      cloud.hueOffset = v[6];
+      cloud.firstPuff = static_cast<std::uint32_t>(world.cloudPuffs.size());
+      world.clouds.push_back(cloud);
+    } else if (keyword == "puff") {
+      if (world.clouds.empty()) {
+        return Fail("'puff' before any 'cloud'");
+      }
+      world.cloudPuffs.push_back({Vec3At(0), Vec3At(3)});
+      ++world.clouds.back().puffCount;
+    } else if (keyword == "hill") {
+      const glm::vec3 center = Vec3At(0);
+      const float stretch = v[3];
+      const float depth = v[4];
+      backdrop.Add(center, glm::vec3(stretch, 0.95f, depth), glm::vec3(0.34f, 0.55f, 0.34f), plankMaterial);
+      backdrop.Add(center + glm::vec3(0.0f, 0.9f, 0.0f),
+                   glm::vec3(stretch * 0.72f, 0.5f, depth * 0.72f),
+                   glm::vec3(0.42f, 0.66f, 0.4f), plankMaterial);
+    } else if (keyword == "tree") {
+      AddTree(Vec3At(0), v[3], v[4], Vec3At(5));
+    } else if (keyword == "pine") {
+      const glm::vec3 pos = Vec3At(0);
+      const float h = v[3];
+      const float c = v[4];
+      AddTree(pos, h, c, glm::vec3(0.2f, 0.45f, 0.25f));
+      backdrop.Add(pos + glm::vec3(0.0f, h + c * 1.38f, 0.0f),
+                   glm::vec3(c * 0.6f, c * 0.35f, c * 0.6f), glm::vec3(0.18f, 0.38f, 0.22f), catMaterial);
+    } else if (keyword == "cabin") {
+      const glm::vec3 base = Vec3At(0);
+      const glm::vec3 tint = Vec3At(3);
+      backdrop.Add(base + glm::vec3(0.0f, 0.8f, 0.0f), glm::vec3(1.6f, 0.8f, 1.2f), tint, plankMaterial);
+      backdrop.Add(base + glm::vec3(0.0f, 1.6f, 0.0f), glm::vec3(1.9f, 0.25f, 1.35f), glm::vec3(0.34f, 0.24f, 0.18f), plankMaterial);
+      backdrop.Add(base + glm::vec3(0.0f, 0.55f, 1.2f), glm::vec3(0.28f, 0.5f, 0.12f), glm::vec3(0.32f, 0.2f, 0.14f), plankMaterial);
+      backdrop.Add(base + glm::vec3(-0.65f, 0.95f, 1.21f), glm::vec3(0.22f, 0.22f, 0.08f), glm::vec3(0.8f, 0.86f, 0.92f), cloudMaterial);
+      backdrop.Add(base + glm::vec3(0.65f, 0.95f, 1.21f), glm::vec3(0.22f, 0.22f, 0.08f), glm::vec3(0.8f, 0.86f, 0.92f), cloudMaterial);
+    } else if (keyword == "tower") {
+      const glm::vec3 towerBase = Vec3At(0);
+      backdrop.Add(towerBase + glm::vec3(0.0f, 2.2f, 0.0f), glm::vec3(1.0f, 0.25f, 1.0f), glm::vec3(0.45f, 0.34f, 0.2f), plankMaterial);
+      backdrop.Add(towerBase + glm::vec3(0.75f, 1.1f, 0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), plankMaterial);
+      backdrop.Add(towerBase + glm::vec3(-0.75f, 1.1f, 0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), plankMaterial);
+      backdrop.Add(towerBase + glm::vec3(0.75f, 1.1f, -0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), plankMaterial);
+      backdrop.Add(towerBase + glm::vec3(-0.75f, 1.1f, -0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), plankMaterial);
+      backdrop.Add(towerBase + glm::vec3(0.0f, 2.9f, 0.0f), glm::vec3(1.15f, 0.2f, 1.15f), glm::vec3(0.33f, 0.26f, 0.18f), plankMaterial);
+    } else if (keyword == "shrub") {
+      const glm::vec3 center = Vec3At(0);
+      backdrop.Add(center + glm::vec3(0.0f, 0.22f, 0.0f), glm::vec3(0.5f, 0.22f, 0.5f), glm::vec3(0.29f, 0.56f, 0.28f), catMaterial);
+      backdrop.Add(center + glm::vec3(0.0f, 0.46f, 0.0f), glm::vec3(0.2f, 0.12f, 0.2f), Vec3At(3), cloudMaterial);
+    } else if (keyword == "lantern") {
+      const glm::vec3 post = Vec3At(0);
+      backdrop.Add(post + glm::vec3(0.0f, 0.9f, 0.0f), glm::vec3(0.08f, 0.9f, 0.08f), glm::vec3(0.34f, 0.27f, 0.2f), plankMaterial);
+      backdrop.Add(post + glm::vec3(0.0f, 1.85f, 0.0f), glm::vec3(0.19f, 0.19f, 0.19f), glm::vec3(1.0f, 0.82f, 0.45f), cloudMaterial);
+      backdrop.Add(post + glm::vec3(0.0f, 1.85f, 0.0f), glm::vec3(0.12f, 0.12f, 0.12f), glm::vec3(1.0f, 0.95f, 0.7f), cloudMaterial);
+    } else if (keyword == "cube") {
+      const TextureLayer material = name == "plank"   ? plankMaterial
+                                    : name == "cat"   ? catMaterial
+                                    : name == "cloud" ? cloudMaterial
+                                    : name == "metal" ? metalMaterial
+                                                      : static_cast<TextureLayer>(kTextureAssetCount);
+      if (material == static_cast<TextureLayer>(kTextureAssetCount)) {
+        return Fail("unknown material '" + name + "'");
+      }
+      backdrop.Add(Vec3At(0), Vec3At(3), Vec3At(6), material);
+    }
   }
 
-  for (std::size_t i = 0; i < dogs.size() && i < 20; ++i) {
-    dogs[i].position = ReadVec3(packet.dogPos[i]);
-    dogs[i].velocity = ReadVec3(packet.dogVel[i]);
-    dogs[i].facing = packet.dogFacing[i];
-    dogs[i].walkCycle = packet.dogWalkCycle[i];
-    dogs[i].blastTimer = packet.dogBlastTimer[i];
+  lineNumber = 0;
+  if (world.platforms.empty()) {
+    return Fail("no platforms; the first one is the ground slab");
   }
-
-  for (std::size_t i = 0; i < bombs.size() && i < 12; ++i) {
-    bombs[i].active = (packet.bombActiveMask & (1u << static_cast<std::uint32_t>(i))) != 0u;
-    bombs[i].position = ReadVec3(packet.bombPos[i]);
-    bombs[i].velocity = ReadVec3(packet.bombVel[i]);
-    bombs[i].timer = packet.bombTimer[i];
+  if (!haveSpawn[0] || !haveSpawn[1] || !haveCar[0] || !haveCar[1] || !haveClown || !haveMummy) {
+    return Fail("needs 'spawn' and 'car' for levels 1 and 2, 'clown' and 'mummy'");
   }
-
-  explosions.clear();
-  const std::size_t count = std::min<std::size_t>(packet.explosionCount, 16);
-  explosions.reserve(count);
-  for (std::size_t i = 0; i < count; ++i) {
-    Explosion explosion;
-    explosion.position = ReadVec3(packet.explosionPos[i]);
-    explosion.age = packet.explosionAge[i];
-    explosion.duration = packet.explosionDuration[i];
-    explosion.seed = packet.explosionSeed[i];
-    explosions.push_back(explosion);
+  world.grid.Build(world.platforms);
+  world.layout.gridOrigin = world.grid.origin;
+  world.layout.gridWidth = world.grid.width;
+  world.layout.gridDepth = world.grid.depth;
+  world.layout.staticCubeCount = static_cast<std::uint32_t>(backdrop.pending.size());
+
+  // The chunk grid covers everything the level places, snapped to whole chunks.
+  glm::vec2 boundsMin(std::numeric_limits<float>::max());
+  glm::vec2 boundsMax(-std::numeric_limits<float>::max());
+  auto Cover = [&](const glm::vec3& position, const glm::vec3& halfExtents) {
+    boundsMin = glm::min(boundsMin, glm::vec2(position.x - halfExtents.x, position.z - halfExtents.z));
+    boundsMax = glm::max(boundsMax, glm::vec2(position.x + halfExtents.x, position.z + halfExtents.z));
+  };
+  for (const Platform& platform : world.platforms) {
+    Cover(platform.position, platform.halfExtents);
   }
-
-  for (std::size_t i = 0; i < worldItems.size() && i < 16; ++i) {
-    worldItems[i].active = (packet.worldItemActiveMask & (1u << static_cast<std::uint32_t>(i))) != 0u;
-    worldItems[i].type = static_cast<ItemType>(packet.worldItemType[i]);
-    worldItems[i].position = ReadVec3(packet.worldItemPos[i]);
+  for (const CubeInstance& cube : backdrop.pending) {
+    Cover(glm::vec3(cube.model[3]), glm::vec3(0.0f));
   }
+  world.layout.chunkOrigin = glm::floor(boundsMin / kWorldChunkSize) * kWorldChunkSize;
+  world.layout.chunkWidth = static_cast<std::int32_t>((boundsMax.x - world.layout.chunkOrigin.x) / kWorldChunkSize) + 1;
+  world.layout.chunkDepth = static_cast<std::int32_t>((boundsMax.y - world.layout.chunkOrigin.y) / kWorldChunkSize) + 1;
+  auto ChunkOf = [&](const glm::vec3& position) {
+    const int x = glm::clamp(static_cast<int>(std::floor((position.x - world.layout.chunkOrigin.x) / kWorldChunkSize)), 0,
+                             world.layout.chunkWidth - 1);
+    const int z = glm::clamp(static_cast<int>(std::floor((position.z - world.layout.chunkOrigin.y) / kWorldChunkSize)), 0,
+                             world.layout.chunkDepth - 1);
+    return static_cast<std::size_t>(z * world.layout.chunkWidth + x);
+  };
 
-  remoteHeldItem = static_cast<ItemType>(packet.localHeldItemType);
-  remoteHeldCharges = packet.localHeldItemCharges;
-
-  clownAlive = (packet.enemyAliveMask & 0x1u) != 0u;
-  mummyAlive = (packet.enemyAliveMask & 0x2u) != 0u;
-  clownRespawnTimer = packet.enemyRespawnTimer[0];
-  mummyRespawnTimer = packet.enemyRespawnTimer[1];
-  clownStunTimer = packet.enemyStunTimer[0];
-  mummyStunTimer = packet.enemyStunTimer[1];
+  // Cubes are grouped by the chunk their center falls in, keeping authored order inside a chunk.
+  world.chunks.assign(static_cast<std::size_t>(world.layout.chunkWidth * world.layout.chunkDepth), WorldChunk{});
+  std::stable_sort(backdrop.pending.begin(), backdrop.pending.end(), [&](const CubeInstance& a, const CubeInstance& b) {
+    return ChunkOf(glm::vec3(a.model[3])) < ChunkOf(glm::vec3(b.model[3]));
+  });
+  for (const CubeInstance& cube : backdrop.pending) {
+    ++world.chunks[ChunkOf(glm::vec3(cube.model[3]))].cubeCount;
+  }
+  world.staticMesh = backdrop.BakeVertices(cubeVertices, cubeVertexCount);
+  std::uint32_t firstVertex = 0u;
+  for (WorldChunk& chunk : world.chunks) {
+    chunk.firstVertex = firstVertex;
+    chunk.vertexCount = chunk.cubeCount * static_cast<std::uint32_t>(cubeVertexCount);
+    firstVertex += chunk.vertexCount;
+    if (chunk.vertexCount == 0u) {
+      continue;
+    }
+    chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    chunk.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (std::uint32_t v = chunk.firstVertex; v < chunk.firstVertex + chunk.vertexCount; ++v) {
+      const glm::vec3 position(world.staticMesh[v * StaticScene::kFloatsPerVertex],
+                               world.staticMesh[v * StaticScene::kFloatsPerVertex + 1],
+                               world.staticMesh[v * StaticScene::kFloatsPerVertex + 2]);
+      chunk.boundsMin = glm::min(chunk.boundsMin, position);
+      chunk.boundsMax = glm::max(chunk.boundsMax, position);
+    }
+  }
+  return true;
 }
 
-static void FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
-  (void)window;
-  glViewport(0, 0, width, height);
+// Lays a compiled world out exactly as it is stored on disk.
+static std::vector<unsigned char> BuildWorldBlob(const CompiledWorld& world, std::uint64_t key) {
+  struct Part {
+    const void* data;
+    std::size_t bytes;
+  };
+  const Part parts[kWorldSectionCount] = {
+      {&world.layout, sizeof(world.layout)},
+      {world.platforms.data(), world.platforms.size() * sizeof(Platform)},
+      {world.cats.data(), world.cats.size() * sizeof(glm::vec3)},
+      {world.dogs.data(), world.dogs.size() * sizeof(WorldDogSpawn)},
+      {world.items.data(), world.items.size() * sizeof(WorldItemSpawn)},
+      {world.clouds.data(), world.clouds.size() * sizeof(WorldCloud)},
+      {world.cloudPuffs.data(), world.cloudPuffs.size() * sizeof(CloudPuff)},
+      {world.grid.cellStart.data(), world.grid.cellStart.size() * sizeof(std::uint32_t)},
+      {world.grid.indices.data(), world.grid.indices.size() * sizeof(std::uint32_t)},
+      {world.staticMesh.data(), world.staticMesh.size() * sizeof(float)},
+      {world.chunks.data(), world.chunks.size() * sizeof(WorldChunk)},
+  };
+  WorldFileHeader header;
+  header.key = key;
+  std::uint64_t offset = sizeof(header);
+  for (std::size_t i = 0; i < kWorldSectionCount; ++i) {
+    offset = (offset + 15u) & ~std::uint64_t{15u};
+    header.sections[i].offset = offset;
+    header.sections[i].bytes = parts[i].bytes;
+    offset += parts[i].bytes;
+  }
+  std::vector<unsigned char> blob(static_cast<std::size_t>(offset), 0u);
+  std::memcpy(blob.data(), &header, sizeof(header));
+  for (std::size_t i = 0; i < kWorldSectionCount; ++i) {
+    if (parts[i].bytes > 0) {
+      std::memcpy(blob.data() + header.sections[i].offset, parts[i].data, parts[i].bytes);
+    }
+  }
+  return blob;
 }
 
-static GLuint BuildCheckerTexture() {
-  const int size = 64;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const int idx = (y * size + x) * 3;
-      const bool odd = ((x / 8) + (y / 8)) % 2 == 1;
-      const unsigned char color = odd ? 220 : 40;
-      pixels[idx + 0] = color;
-      pixels[idx + 1] = color;
-      pixels[idx + 2] = color;
+// A compiled world viewed in place, either through the file mapping or, when the binary could
+// not be written, through the freshly compiled blob. Views stay valid until the next Load, and
+// across a move, which hands over the mapping and the blob without relocating either.
+struct WorldFile {
+  MappedFile file;
+  std::vector<unsigned char> compiled;
+  WorldLayout layout;
+  WorldView<Platform> platforms;
+  WorldView<glm::vec3> cats;
+  WorldView<WorldDogSpawn> dogs;
+  WorldView<WorldItemSpawn> items;
+  WorldView<WorldCloud> clouds;
+  WorldView<CloudPuff> cloudPuffs;
+  WorldView<std::uint32_t> gridCells;
+  WorldView<std::uint32_t> gridIndices;
+  WorldView<float> staticMesh;
+  WorldView<WorldChunk> chunks;
+
+  // checkKey is false for binary-only installs that ship no source to hash.
+  bool Attach(const unsigned char* data, std::size_t size, std::uint64_t key, bool checkKey) {
+    WorldFileHeader header;
+    if (size < sizeof(header)) {
+      return false;
     }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kWorldFileMagic || header.sectionCount != kWorldSectionCount || (checkKey && header.key != key)) {
+      return false;
+    }
+    for (const WorldSectionEntry& section : header.sections) {
+      if (section.offset % 16u != 0u || section.offset > size || section.bytes > size - section.offset) {
+        return false;
+      }
+    }
+    auto Bind = [&](auto& view, WorldSection section) {
+      using T = typename std::remove_reference<decltype(*view.data)>::type;
+      const WorldSectionEntry& entry = header.sections[section];
+      if (entry.bytes % sizeof(T) != 0u) {
+        return false;
+      }
+      view.data = reinterpret_cast<const T*>(data + entry.offset);
+      view.count = static_cast<std::size_t>(entry.bytes / sizeof(T));
+      return true;
+    };
+    if (header.sections[kWorldSectionLayout].bytes != sizeof(layout) || !Bind(platforms, kWorldSectionPlatforms) ||
+        !Bind(cats, kWorldSectionCats) || !Bind(dogs, kWorldSectionDogs) || !Bind(items, kWorldSectionItems) ||
+        !Bind(clouds, kWorldSectionClouds) || !Bind(cloudPuffs, kWorldSectionCloudPuffs) ||
+        !Bind(gridCells, kWorldSectionGridCells) || !Bind(gridIndices, kWorldSectionGridIndices) ||
+        !Bind(staticMesh, kWorldSectionStaticMesh) || !Bind(chunks, kWorldSectionChunks)) {
+      return false;
+    }
+    std::memcpy(&layout, data + header.sections[kWorldSectionLayout].offset, sizeof(layout));
+
+    // Everything the game indexes with must be in range, so a damaged file is rejected here.
+    // Backdrop vertices are left to the chunk streamer, which checks them as it reads them, so
+    // opening a large world does not page in its whole mesh.
+    const std::size_t cellCount = static_cast<std::size_t>(std::max(0, layout.gridWidth)) *
+                                  static_cast<std::size_t>(std::max(0, layout.gridDepth));
+    bool wellFormed = platforms.count > 0 && layout.gridWidth > 0 && layout.gridDepth > 0 &&
+                      gridCells.count == cellCount + 1 && gridCells[0] == 0u &&
+                      gridCells[cellCount] == gridIndices.count &&
+                      staticMesh.count % StaticScene::kFloatsPerVertex == 0u && layout.chunkWidth > 0 &&
+                      layout.chunkDepth > 0 &&
+                      chunks.count == static_cast<std::size_t>(layout.chunkWidth) * static_cast<std::size_t>(layout.chunkDepth);
+    const std::size_t meshVertices = staticMesh.count / StaticScene::kFloatsPerVertex;
+    for (std::size_t i = 0; wellFormed && i < chunks.count; ++i) {
+      wellFormed = chunks[i].firstVertex <= meshVertices && chunks[i].vertexCount <= meshVertices - chunks[i].firstVertex;
+    }
+    for (std::size_t cell = 0; wellFormed && cell < cellCount; ++cell) {
+      wellFormed = gridCells[cell] <= gridCells[cell + 1];
+    }
+    for (std::size_t i = 0; wellFormed && i < gridIndices.count; ++i) {
+      wellFormed = gridIndices[i] < platforms.count;
+    }
+    for (std::size_t i = 0; wellFormed && i < clouds.count; ++i) {
+      wellFormed = clouds[i].firstPuff <= cloudPuffs.count && clouds[i].puffCount <= cloudPuffs.count - clouds[i].firstPuff;
+    }
+    for (std::size_t i = 0; wellFormed && i < items.count; ++i) {
+      wellFormed = items[i].type >= static_cast<std::uint32_t>(ItemType::Boomerang) &&
+                   items[i].type <= static_cast<std::uint32_t>(ItemType::Sword);
+    }
+    return wellFormed;
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+  // Maps the binary compiled from sourcePath, recompiling it first when it is missing or was
+  // built from different source. Without the source (a binary-only install) whatever binary is
+  // present is used as is.
+  bool Load(const std::string& sourcePath, const float* cubeVertices, int cubeVertexCount) {
+    file.Close();
+    compiled.clear();
+    std::ifstream sourceFile(sourcePath, std::ios::in | std::ios::binary);
+    if (!sourceFile) {
+      if (file.Open(kWorldBinaryFile) && Attach(file.data, file.size, 0u, false)) {
+        return true;
+      }
+      std::cerr << "Failed to open world " << sourcePath << " and no usable " << kWorldBinaryFile << "\n";
+      return false;
+    }
+    std::ostringstream contents;
+    contents << sourceFile.rdbuf();
+    const std::string source = contents.str();
+    const std::uint64_t key = WorldKey(source);
+    if (file.Open(kWorldBinaryFile) && Attach(file.data, file.size, key, true)) {
+      return true;
+    }
+    file.Close();
 
-static GLuint BuildStripeTexture(unsigned char a, unsigned char b) {
-  const int size = 64;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const int idx = (y * size + x) * 3;
-      const bool odd = ((x / 6) % 2) == 1;
-      const unsigned char color = odd ? a : b;
-      pixels[idx + 0] = color;
-      pixels[idx + 1] = color;
-      pixels[idx + 2] = color;
+    const auto compileStart = std::chrono::steady_clock::now();
+    CompiledWorld world;
+    if (!CompileWorld(sourcePath, source, cubeVertices, cubeVertexCount, world)) {
+      return false;
+    }
+    compiled = BuildWorldBlob(world, key);
+    // Same publish-by-rename as the asset cache, so a crash never leaves a truncated binary.
+    const std::string tempPath = std::string(kWorldBinaryFile) + ".tmp";
+    bool written = false;
+    {
+      std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(compiled.data()), static_cast<std::streamsize>(compiled.size()));
+      written = static_cast<bool>(out);
     }
+    std::remove(kWorldBinaryFile);  // rename() does not replace an existing file on Windows.
+    written = written && std::rename(tempPath.c_str(), kWorldBinaryFile) == 0;
+    if (!written) {
+      std::remove(tempPath.c_str());
+      std::cerr << "Failed to write " << kWorldBinaryFile << "; using the compiled world from memory.\n";
+    }
+    std::cout << "Compiled " << sourcePath << " (" << world.platforms.size() << " platforms, "
+              << world.layout.staticCubeCount << " backdrop cubes) in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - compileStart).count()
+              << " ms\n";
+    if (written && file.Open(kWorldBinaryFile) && Attach(file.data, file.size, key, true)) {
+      compiled.clear();
+      compiled.shrink_to_fit();
+      return true;
+    }
+    file.Close();
+    if (!Attach(compiled.data(), compiled.size(), key, true)) {
+      std::cerr << "Compiled world from " << sourcePath << " failed its own layout checks\n";
+      return false;
+    }
+    return true;
   }
+};
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
+static NetPositionRange NetPositionRangeForWorld(const WorldFile& world) {
+  glm::vec3 lo(std::numeric_limits<float>::max());
+  glm::vec3 hi(-std::numeric_limits<float>::max());
+  for (const Platform& platform : world.platforms) {
+    for (int axis = 0; axis < 3; ++axis) {
+      lo[axis] = std::min(lo[axis], platform.position[axis] - platform.halfExtents[axis]);
+      hi[axis] = std::max(hi[axis], platform.position[axis] + platform.halfExtents[axis]);
+    }
+  }
+  return NetPositionRange::ForBounds(lo, hi);
 }
 
-static GLuint BuildDotsTexture(unsigned char base, unsigned char dot) {
-  const int size = 64;
-  std::vector<unsigned char> pixels(size * size * 3, base);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const int cellX = x % 16;
-      const int cellY = y % 16;
-      const int dx = cellX - 8;
-      const int dy = cellY - 8;
-      if (dx * dx + dy * dy <= 16) {
-        const int idx = (y * size + x) * 3;
-        pixels[idx + 0] = dot;
-        pixels[idx + 1] = dot;
-        pixels[idx + 2] = dot;
+// Chunks within kChunkWakeDistance of a player are awake and their animals run AI and physics;
+// the rest sleep, frozen where they stand. Backdrop meshes of chunks within
+// kChunkStreamDistance are read from the mapped world file on a loader thread and uploaded as
+// they arrive, and evicted again once they fall a chunk further behind. Per-step and per-frame
+// work only visits the chunks around the players, however large the world is.
+static constexpr float kChunkWakeDistance = 64.0f;
+static constexpr float kChunkStreamDistance = 112.0f;  // Far plane plus the camera boom.
+
+struct ChunkStreamer {
+  static constexpr int kLoadSlots = 8;
+  enum SlotState : int { kSlotFree, kSlotRequested, kSlotReady };
+  enum class Residency : std::uint8_t { Unloaded, Loading, Resident };
+
+  // Handed between the game and loader threads through state alone.
+  struct LoadSlot {
+    std::atomic<int> state{kSlotFree};
+    std::uint32_t chunk = 0u;
+    std::vector<float> vertices;  // Layer-resolved copy; capacity is kept between loads.
+  };
+
+  glm::vec2 origin{0.0f};
+  int width = 0;
+  int depth = 0;
+  const WorldChunk* table = nullptr;
+  const float* mesh = nullptr;
+  bool dropPages = false;  // Mesh is a file mapping whose pages can be handed back once copied.
+  TextureLayer layers[kTextureAssetCount] = {};
+  std::vector<std::uint8_t> awake;
+  std::vector<std::uint32_t> awakeChunks;
+  std::vector<Residency> residency;
+  std::vector<std::uint32_t> streamed;  // Loading or resident chunks, checked for eviction.
+  LoadSlot slots[kLoadSlots];
+  std::thread loader;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool quit = false;
+
+  ChunkStreamer() = default;
+  ChunkStreamer(const ChunkStreamer&) = delete;
+  ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+  ~ChunkStreamer() { Shutdown(); }
+
+  void Start() {
+    loader = std::thread([this]() { LoaderLoop(); });
+  }
+
+  void Shutdown() {
+    if (!loader.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    wake.notify_one();
+    loader.join();
+  }
+
+  void Attach(const WorldFile& world, const TextureLayer* assetLayers) {
+    origin = world.layout.chunkOrigin;
+    width = world.layout.chunkWidth;
+    depth = world.layout.chunkDepth;
+    table = world.chunks.data;
+    mesh = world.staticMesh.data;
+    dropPages = world.compiled.empty();
+    std::copy(assetLayers, assetLayers + kTextureAssetCount, layers);
+    awake.assign(world.chunks.size(), 0u);
+    awakeChunks.clear();
+    awakeChunks.reserve(world.chunks.size());
+    residency.assign(world.chunks.size(), Residency::Unloaded);
+    streamed.clear();
+    streamed.reserve(world.chunks.size());
+  }
+
+  // Lets go of the world's mapping (waiting out loads in flight) and frees every chunk mesh. Until
+  // the next Attach everything counts as awake.
+  void Detach(StaticScene& scene) {
+    for (LoadSlot& slot : slots) {
+      while (slot.state.load(std::memory_order_acquire) == kSlotRequested) {
+        std::this_thread::yield();
       }
+      slot.state.store(kSlotFree, std::memory_order_relaxed);
     }
+    scene.Clear();
+    width = 0;
+    depth = 0;
+    table = nullptr;
+    mesh = nullptr;
+    awakeChunks.clear();
+    streamed.clear();
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+  int ChunkX(float x) const {
+    return glm::clamp(static_cast<int>(std::floor((x - origin.x) / kWorldChunkSize)), 0, width - 1);
+  }
+  int ChunkZ(float z) const {
+    return glm::clamp(static_cast<int>(std::floor((z - origin.y) / kWorldChunkSize)), 0, depth - 1);
+  }
 
-static GLuint BuildCatTexture() {
-  const int size = 128;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const float fx = static_cast<float>(x) / static_cast<float>(size - 1);
-      const float fy = static_cast<float>(y) / static_cast<float>(size - 1);
-      const float stripe = 0.04f * std::sin(fx * 10.0f + fy * 6.0f) +
-                           0.03f * std::sin(fx * 22.0f - fy * 4.0f);
-      const int cellX = (x + 8) % 32;
-      const int cellY = (y + 12) % 32;
-      const int dx = cellX - 16;
-      const int dy = cellY - 16;
-      const float spot = (dx * dx + dy * dy <= 40) ? -0.12f : 0.0f;
-      float base = 0.86f + stripe + spot + 0.04f * (0.5f - fy);
-      base = glm::clamp(base, 0.65f, 1.0f);
-      const int idx = (y * size + x) * 3;
-      pixels[idx + 0] = static_cast<unsigned char>(base * 240.0f + 10.0f);
-      pixels[idx + 1] = static_cast<unsigned char>(base * 220.0f + 8.0f);
-      pixels[idx + 2] = static_cast<unsigned char>(base * 210.0f + 6.0f);
+  // XZ distance from position to the chunk's square. Border chunks reach out to infinity, matching
+  // the clamp in ChunkX/ChunkZ, so anything that strays off the map still has a home chunk.
+  float DistanceTo(std::uint32_t chunk, const glm::vec3& position) const {
+    const int x = static_cast<int>(chunk % static_cast<std::uint32_t>(width));
+    const int z = static_cast<int>(chunk / static_cast<std::uint32_t>(width));
+    const float far = std::numeric_limits<float>::max();
+    const glm::vec2 cornerMin(x == 0 ? -far : origin.x + x * kWorldChunkSize, z == 0 ? -far : origin.y + z * kWorldChunkSize);
+    const glm::vec2 cornerMax(x == width - 1 ? far : origin.x + (x + 1) * kWorldChunkSize,
+                              z == depth - 1 ? far : origin.y + (z + 1) * kWorldChunkSize);
+    const glm::vec2 point(position.x, position.z);
+    return glm::length(point - glm::clamp(point, cornerMin, cornerMax));
+  }
+
+  // Visits every chunk within range of position.
+  template <typename Fn>
+  void ForEachWithin(const glm::vec3& position, float range, Fn&& fn) const {
+    const int x0 = ChunkX(position.x - range);
+    const int x1 = ChunkX(position.x + range);
+    const int z0 = ChunkZ(position.z - range);
+    const int z1 = ChunkZ(position.z + range);
+    for (int z = z0; z <= z1; ++z) {
+      for (int x = x0; x <= x1; ++x) {
+        const std::uint32_t chunk = static_cast<std::uint32_t>(z * width + x);
+        if (DistanceTo(chunk, position) <= range) {
+          fn(chunk);
+        }
+      }
     }
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+  bool Awake(const glm::vec3& position) const {
+    return width == 0 || awake[static_cast<std::size_t>(ChunkZ(position.z) * width + ChunkX(position.x))] != 0u;
+  }
 
-static GLuint BuildPlankTexture() {
-  const int size = 128;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const float fx = static_cast<float>(x) / static_cast<float>(size);
-      const float fy = static_cast<float>(y) / static_cast<float>(size);
-      const int plank = (x / 16) % 2;
-      const float grain = 0.12f * std::sin(fy * 40.0f + fx * 6.0f);
-      const float edge = (x % 16 == 0 || x % 16 == 15) ? -0.25f : 0.0f;
-      float base = 0.55f + grain + edge + (plank ? 0.05f : -0.03f);
-      base = glm::clamp(base, 0.2f, 0.9f);
-      const unsigned char r = static_cast<unsigned char>(base * 140.0f + 60.0f);
-      const unsigned char g = static_cast<unsigned char>(base * 110.0f + 50.0f);
-      const unsigned char b = static_cast<unsigned char>(base * 80.0f + 40.0f);
-      const int idx = (y * size + x) * 3;
-      pixels[idx + 0] = r;
-      pixels[idx + 1] = g;
-      pixels[idx + 2] = b;
+  // Once per sim step, so the awake set is a function of sim state and replays stay exact.
+  void UpdateAwake(const glm::vec3* centers, int centerCount) {
+    if (width == 0) {
+      return;
+    }
+    for (const std::uint32_t chunk : awakeChunks) {
+      awake[chunk] = 0u;
+    }
+    awakeChunks.clear();
+    for (int i = 0; i < centerCount; ++i) {
+      ForEachWithin(centers[i], kChunkWakeDistance, [&](std::uint32_t chunk) {
+        if (awake[chunk] == 0u) {
+          awake[chunk] = 1u;
+          awakeChunks.push_back(chunk);
+        }
+      });
     }
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
-
-static GLuint BuildFabricTexture(unsigned char base, unsigned char stripe) {
-  const int size = 128;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const int idx = (y * size + x) * 3;
-      const bool band = ((x / 10) % 2) == 0;
-      const int weave = ((x % 4) == 0 || (y % 4) == 0) ? -8 : 0;
-      const unsigned char c = static_cast<unsigned char>(glm::clamp<int>(base + (band ? stripe : 0) + weave, 20, 230));
-      pixels[idx + 0] = c;
-      pixels[idx + 1] = static_cast<unsigned char>(glm::clamp<int>(c - 10, 0, 255));
-      pixels[idx + 2] = static_cast<unsigned char>(glm::clamp<int>(c - 20, 0, 255));
+  // Once per rendered frame: uploads finished loads, evicts chunks left behind and queues loads
+  // for chunks coming into range.
+  void Stream(const glm::vec3* centers, int centerCount, StaticScene& scene) {
+    if (width == 0) {
+      return;
+    }
+    for (LoadSlot& slot : slots) {
+      if (slot.state.load(std::memory_order_acquire) != kSlotReady) {
+        continue;
+      }
+      const WorldChunk& chunk = table[slot.chunk];
+      scene.Upload(slot.chunk, slot.vertices.data(), chunk.vertexCount, static_cast<int>(chunk.cubeCount),
+                   chunk.boundsMin, chunk.boundsMax);
+      residency[slot.chunk] = Residency::Resident;
+      slot.state.store(kSlotFree, std::memory_order_release);
     }
-  }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+    // Chunks still loading are left until their upload lands.
+    for (std::size_t i = 0; i < streamed.size();) {
+      const std::uint32_t chunk = streamed[i];
+      float nearest = std::numeric_limits<float>::max();
+      for (int c = 0; c < centerCount; ++c) {
+        nearest = std::min(nearest, DistanceTo(chunk, centers[c]));
+      }
+      if (residency[chunk] == Residency::Resident && nearest > kChunkStreamDistance + kWorldChunkSize) {
+        scene.Evict(chunk);
+        residency[chunk] = Residency::Unloaded;
+        streamed[i] = streamed.back();
+        streamed.pop_back();
+      } else {
+        ++i;
+      }
+    }
 
-static GLuint BuildSkinTexture() {
-  const int size = 64;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const float fx = static_cast<float>(x) / static_cast<float>(size);
-      const float fy = static_cast<float>(y) / static_cast<float>(size);
-      const float vignette = 0.85f + 0.2f * (1.0f - std::abs(fx - 0.5f) * 2.0f);
-      const float freckles = ((x + y * 7) % 17 == 0) ? -0.08f : 0.0f;
-      float base = 0.86f * vignette + freckles;
-      base = glm::clamp(base, 0.6f, 0.95f);
-      const int idx = (y * size + x) * 3;
-      pixels[idx + 0] = static_cast<unsigned char>(base * 230.0f + 10.0f);
-      pixels[idx + 1] = static_cast<unsigned char>(base * 190.0f + 15.0f);
-      pixels[idx + 2] = static_cast<unsigned char>(base * 160.0f + 20.0f);
+    bool requested = false;
+    int nextSlot = 0;
+    for (int i = 0; i < centerCount; ++i) {
+      ForEachWithin(centers[i], kChunkStreamDistance, [&](std::uint32_t chunk) {
+        if (residency[chunk] != Residency::Unloaded) {
+          return;
+        }
+        if (table[chunk].vertexCount == 0u) {
+          residency[chunk] = Residency::Resident;  // Nothing to load.
+          streamed.push_back(chunk);
+          return;
+        }
+        while (nextSlot < kLoadSlots && slots[nextSlot].state.load(std::memory_order_acquire) != kSlotFree) {
+          ++nextSlot;
+        }
+        if (nextSlot == kLoadSlots) {
+          return;  // Every slot busy; picked up again next frame.
+        }
+        slots[nextSlot].chunk = chunk;
+        slots[nextSlot].state.store(kSlotRequested, std::memory_order_release);
+        residency[chunk] = Residency::Loading;
+        streamed.push_back(chunk);
+        requested = true;
+      });
+    }
+    if (requested) {
+      { std::lock_guard<std::mutex> lock(mutex); }
+      wake.notify_one();
     }
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+  int LoadsInFlight() const {
+    int count = 0;
+    for (const LoadSlot& slot : slots) {
+      count += slot.state.load(std::memory_order_relaxed) != kSlotFree ? 1 : 0;
+    }
+    return count;
+  }
 
-static GLuint BuildMetalTexture() {
-  const int size = 64;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const float fx = static_cast<float>(x) / static_cast<float>(size);
-      const float streak = 0.1f * std::sin(fx * 24.0f) + 0.05f * std::sin(fx * 60.0f);
-      float base = 0.75f + streak;
-      base = glm::clamp(base, 0.55f, 0.9f);
-      const int idx = (y * size + x) * 3;
-      pixels[idx + 0] = static_cast<unsigned char>(base * 220.0f);
-      pixels[idx + 1] = static_cast<unsigned char>(base * 220.0f);
-      pixels[idx + 2] = static_cast<unsigned char>(base * 235.0f);
+  void LoaderLoop() {
+    auto Pending = [&]() {
+      for (const LoadSlot& slot : slots) {
+        if (slot.state.load(std::memory_order_acquire) == kSlotRequested) {
+          return true;
+        }
+      }
+      return false;
+    };
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [&]() { return quit || Pending(); });
+      if (quit) {
+        return;
+      }
+      lock.unlock();
+      for (LoadSlot& slot : slots) {
+        if (slot.state.load(std::memory_order_acquire) == kSlotRequested) {
+          Load(slot);
+          slot.state.store(kSlotReady, std::memory_order_release);
+        }
+      }
+      lock.lock();
     }
   }
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
-}
+  // Runs on the loader thread: faults the chunk's vertices in from the world file, resolves
+  // their texture layers (out-of-range ids from a damaged file fall back to layer 0) and hands
+  // the mapped pages back, since the GPU copy is what gets drawn.
+  void Load(LoadSlot& slot) {
+    const WorldChunk& chunk = table[slot.chunk];
+    const float* begin = mesh + static_cast<std::size_t>(chunk.firstVertex) * StaticScene::kFloatsPerVertex;
+    const float* end = begin + static_cast<std::size_t>(chunk.vertexCount) * StaticScene::kFloatsPerVertex;
+    slot.vertices.assign(begin, end);
+    for (std::size_t v = 11; v < slot.vertices.size(); v += StaticScene::kFloatsPerVertex) {
+      const float asset = slot.vertices[v];
+      slot.vertices[v] = static_cast<float>(
+          asset >= 0.0f && asset < static_cast<float>(kTextureAssetCount) ? layers[static_cast<std::size_t>(asset)] : 0u);
+    }
+#ifndef _WIN32
+    if (dropPages) {
+      const std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+      const std::uintptr_t first = (reinterpret_cast<std::uintptr_t>(begin) + page - 1u) & ~(page - 1u);
+      const std::uintptr_t last = reinterpret_cast<std::uintptr_t>(end) & ~(page - 1u);
+      if (last > first) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+      }
+    }
+#endif
+  }
+};
 
-static GLuint BuildCloudTexture() {
-  const int size = 128;
-  std::vector<unsigned char> pixels(size * size * 3);
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const float fx = static_cast<float>(x) / static_cast<float>(size - 1);
-      const float fy = static_cast<float>(y) / static_cast<float>(size - 1);
-      const float dx = (fx - 0.5f) * 2.0f;
-      const float dy = (fy - 0.5f) * 2.0f;
-      const float puff = std::exp(-(dx * dx * 1.6f + dy * dy * 3.0f));
-      const float wisps = 0.08f * std::sin(fx * 20.0f) + 0.06f * std::sin((fx + fy) * 16.0f);
-      float shade = 0.72f + puff * 0.24f + wisps;
-      shade = glm::clamp(shade, 0.62f, 1.0f);
-      const int idx = (y * size + x) * 3;
-      pixels[idx + 0] = static_cast<unsigned char>(shade * 245.0f);
-      pixels[idx + 1] = static_cast<unsigned char>(shade * 242.0f);
-      pixels[idx + 2] = static_cast<unsigned char>(shade * 236.0f);
+static std::string ParseWorldPath(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string(argv[i]) == "--world") {
+      return argv[i + 1];
     }
   }
+  return std::string(VIBE_LEVEL_DIR) + "/world.level";
+}
 
-  GLuint tex = 0;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return tex;
+// Prints step-time percentiles and a hash of the final sim state; equal hashes across runs
+// with the same arguments confirm the run was deterministic.
+static void ReportHeadlessRun(const HeadlessConfig& config, std::vector<double>& stepNs, std::size_t cats,
+                              std::size_t dogs, std::uint64_t stateHash, int restarts, std::size_t slowestFrame) {
+  if (stepNs.empty()) {
+    return;
+  }
+  double totalNs = 0.0;
+  for (double ns : stepNs) {
+    totalNs += ns;
+  }
+  std::sort(stepNs.begin(), stepNs.end());
+  auto At = [&](double fraction) {
+    return stepNs[std::min(stepNs.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(stepNs.size())))];
+  };
+  char line[320];
+  std::snprintf(line, sizeof(line),
+                "level %d, %zu cats, %zu dogs, %d bombs, seed %u: %zu steps, ns/step mean %.0f p50 %.0f p95 %.0f "
+                "p99 %.0f max %.0f (frame %zu), %d restarts, state %016llx",
+                config.level, cats, dogs, config.bombs, config.seed, stepNs.size(),
+                totalNs / static_cast<double>(stepNs.size()), At(0.5), At(0.95), At(0.99), stepNs.back(), slowestFrame,
+                restarts, static_cast<unsigned long long>(stateHash));
+  std::cout << line << "\n";
 }
 
-int main(int argc, char** argv) {
+static int RunGame(int argc, char** argv) {
   MultiplayerConfig multiplayerConfig = ParseMultiplayerConfig(argc, argv);
+  HeadlessConfig headlessConfig = ParseHeadlessConfig(argc, argv);
+  const ReplayConfig replayConfig = ParseReplayConfig(argc, argv);
+  const bool headless = headlessConfig.enabled;
+  // A replay restores the seeds, difficulty and scenario it was recorded with; windowed
+  // sessions always start on level 1 as authored.
+  InputReplayHeader replayHeader;
+  std::vector<ReplayFrame> replayFrames;
+  const bool replaying = !replayConfig.replayPath.empty();
+  if (replaying) {
+    if (!LoadInputReplay(replayConfig.replayPath, replayHeader, replayFrames)) {
+      return 1;
+    }
+    headlessConfig.level = static_cast<int>(replayHeader.level);
+    headlessConfig.cats = static_cast<int>(replayHeader.cats);
+    headlessConfig.dogs = static_cast<int>(replayHeader.dogs);
+    headlessConfig.bombs = static_cast<int>(replayHeader.bombs);
+    headlessConfig.seed = replayHeader.scenarioSeed;
+  } else if (!headless) {
+    headlessConfig = HeadlessConfig{};
+  }
+  // Headless runs and replays are single-player; headless runs also ignore the saved
+  // profile so results do not depend on local settings.
+  if (headless || replaying) {
+    multiplayerConfig.enabled = false;
+  }
   SettingsProfile settings;
-  LoadSettings(settings);
-  MultiplayerState multiplayer;
-  if (!InitMultiplayer(multiplayerConfig, multiplayer)) {
-    std::cerr << "Multiplayer init failed. Running in single-player mode.\n";
-    ShutdownMultiplayer(multiplayer);
-  } else if (multiplayer.active) {
-    std::cout << "Multiplayer enabled. Local UDP port " << multiplayerConfig.localPort
-              << ", peer " << multiplayerConfig.peerIp << ":" << multiplayerConfig.peerPort << "\n";
+  SettingsWriter settingsWriter;
+  if (!headless && LoadSettings(settings) == SettingsSource::Migrated) {
+    std::cout << "Migrated " << kLegacySettingsFile << " to " << kSettingsFile << "\n";
+    settingsWriter.Save(settings);
   }
-
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW\n";
-    ShutdownMultiplayer(multiplayer);
-    return 1;
+  if (replaying) {
+    settings.difficulty = static_cast<int>(replayHeader.difficulty);
   }
-
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
-  const GLFWvidmode* fullscreenMode = primaryMonitor ? glfwGetVideoMode(primaryMonitor) : nullptr;
-  const int windowWidth = fullscreenMode ? fullscreenMode->width : 1280;
-  const int windowHeight = fullscreenMode ? fullscreenMode->height : 720;
-  GLFWwindow* window = glfwCreateWindow(windowWidth,
-                                        windowHeight,
-                                        "Vibe 3D",
-                                        primaryMonitor,
-                                        nullptr);
-  if (!window) {
-    std::cerr << "Failed to create window\n";
-    glfwTerminate();
-    ShutdownMultiplayer(multiplayer);
-    return 1;
+  // Texture and sound synthesis runs on workers while the window and GL come up.
+  ProceduralAssets assets;
+  if (!headless) {
+    assets.Start(kAudioSampleRate);
   }
+  MultiplayerState multiplayer;
 
-  glfwMakeContextCurrent(window);
-  glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-  glfwSwapInterval(1);
+  GLFWwindow* window = nullptr;
+  if (!headless) {
+    if (!glfwInit()) {
+      std::cerr << "Failed to initialize GLFW\n";
+      ShutdownMultiplayer(multiplayer);
+      return 1;
+    }
 
-  if (!gladLoadGL(reinterpret_cast<GLADloadfunc>(glfwGetProcAddress))) {
-    std::cerr << "Failed to load OpenGL\n";
-    glfwTerminate();
-    ShutdownMultiplayer(multiplayer);
-    return 1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* fullscreenMode = primaryMonitor ? glfwGetVideoMode(primaryMonitor) : nullptr;
+    const int windowWidth = fullscreenMode ? fullscreenMode->width : 1280;
+    const int windowHeight = fullscreenMode ? fullscreenMode->height : 720;
+    window = glfwCreateWindow(windowWidth, windowHeight, "Vibe 3D", primaryMonitor, nullptr);
+    if (!window) {
+      std::cerr << "Failed to create window\n";
+      glfwTerminate();
+      ShutdownMultiplayer(multiplayer);
+      return 1;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+    glfwSwapInterval(settings.vsync ? 1 : 0);
+
+    if (!gladLoadGL(reinterpret_cast<GLADloadfunc>(glfwGetProcAddress))) {
+      std::cerr << "Failed to load OpenGL\n";
+      glfwTerminate();
+      ShutdownMultiplayer(multiplayer);
+      return 1;
+    }
   }
 
   IMGUI_CHECKVERSION();
@@ -1519,14 +6821,16 @@ int main(int argc, char** argv) {
     ImGui::GetIO().FontGlobalScale = scale;
   };
   ApplyUiScale(uiScale);
-  ImGui_ImplGlfw_InitForOpenGL(window, true);
-  ImGui_ImplOpenGL3_Init("#version 330");
-
-  glEnable(GL_DEPTH_TEST);
+  if (!headless) {
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330");
+    glEnable(GL_DEPTH_TEST);
+  }
 
   Shader shader;
   const std::string shaderDir = std::string(VIBE_SHADER_DIR);
-  if (!shader.Load(shaderDir + "/standard.vert", shaderDir + "/standard.frag")) {
+  const glm::vec3 lightDir = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.2f));
+  if (!headless && !shader.Load(shaderDir + "/standard.vert", shaderDir + "/standard.frag")) {
     glfwTerminate();
     ShutdownMultiplayer(multiplayer);
     return 1;
@@ -1579,54 +6883,134 @@ int main(int argc, char** argv) {
 
   GLuint vao = 0;
   GLuint vbo = 0;
-  glGenVertexArrays(1, &vao);
-  glGenBuffers(1, &vbo);
-  glBindVertexArray(vao);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(0));
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(6 * sizeof(float)));
-  glBindVertexArray(0);
-
-  const GLuint platformTexture = BuildPlankTexture();
-  const GLuint playerTexture = BuildFabricTexture(90, 70);
-  const GLuint playerSkinTexture = BuildSkinTexture();
-  const GLuint clownTexture = BuildFabricTexture(160, 40);
-  const GLuint clownSkinTexture = BuildSkinTexture();
-  const GLuint clownAccentTexture = BuildDotsTexture(220, 60);
-  const GLuint knifeTexture = BuildMetalTexture();
-  const GLuint catTexture = BuildCatTexture();
-  const GLuint carTexture = BuildMetalTexture();
-  const GLuint cloudTexture = BuildCloudTexture();
+  RenderQueue renderQueue;
+  std::vector<InstanceBatch> modelBatches(JobSystem::kMaxTasks);
+  ParticleSystem particles;
+  ShadowMaps shadowMaps;
+  FrameProfiler profiler;
+  int traceFrames = 120;
+  if (!headless) {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(6 * sizeof(float)));
+    glBindVertexArray(0);
+
+    renderQueue.Init(vao);
+
+    if (!particles.Init(shaderDir, vbo)) {
+      glfwTerminate();
+      ShutdownMultiplayer(multiplayer);
+      return 1;
+    }
+    particles.shader.Use();
+    particles.shader.SetInt("uTexture", 0);
+
+    if (!shadowMaps.Init(shaderDir, vbo, lightDir)) {
+      glfwTerminate();
+      ShutdownMultiplayer(multiplayer);
+      return 1;
+    }
+    shadowMaps.BindReceiver(shader);
+
+    profiler.Init();
+
+    assets.Finish();
+  }
+  // Headless runs never sample textures, so every material maps to layer 0.
+  TextureArray textures;
+  TextureLayer assetLayers[kTextureAssetCount] = {};
+  auto AddTexture = [&](TextureAsset asset) -> TextureLayer {
+    const TextureLayer layer = headless ? 0u : textures.Add(assets.TextureSize(asset), assets.TexturePixels(asset));
+    assetLayers[static_cast<std::size_t>(asset)] = layer;
+    return layer;
+  };
+  const TextureLayer platformTexture = AddTexture(TextureAsset::Plank);
+  const TextureLayer playerTexture = AddTexture(TextureAsset::PlayerFabric);
+  const TextureLayer playerSkinTexture = AddTexture(TextureAsset::Skin);
+  const TextureLayer clownTexture = AddTexture(TextureAsset::ClownFabric);
+  const TextureLayer clownSkinTexture = AddTexture(TextureAsset::Skin);
+  const TextureLayer clownAccentTexture = AddTexture(TextureAsset::ClownDots);
+  const TextureLayer knifeTexture = AddTexture(TextureAsset::Metal);
+  const TextureLayer catTexture = AddTexture(TextureAsset::Cat);
+  const TextureLayer carTexture = AddTexture(TextureAsset::Metal);
+  const TextureLayer cloudTexture = AddTexture(TextureAsset::Cloud);
+  if (!headless) {
+    textures.Upload();
+  }
+
+  const std::string worldPath = ParseWorldPath(argc, argv);
+  WorldFile world;
+  if (!world.Load(worldPath, cubeVertices, 36)) {
+    if (!headless) {
+      glfwTerminate();
+    }
+    ShutdownMultiplayer(multiplayer);
+    return 1;
+  }
+  // Snapshot positions are quantized over the world's bounds, so the session starts once
+  // the world is loaded.
+  multiplayer.positionRange = NetPositionRangeForWorld(world);
+  if (!InitMultiplayer(multiplayerConfig, multiplayer)) {
+    std::cerr << "Multiplayer init failed. Running in single-player mode.\n";
+    ShutdownMultiplayer(multiplayer);
+  } else if (multiplayer.active) {
+    std::cout << "Multiplayer enabled. Local UDP port " << multiplayerConfig.localPort
+              << ", peer " << multiplayerConfig.peerIp << ":" << multiplayerConfig.peerPort << "\n";
+  }
+  StaticScene staticScene;
+  ChunkStreamer chunkStreamer;
+  // AI, physics and model building for the animals run as ParallelFor passes; each pass
+  // keeps its own cost so the split follows what that pass measures.
+  JobSystem jobs;
+  JobSystem::Cost catAiCost;
+  JobSystem::Cost catPhysicsCost;
+  JobSystem::Cost dogAiCost;
+  JobSystem::Cost dogPhysicsCost;
+  JobSystem::Cost catModelCost;
+  JobSystem::Cost dogModelCost;
 
   AudioState audio;
-  if (ma_engine_init(nullptr, &audio.engine) == MA_SUCCESS) {
-    audio.ready = true;
-    const int sampleRate = 48000;
-    CreateSound(audio.engine, audio.footstep, GenerateFootstep(sampleRate), false);
-    CreateSound(audio.engine, audio.jump, GenerateJump(sampleRate), false);
-    CreateSound(audio.engine, audio.land, GenerateLand(sampleRate), false);
-    CreateSound(audio.engine, audio.ambient, GenerateAmbient(sampleRate), true);
-    CreateSound(audio.engine, audio.chase, GenerateChase(sampleRate), false);
-    CreateSound(audio.engine, audio.explosion, GenerateExplosion(sampleRate), false);
-    CreateSound(audio.engine, audio.hurt, GenerateHurt(sampleRate), false);
+  if (!headless && ma_engine_init(nullptr, &audio.engine) == MA_SUCCESS) {
+    audio.ready = ma_sound_group_init(&audio.engine, 0, nullptr, &audio.sfx) == MA_SUCCESS;
+    if (!audio.ready) {
+      ma_engine_uninit(&audio.engine);
+    }
+  }
+  if (audio.ready) {
+    auto CreateAssetPool = [&](SoundPool& pool, SoundAsset asset, int voices, SoundPool::Steal steal, float volume,
+                               float minDistance, float maxDistance) {
+      pool.steal = steal;
+      pool.volume = volume;
+      pool.minDistance = minDistance;
+      pool.maxDistance = maxDistance;
+      CreateSoundPool(audio.engine, audio.sfx, pool, assets.SoundSamples(asset), assets.SoundFrames(asset), voices);
+    };
+    // Voice counts bound the mixer's work: at most 15 effect voices however busy the
+    // level gets. The land and explosion radii start past the camera boom, so the local
+    // player is heard at full volume.
+    CreateAssetPool(audio.footstep, SoundAsset::Footstep, 2, SoundPool::Steal::Oldest, 0.45f, 1.0f, 0.0f);
+    CreateAssetPool(audio.jump, SoundAsset::Jump, 2, SoundPool::Steal::Oldest, 0.5f, 1.0f, 0.0f);
+    CreateAssetPool(audio.land, SoundAsset::Land, 3, SoundPool::Steal::Quietest, 0.5f, 8.0f, 40.0f);
+    CreateAssetPool(audio.explosion, SoundAsset::Explosion, 6, SoundPool::Steal::Quietest, 0.72f, 10.0f, 90.0f);
+    CreateAssetPool(audio.hurt, SoundAsset::Hurt, 2, SoundPool::Steal::Oldest, 0.65f, 1.0f, 0.0f);
+    CreateSound(audio.engine, nullptr, audio.ambient, assets.SoundSamples(SoundAsset::Ambient),
+                assets.SoundFrames(SoundAsset::Ambient), true);
+    CreateSound(audio.engine, &audio.sfx, audio.chase, assets.SoundSamples(SoundAsset::Chase),
+                assets.SoundFrames(SoundAsset::Chase), false);
     ma_sound_set_volume(&audio.ambient.sound, 0.3f);
-    ma_sound_set_volume(&audio.footstep.sound, 0.45f);
-    ma_sound_set_volume(&audio.jump.sound, 0.5f);
-    ma_sound_set_volume(&audio.land.sound, 0.5f);
     ma_sound_set_volume(&audio.chase.sound, 0.6f);
-    ma_sound_set_volume(&audio.explosion.sound, 0.72f);
-    ma_sound_set_volume(&audio.hurt.sound, 0.65f);
     ma_sound_start(&audio.ambient.sound);
   }
 
   Player player;
-  constexpr float kMapScale = 10.0f;
-  const glm::vec3 playerSpawn{0.0f, 2.0f, 0.0f};
   Enemy clown;
   const float gravity = -18.0f;
   const float moveSpeed = 5.0f;
@@ -1640,142 +7024,96 @@ int main(int argc, char** argv) {
   float jumpBufferTimer = 0.0f;
   float stamina = 1.0f;
 
-  std::vector<Platform> platforms = {
-      {{0.0f, -1.0f, 0.0f}, {22.0f, 0.5f, 22.0f}, {0.6f, 0.7f, 0.8f}},
-      {{4.0f, 1.0f, 0.0f}, {1.8f, 0.3f, 1.8f}, {0.9f, 0.7f, 0.4f}},
-      {{-3.0f, 2.2f, -2.5f}, {1.2f, 0.3f, 1.2f}, {0.5f, 0.9f, 0.6f}},
-      {{7.0f, 3.2f, 2.5f}, {1.2f, 0.3f, 1.2f}, {0.6f, 0.8f, 0.9f}},
-      {{-8.0f, 1.4f, 4.0f}, {2.0f, 0.3f, 1.0f}, {0.8f, 0.6f, 0.7f}},
-      {{-11.0f, 3.0f, 6.0f}, {1.4f, 0.3f, 1.4f}, {0.7f, 0.8f, 0.5f}},
-      {{10.0f, 1.8f, -6.0f}, {1.6f, 0.3f, 1.2f}, {0.6f, 0.9f, 0.7f}},
-      {{14.0f, 3.0f, -8.0f}, {1.2f, 0.3f, 1.2f}, {0.9f, 0.8f, 0.5f}},
-      {{-12.0f, 1.0f, -4.0f}, {1.2f, 0.3f, 1.2f}, {0.7f, 0.8f, 0.7f}},
-      {{-14.0f, 1.6f, -6.0f}, {1.2f, 0.3f, 1.2f}, {0.7f, 0.6f, 0.9f}},
-      {{-18.0f, 2.4f, -9.0f}, {1.1f, 0.3f, 1.1f}, {0.9f, 0.6f, 0.6f}},
-      {{5.0f, 3.6f, 8.0f}, {1.2f, 0.3f, 1.2f}, {0.6f, 0.8f, 0.6f}},
-      {{-2.0f, 4.2f, 8.5f}, {1.0f, 0.3f, 1.0f}, {0.8f, 0.7f, 0.6f}},
-      {{-6.0f, 4.6f, 9.0f}, {1.0f, 0.3f, 1.0f}, {0.7f, 0.7f, 0.9f}},
-  };
-
-  std::vector<Cat> cats = {
-      {{2.5f, 0.0f, -2.0f}},
-      {{-4.0f, 0.0f, 3.0f}},
-      {{6.0f, 2.0f, 1.5f}},
-      {{-9.0f, 2.4f, 4.0f}},
-      {{-12.0f, 3.8f, 6.0f}},
-      {{10.0f, 2.2f, -5.5f}},
-      {{14.0f, 3.4f, -8.0f}},
-      {{-14.0f, 2.2f, -6.0f}},
-      {{-18.0f, 2.8f, -9.0f}},
-      {{-6.0f, 5.0f, 9.0f}},
-  };
-  
-  // Initialize cat personalities
-  unsigned int catSeed = 42u;
-  for (Cat& cat : cats) {
-    cat.seed = catSeed;
-    catSeed = catSeed * 1664525u + 1013904223u;
-    cat.moveSpeed = 2.5f + RandomFloat(cat.seed) * 2.0f; // 2.5-4.5 speed
-    cat.turnSpeed = 4.0f + RandomFloat(cat.seed) * 3.0f; // 4-7 turn rate
-    cat.facing = RandomFloat(cat.seed) * 6.28318f;
-    cat.behaviorTimer = RandomFloat(cat.seed) * 3.0f;
-    cat.behavior = Cat::Behavior::Idle;
-    cat.idleAnimTimer = 0.5f + RandomFloat(cat.seed) * 2.0f;
-  }
-  std::vector<Dog> dogs = {
-      {{-14.0f, 0.35f, -16.0f}, false, 0.1f},
-      {{-8.0f, 0.35f, -18.0f}, false, 0.4f},
-      {{-2.0f, 0.35f, -15.0f}, false, 1.0f},
-      {{4.0f, 0.35f, -17.0f}, false, 1.7f},
-      {{11.0f, 0.35f, -14.0f}, false, 2.1f},
-      {{16.0f, 0.35f, -8.0f}, false, 2.6f},
-      {{14.0f, 0.35f, -1.0f}, false, 3.0f},
-      {{9.0f, 0.35f, 4.0f}, false, 3.4f},
-      {{2.0f, 0.35f, 7.0f}, false, 3.9f},
-      {{-5.0f, 0.35f, 9.0f}, false, 4.3f},
-      {{-11.0f, 0.35f, 12.0f}, false, 4.8f},
-      {{-17.0f, 0.35f, 9.0f}, false, 5.2f},
-      {{-19.0f, 0.35f, 2.0f}, false, 5.7f},
-      {{-18.0f, 0.35f, -5.0f}, false, 6.1f},
-      {{-12.0f, 0.35f, -8.0f}, false, 0.7f},
-      {{-6.0f, 0.35f, -6.0f}, false, 1.4f},
-      {{0.0f, 0.35f, -2.0f}, false, 2.9f},
-      {{7.0f, 0.35f, -4.0f}, false, 3.7f},
-      {{12.0f, 0.35f, 10.0f}, false, 4.9f},
-      {{-2.0f, 0.35f, 15.0f}, false, 5.9f},
+  // Level content comes from the world file; ApplyWorld fills everything below.
+  std::vector<Platform> platforms;
+  std::vector<Cat> cats;
+  AnimalBodies catBodies;
+  std::vector<Dog> dogs;
+  AnimalBodies dogBodies;
+  ObjectPool<Bomb> bombs(12);
+  // Sized for hundreds of overlapping blasts, which the particle system draws in one call;
+  // past that a new blast is dropped, as the Debug window's high-water mark would show.
+  ObjectPool<Explosion> explosions(512);
+  std::vector<WorldItem> worldItems;
+  // Platforms never move and both levels share them, so the broad-phase grid comes
+  // precomputed with the world; the entity grid spans the ground slab and is refilled
+  // every sim step.
+  std::vector<CatView> catViews;
+  std::vector<GroomContact> groomContacts;
+  PlatformGrid platformGrid;
+  EntityGrid entityGrid;
+  auto RebuildEntityGrid = [&]() {
+    entityGrid.Begin();
+    for (size_t i = 0; i < cats.size(); ++i) {
+      entityGrid.Add(EntityGrid::Kind::Cat, i, catBodies.Position(i));
+    }
+    for (size_t i = 0; i < dogs.size(); ++i) {
+      entityGrid.Add(EntityGrid::Kind::Dog, i, dogBodies.Position(i));
+    }
+    for (const Bomb& bomb : bombs) {
+      entityGrid.Add(EntityGrid::Kind::Bomb, bombs.SlotOf(bomb), bomb.position);
+    }
+    for (size_t i = 0; i < worldItems.size(); ++i) {
+      if (worldItems[i].active) {
+        entityGrid.Add(EntityGrid::Kind::Item, i, worldItems[i].position);
+      }
+    }
+    entityGrid.End();
   };
-  std::vector<Bomb> bombs(12);
-  std::vector<Explosion> explosions;
-  std::vector<WorldItem> worldItems = {
-      {ItemType::Boomerang, glm::vec3(6.0f, 0.7f, -4.0f), true},
-      {ItemType::SpeedBoots, glm::vec3(-8.0f, 0.7f, 6.0f), true},
-      {ItemType::Shotgun, glm::vec3(12.0f, 0.7f, -10.0f), true},
-      {ItemType::Sword, glm::vec3(-14.0f, 0.7f, -8.0f), true},
-      {ItemType::Boomerang, glm::vec3(-16.0f, 0.7f, 12.0f), true},
-      {ItemType::SpeedBoots, glm::vec3(16.0f, 0.7f, 12.0f), true},
-      {ItemType::Shotgun, glm::vec3(-4.0f, 0.7f, 14.0f), true},
-      {ItemType::Sword, glm::vec3(4.0f, 0.7f, -14.0f), true},
+  // Drops reuse a picked-up slot before growing the list, so item count tracks what is
+  // actually lying around rather than how many drops have happened.
+  auto PlaceWorldItem = [&](const WorldItem& item) {
+    for (std::size_t i = 0; i < worldItems.size(); ++i) {
+      if (!worldItems[i].active) {
+        worldItems[i] = item;
+        return i;
+      }
+    }
+    worldItems.push_back(item);
+    return worldItems.size() - 1;
   };
-  for (Platform& platform : platforms) {
-    platform.position = ScaleXZ(platform.position, kMapScale);
-    platform.halfExtents = ScaleExtentXZ(platform.halfExtents, kMapScale);
-  }
-  for (Cat& cat : cats) {
-    cat.position = ScaleXZ(cat.position, kMapScale);
-  }
-  for (Dog& dog : dogs) {
-    dog.position = ScaleXZ(dog.position, kMapScale);
-  }
-  for (WorldItem& item : worldItems) {
-    item.position = ScaleXZ(item.position, kMapScale);
-  }
-  unsigned int dogSeed = 9001u;
-  for (Dog& dog : dogs) {
-    dog.seed = dogSeed;
-    dogSeed = dogSeed * 1664525u + 1013904223u;
-    dog.moveSpeed = 2.4f + RandomFloat(dog.seed) * 1.6f;
-    dog.turnSpeed = 4.0f + RandomFloat(dog.seed) * 2.5f;
-    dog.behaviorTimer = 0.6f + RandomFloat(dog.seed) * 2.2f;
-    dog.facing = RandomFloat(dog.seed) * 6.28318f;
-    dog.wanderTarget = dog.position;
-  }
   Enemy mummy;
-  mummy.position = ScaleXZ(glm::vec3(-2.0f, 0.45f, -10.0f), kMapScale);
   mummy.speed = 2.2f;
   float mummyFacing = 0.0f;
   float mummyWalkCycle = 0.0f;
   float mummyThrowCooldown = 1.4f;
-  const glm::vec3 levelOneSpawn = playerSpawn;
-  const glm::vec3 levelTwoSpawn = ScaleXZ(glm::vec3(-16.0f, 2.0f, -16.0f), kMapScale);
-  const glm::vec3 carPositionLevel1 = ScaleXZ(glm::vec3(18.0f, 0.0f, 16.0f), kMapScale);
-  const glm::vec3 carPositionLevel2 = ScaleXZ(glm::vec3(-18.0f, 0.0f, 18.0f), kMapScale);
+  glm::vec3 levelOneSpawn(0.0f);
+  glm::vec3 levelTwoSpawn(0.0f);
+  glm::vec3 carPositionLevel1(0.0f);
+  glm::vec3 carPositionLevel2(0.0f);
   enum class GameLevel { Level1Cats, Level2Dogs };
   GameLevel currentLevel = GameLevel::Level1Cats;
   bool levelOneAnnounced = false;
-  const float worldGroundTop = platforms[0].position.y + platforms[0].halfExtents.y;
-  const glm::vec3 clownStartPosition = ScaleXZ(glm::vec3(4.0f, worldGroundTop + clown.halfSize, -4.0f), kMapScale);
-  const glm::vec3 mummyStartPosition = ScaleXZ(glm::vec3(-2.0f, worldGroundTop + mummy.halfSize, -10.0f), kMapScale);
-  clown.position = clownStartPosition;
-  mummy.position = mummyStartPosition;
-  const std::vector<Cat> initialCats = cats;
-  const std::vector<Dog> initialDogs = dogs;
-  const std::vector<WorldItem> initialWorldItems = worldItems;
+  float worldGroundTop = 0.0f;
+  glm::vec3 clownStartPosition(0.0f);
+  glm::vec3 mummyStartPosition(0.0f);
+  if (headless || replaying) {
+    bombs.Reserve(static_cast<std::size_t>(headlessConfig.bombs) + bombs.Capacity());
+    explosions.Reserve(static_cast<std::size_t>(headlessConfig.bombs) + explosions.Capacity());
+  }
+  std::vector<Cat> initialCats;
+  AnimalBodies initialCatBodies;
+  std::vector<Dog> initialDogs;
+  AnimalBodies initialDogBodies;
+  std::vector<WorldItem> initialWorldItems;
   ItemType heldItem = ItemType::None;
   int heldItemCharges = 0;
-  ItemType remoteHeldItem = ItemType::None;
-  int remoteHeldCharges = 0;
+  RemotePlayer remotePlayers[kMaxSessionPlayers];
   float speedBootTimer = 0.0f;
   BoomerangProjectile boomerangProjectile;
-  std::vector<ShotProjectile> shotgunProjectiles(24);
-  std::vector<CollectSprite> collectSprites;
+  ObjectPool<ShotProjectile> shotgunProjectiles(24);
+  ObjectPool<CollectSprite> collectSprites(24);
   float swordDashTimer = 0.0f;
   float swordDashCurveTimer = 0.0f;
+  std::uint32_t swordDashCommand = 0u;
+  std::deque<InputCommand> pendingInputCommands;
+  std::uint32_t nextInputCommandSequence = 0u;
+  PredictedEnemyHit predictedClownHit;
+  PredictedEnemyHit predictedMummyHit;
+  std::vector<PredictedItemDrop> predictedDrops;
   float boomerangUseAnimTimer = 0.0f;
   float shotgunUseAnimTimer = 0.0f;
   float swordUseAnimTimer = 0.0f;
-  float remoteBoomerangUseAnimTimer = 0.0f;
-  float remoteShotgunUseAnimTimer = 0.0f;
-  float remoteSwordUseAnimTimer = 0.0f;
   glm::vec3 swordDashDir(0.0f);
   bool swordDashHit = false;
   bool clownAlive = true;
@@ -1784,37 +7122,106 @@ int main(int argc, char** argv) {
   float mummyRespawnTimer = 0.0f;
   float clownStunTimer = 0.0f;
   float mummyStunTimer = 0.0f;
-  const std::vector<CloudCluster> clouds = {
-      {glm::vec3(-16.0f, 14.0f, -18.0f), glm::normalize(glm::vec2(1.0f, 0.2f)), 0.55f, 0.05f,
-       {{glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(5.2f, 1.1f, 2.6f)},
-        {glm::vec3(3.2f, 0.25f, 0.5f), glm::vec3(3.6f, 0.95f, 2.1f)},
-        {glm::vec3(-3.0f, 0.2f, -0.6f), glm::vec3(3.4f, 0.9f, 1.9f)},
-        {glm::vec3(1.0f, 0.45f, -1.1f), glm::vec3(2.8f, 0.85f, 1.6f)}}},
-      {glm::vec3(4.0f, 16.5f, -24.0f), glm::normalize(glm::vec2(0.9f, -0.3f)), 0.42f, 0.12f,
-       {{glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(6.0f, 1.25f, 2.9f)},
-        {glm::vec3(3.8f, 0.35f, -0.8f), glm::vec3(4.1f, 1.0f, 2.2f)},
-        {glm::vec3(-3.6f, 0.25f, 0.7f), glm::vec3(4.0f, 1.0f, 2.15f)},
-        {glm::vec3(0.6f, 0.55f, 1.3f), glm::vec3(3.2f, 0.95f, 1.75f)}}},
-      {glm::vec3(20.0f, 15.0f, -10.0f), glm::normalize(glm::vec2(0.8f, 0.55f)), 0.38f, 0.18f,
-       {{glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(5.0f, 1.0f, 2.4f)},
-        {glm::vec3(2.7f, 0.28f, 0.9f), glm::vec3(3.3f, 0.82f, 1.8f)},
-        {glm::vec3(-2.9f, 0.22f, -0.7f), glm::vec3(3.1f, 0.8f, 1.7f)},
-        {glm::vec3(0.2f, 0.45f, -1.2f), glm::vec3(2.6f, 0.75f, 1.45f)}}},
-      {glm::vec3(-24.0f, 13.8f, 10.0f), glm::normalize(glm::vec2(1.0f, -0.45f)), 0.5f, 0.09f,
-       {{glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(4.8f, 0.95f, 2.3f)},
-        {glm::vec3(2.9f, 0.2f, 0.7f), glm::vec3(3.2f, 0.8f, 1.7f)},
-        {glm::vec3(-2.5f, 0.18f, -0.6f), glm::vec3(3.0f, 0.78f, 1.65f)},
-        {glm::vec3(0.1f, 0.42f, 1.15f), glm::vec3(2.4f, 0.72f, 1.35f)}}},
-      {glm::vec3(10.0f, 17.2f, 22.0f), glm::normalize(glm::vec2(0.7f, 0.5f)), 0.34f, 0.22f,
-       {{glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(5.6f, 1.18f, 2.7f)},
-        {glm::vec3(3.4f, 0.32f, -0.9f), glm::vec3(3.9f, 0.96f, 2.1f)},
-        {glm::vec3(-3.2f, 0.26f, 0.8f), glm::vec3(3.7f, 0.92f, 2.0f)},
-        {glm::vec3(0.8f, 0.52f, 1.4f), glm::vec3(3.0f, 0.88f, 1.65f)}}},
+  std::vector<CloudCluster> clouds;
+  // Copies the mapped world into the live level state. Personalities reseed from the
+  // replay header, so a reload rolls the same animals as a fresh start.
+  auto ApplyWorld = [&]() {
+    platforms.assign(world.platforms.begin(), world.platforms.end());
+    platformGrid.Assign(world.layout.gridOrigin, world.layout.gridWidth, world.layout.gridDepth, world.gridCells.data,
+                        world.gridCells.size(), world.gridIndices.data, world.gridIndices.size());
+    const Platform& ground = platforms[0];
+    entityGrid.Configure(glm::vec2(ground.position.x - ground.halfExtents.x, ground.position.z - ground.halfExtents.z),
+                         glm::vec2(ground.position.x + ground.halfExtents.x, ground.position.z + ground.halfExtents.z));
+    worldGroundTop = ground.position.y + ground.halfExtents.y;
+    levelOneSpawn = world.layout.levelOneSpawn;
+    levelTwoSpawn = world.layout.levelTwoSpawn;
+    carPositionLevel1 = world.layout.carPositionLevel1;
+    carPositionLevel2 = world.layout.carPositionLevel2;
+    clownStartPosition = glm::vec3(world.layout.clownStart.x, worldGroundTop + clown.halfSize, world.layout.clownStart.y);
+    mummyStartPosition = glm::vec3(world.layout.mummyStart.x, worldGroundTop + mummy.halfSize, world.layout.mummyStart.y);
+    clown.position = clownStartPosition;
+    mummy.position = mummyStartPosition;
+
+    unsigned int catSeed = replayHeader.catSeed;
+    cats.clear();
+    catBodies.Clear();
+    for (const glm::vec3& position : world.cats) {
+      cats.emplace_back();
+      catBodies.Add(position);
+      InitCatPersonality(cats.back(), catSeed);
+    }
+    unsigned int dogSeed = replayHeader.dogSeed;
+    dogs.clear();
+    dogBodies.Clear();
+    for (const WorldDogSpawn& spawn : world.dogs) {
+      Dog dog;
+      dog.bobOffset = spawn.bobOffset;
+      InitDogPersonality(dog, spawn.position, dogSeed);
+      dogs.push_back(dog);
+      dogBodies.Add(spawn.position);
+    }
+    worldItems.clear();
+    for (const WorldItemSpawn& spawn : world.items) {
+      worldItems.push_back({static_cast<ItemType>(spawn.type), spawn.position, true});
+    }
+    clouds.clear();
+    for (const WorldCloud& cloud : world.clouds) {
+      clouds.push_back({cloud.basePosition, cloud.driftDir, cloud.driftSpeed, cloud.hueOffset,
+                        std::vector<CloudPuff>(world.cloudPuffs.begin() + cloud.firstPuff,
+                                               world.cloudPuffs.begin() + cloud.firstPuff + cloud.puffCount)});
+    }
+
+    // Benchmark populations: the authored animals come first, extras are scattered over the
+    // ground slab from the run seed with personalities from the same seed streams.
+    if (headless || replaying) {
+      unsigned int spawnSeed = headlessConfig.seed;
+      auto ScatterOnGround = [&](float height) {
+        return glm::vec3(ground.position.x + (RandomFloat(spawnSeed) * 1.8f - 0.9f) * ground.halfExtents.x, height,
+                         ground.position.z + (RandomFloat(spawnSeed) * 1.8f - 0.9f) * ground.halfExtents.z);
+      };
+      if (headlessConfig.cats > 0) {
+        cats.erase(cats.begin() + std::min(cats.size(), static_cast<std::size_t>(headlessConfig.cats)), cats.end());
+        catBodies.Truncate(cats.size());
+        while (cats.size() < static_cast<std::size_t>(headlessConfig.cats)) {
+          catBodies.Add(ScatterOnGround(0.0f));
+          cats.emplace_back();
+          InitCatPersonality(cats.back(), catSeed);
+        }
+      }
+      if (headlessConfig.dogs > 0) {
+        dogs.erase(dogs.begin() + std::min(dogs.size(), static_cast<std::size_t>(headlessConfig.dogs)), dogs.end());
+        dogBodies.Truncate(dogs.size());
+        while (dogs.size() < static_cast<std::size_t>(headlessConfig.dogs)) {
+          const glm::vec3 position = ScatterOnGround(0.35f);
+          Dog dog;
+          InitDogPersonality(dog, position, dogSeed);
+          dogs.push_back(dog);
+          dogBodies.Add(position);
+        }
+      }
+    }
+    initialCats = cats;
+    initialCatBodies = catBodies;
+    initialDogs = dogs;
+    initialDogBodies = dogBodies;
+    initialWorldItems = worldItems;
+
+    chunkStreamer.Attach(world, assetLayers);
+    if (!headless) {
+      staticScene.Reset(world.chunks.size());
+    }
+    shadowMaps.bakedLevel = -1;
   };
+  ApplyWorld();
+  if (!headless) {
+    chunkStreamer.Start();
+  }
+  jobs.Start(ParseJobThreads(argc, argv));
+  player.position = levelOneSpawn;
   bool hasWon = false;
   bool winAnnounced = false;
 
-  float lastTime = static_cast<float>(glfwGetTime());
+  float lastTime = replaying ? replayHeader.startTime : headless ? 0.0f : static_cast<float>(glfwGetTime());
   float yaw = glm::radians(45.0f);
   float pitch = glm::radians(-20.0f);
   float cameraDistance = 6.0f;
@@ -1824,19 +7231,22 @@ int main(int argc, char** argv) {
   glm::vec3 cameraTargetSmooth(0.0f);
   bool cameraInitialized = false;
   float playerWalkCycle = 0.0f;
-  float remotePlayerWalkCycle = 0.0f;
   float clownWalkCycle = 0.0f;
   enum class ClownAiState { Patrol, Chase, Windup };
   ClownAiState clownAiState = ClownAiState::Patrol;
   float clownJumpWindup = 0.0f;
   float mummyThrowTelegraph = 0.0f;
-  glm::vec3 remoteRenderPos(0.0f);
-  bool remoteRenderInitialized = false;
   bool wasPlayerOnGround = false;
   bool wasClownOnGround = false;
   bool wasJumpDown = false;
   bool wasLeftMouseDown = false;
   bool wasDropDown = false;
+  // Cursor position at the last orbit frame; the first frame of a drag only records it.
+  double lastCursorX = 0.0;
+  double lastCursorY = 0.0;
+  bool firstOrbitFrame = true;
+  bool useItemQueued = false;
+  bool dropItemQueued = false;
   float footstepTimer = 0.0f;
   float chaseTimer = 0.0f;
   bool isPaused = false;
@@ -1849,6 +7259,11 @@ int main(int argc, char** argv) {
   float mouseSensitivity = settings.mouseSensitivity;
   float musicVolume = settings.musicVolume;
   float sfxVolume = settings.sfxVolume;
+  float lodDistance = settings.lodDistance;
+  bool vsync = settings.vsync;
+  bool shadows = settings.shadows;
+  int netTickRate = settings.netTickRate;
+  int netPlayoutDelayMs = settings.netPlayoutDelayMs;
   constexpr int kDifficultyCount = 3;
   const char* kDifficultyLabels[kDifficultyCount] = {"Easy (Demo)", "Normal", "Hard"};
   const int kDifficultyLives[kDifficultyCount] = {9, 5, 3};
@@ -1865,10 +7280,94 @@ int main(int argc, char** argv) {
   float lifeHitCooldown = 0.0f;
   bool isDead = false;
   bool showMultiplayerWindow = settings.showMultiplayerWindow;
-  bool multiplayerAuthority = multiplayerConfig.localPort <= multiplayerConfig.peerPort;
+  bool multiplayerAuthority = multiplayerConfig.host;
   InputBindings bindings = settings.keys;
+  // The pause menu edits the copies above; this folds them back into the profile for saving.
+  auto StoreSettings = [&]() {
+    settings.uiScale = uiScale;
+    settings.mouseSensitivity = mouseSensitivity;
+    settings.musicVolume = musicVolume;
+    settings.sfxVolume = sfxVolume;
+    settings.cameraDistance = cameraDistance;
+    settings.difficulty = difficultyIndex;
+    settings.invertLookY = invertLookY;
+    settings.showDebugHud = showDebugHud;
+    settings.showMultiplayerWindow = showMultiplayerWindow;
+    settings.highContrastHud = highContrastHud;
+    settings.lodDistance = lodDistance;
+    settings.vsync = vsync;
+    settings.shadows = shadows;
+    settings.netTickRate = netTickRate;
+    settings.netPlayoutDelayMs = netPlayoutDelayMs;
+    settings.keys = bindings;
+  };
   PerformanceHistory perfHistory;
+  FrameArena frameArena(64 * 1024);
+  std::uint64_t lastHeapAllocations = HeapAllocationCount();
   float simulationAccumulator = 0.0f;
+  std::uint32_t simTick = 0u;
+  constexpr float kFixedStep = 1.0f / 120.0f;
+  constexpr int kMaxSimSteps = 4;
+  int netStepsSinceSend = 0;
+  // Headless runs keep time on the sim clock so results do not depend on host speed.
+  // Replays run on the logged frame clock, so every timer reads what it read live.
+  float replayClock = replayHeader.startTime;
+  auto ClockSeconds = [&]() {
+    if (replaying) {
+      return replayClock;
+    }
+    return headless ? static_cast<float>(simTick) * kFixedStep : static_cast<float>(glfwGetTime());
+  };
+  auto SetWindowTitle = [&](const char* title) {
+    if (window) {
+      glfwSetWindowTitle(window, title);
+    }
+  };
+  // Queues a discrete action for the peer; returns 0 when offline so nothing is predicted.
+  auto IssueInputCommand = [&](std::uint8_t actions) -> std::uint32_t {
+    if (!multiplayer.active) {
+      return 0u;
+    }
+    InputCommand command;
+    command.sequence = ++nextInputCommandSequence;
+    command.actions = actions;
+    command.heldItem = static_cast<std::uint8_t>(heldItem);
+    WriteVec3(command.pos, player.position);
+    command.facing = playerFacing;
+    pendingInputCommands.push_back(command);
+    while (pendingInputCommands.size() > kMaxPendingInputCommands) {
+      pendingInputCommands.pop_front();
+      ++multiplayer.stats.totals.inputCommandsDropped;
+    }
+    return command.sequence;
+  };
+  glm::vec3 previousPlayerPosition = player.position;
+  glm::vec3 previousClownPosition = clown.position;
+  glm::vec3 previousMummyPosition = mummy.position;
+  auto SnapshotPreviousPositions = [&]() {
+    previousPlayerPosition = player.position;
+    previousClownPosition = clown.position;
+    previousMummyPosition = mummy.position;
+    for (size_t i = 0; i < cats.size(); ++i) {
+      cats[i].previousPosition = catBodies.Position(i);
+    }
+    for (size_t i = 0; i < dogs.size(); ++i) {
+      dogs[i].previousPosition = dogBodies.Position(i);
+    }
+  };
+  SnapshotPreviousPositions();
+  // Chunks wake and stream around every player in the session.
+  glm::vec3 chunkCenters[kMaxSessionPlayers];
+  auto GatherChunkCenters = [&]() {
+    int count = 0;
+    chunkCenters[count++] = player.position;
+    for (const RemotePlayer& remote : remotePlayers) {
+      if (remote.online && count < static_cast<int>(kMaxSessionPlayers)) {
+        chunkCenters[count++] = remote.position;
+      }
+    }
+    return count;
+  };
   float levelStartTime = lastTime;
   std::string levelMedal;
   if (!multiplayer.active) {
@@ -1876,6 +7375,7 @@ int main(int argc, char** argv) {
   }
   int mpUiLocalPort = multiplayerConfig.localPort;
   int mpUiPeerPort = multiplayerConfig.peerPort;
+  bool mpUiHost = multiplayerConfig.host;
   char mpUiPeerIp[64] = {};
   std::snprintf(mpUiPeerIp, sizeof(mpUiPeerIp), "%s", multiplayerConfig.peerIp.c_str());
   std::string mpUiStatus = multiplayer.active ? "Connected." : "Not connected.";
@@ -1898,12 +7398,15 @@ int main(int argc, char** argv) {
     clown.onGround = true;
     clown.jumpCooldown = 0.0f;
     cats = initialCats;
+    catBodies = initialCatBodies;
     dogs = initialDogs;
+    dogBodies = initialDogBodies;
     worldItems = initialWorldItems;
     heldItem = ItemType::None;
     heldItemCharges = 0;
-    remoteHeldItem = ItemType::None;
-    remoteHeldCharges = 0;
+    for (RemotePlayer& remote : remotePlayers) {
+      remote.ClearItem();
+    }
     speedBootTimer = 0.0f;
     boomerangProjectile = {};
     swordDashTimer = 0.0f;
@@ -1911,28 +7414,24 @@ int main(int argc, char** argv) {
     boomerangUseAnimTimer = 0.0f;
     shotgunUseAnimTimer = 0.0f;
     swordUseAnimTimer = 0.0f;
-    remoteBoomerangUseAnimTimer = 0.0f;
-    remoteShotgunUseAnimTimer = 0.0f;
-    remoteSwordUseAnimTimer = 0.0f;
     swordDashHit = false;
+    predictedClownHit = {};
+    predictedMummyHit = {};
+    predictedDrops.clear();
     clownAlive = true;
     mummyAlive = true;
     clownRespawnTimer = 0.0f;
     mummyRespawnTimer = 0.0f;
     clownStunTimer = 0.0f;
     mummyStunTimer = 0.0f;
-    for (ShotProjectile& projectile : shotgunProjectiles) {
-      projectile.active = false;
-    }
-    collectSprites.clear();
-    for (Bomb& bomb : bombs) {
-      bomb.active = false;
-    }
-    explosions.clear();
+    shotgunProjectiles.Clear();
+    collectSprites.Clear();
+    bombs.Clear();
+    explosions.Clear();
     collectedCount = 0;
-    levelStartTime = static_cast<float>(glfwGetTime());
+    levelStartTime = ClockSeconds();
     levelMedal.clear();
-    glfwSetWindowTitle(window, "Vibe 3D - Level 1: Cats");
+    SetWindowTitle("Vibe 3D - Level 1: Cats");
   };
 
   auto ResetLevel2 = [&]() {
@@ -1954,12 +7453,15 @@ int main(int argc, char** argv) {
     mummy.onGround = true;
     mummyThrowCooldown = 1.25f * kDifficultyEnemyCooldownScale[difficultyIndex];
     cats = initialCats;
+    catBodies = initialCatBodies;
     dogs = initialDogs;
+    dogBodies = initialDogBodies;
     worldItems = initialWorldItems;
     heldItem = ItemType::None;
     heldItemCharges = 0;
-    remoteHeldItem = ItemType::None;
-    remoteHeldCharges = 0;
+    for (RemotePlayer& remote : remotePlayers) {
+      remote.ClearItem();
+    }
     speedBootTimer = 0.0f;
     boomerangProjectile = {};
     swordDashTimer = 0.0f;
@@ -1967,28 +7469,24 @@ int main(int argc, char** argv) {
     boomerangUseAnimTimer = 0.0f;
     shotgunUseAnimTimer = 0.0f;
     swordUseAnimTimer = 0.0f;
-    remoteBoomerangUseAnimTimer = 0.0f;
-    remoteShotgunUseAnimTimer = 0.0f;
-    remoteSwordUseAnimTimer = 0.0f;
     swordDashHit = false;
+    predictedClownHit = {};
+    predictedMummyHit = {};
+    predictedDrops.clear();
     clownAlive = true;
     mummyAlive = true;
     clownRespawnTimer = 0.0f;
     mummyRespawnTimer = 0.0f;
     clownStunTimer = 0.0f;
     mummyStunTimer = 0.0f;
-    for (ShotProjectile& projectile : shotgunProjectiles) {
-      projectile.active = false;
-    }
-    collectSprites.clear();
-    for (Bomb& bomb : bombs) {
-      bomb.active = false;
-    }
-    explosions.clear();
+    shotgunProjectiles.Clear();
+    collectSprites.Clear();
+    bombs.Clear();
+    explosions.Clear();
     collectedCount = 0;
-    levelStartTime = static_cast<float>(glfwGetTime());
+    levelStartTime = ClockSeconds();
     levelMedal.clear();
-    glfwSetWindowTitle(window, "Vibe 3D - Level 2: Rescue the Dogs");
+    SetWindowTitle("Vibe 3D - Level 2: Rescue the Dogs");
   };
 
   auto LoseLife = [&](bool respawnPlayer, bool ignoreCooldown) {
@@ -2018,38 +7516,125 @@ int main(int argc, char** argv) {
     }
   };
 
-  shader.Use();
-  shader.SetInt("uTexture", 0);
+  if (!headless) {
+    shader.Use();
+    shader.SetInt("uTexture", 0);
+    shader.SetInt("uStaticShadow", 1);
+    shader.SetInt("uDynamicShadow", 2);
+  }
+
+  // Headless runs start on the requested level and take exactly one sim step per loop.
+  InputScript inputScript;
+  inputScript.seed = headlessConfig.seed;
+  std::vector<double> headlessStepNs;
+  int levelRestarts = 0;
+  double slowestStepNs = 0.0;
+  std::size_t slowestFrame = 0;  // Loop iteration, which is the replay frame when replaying.
+  unsigned int headlessBombSeed = headlessConfig.seed * 2654435761u + 1u;
+  if (headless) {
+    headlessStepNs.reserve(replaying ? replayFrames.size() : headlessConfig.steps);
+  }
+  if ((headless || replaying) && headlessConfig.level == 2) {
+    ResetLevel2();
+  }
+
+  InputRecorder recorder;
+  if (!replayConfig.recordPath.empty()) {
+    InputReplayHeader header = replayHeader;
+    header.startTime = lastTime;
+    header.difficulty = static_cast<std::uint32_t>(difficultyIndex);
+    header.level = static_cast<std::uint32_t>(headlessConfig.level);
+    header.cats = static_cast<std::uint32_t>(headlessConfig.cats);
+    header.dogs = static_cast<std::uint32_t>(headlessConfig.dogs);
+    header.bombs = static_cast<std::uint32_t>(headlessConfig.bombs);
+    header.scenarioSeed = headlessConfig.seed;
+    recorder.Open(replayConfig.recordPath, header);
+  }
+  std::uint8_t queuedInputActions = 0u;
+  std::size_t replayCursor = 0;
 
-  while (!glfwWindowShouldClose(window)) {
-    const float currentTime = static_cast<float>(glfwGetTime());
+  while (headless ? (replaying ? replayCursor < replayFrames.size() : simTick < headlessConfig.steps)
+                  : !glfwWindowShouldClose(window)) {
+    if (replaying && replayCursor == replayFrames.size()) {
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+      break;
+    }
+    const ReplayFrame* replayFrame = replaying ? &replayFrames[replayCursor++] : nullptr;
+    if (replayFrame) {
+      replayClock = replayFrame->time;
+    }
+    profiler.BeginFrame();
+    frameArena.Reset();
+    const float currentTime = ClockSeconds();
     const float rawDeltaTime = glm::max(0.0f, currentTime - lastTime);
     const float clampedDeltaTime = glm::clamp(rawDeltaTime, 0.0f, 0.05f);
     lastTime = currentTime;
-    PushFrameSample(perfHistory, rawDeltaTime * 1000.0f);
-    simulationAccumulator += clampedDeltaTime;
-    constexpr float kFixedStep = 1.0f / 120.0f;
+    // Allocations made over the whole previous iteration, swap included.
+    const std::uint64_t heapAllocations = HeapAllocationCount();
+    PushFrameSample(perfHistory, rawDeltaTime * 1000.0f, heapAllocations - lastHeapAllocations);
+    lastHeapAllocations = heapAllocations;
+    simulationAccumulator = headless ? kFixedStep : simulationAccumulator + clampedDeltaTime;
     int simSteps = 0;
-    while (simulationAccumulator >= kFixedStep && simSteps < 4) {
+    while (simulationAccumulator >= kFixedStep && simSteps < kMaxSimSteps) {
       simulationAccumulator -= kFixedStep;
       ++simSteps;
     }
-    const float deltaTime = (simSteps > 0) ? (kFixedStep * static_cast<float>(simSteps)) : clampedDeltaTime;
-
-    glfwPollEvents();
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    if (simSteps == kMaxSimSteps) {
+      // Too far behind to catch up; drop the backlog rather than spiralling.
+      simulationAccumulator = std::fmod(simulationAccumulator, kFixedStep);
+    }
+    if (replayFrame) {
+      // The log decides, so a recorded hitch replays with the same catch-up steps.
+      simSteps = static_cast<int>(replayFrame->simSteps);
+    }
+    // Camera smoothing, animation cycles and HUD run on frame time; gameplay only
+    // advances in kFixedStep increments inside the step loop below.
+    const float deltaTime = clampedDeltaTime;
+
+    FrameInput input;
+    if (!headless) {
+      glfwPollEvents();
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+    }
+    if (replayFrame) {
+      input = replayFrame->input;
+      if (static_cast<int>(replayFrame->difficulty) != difficultyIndex) {
+        difficultyIndex = static_cast<int>(replayFrame->difficulty);
+        livesRemaining = glm::min(livesRemaining, kDifficultyLives[difficultyIndex]);
+      }
+    } else {
+      input = headless ? inputScript.Next(simTick) : ReadFrameInput(window, bindings);
+      input.actions = queuedInputActions;
+    }
+    queuedInputActions = 0u;
 
-    const bool escapeDown = glfwGetKey(window, bindings.pauseA) == GLFW_PRESS;
-    const bool pDown = glfwGetKey(window, bindings.pauseB) == GLFW_PRESS;
+    const bool escapeDown = input.pauseA;
+    const bool pDown = input.pauseB;
     if (!isDead && ((escapeDown && !wasEscapeDown) || (pDown && !wasPDown))) {
       isPaused = !isPaused;
     }
     wasEscapeDown = escapeDown;
     wasPDown = pDown;
 
-    if (std::abs(uiScale - lastAppliedUiScale) > 0.001f) {
+    if ((input.actions & kInputActionResume) != 0u) {
+      isPaused = false;
+    }
+    if ((input.actions & kInputActionResetPlayer) != 0u) {
+      player.position = (currentLevel == GameLevel::Level1Cats) ? levelOneSpawn : levelTwoSpawn;
+      player.velocity = glm::vec3(0.0f);
+    }
+    if ((input.actions & kInputActionRestartLevel) != 0u) {
+      if (currentLevel == GameLevel::Level1Cats) {
+        ResetLevel1();
+      } else {
+        ResetLevel2();
+      }
+      ++levelRestarts;
+    }
+
+    if (!headless && std::abs(uiScale - lastAppliedUiScale) > 0.001f) {
       ApplyUiScale(uiScale);
       lastAppliedUiScale = uiScale;
     }
@@ -2067,129 +7652,180 @@ int main(int argc, char** argv) {
         std::sin(pitch),
         std::cos(yaw) * std::cos(pitch)));
 
-    static double lastX = 0.0;
-    static double lastY = 0.0;
-    static bool first = true;
-    if (!isPaused && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
-      double x = 0.0;
-      double y = 0.0;
-      glfwGetCursorPos(window, &x, &y);
-      if (first) {
-        lastX = x;
-        lastY = y;
-        first = false;
-      }
-      const float dx = static_cast<float>(x - lastX) * mouseSensitivity;
-      const float dySign = invertLookY ? -1.0f : 1.0f;
-      const float dy = static_cast<float>(y - lastY) * mouseSensitivity * dySign;
-      yaw -= dx;
-      pitch -= dy;
+    if (!isPaused && input.orbit) {
+      if (!replayFrame) {
+        const double x = input.cursorX;
+        const double y = input.cursorY;
+        if (firstOrbitFrame) {
+          lastCursorX = x;
+          lastCursorY = y;
+          firstOrbitFrame = false;
+        }
+        const float dySign = invertLookY ? -1.0f : 1.0f;
+        input.orbitYaw = static_cast<float>(x - lastCursorX) * mouseSensitivity;
+        input.orbitPitch = static_cast<float>(y - lastCursorY) * mouseSensitivity * dySign;
+        lastCursorX = x;
+        lastCursorY = y;
+      }
+      yaw -= input.orbitYaw;
+      pitch -= input.orbitPitch;
       pitch = glm::clamp(pitch, glm::radians(-70.0f), glm::radians(20.0f));
-      lastX = x;
-      lastY = y;
     } else {
-      first = true;
-    }
-
-    lifeHitCooldown = glm::max(0.0f, lifeHitCooldown - deltaTime);
-    player.hurtTimer = glm::max(0.0f, player.hurtTimer - deltaTime);
-    boomerangUseAnimTimer = glm::max(0.0f, boomerangUseAnimTimer - deltaTime);
-    shotgunUseAnimTimer = glm::max(0.0f, shotgunUseAnimTimer - deltaTime);
-    swordUseAnimTimer = glm::max(0.0f, swordUseAnimTimer - deltaTime);
-    remoteBoomerangUseAnimTimer = glm::max(0.0f, remoteBoomerangUseAnimTimer - deltaTime);
-    remoteShotgunUseAnimTimer = glm::max(0.0f, remoteShotgunUseAnimTimer - deltaTime);
-    remoteSwordUseAnimTimer = glm::max(0.0f, remoteSwordUseAnimTimer - deltaTime);
-    const bool leftMouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-    const bool dropDown = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
-    const bool useItemPressed = leftMouseDown && !wasLeftMouseDown;
-    const bool dropItemPressed = dropDown && !wasDropDown;
-    wasLeftMouseDown = leftMouseDown;
-    wasDropDown = dropDown;
-    std::uint32_t localInputActions = 0u;
-    for (std::size_t i = 0; i < collectSprites.size();) {
-      collectSprites[i].age += deltaTime;
-      if (collectSprites[i].age >= collectSprites[i].duration) {
-        collectSprites[i] = collectSprites.back();
-        collectSprites.pop_back();
-      } else {
-        ++i;
-      }
+      firstOrbitFrame = true;
     }
 
-    if (!isPaused && !isDead) {
-      const float playerSpeedScale = kDifficultyPlayerSpeedScale[difficultyIndex];
-      const float enemySpeedScale = kDifficultyEnemySpeedScale[difficultyIndex];
-      const float enemyCooldownScale = kDifficultyEnemyCooldownScale[difficultyIndex];
-      const float aggroScale = kDifficultyAggroScale[difficultyIndex];
-      const float blastRadiusScale = kDifficultyBlastRadiusScale[difficultyIndex];
-      const float blastImpulseScale = kDifficultyBlastImpulseScale[difficultyIndex];
-      glm::vec3 forwardXZ = glm::normalize(glm::vec3(cameraForward.x, 0.0f, cameraForward.z));
-      glm::vec3 rightXZ = glm::normalize(glm::cross(forwardXZ, glm::vec3(0.0f, 1.0f, 0.0f)));
-
-    glm::vec3 inputDir(0.0f);
-    if (glfwGetKey(window, bindings.forward) == GLFW_PRESS) {
-      inputDir += forwardXZ;
-    }
-    if (glfwGetKey(window, bindings.backward) == GLFW_PRESS) {
-      inputDir -= forwardXZ;
-    }
-    if (glfwGetKey(window, bindings.right) == GLFW_PRESS) {
-      inputDir += rightXZ;
-    }
-    if (glfwGetKey(window, bindings.left) == GLFW_PRESS) {
-      inputDir -= rightXZ;
-    }
-    if (glm::length(inputDir) > 0.001f) {
-      inputDir = glm::normalize(inputDir);
-    }
-    if (hasWon) {
-      inputDir = glm::vec3(0.0f);
+    if (recorder.Active()) {
+      ReplayFrame frame;
+      frame.time = currentTime;
+      frame.simSteps = static_cast<std::uint32_t>(simSteps);
+      frame.difficulty = static_cast<std::uint32_t>(difficultyIndex);
+      frame.input = input;
+      recorder.Write(frame);
     }
 
-    if (player.blastTimer > 0.0f) {
-      player.blastTimer = glm::max(0.0f, player.blastTimer - deltaTime);
-      inputDir = glm::vec3(0.0f);
+    const bool leftMouseDown = input.useItem;
+    const bool dropDown = input.dropItem;
+    // Edges stay latched until a sim step consumes them, so a click on a frame
+    // that runs zero steps is not lost and one that runs several fires once.
+    useItemQueued = useItemQueued || (leftMouseDown && !wasLeftMouseDown);
+    dropItemQueued = dropItemQueued || (dropDown && !wasDropDown);
+    wasLeftMouseDown = leftMouseDown;
+    wasDropDown = dropDown;
+    collectSprites.ReleaseIf([&](CollectSprite& sprite) {
+      sprite.age += deltaTime;
+      return sprite.age >= sprite.duration;
+    });
+
+    // Scenario bombs: keep the requested number in flight, lobbed from random spots over
+    // the ground slab so their blasts land across the whole field.
+    if (headless || replaying) {
+      const Platform& ground = platforms[0];
+      while (bombs.Size() < static_cast<std::size_t>(headlessConfig.bombs)) {
+        Bomb* bomb = bombs.Acquire();
+        if (!bomb) {
+          break;
+        }
+        bomb->timer = 1.5f + RandomFloat(headlessBombSeed) * 2.5f;
+        bomb->position = glm::vec3(ground.position.x + (RandomFloat(headlessBombSeed) * 1.8f - 0.9f) * ground.halfExtents.x,
+                                   worldGroundTop + 3.0f,
+                                   ground.position.z + (RandomFloat(headlessBombSeed) * 1.8f - 0.9f) * ground.halfExtents.z);
+        const float heading = RandomFloat(headlessBombSeed) * 6.28318f;
+        bomb->velocity = glm::vec3(std::cos(heading) * 6.0f, 5.0f, std::sin(heading) * 6.0f);
+      }
     }
 
-    speedBootTimer = glm::max(0.0f, speedBootTimer - deltaTime);
-    const bool wantsSprint = glfwGetKey(window, bindings.sprint) == GLFW_PRESS && stamina > 0.05f;
-    const float bootsMultiplier = (speedBootTimer > 0.0f) ? 1.65f : 1.0f;
-    const float targetSpeed = moveSpeed * playerSpeedScale * bootsMultiplier * (wantsSprint ? sprintMultiplier : 1.0f);
-    const float accel = player.onGround ? accelGround : accelAir;
-    const glm::vec3 targetVel = inputDir * targetSpeed;
-    player.velocity.x = glm::mix(player.velocity.x, targetVel.x, glm::clamp(accel * deltaTime, 0.0f, 1.0f));
-    player.velocity.z = glm::mix(player.velocity.z, targetVel.z, glm::clamp(accel * deltaTime, 0.0f, 1.0f));
-    player.velocity.y += gravity * deltaTime;
+    // One fixed simulation step: queued input, the player and items, enemies, animals,
+    // pickups and level progression, all advancing by kFixedStep.
+    auto StepSimulation = [&]() {
+      ++simTick;
+      const bool useItemPressed = useItemQueued;
+      const bool dropItemPressed = dropItemQueued;
+      useItemQueued = false;
+      dropItemQueued = false;
+      lifeHitCooldown = glm::max(0.0f, lifeHitCooldown - kFixedStep);
+      player.hurtTimer = glm::max(0.0f, player.hurtTimer - kFixedStep);
+      boomerangUseAnimTimer = glm::max(0.0f, boomerangUseAnimTimer - kFixedStep);
+      shotgunUseAnimTimer = glm::max(0.0f, shotgunUseAnimTimer - kFixedStep);
+      swordUseAnimTimer = glm::max(0.0f, swordUseAnimTimer - kFixedStep);
+      for (RemotePlayer& remote : remotePlayers) {
+        remote.boomerangUseAnimTimer = glm::max(0.0f, remote.boomerangUseAnimTimer - kFixedStep);
+        remote.shotgunUseAnimTimer = glm::max(0.0f, remote.shotgunUseAnimTimer - kFixedStep);
+        remote.swordUseAnimTimer = glm::max(0.0f, remote.swordUseAnimTimer - kFixedStep);
+      }
+      SnapshotPreviousPositions();
+      RebuildEntityGrid();
+      chunkStreamer.UpdateAwake(chunkCenters, GatherChunkCenters());
+
+      if (!isPaused && !isDead) {
+        const float playerSpeedScale = kDifficultyPlayerSpeedScale[difficultyIndex];
+        const bool predictingForHost = multiplayer.active && !multiplayerAuthority;
+        const float enemySpeedScale = kDifficultyEnemySpeedScale[difficultyIndex];
+        const float enemyCooldownScale = kDifficultyEnemyCooldownScale[difficultyIndex];
+        const float aggroScale = kDifficultyAggroScale[difficultyIndex];
+        const float blastRadiusScale = kDifficultyBlastRadiusScale[difficultyIndex];
+        const float blastImpulseScale = kDifficultyBlastImpulseScale[difficultyIndex];
+        glm::vec3 forwardXZ = glm::normalize(glm::vec3(cameraForward.x, 0.0f, cameraForward.z));
+        glm::vec3 rightXZ = glm::normalize(glm::cross(forwardXZ, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+      glm::vec3 inputDir(0.0f);
+      if (input.forward) {
+        inputDir += forwardXZ;
+      }
+      if (input.backward) {
+        inputDir -= forwardXZ;
+      }
+      if (input.right) {
+        inputDir += rightXZ;
+      }
+      if (input.left) {
+        inputDir -= rightXZ;
+      }
+      if (glm::length(inputDir) > 0.001f) {
+        inputDir = glm::normalize(inputDir);
+      }
+      if (hasWon) {
+        inputDir = glm::vec3(0.0f);
+      }
 
-    if (wantsSprint && glm::length(inputDir) > 0.1f) {
-      stamina = glm::max(0.0f, stamina - deltaTime * 0.45f);
-    } else {
-      stamina = glm::min(1.0f, stamina + deltaTime * 0.35f);
-    }
+      if (player.blastTimer > 0.0f) {
+        player.blastTimer = glm::max(0.0f, player.blastTimer - kFixedStep);
+        inputDir = glm::vec3(0.0f);
+      }
 
-    const bool jumpDown = glfwGetKey(window, bindings.jump) == GLFW_PRESS;
-    if (jumpDown) {
-      jumpBufferTimer = jumpBufferMax;
-    }
+      speedBootTimer = glm::max(0.0f, speedBootTimer - kFixedStep);
+      const bool wantsSprint = input.sprint && stamina > 0.05f;
+      const float bootsMultiplier = (speedBootTimer > 0.0f) ? 1.65f : 1.0f;
+      const float targetSpeed = moveSpeed * playerSpeedScale * bootsMultiplier * (wantsSprint ? sprintMultiplier : 1.0f);
+      const float accel = player.onGround ? accelGround : accelAir;
+      const glm::vec3 targetVel = inputDir * targetSpeed;
+      player.velocity.x = glm::mix(player.velocity.x, targetVel.x, glm::clamp(accel * kFixedStep, 0.0f, 1.0f));
+      player.velocity.z = glm::mix(player.velocity.z, targetVel.z, glm::clamp(accel * kFixedStep, 0.0f, 1.0f));
+      player.velocity.y += gravity * kFixedStep;
+
+      if (wantsSprint && glm::length(inputDir) > 0.1f) {
+        stamina = glm::max(0.0f, stamina - kFixedStep * 0.45f);
+      } else {
+        stamina = glm::min(1.0f, stamina + kFixedStep * 0.35f);
+      }
 
-    auto SpawnCollectSprite = [&](ItemType itemType, const glm::vec3& atPos) {
-      if (collectSprites.size() >= 24) {
-        collectSprites.erase(collectSprites.begin());
+      const bool jumpDown = input.jump;
+      if (jumpDown) {
+        jumpBufferTimer = jumpBufferMax;
       }
-      CollectSprite sprite;
-      sprite.position = atPos;
-      sprite.itemType = itemType;
-      sprite.age = 0.0f;
-      sprite.duration = 0.82f;
-      collectSprites.push_back(sprite);
-    };
 
-    if (heldItem == ItemType::None) {
-      for (WorldItem& item : worldItems) {
-        if (!item.active) {
-          continue;
+      auto SpawnCollectSprite = [&](ItemType itemType, const glm::vec3& atPos) {
+        // A full pool recycles the oldest sprite, which is the one closest to fading out.
+        if (collectSprites.Size() == collectSprites.Capacity()) {
+          const CollectSprite* oldest = nullptr;
+          for (const CollectSprite& sprite : collectSprites) {
+            if (oldest == nullptr || sprite.age > oldest->age) {
+              oldest = &sprite;
+            }
+          }
+          collectSprites.Release(collectSprites.SlotOf(*oldest));
         }
-        if (glm::distance(player.position, item.position) < 1.45f) {
+        CollectSprite* sprite = collectSprites.Acquire();
+        sprite->position = atPos;
+        sprite->itemType = itemType;
+        sprite->age = 0.0f;
+        sprite->duration = 0.82f;
+      };
+
+      // First active item in reach, in index order like the old linear scan.
+      auto FindItemNear = [&](const glm::vec3& position) -> WorldItem* {
+        size_t found = worldItems.size();
+        entityGrid.ForEachNear(EntityGrid::Kind::Item, position, 1.45f, [&](size_t itemIdx) {
+          if (itemIdx < found && worldItems[itemIdx].active &&
+              glm::distance(position, worldItems[itemIdx].position) < 1.45f) {
+            found = itemIdx;
+          }
+        });
+        return found < worldItems.size() ? &worldItems[found] : nullptr;
+      };
+
+      if (heldItem == ItemType::None) {
+        if (WorldItem* picked = FindItemNear(player.position)) {
+          WorldItem& item = *picked;
           const ItemType pickedType = item.type;
           const glm::vec3 pickupPos = item.position;
           heldItem = item.type;
@@ -2204,1081 +7840,1251 @@ int main(int argc, char** argv) {
           }
           item.active = false;
           SpawnCollectSprite(pickedType, pickupPos + glm::vec3(0.0f, 0.5f, 0.0f));
-          break;
         }
       }
-    }
 
-    const bool remoteRecent = multiplayer.hasRemote && (currentTime - multiplayer.lastReceiveTime) < 2.0f;
-    if (remoteRecent && remoteHeldItem == ItemType::None) {
-      const glm::vec3 remotePos(multiplayer.latest.pos[0], multiplayer.latest.pos[1], multiplayer.latest.pos[2]);
-      for (WorldItem& item : worldItems) {
-        if (!item.active) {
+      for (const RemotePlayer& remote : remotePlayers) {
+        if (!remote.online || remote.heldItem != ItemType::None) {
           continue;
         }
-        if (glm::distance(remotePos, item.position) < 1.45f) {
-          const ItemType pickedType = item.type;
-          const glm::vec3 pickupPos = item.position;
-          item.active = false;
-          SpawnCollectSprite(pickedType, pickupPos + glm::vec3(0.0f, 0.5f, 0.0f));
-          break;
+        if (WorldItem* picked = FindItemNear(remote.position)) {
+          picked->active = false;
+          SpawnCollectSprite(picked->type, picked->position + glm::vec3(0.0f, 0.5f, 0.0f));
         }
       }
-    }
 
-    auto ConsumeHeldIfEmpty = [&]() {
-      if (heldItemCharges <= 0) {
+      auto ConsumeHeldIfEmpty = [&]() {
+        if (heldItemCharges <= 0) {
+          heldItem = ItemType::None;
+          heldItemCharges = 0;
+        }
+      };
+
+      if (dropItemPressed && heldItem != ItemType::None && !boomerangProjectile.active) {
+        const std::uint32_t dropCommand = IssueInputCommand(kInputActionDropItem);
+        WorldItem dropped;
+        dropped.type = heldItem;
+        dropped.active = true;
+        dropped.position = player.position + forwardXZ * 1.25f;
+        const std::size_t droppedIndex = PlaceWorldItem(dropped);
+        if (predictingForHost) {
+          predictedDrops.push_back({dropCommand, droppedIndex, dropped});
+        }
         heldItem = ItemType::None;
         heldItemCharges = 0;
       }
-    };
-
-    if (dropItemPressed && heldItem != ItemType::None && !boomerangProjectile.active) {
-      localInputActions |= kInputActionDropItem;
-      WorldItem dropped;
-      dropped.type = heldItem;
-      dropped.active = true;
-      dropped.position = player.position + forwardXZ * 1.25f;
-      if (worldItems.size() < 16) {
-        worldItems.push_back(dropped);
-      }
-      heldItem = ItemType::None;
-      heldItemCharges = 0;
-    }
 
-    if (useItemPressed && heldItem != ItemType::None) {
-      localInputActions |= kInputActionUseItem;
-      if (heldItem == ItemType::SpeedBoots) {
-        speedBootTimer = 10.0f;
-        heldItem = ItemType::None;
-        heldItemCharges = 0;
-      } else if (heldItem == ItemType::Boomerang && !boomerangProjectile.active) {
-        boomerangUseAnimTimer = 0.28f;
-        boomerangProjectile.active = true;
-        boomerangProjectile.returning = false;
-        boomerangProjectile.timeAlive = 0.0f;
-        boomerangProjectile.position = player.position + glm::vec3(0.0f, 0.7f, 0.0f) + forwardXZ * 0.85f;
-        boomerangProjectile.velocity = forwardXZ * 24.0f;
-        heldItemCharges -= 1;
-      } else if (heldItem == ItemType::Shotgun && heldItemCharges > 0) {
-        shotgunUseAnimTimer = 0.22f;
-        const int kPellets = 7;
-        for (int pellet = 0; pellet < kPellets; ++pellet) {
-          for (ShotProjectile& projectile : shotgunProjectiles) {
-            if (projectile.active) {
-              continue;
+      if (useItemPressed && heldItem != ItemType::None) {
+        const std::uint32_t useCommand = IssueInputCommand(kInputActionUseItem);
+        if (heldItem == ItemType::SpeedBoots) {
+          speedBootTimer = 10.0f;
+          heldItem = ItemType::None;
+          heldItemCharges = 0;
+        } else if (heldItem == ItemType::Boomerang && !boomerangProjectile.active) {
+          boomerangUseAnimTimer = 0.28f;
+          boomerangProjectile.active = true;
+          boomerangProjectile.returning = false;
+          boomerangProjectile.timeAlive = 0.0f;
+          boomerangProjectile.position = player.position + glm::vec3(0.0f, 0.7f, 0.0f) + forwardXZ * 0.85f;
+          boomerangProjectile.velocity = forwardXZ * 24.0f;
+          boomerangProjectile.command = useCommand;
+          heldItemCharges -= 1;
+        } else if (heldItem == ItemType::Shotgun && heldItemCharges > 0) {
+          shotgunUseAnimTimer = 0.22f;
+          const int kPellets = 7;
+          for (int pellet = 0; pellet < kPellets; ++pellet) {
+            ShotProjectile* projectile = shotgunProjectiles.Acquire();
+            if (projectile == nullptr) {
+              break;
             }
             const float spreadT = (static_cast<float>(pellet) / static_cast<float>(kPellets - 1)) * 2.0f - 1.0f;
             const glm::vec3 shotDir = glm::normalize(forwardXZ + rightXZ * spreadT * 0.32f + glm::vec3(0.0f, 0.015f * std::abs(spreadT), 0.0f));
-            projectile.active = true;
-            projectile.position = player.position + glm::vec3(0.0f, 0.95f, 0.0f) + shotDir * 0.8f;
-            projectile.velocity = shotDir * 46.0f;
-            projectile.lifetime = 0.35f;
-            break;
+            projectile->position = player.position + glm::vec3(0.0f, 0.95f, 0.0f) + shotDir * 0.8f;
+            projectile->velocity = shotDir * 46.0f;
+            projectile->lifetime = 0.35f;
+            projectile->command = useCommand;
           }
-        }
-        heldItemCharges -= 1;
-        ConsumeHeldIfEmpty();
-      } else if (heldItem == ItemType::Sword && heldItemCharges > 0 && swordDashTimer <= 0.0f) {
-        swordUseAnimTimer = 0.32f;
-        swordDashTimer = 0.24f;
-        swordDashCurveTimer = 0.24f;
-        swordDashHit = false;
-        swordDashDir = (glm::length(inputDir) > 0.1f) ? glm::normalize(inputDir) : forwardXZ;
-        heldItemCharges -= 1;
-        ConsumeHeldIfEmpty();
-      }
-    }
-
-    if (swordDashTimer > 0.0f) {
-      swordDashTimer = glm::max(0.0f, swordDashTimer - deltaTime);
-      swordDashCurveTimer = glm::max(0.0f, swordDashCurveTimer - deltaTime);
-      const float curveNorm = glm::clamp(1.0f - swordDashCurveTimer / 0.24f, 0.0f, 1.0f);
-      const float hook = std::sin(curveNorm * 3.14159f) * 0.95f;
-      const glm::vec3 curvedDir = glm::normalize(swordDashDir + rightXZ * hook * 0.6f);
-      player.velocity.x = curvedDir.x * 32.0f;
-      player.velocity.z = curvedDir.z * 32.0f;
-    }
-
-    player.position += player.velocity * deltaTime;
-
-    auto KillCurrentEnemyFromItem = [&]() {
-      if (currentLevel == GameLevel::Level1Cats && clownAlive) {
-        clownAlive = false;
-        clownRespawnTimer = 7.0f;
-        clownStunTimer = 0.0f;
-        clown.velocity = glm::vec3(0.0f);
-      } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
-        mummyAlive = false;
-        mummyRespawnTimer = 7.0f;
-        mummyStunTimer = 0.0f;
-        mummy.velocity = glm::vec3(0.0f);
-        for (Bomb& bomb : bombs) {
-          bomb.active = false;
+          heldItemCharges -= 1;
+          ConsumeHeldIfEmpty();
+        } else if (heldItem == ItemType::Sword && heldItemCharges > 0 && swordDashTimer <= 0.0f) {
+          swordUseAnimTimer = 0.32f;
+          swordDashTimer = 0.24f;
+          swordDashCurveTimer = 0.24f;
+          swordDashHit = false;
+          swordDashCommand = useCommand;
+          swordDashDir = (glm::length(inputDir) > 0.1f) ? glm::normalize(inputDir) : forwardXZ;
+          heldItemCharges -= 1;
+          ConsumeHeldIfEmpty();
         }
       }
-    };
 
-    auto StunCurrentEnemy = [&]() {
-      if (currentLevel == GameLevel::Level1Cats && clownAlive) {
-        clownStunTimer = glm::max(clownStunTimer, 2.6f);
-      } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
-        mummyStunTimer = glm::max(mummyStunTimer, 2.6f);
+      if (swordDashTimer > 0.0f) {
+        swordDashTimer = glm::max(0.0f, swordDashTimer - kFixedStep);
+        swordDashCurveTimer = glm::max(0.0f, swordDashCurveTimer - kFixedStep);
+        const float curveNorm = glm::clamp(1.0f - swordDashCurveTimer / 0.24f, 0.0f, 1.0f);
+        const float hook = std::sin(curveNorm * 3.14159f) * 0.95f;
+        const glm::vec3 curvedDir = glm::normalize(swordDashDir + rightXZ * hook * 0.6f);
+        player.velocity.x = curvedDir.x * 32.0f;
+        player.velocity.z = curvedDir.z * 32.0f;
       }
-    };
 
-    if (boomerangProjectile.active) {
-      boomerangProjectile.timeAlive += deltaTime;
-      const glm::vec3 toPlayer = (player.position + glm::vec3(0.0f, 0.75f, 0.0f)) - boomerangProjectile.position;
-      const float distToPlayer = glm::length(toPlayer);
-      if (!boomerangProjectile.returning) {
-        if (boomerangProjectile.timeAlive > 0.3f || distToPlayer > 20.0f) {
-          boomerangProjectile.returning = true;
+      player.position += player.velocity * kFixedStep;
+
+      auto PredictHit = [&](PredictedEnemyHit& hit, std::uint32_t command, bool kill, float duration) {
+        if (!predictingForHost || command == 0u || (hit.kill && !kill)) {
+          return;
         }
-      }
-      if (boomerangProjectile.returning && distToPlayer > 0.001f) {
-        boomerangProjectile.velocity = glm::normalize(toPlayer) * 26.0f;
-      }
-      boomerangProjectile.position += boomerangProjectile.velocity * deltaTime;
+        hit.command = command;
+        hit.kill = kill;
+        hit.tick = simTick;
+        hit.duration = duration;
+      };
 
-      const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
-      const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
-      if (enemyAlive && glm::distance(boomerangProjectile.position, enemyPos) < 1.25f) {
-        StunCurrentEnemy();
-      }
+      auto KillCurrentEnemyFromItem = [&](std::uint32_t command) {
+        if (currentLevel == GameLevel::Level1Cats && clownAlive) {
+          clownAlive = false;
+          clownRespawnTimer = 7.0f;
+          clownStunTimer = 0.0f;
+          clown.velocity = glm::vec3(0.0f);
+          PredictHit(predictedClownHit, command, true, clownRespawnTimer);
+        } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
+          mummyAlive = false;
+          mummyRespawnTimer = 7.0f;
+          mummyStunTimer = 0.0f;
+          mummy.velocity = glm::vec3(0.0f);
+          bombs.Clear();
+          PredictHit(predictedMummyHit, command, true, mummyRespawnTimer);
+        }
+      };
 
-      if (boomerangProjectile.returning && distToPlayer < 1.15f) {
-        boomerangProjectile.active = false;
-        if (heldItem == ItemType::Boomerang && heldItemCharges <= 0) {
-          heldItem = ItemType::None;
-          heldItemCharges = 0;
+      auto StunCurrentEnemy = [&](std::uint32_t command) {
+        if (currentLevel == GameLevel::Level1Cats && clownAlive) {
+          clownStunTimer = glm::max(clownStunTimer, 2.6f);
+          PredictHit(predictedClownHit, command, false, clownStunTimer);
+        } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
+          mummyStunTimer = glm::max(mummyStunTimer, 2.6f);
+          PredictHit(predictedMummyHit, command, false, mummyStunTimer);
         }
-      }
-      if (boomerangProjectile.timeAlive > 4.0f) {
-        boomerangProjectile.active = false;
-      }
-    }
+      };
 
-    for (ShotProjectile& projectile : shotgunProjectiles) {
-      if (!projectile.active) {
-        continue;
-      }
-      projectile.lifetime -= deltaTime;
-      projectile.position += projectile.velocity * deltaTime;
-      if (projectile.lifetime <= 0.0f) {
-        projectile.active = false;
-        continue;
-      }
-      const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
-      const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
-      if (enemyAlive && glm::distance(projectile.position, enemyPos) < 1.35f) {
-        projectile.active = false;
-        KillCurrentEnemyFromItem();
-      }
-    }
+      if (boomerangProjectile.active) {
+        boomerangProjectile.timeAlive += kFixedStep;
+        const glm::vec3 toPlayer = (player.position + glm::vec3(0.0f, 0.75f, 0.0f)) - boomerangProjectile.position;
+        const float distToPlayer = glm::length(toPlayer);
+        if (!boomerangProjectile.returning) {
+          if (boomerangProjectile.timeAlive > 0.3f || distToPlayer > 20.0f) {
+            boomerangProjectile.returning = true;
+          }
+        }
+        if (boomerangProjectile.returning && distToPlayer > 0.001f) {
+          boomerangProjectile.velocity = glm::normalize(toPlayer) * 26.0f;
+        }
+        boomerangProjectile.position += boomerangProjectile.velocity * kFixedStep;
 
-    if (swordDashTimer > 0.0f && !swordDashHit) {
-      const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
-      const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
-      if (enemyAlive && glm::distance(player.position, enemyPos) < 2.0f) {
-        swordDashHit = true;
-        KillCurrentEnemyFromItem();
+        const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
+        const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
+        if (enemyAlive && glm::distance(boomerangProjectile.position, enemyPos) < 1.25f) {
+          StunCurrentEnemy(boomerangProjectile.command);
+        }
+
+        if (boomerangProjectile.returning && distToPlayer < 1.15f) {
+          boomerangProjectile.active = false;
+          if (heldItem == ItemType::Boomerang && heldItemCharges <= 0) {
+            heldItem = ItemType::None;
+            heldItemCharges = 0;
+          }
+        }
+        if (boomerangProjectile.timeAlive > 4.0f) {
+          boomerangProjectile.active = false;
+        }
       }
-    }
 
-    player.onGround = false;
-    const float groundTop = platforms[0].position.y + platforms[0].halfExtents.y;
-    if (player.position.y - player.halfSize < groundTop) {
-      player.position.y = groundTop + player.halfSize;
-      player.velocity.y = 0.0f;
-      player.onGround = true;
-    }
+      shotgunProjectiles.ReleaseIf([&](ShotProjectile& projectile) {
+        projectile.position += projectile.velocity * kFixedStep;
+        projectile.lifetime -= kFixedStep;
+        if (projectile.lifetime <= 0.0f) {
+          return true;
+        }
+        const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
+        const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
+        if (enemyAlive && glm::distance(projectile.position, enemyPos) < 1.35f) {
+          KillCurrentEnemyFromItem(projectile.command);
+          return true;
+        }
+        return false;
+      });
 
-    for (size_t i = 1; i < platforms.size(); ++i) {
-      const Platform& platform = platforms[i];
-      const float platformTop = platform.position.y + platform.halfExtents.y;
-      const bool withinX = std::abs(player.position.x - platform.position.x) <= (platform.halfExtents.x + player.halfSize);
-      const bool withinZ = std::abs(player.position.z - platform.position.z) <= (platform.halfExtents.z + player.halfSize);
-      const bool falling = player.velocity.y <= 0.0f;
-      if (withinX && withinZ && falling) {
-        const float playerBottom = player.position.y - player.halfSize;
-        if (playerBottom < platformTop && player.position.y > platformTop - 0.6f) {
-          player.position.y = platformTop + player.halfSize;
-          player.velocity.y = 0.0f;
-          player.onGround = true;
+      if (swordDashTimer > 0.0f && !swordDashHit) {
+        const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
+        const bool enemyAlive = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
+        if (enemyAlive && glm::distance(player.position, enemyPos) < 2.0f) {
+          swordDashHit = true;
+          KillCurrentEnemyFromItem(swordDashCommand);
         }
       }
-    }
-
-    if (player.onGround) {
-      coyoteTimer = coyoteTimeMax;
-    } else {
-      coyoteTimer = glm::max(0.0f, coyoteTimer - deltaTime);
-    }
-    jumpBufferTimer = glm::max(0.0f, jumpBufferTimer - deltaTime);
 
-    if (jumpBufferTimer > 0.0f && coyoteTimer > 0.0f) {
-      player.velocity.y = jumpSpeed;
       player.onGround = false;
-      coyoteTimer = 0.0f;
-      jumpBufferTimer = 0.0f;
-      if (audio.ready) {
-        PlaySound(audio.jump);
+      const float groundTop = platforms[0].position.y + platforms[0].halfExtents.y;
+      if (player.position.y - player.halfSize < groundTop) {
+        player.position.y = groundTop + player.halfSize;
+        player.velocity.y = 0.0f;
+        player.onGround = true;
       }
-    }
 
-    if (!jumpDown && wasJumpDown && player.velocity.y > 0.0f) {
-      player.velocity.y *= 0.52f;
-    }
-    wasJumpDown = jumpDown;
+      for (const std::uint32_t i : platformGrid.Near(player.position)) {
+        const Platform& platform = platforms[i];
+        const float platformTop = platform.position.y + platform.halfExtents.y;
+        const bool withinX = std::abs(player.position.x - platform.position.x) <= (platform.halfExtents.x + player.halfSize);
+        const bool withinZ = std::abs(player.position.z - platform.position.z) <= (platform.halfExtents.z + player.halfSize);
+        const bool falling = player.velocity.y <= 0.0f;
+        if (withinX && withinZ && falling) {
+          const float playerBottom = player.position.y - player.halfSize;
+          if (playerBottom < platformTop && player.position.y > platformTop - 0.6f) {
+            player.position.y = platformTop + player.halfSize;
+            player.velocity.y = 0.0f;
+            player.onGround = true;
+          }
+        }
+      }
 
-    clownStunTimer = glm::max(0.0f, clownStunTimer - deltaTime);
-    mummyStunTimer = glm::max(0.0f, mummyStunTimer - deltaTime);
-    if (!clownAlive) {
-      clownRespawnTimer = glm::max(0.0f, clownRespawnTimer - deltaTime);
-      if (clownRespawnTimer <= 0.0f) {
-        clownAlive = true;
-        clown.position = clownStartPosition;
-        clown.velocity = glm::vec3(0.0f);
-        clown.onGround = true;
+      if (player.onGround) {
+        coyoteTimer = coyoteTimeMax;
+      } else {
+        coyoteTimer = glm::max(0.0f, coyoteTimer - kFixedStep);
       }
-    }
-    if (!mummyAlive) {
-      mummyRespawnTimer = glm::max(0.0f, mummyRespawnTimer - deltaTime);
-      if (mummyRespawnTimer <= 0.0f) {
-        mummyAlive = true;
-        mummy.position = mummyStartPosition;
-        mummy.velocity = glm::vec3(0.0f);
-        mummy.onGround = true;
+      jumpBufferTimer = glm::max(0.0f, jumpBufferTimer - kFixedStep);
+
+      if (jumpBufferTimer > 0.0f && coyoteTimer > 0.0f) {
+        player.velocity.y = jumpSpeed;
+        player.onGround = false;
+        coyoteTimer = 0.0f;
+        jumpBufferTimer = 0.0f;
+        if (audio.ready) {
+          PlaySound(audio.jump);
+        }
       }
-    }
 
-    if (currentLevel == GameLevel::Level1Cats) {
-    if (clownAlive) {
-    const float enemyGround = platforms[0].position.y + platforms[0].halfExtents.y + clown.halfSize;
-    const float playerDistance = glm::length(player.position - clown.position);
-    const float aggroRange = 18.0f * aggroScale * kMapScale;
-    const bool hasLineOfSight = playerDistance < aggroRange;
-    const float levelThreat = glm::clamp(static_cast<float>(collectedCount) / 10.0f, 0.0f, 1.0f);
-    glm::vec3 aiTarget = player.position;
-
-    if (hasLineOfSight) {
-      clownAiState = ClownAiState::Chase;
-    } else if (clownAiState != ClownAiState::Windup) {
-      clownAiState = ClownAiState::Patrol;
-    }
-
-    if (hasLineOfSight && player.position.y > clown.position.y + 0.6f) {
-      float bestScore = 1e9f;
-      for (const Platform& platform : platforms) {
-        const float platformTop = platform.position.y + platform.halfExtents.y + clown.halfSize;
-        if (platformTop > clown.position.y + 0.4f && platformTop <= player.position.y + 0.3f) {
-          const float distToPlayer = glm::length(glm::vec2(platform.position.x - player.position.x,
-                                                           platform.position.z - player.position.z));
-          const float distToClown = glm::length(glm::vec2(platform.position.x - clown.position.x,
-                                                          platform.position.z - clown.position.z));
-          const float score = distToPlayer + distToClown * 0.4f + std::abs(platformTop - player.position.y);
-          if (score < bestScore) {
-            bestScore = score;
-            aiTarget = glm::vec3(platform.position.x, platformTop, platform.position.z);
-          }
+      if (!jumpDown && wasJumpDown && player.velocity.y > 0.0f) {
+        player.velocity.y *= 0.52f;
+      }
+      wasJumpDown = jumpDown;
+
+      clownStunTimer = glm::max(0.0f, clownStunTimer - kFixedStep);
+      mummyStunTimer = glm::max(0.0f, mummyStunTimer - kFixedStep);
+      if (!clownAlive) {
+        clownRespawnTimer = glm::max(0.0f, clownRespawnTimer - kFixedStep);
+        if (clownRespawnTimer <= 0.0f) {
+          clownAlive = true;
+          clown.position = clownStartPosition;
+          clown.velocity = glm::vec3(0.0f);
+          clown.onGround = true;
+        }
+      }
+      if (!mummyAlive) {
+        mummyRespawnTimer = glm::max(0.0f, mummyRespawnTimer - kFixedStep);
+        if (mummyRespawnTimer <= 0.0f) {
+          mummyAlive = true;
+          mummy.position = mummyStartPosition;
+          mummy.velocity = glm::vec3(0.0f);
+          mummy.onGround = true;
         }
       }
-    }
-
-    glm::vec3 chaseDir = aiTarget - clown.position;
-    chaseDir.y = 0.0f;
-    if (glm::length(chaseDir) > 0.001f) {
-      chaseDir = glm::normalize(chaseDir);
-    }
-
-    const float closeRange = 4.5f * kMapScale;
-    const float speedRamp = 1.0f + glm::clamp((closeRange - playerDistance) / closeRange, 0.0f, 1.0f) * 0.6f;
-    const float adaptiveSpeedBoost = 1.0f + levelThreat * 0.3f;
-    const float clownChaseSpeed = clown.speed * enemySpeedScale * speedRamp * 1.15f * adaptiveSpeedBoost;
-    if (clownStunTimer > 0.0f) {
-      clown.velocity.x = 0.0f;
-      clown.velocity.z = 0.0f;
-    } else if (clownAiState == ClownAiState::Windup) {
-      clown.velocity.x = 0.0f;
-      clown.velocity.z = 0.0f;
-      clownJumpWindup = glm::max(0.0f, clownJumpWindup - deltaTime);
-    } else if (clownAiState == ClownAiState::Chase) {
-      clown.velocity.x = chaseDir.x * clownChaseSpeed;
-      clown.velocity.z = chaseDir.z * clownChaseSpeed;
-    } else {
-      clown.velocity.x = chaseDir.x * clown.speed * enemySpeedScale * 0.45f;
-      clown.velocity.z = chaseDir.z * clown.speed * enemySpeedScale * 0.45f;
-    }
-    clown.velocity.y += gravity * deltaTime;
 
-    if (clown.jumpCooldown > 0.0f) {
-      clown.jumpCooldown -= deltaTime;
-    }
+      if (currentLevel == GameLevel::Level1Cats) {
+      if (clownAlive) {
+      const float enemyGround = platforms[0].position.y + platforms[0].halfExtents.y + clown.halfSize;
+      const float playerDistance = glm::length(player.position - clown.position);
+      const float aggroRange = 18.0f * aggroScale * kMapScale;
+      const bool hasLineOfSight = playerDistance < aggroRange;
+      const float levelThreat = glm::clamp(static_cast<float>(collectedCount) / 10.0f, 0.0f, 1.0f);
+      glm::vec3 aiTarget = player.position;
+
+      if (hasLineOfSight) {
+        clownAiState = ClownAiState::Chase;
+      } else if (clownAiState != ClownAiState::Windup) {
+        clownAiState = ClownAiState::Patrol;
+      }
 
-    const float playerHeightGap = player.position.y - clown.position.y;
-    const float playerHorizDist = glm::length(glm::vec2(player.position.x - clown.position.x,
-                                                       player.position.z - clown.position.z));
-    if (!hasWon && clown.onGround && clown.jumpCooldown <= 0.0f && clownAiState != ClownAiState::Windup &&
-      clownStunTimer <= 0.0f && playerHeightGap > 0.2f && playerHorizDist < 6.5f * kMapScale) {
-      clownAiState = ClownAiState::Windup;
-      clownJumpWindup = 0.18f * enemyCooldownScale;
-    }
+      if (hasLineOfSight && player.position.y > clown.position.y + 0.6f) {
+        float bestScore = 1e9f;
+        for (const Platform& platform : platforms) {
+          const float platformTop = platform.position.y + platform.halfExtents.y + clown.halfSize;
+          if (platformTop > clown.position.y + 0.4f && platformTop <= player.position.y + 0.3f) {
+            const float distToPlayer = glm::length(glm::vec2(platform.position.x - player.position.x,
+                                                             platform.position.z - player.position.z));
+            const float distToClown = glm::length(glm::vec2(platform.position.x - clown.position.x,
+                                                            platform.position.z - clown.position.z));
+            const float score = distToPlayer + distToClown * 0.4f + std::abs(platformTop - player.position.y);
+            if (score < bestScore) {
+              bestScore = score;
+              aiTarget = glm::vec3(platform.position.x, platformTop, platform.position.z);
+            }
+          }
+        }
+      }
 
-    if (clownAiState == ClownAiState::Windup && clownJumpWindup <= 0.0f && clown.onGround) {
-      const float jumpHeight = glm::clamp(playerHeightGap + 0.4f, 0.8f, 2.4f);
-      const float jumpVelocity = std::sqrt(2.0f * -gravity * jumpHeight);
-      clown.velocity.y = jumpVelocity;
-      clown.jumpCooldown = (0.45f - levelThreat * 0.12f) * enemyCooldownScale;
-      clownAiState = ClownAiState::Chase;
-    }
+      glm::vec3 chaseDir = aiTarget - clown.position;
+      chaseDir.y = 0.0f;
+      if (glm::length(chaseDir) > 0.001f) {
+        chaseDir = glm::normalize(chaseDir);
+      }
 
-    if (audio.ready) {
-      footstepTimer -= deltaTime;
-      const float playerSpeed = glm::length(glm::vec2(player.velocity.x, player.velocity.z));
-      if (player.onGround && playerSpeed > 0.2f && footstepTimer <= 0.0f) {
-        PlaySound(audio.footstep);
-        footstepTimer = 0.35f - glm::clamp(playerSpeed / (moveSpeed * sprintMultiplier), 0.0f, 1.0f) * 0.15f;
+      const float closeRange = 4.5f * kMapScale;
+      const float speedRamp = 1.0f + glm::clamp((closeRange - playerDistance) / closeRange, 0.0f, 1.0f) * 0.6f;
+      const float adaptiveSpeedBoost = 1.0f + levelThreat * 0.3f;
+      const float clownChaseSpeed = clown.speed * enemySpeedScale * speedRamp * 1.15f * adaptiveSpeedBoost;
+      if (clownStunTimer > 0.0f) {
+        clown.velocity.x = 0.0f;
+        clown.velocity.z = 0.0f;
+      } else if (clownAiState == ClownAiState::Windup) {
+        clown.velocity.x = 0.0f;
+        clown.velocity.z = 0.0f;
+        clownJumpWindup = glm::max(0.0f, clownJumpWindup - kFixedStep);
+      } else if (clownAiState == ClownAiState::Chase) {
+        clown.velocity.x = chaseDir.x * clownChaseSpeed;
+        clown.velocity.z = chaseDir.z * clownChaseSpeed;
+      } else {
+        clown.velocity.x = chaseDir.x * clown.speed * enemySpeedScale * 0.45f;
+        clown.velocity.z = chaseDir.z * clown.speed * enemySpeedScale * 0.45f;
       }
+      clown.velocity.y += gravity * kFixedStep;
 
-      if (!wasPlayerOnGround && player.onGround) {
-        PlaySound(audio.land);
+      if (clown.jumpCooldown > 0.0f) {
+        clown.jumpCooldown -= kFixedStep;
       }
-      wasPlayerOnGround = player.onGround;
 
-      if (!wasClownOnGround && clown.onGround) {
-        PlaySound(audio.land);
+      const float playerHeightGap = player.position.y - clown.position.y;
+      const float playerHorizDist = glm::length(glm::vec2(player.position.x - clown.position.x,
+                                                         player.position.z - clown.position.z));
+      if (!hasWon && clown.onGround && clown.jumpCooldown <= 0.0f && clownAiState != ClownAiState::Windup &&
+        clownStunTimer <= 0.0f && playerHeightGap > 0.2f && playerHorizDist < 6.5f * kMapScale) {
+        clownAiState = ClownAiState::Windup;
+        clownJumpWindup = 0.18f * enemyCooldownScale;
       }
-      wasClownOnGround = clown.onGround;
 
-      chaseTimer -= deltaTime;
-      if (playerDistance < 5.5f * kMapScale && chaseTimer <= 0.0f) {
-        PlaySound(audio.chase);
-        chaseTimer = 2.5f;
+      if (clownAiState == ClownAiState::Windup && clownJumpWindup <= 0.0f && clown.onGround) {
+        const float jumpHeight = glm::clamp(playerHeightGap + 0.4f, 0.8f, 2.4f);
+        const float jumpVelocity = std::sqrt(2.0f * -gravity * jumpHeight);
+        clown.velocity.y = jumpVelocity;
+        clown.jumpCooldown = (0.45f - levelThreat * 0.12f) * enemyCooldownScale;
+        clownAiState = ClownAiState::Chase;
       }
-    }
 
-    if (hasWon) {
-      clown.velocity.x = 0.0f;
-      clown.velocity.z = 0.0f;
-    }
+      if (audio.ready) {
+        footstepTimer -= kFixedStep;
+        const float playerSpeed = glm::length(glm::vec2(player.velocity.x, player.velocity.z));
+        if (player.onGround && playerSpeed > 0.2f && footstepTimer <= 0.0f) {
+          PlaySound(audio.footstep);
+          footstepTimer = 0.35f - glm::clamp(playerSpeed / (moveSpeed * sprintMultiplier), 0.0f, 1.0f) * 0.15f;
+        }
 
-    clown.position += clown.velocity * deltaTime;
+        if (!wasPlayerOnGround && player.onGround) {
+          PlaySoundAt(audio.land, player.position, audio.listener);
+        }
+        wasPlayerOnGround = player.onGround;
 
-    clown.onGround = false;
-    if (clown.position.y < enemyGround) {
-      clown.position.y = enemyGround;
-      clown.velocity.y = 0.0f;
-      clown.onGround = true;
-    }
+        if (!wasClownOnGround && clown.onGround) {
+          PlaySoundAt(audio.land, clown.position, audio.listener);
+        }
+        wasClownOnGround = clown.onGround;
 
-    for (size_t i = 1; i < platforms.size(); ++i) {
-      const Platform& platform = platforms[i];
-      const float platformTop = platform.position.y + platform.halfExtents.y;
-      const bool withinX = std::abs(clown.position.x - platform.position.x) <= (platform.halfExtents.x + clown.halfSize);
-      const bool withinZ = std::abs(clown.position.z - platform.position.z) <= (platform.halfExtents.z + clown.halfSize);
-      const bool falling = clown.velocity.y <= 0.0f;
-      if (withinX && withinZ && falling) {
-        const float clownBottom = clown.position.y - clown.halfSize;
-        if (clownBottom < platformTop && clown.position.y > platformTop - 0.6f) {
-          clown.position.y = platformTop + clown.halfSize;
-          clown.velocity.y = 0.0f;
-          clown.onGround = true;
+        chaseTimer -= kFixedStep;
+        if (playerDistance < 5.5f * kMapScale && chaseTimer <= 0.0f) {
+          PlaySound(audio.chase);
+          chaseTimer = 2.5f;
         }
       }
-    }
 
-    const float hitDistance = player.halfSize + clown.halfSize + 0.1f;
-    if (glm::distance(player.position, clown.position) < hitDistance) {
-      LoseLife(true, false);
-      clown.position = clownStartPosition;
-      clown.velocity = glm::vec3(0.0f);
-      clown.onGround = true;
-    }
-    } else {
-      clown.velocity = glm::vec3(0.0f);
-    }
+      if (hasWon) {
+        clown.velocity.x = 0.0f;
+        clown.velocity.z = 0.0f;
+      }
 
-      collectedCount = 0;
-    for (Cat& cat : cats) {
-      if (!cat.collected && glm::distance(player.position, cat.position) < 1.2f) {
-        cat.collected = true;
-        cat.behavior = Cat::Behavior::Following;
-        cat.behaviorTimer = 0.0f;
+      clown.position += clown.velocity * kFixedStep;
+
+      clown.onGround = false;
+      if (clown.position.y < enemyGround) {
+        clown.position.y = enemyGround;
+        clown.velocity.y = 0.0f;
+        clown.onGround = true;
       }
-      if (cat.collected) {
-        collectedCount++;
+
+      for (const std::uint32_t i : platformGrid.Near(clown.position)) {
+        const Platform& platform = platforms[i];
+        const float platformTop = platform.position.y + platform.halfExtents.y;
+        const bool withinX = std::abs(clown.position.x - platform.position.x) <= (platform.halfExtents.x + clown.halfSize);
+        const bool withinZ = std::abs(clown.position.z - platform.position.z) <= (platform.halfExtents.z + clown.halfSize);
+        const bool falling = clown.velocity.y <= 0.0f;
+        if (withinX && withinZ && falling) {
+          const float clownBottom = clown.position.y - clown.halfSize;
+          if (clownBottom < platformTop && clown.position.y > platformTop - 0.6f) {
+            clown.position.y = platformTop + clown.halfSize;
+            clown.velocity.y = 0.0f;
+            clown.onGround = true;
+          }
+        }
       }
-    }
 
-    // Update cat AI and physics
-    for (size_t catIdx = 0; catIdx < cats.size(); ++catIdx) {
-      Cat& cat = cats[catIdx];
-      cat.behaviorTimer -= deltaTime;
-      cat.idleAnimTimer -= deltaTime;
-      if (cat.idleAnim != Cat::IdleAnim::None) {
-        cat.idleAnimPhase += deltaTime;
-        if (cat.idleAnimTimer <= 0.0f) {
-          cat.idleAnim = Cat::IdleAnim::None;
-          cat.idleAnimPhase = 0.0f;
-          cat.groomTarget = -1;
-          cat.rollHold = 0.0f;
+      const float hitDistance = player.halfSize + clown.halfSize + 0.1f;
+      if (glm::distance(player.position, clown.position) < hitDistance) {
+        LoseLife(true, false);
+        clown.position = clownStartPosition;
+        clown.velocity = glm::vec3(0.0f);
+        clown.onGround = true;
+      }
+      } else {
+        clown.velocity = glm::vec3(0.0f);
+      }
+
+        collectedCount = 0;
+      for (size_t catIdx = 0; catIdx < cats.size(); ++catIdx) {
+        Cat& cat = cats[catIdx];
+        if (!cat.collected && glm::distance(player.position, catBodies.Position(catIdx)) < 1.2f) {
+          cat.collected = true;
+          cat.behavior = Cat::Behavior::Following;
+          cat.behaviorTimer = 0.0f;
+        }
+        if (cat.collected) {
+          collectedCount++;
         }
       }
-      
-      // Apply gravity
+
+      // Update cat AI and physics. The AI pass leaves a desired velocity in catBodies;
+      // steering, integration, gravity and the ground clamp then run as a second pass.
       const float catGravity = -18.0f;
-      cat.velocity.y += catGravity * deltaTime;
-      
-      // Ground collision
       const float catRadius = 0.3f;
-      if (cat.position.y - catRadius < 0.0f) {
-        cat.position.y = catRadius;
-        cat.velocity.y = 0.0f;
+      // Cats update in parallel against catViews, a copy of what they can see of each other
+      // taken before the pass, and a groom's effect on its target waits in groomContacts
+      // until the pass is over, so no cat writes another while the jobs run.
+      catViews.resize(cats.size());
+      groomContacts.assign(cats.size(), GroomContact{});
+      for (size_t i = 0; i < cats.size(); ++i) {
+        catViews[i] = {catBodies.Position(i), catBodies.Velocity(i), cats[i].asleep};
       }
+      auto UpdateCatAi = [&](size_t catIdx) {
+        Cat& cat = cats[catIdx];
+        // Cats in sleeping chunks stand idle until a player comes near; followers never sleep.
+        if (!cat.collected && !chunkStreamer.Awake(catBodies.Position(catIdx))) {
+          if (!cat.asleep) {
+            cat.asleep = true;
+            cat.behavior = Cat::Behavior::Idle;
+            cat.idleAnim = Cat::IdleAnim::None;
+            cat.idleAnimPhase = 0.0f;
+            cat.groomTarget = -1;
+            catBodies.SetVelocity(catIdx, glm::vec3(0.0f));
+          }
+          catBodies.Sleep(catIdx);
+          return;
+        }
+        cat.asleep = false;
+        cat.behaviorTimer -= kFixedStep;
+        cat.idleAnimTimer -= kFixedStep;
+        if (cat.idleAnim != Cat::IdleAnim::None) {
+          cat.idleAnimPhase += kFixedStep;
+          if (cat.idleAnimTimer <= 0.0f) {
+            cat.idleAnim = Cat::IdleAnim::None;
+            cat.idleAnimPhase = 0.0f;
+            cat.groomTarget = -1;
+            cat.rollHold = 0.0f;
+          }
+        }
       
-      // Platform collision
-      for (size_t i = 1; i < platforms.size(); ++i) {
-        const Platform& platform = platforms[i];
-        const float platformTop = platform.position.y + platform.halfExtents.y;
-        const bool withinX = std::abs(cat.position.x - platform.position.x) <= (platform.halfExtents.x + catRadius);
-        const bool withinZ = std::abs(cat.position.z - platform.position.z) <= (platform.halfExtents.z + catRadius);
-        const bool falling = cat.velocity.y <= 0.0f;
-        if (withinX && withinZ && falling) {
-          const float catBottom = cat.position.y - catRadius;
-          if (catBottom < platformTop && cat.position.y > platformTop - 0.6f) {
-            cat.position.y = platformTop + catRadius;
-            cat.velocity.y = 0.0f;
+        // Platform collision
+        float& catY = catBodies.py[catIdx];
+        for (const std::uint32_t i : platformGrid.Near(catBodies.Position(catIdx))) {
+          const Platform& platform = platforms[i];
+          const float platformTop = platform.position.y + platform.halfExtents.y;
+          const bool withinX = std::abs(catBodies.px[catIdx] - platform.position.x) <= (platform.halfExtents.x + catRadius);
+          const bool withinZ = std::abs(catBodies.pz[catIdx] - platform.position.z) <= (platform.halfExtents.z + catRadius);
+          const bool falling = catBodies.vy[catIdx] <= 0.0f;
+          if (withinX && withinZ && falling) {
+            const float catBottom = catY - catRadius;
+            if (catBottom < platformTop && catY > platformTop - 0.6f) {
+              catY = platformTop + catRadius;
+              catBodies.vy[catIdx] = 0.0f;
+            }
           }
         }
-      }
+        const glm::vec3 catPosition = catBodies.Position(catIdx);
+        const glm::vec3 catVelocity = catBodies.Velocity(catIdx);
       
-      glm::vec3 desiredVelocity(0.0f);
-      float distToTarget = 999.0f;
-      const float playerDist2D = glm::length(glm::vec2(player.position.x - cat.position.x,
-                                                       player.position.z - cat.position.z));
+        glm::vec3 desiredVelocity(0.0f);
+        float distToTarget = 999.0f;
+        const float playerDist2D = glm::length(glm::vec2(player.position.x - catPosition.x,
+                                                         player.position.z - catPosition.z));
       
-      if (cat.collected) {
-        // Following AI - move toward area around player
-        if (cat.behaviorTimer <= 0.0f || playerDist2D > 5.5f) {
-          // Pick new target near player
-          const float angle = RandomFloat(cat.seed) * 6.28318f;
-          const float radius = (playerDist2D > 5.5f) ? 0.6f : (1.6f + RandomFloat(cat.seed) * 1.8f);
-          cat.wanderTarget = player.position + glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
-          cat.behaviorTimer = (playerDist2D > 5.5f) ? 0.5f : (1.4f + RandomFloat(cat.seed) * 1.6f);
-        }
-        
-        const glm::vec3 toTarget = cat.wanderTarget - cat.position;
-        distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
-        
-        if (distToTarget > 0.35f) {
-          const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
-          const float catchup = glm::clamp((playerDist2D - 2.5f) / 6.0f, 0.0f, 1.0f);
-          const float targetSpeed = cat.moveSpeed * (1.0f + catchup * 1.2f);
-          desiredVelocity = dir * targetSpeed;
-          
-          // Update facing
-          const float targetFacing = std::atan2(dir.x, dir.z);
-          float facingDiff = targetFacing - cat.facing;
-          while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
-          while (facingDiff < -3.14159f) facingDiff += 6.28318f;
-          cat.facing += facingDiff * cat.turnSpeed * deltaTime;
-        }
-      } else {
-        // Wandering AI - explore randomly
-        if (cat.behaviorTimer <= 0.0f) {
-          const float roll = RandomFloat(cat.seed);
-          if (roll < 0.4f) {
-            // Idle
-            cat.behavior = Cat::Behavior::Idle;
-            cat.behaviorTimer = 1.0f + RandomFloat(cat.seed) * 2.0f;
-          } else {
-            // Wander
-            cat.behavior = Cat::Behavior::Wandering;
+        if (cat.collected) {
+          // Following AI - move toward area around player
+          if (cat.behaviorTimer <= 0.0f || playerDist2D > 5.5f) {
+            // Pick new target near player
             const float angle = RandomFloat(cat.seed) * 6.28318f;
-            const float dist = 2.0f + RandomFloat(cat.seed) * 4.0f;
-            cat.wanderTarget = cat.position + glm::vec3(std::cos(angle) * dist, 0.0f, std::sin(angle) * dist);
-            cat.behaviorTimer = 2.0f + RandomFloat(cat.seed) * 3.0f;
+            const float radius = (playerDist2D > 5.5f) ? 0.6f : (1.6f + RandomFloat(cat.seed) * 1.8f);
+            cat.wanderTarget = player.position + glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
+            cat.behaviorTimer = (playerDist2D > 5.5f) ? 0.5f : (1.4f + RandomFloat(cat.seed) * 1.6f);
           }
-        }
         
-        if (cat.behavior == Cat::Behavior::Wandering) {
-          const glm::vec3 toTarget = cat.wanderTarget - cat.position;
+          const glm::vec3 toTarget = cat.wanderTarget - catPosition;
           distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
-          
-          if (distToTarget > 0.5f) {
+        
+          if (distToTarget > 0.35f) {
             const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
-            desiredVelocity = dir * (cat.moveSpeed * 0.5f); // Slower when wandering
-            
+            const float catchup = glm::clamp((playerDist2D - 2.5f) / 6.0f, 0.0f, 1.0f);
+            const float targetSpeed = cat.moveSpeed * (1.0f + catchup * 1.2f);
+            desiredVelocity = dir * targetSpeed;
+          
+            // Update facing
             const float targetFacing = std::atan2(dir.x, dir.z);
             float facingDiff = targetFacing - cat.facing;
             while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
             while (facingDiff < -3.14159f) facingDiff += 6.28318f;
-            cat.facing += facingDiff * cat.turnSpeed * deltaTime;
-          } else {
-            cat.behavior = Cat::Behavior::Idle;
-            cat.behaviorTimer = 1.0f + RandomFloat(cat.seed) * 2.0f;
+            cat.facing += facingDiff * cat.turnSpeed * kFixedStep;
+          }
+        } else {
+          // Wandering AI - explore randomly
+          if (cat.behaviorTimer <= 0.0f) {
+            const float roll = RandomFloat(cat.seed);
+            if (roll < 0.4f) {
+              // Idle
+              cat.behavior = Cat::Behavior::Idle;
+              cat.behaviorTimer = 1.0f + RandomFloat(cat.seed) * 2.0f;
+            } else {
+              // Wander
+              cat.behavior = Cat::Behavior::Wandering;
+              const float angle = RandomFloat(cat.seed) * 6.28318f;
+              const float dist = 2.0f + RandomFloat(cat.seed) * 4.0f;
+              cat.wanderTarget = catPosition + glm::vec3(std::cos(angle) * dist, 0.0f, std::sin(angle) * dist);
+              cat.behaviorTimer = 2.0f + RandomFloat(cat.seed) * 3.0f;
+            }
+          }
+        
+          if (cat.behavior == Cat::Behavior::Wandering) {
+            const glm::vec3 toTarget = cat.wanderTarget - catPosition;
+            distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
+          
+            if (distToTarget > 0.5f) {
+              const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
+              desiredVelocity = dir * (cat.moveSpeed * 0.5f); // Slower when wandering
+            
+              const float targetFacing = std::atan2(dir.x, dir.z);
+              float facingDiff = targetFacing - cat.facing;
+              while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
+              while (facingDiff < -3.14159f) facingDiff += 6.28318f;
+              cat.facing += facingDiff * cat.turnSpeed * kFixedStep;
+            } else {
+              cat.behavior = Cat::Behavior::Idle;
+              cat.behaviorTimer = 1.0f + RandomFloat(cat.seed) * 2.0f;
+            }
           }
         }
-      }
 
-      const float speed2D = glm::length(glm::vec2(cat.velocity.x, cat.velocity.z));
-      const bool canIdle = speed2D < 0.15f && cat.velocity.y == 0.0f &&
-                           ((cat.collected && playerDist2D < 2.8f && distToTarget < 0.6f) ||
-                            (!cat.collected && cat.behavior == Cat::Behavior::Idle));
-      if (glm::length(glm::vec2(desiredVelocity.x, desiredVelocity.z)) > 0.2f) {
-        cat.idleAnim = Cat::IdleAnim::None;
-        cat.idleAnimTimer = 0.2f;
-        cat.idleAnimPhase = 0.0f;
-        cat.groomTarget = -1;
-        cat.rollHold = 0.0f;
-      } else if (canIdle && cat.idleAnim == Cat::IdleAnim::None && cat.idleAnimTimer <= 0.0f) {
-        const float roll = RandomFloat(cat.seed);
-        if (roll < 0.28f) {
-          cat.idleAnim = Cat::IdleAnim::Groom;
-          cat.idleAnimTimer = 12.0f + RandomFloat(cat.seed) * 18.0f;
+        const float speed2D = glm::length(glm::vec2(catVelocity.x, catVelocity.z));
+        const bool canIdle = speed2D < 0.15f && catVelocity.y == 0.0f &&
+                             ((cat.collected && playerDist2D < 2.8f && distToTarget < 0.6f) ||
+                              (!cat.collected && cat.behavior == Cat::Behavior::Idle));
+        if (glm::length(glm::vec2(desiredVelocity.x, desiredVelocity.z)) > 0.2f) {
+          cat.idleAnim = Cat::IdleAnim::None;
+          cat.idleAnimTimer = 0.2f;
+          cat.idleAnimPhase = 0.0f;
           cat.groomTarget = -1;
-          float nearestDist = 999.0f;
-          for (size_t otherIdx = 0; otherIdx < cats.size(); ++otherIdx) {
-            if (otherIdx == catIdx) {
-              continue;
-            }
-            const Cat& other = cats[otherIdx];
-            const float otherSpeed = glm::length(glm::vec2(other.velocity.x, other.velocity.z));
-            const float dist = glm::length(glm::vec2(other.position.x - cat.position.x,
-                                                      other.position.z - cat.position.z));
-            if (otherSpeed < 0.2f && dist < 1.4f && dist < nearestDist) {
-              nearestDist = dist;
-              cat.groomTarget = static_cast<int>(otherIdx);
-            }
+          cat.rollHold = 0.0f;
+        } else if (canIdle && cat.idleAnim == Cat::IdleAnim::None && cat.idleAnimTimer <= 0.0f) {
+          const float roll = RandomFloat(cat.seed);
+          if (roll < 0.28f) {
+            cat.idleAnim = Cat::IdleAnim::Groom;
+            cat.idleAnimTimer = 12.0f + RandomFloat(cat.seed) * 18.0f;
+            cat.groomTarget = -1;
+            float nearestDist = 999.0f;
+            entityGrid.ForEachNear(EntityGrid::Kind::Cat, catPosition, 1.4f, [&](size_t otherIdx) {
+              if (otherIdx == catIdx || catViews[otherIdx].asleep) {
+                return;
+              }
+              const CatView& other = catViews[otherIdx];
+              const float otherSpeed = glm::length(glm::vec2(other.velocity.x, other.velocity.z));
+              const float dist = glm::length(glm::vec2(other.position.x - catPosition.x,
+                                                        other.position.z - catPosition.z));
+              if (otherSpeed < 0.2f && dist < 1.4f && dist < nearestDist) {
+                nearestDist = dist;
+                cat.groomTarget = static_cast<int>(otherIdx);
+              }
+            });
+          } else if (roll < 0.72f) {
+            cat.idleAnim = Cat::IdleAnim::Loaf;
+            cat.idleAnimTimer = 20.0f + RandomFloat(cat.seed) * 220.0f;
+          } else if (roll < 0.86f) {
+            cat.idleAnim = Cat::IdleAnim::Roll;
+            cat.rollHold = 4.0f + RandomFloat(cat.seed) * 4.0f;
+            cat.idleAnimTimer = 2.0f + cat.rollHold + 2.0f;
+          } else {
+            cat.idleAnimTimer = 1.0f + RandomFloat(cat.seed) * 1.5f;
           }
-        } else if (roll < 0.72f) {
-          cat.idleAnim = Cat::IdleAnim::Loaf;
-          cat.idleAnimTimer = 20.0f + RandomFloat(cat.seed) * 220.0f;
-        } else if (roll < 0.86f) {
-          cat.idleAnim = Cat::IdleAnim::Roll;
-          cat.rollHold = 4.0f + RandomFloat(cat.seed) * 4.0f;
-          cat.idleAnimTimer = 2.0f + cat.rollHold + 2.0f;
-        } else {
-          cat.idleAnimTimer = 1.0f + RandomFloat(cat.seed) * 1.5f;
+          cat.idleAnimPhase = 0.0f;
         }
-        cat.idleAnimPhase = 0.0f;
-      }
-
-      if (cat.idleAnim == Cat::IdleAnim::Groom && cat.groomTarget >= 0) {
-        const Cat& other = cats[static_cast<size_t>(cat.groomTarget)];
-        const glm::vec3 toOther = other.position - cat.position;
-        const float dist = glm::length(glm::vec2(toOther.x, toOther.z));
-        if (dist < 1.8f) {
-          const glm::vec3 dir = glm::normalize(glm::vec3(toOther.x, 0.0f, toOther.z));
-          const float targetFacing = std::atan2(dir.x, dir.z);
-          float facingDiff = targetFacing - cat.facing;
-          while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
-          while (facingDiff < -3.14159f) facingDiff += 6.28318f;
-          cat.facing += facingDiff * cat.turnSpeed * deltaTime;
-          Cat& otherCat = cats[static_cast<size_t>(cat.groomTarget)];
-          const float otherSpeed = glm::length(glm::vec2(otherCat.velocity.x, otherCat.velocity.z));
-          if (otherSpeed < 0.2f && otherCat.velocity.y == 0.0f) {
-            if (otherCat.idleAnim != Cat::IdleAnim::Groomed) {
-              otherCat.idleAnimPhase = 0.0f;
-            }
-            otherCat.idleAnim = Cat::IdleAnim::Groomed;
-            otherCat.idleAnimTimer = 1.2f;
-            const float otherFacing = std::atan2(-dir.x, -dir.z);
-            float otherDiff = otherFacing - otherCat.facing;
-            while (otherDiff > 3.14159f) otherDiff -= 6.28318f;
-            while (otherDiff < -3.14159f) otherDiff += 6.28318f;
-            otherCat.facing += otherDiff * otherCat.turnSpeed * deltaTime;
+
+        if (cat.idleAnim == Cat::IdleAnim::Groom && cat.groomTarget >= 0) {
+          const CatView& other = catViews[static_cast<size_t>(cat.groomTarget)];
+          const glm::vec3 toOther = other.position - catPosition;
+          const float dist = glm::length(glm::vec2(toOther.x, toOther.z));
+          if (dist < 1.8f) {
+            const glm::vec3 dir = glm::normalize(glm::vec3(toOther.x, 0.0f, toOther.z));
+            const float targetFacing = std::atan2(dir.x, dir.z);
+            float facingDiff = targetFacing - cat.facing;
+            while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
+            while (facingDiff < -3.14159f) facingDiff += 6.28318f;
+            cat.facing += facingDiff * cat.turnSpeed * kFixedStep;
+            groomContacts[catIdx] = {cat.groomTarget, dir};
+          } else {
+            cat.groomTarget = -1;
           }
-        } else {
-          cat.groomTarget = -1;
         }
-      }
-      
-      // Apply horizontal movement with smooth acceleration
-      const float accel = (cat.collected ? 18.0f : 12.0f) * deltaTime;
-      cat.velocity.x = glm::mix(cat.velocity.x, desiredVelocity.x, accel);
-      cat.velocity.z = glm::mix(cat.velocity.z, desiredVelocity.z, accel);
       
-      // Update walk cycle
-      const float speed = glm::length(glm::vec2(cat.velocity.x, cat.velocity.z));
-      cat.walkCycle += speed * deltaTime * 3.0f;
-      
-      // Apply velocity
-      cat.position += cat.velocity * deltaTime;
-    }
-
-      if (!levelOneAnnounced && collectedCount >= 10 && glm::distance(player.position, carPositionLevel1) < 2.2f) {
-        levelOneAnnounced = true;
-        currentLevel = GameLevel::Level2Dogs;
-        livesRemaining = kDifficultyLives[difficultyIndex];
-        lifeHitCooldown = 0.0f;
-        player.position = levelTwoSpawn;
-        player.velocity = glm::vec3(0.0f);
-        clown.velocity = glm::vec3(0.0f);
-        mummy.position = mummyStartPosition;
-        mummy.velocity = glm::vec3(0.0f);
-        mummyThrowCooldown = 1.25f * enemyCooldownScale;
-        for (Bomb& bomb : bombs) {
-          bomb.active = false;
+        // Horizontal movement eases toward the desired velocity
+        catBodies.Steer(catIdx, desiredVelocity, (cat.collected ? 18.0f : 12.0f) * kFixedStep, kFixedStep);
+      };
+      jobs.ParallelFor(catAiCost, cats.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t catIdx = begin; catIdx < end; ++catIdx) {
+          UpdateCatAi(catIdx);
+        }
+      });
+      for (const GroomContact& contact : groomContacts) {
+        if (contact.target < 0) {
+          continue;
+        }
+        const size_t otherIdx = static_cast<size_t>(contact.target);
+        Cat& otherCat = cats[otherIdx];
+        const float otherSpeed = glm::length(glm::vec2(catBodies.vx[otherIdx], catBodies.vz[otherIdx]));
+        if (otherSpeed < 0.2f && catBodies.vy[otherIdx] == 0.0f) {
+          if (otherCat.idleAnim != Cat::IdleAnim::Groomed) {
+            otherCat.idleAnimPhase = 0.0f;
+          }
+          otherCat.idleAnim = Cat::IdleAnim::Groomed;
+          otherCat.idleAnimTimer = 1.2f;
+          const float otherFacing = std::atan2(-contact.direction.x, -contact.direction.z);
+          float otherDiff = otherFacing - otherCat.facing;
+          while (otherDiff > 3.14159f) otherDiff -= 6.28318f;
+          while (otherDiff < -3.14159f) otherDiff += 6.28318f;
+          otherCat.facing += otherDiff * otherCat.turnSpeed * kFixedStep;
         }
-        levelStartTime = currentTime;
-        levelMedal.clear();
-        glfwSetWindowTitle(window, "Vibe 3D - Level 2: Rescue the Dogs");
-        std::cout << "Level 2 unlocked! Collect 20 dogs and escape the mummy.\n";
       }
-    } else {
-      if (mummyAlive) {
-      const float enemyGround = platforms[0].position.y + platforms[0].halfExtents.y + mummy.halfSize;
-      const glm::vec3 toPlayer = player.position - mummy.position;
-      glm::vec3 moveDir(toPlayer.x, 0.0f, toPlayer.z);
-      if (glm::length(moveDir) > 0.001f) {
-        moveDir = glm::normalize(moveDir);
-      }
-
-      const float desiredDistance = 8.0f * kMapScale;
-      const float dist2D = glm::length(glm::vec2(toPlayer.x, toPlayer.z));
-      const float approach = glm::clamp((dist2D - desiredDistance) / 6.0f, -1.0f, 1.0f);
-      if (mummyStunTimer > 0.0f) {
-        mummy.velocity.x = 0.0f;
-        mummy.velocity.z = 0.0f;
+
+      // The physics jobs split catBodies by whole Float4 groups. Sleeping cats and the tail
+      // lanes have a zero step, so the packed passes leave them as they are.
+      jobs.ParallelFor(catPhysicsCost, catBodies.Lanes() / Float4::kWidth, [&](size_t begin, size_t end, size_t) {
+        const size_t first = begin * Float4::kWidth;
+        const size_t last = end * Float4::kWidth;
+        SteerAndIntegrateBodies(catBodies, first, last, 3.0f);
+        // Gravity and the ground clamp land here rather than at the top of the next step;
+        // the cyclic order of the passes is unchanged.
+        ApplyBodyGravity(catBodies, first, last, catGravity);
+        for (size_t catIdx = first; catIdx < std::min(last, cats.size()); ++catIdx) {
+          if (!cats[catIdx].asleep) {
+            ClampBodyToFloor(catBodies, catIdx, catRadius);
+          }
+        }
+      });
+
+        if (!levelOneAnnounced && collectedCount >= 10 && glm::distance(player.position, carPositionLevel1) < 2.2f) {
+          levelOneAnnounced = true;
+          currentLevel = GameLevel::Level2Dogs;
+          livesRemaining = kDifficultyLives[difficultyIndex];
+          lifeHitCooldown = 0.0f;
+          player.position = levelTwoSpawn;
+          player.velocity = glm::vec3(0.0f);
+          clown.velocity = glm::vec3(0.0f);
+          mummy.position = mummyStartPosition;
+          mummy.velocity = glm::vec3(0.0f);
+          mummyThrowCooldown = 1.25f * enemyCooldownScale;
+          bombs.Clear();
+          levelStartTime = currentTime;
+          levelMedal.clear();
+          SetWindowTitle("Vibe 3D - Level 2: Rescue the Dogs");
+          std::cout << "Level 2 unlocked! Collect 20 dogs and escape the mummy.\n";
+        }
       } else {
-        mummy.velocity.x = moveDir.x * mummy.speed * enemySpeedScale * approach;
-        mummy.velocity.z = moveDir.z * mummy.speed * enemySpeedScale * approach;
-      }
-      mummy.velocity.y += gravity * deltaTime;
-      mummy.position += mummy.velocity * deltaTime;
+        if (mummyAlive) {
+        const float enemyGround = platforms[0].position.y + platforms[0].halfExtents.y + mummy.halfSize;
+        const glm::vec3 toPlayer = player.position - mummy.position;
+        glm::vec3 moveDir(toPlayer.x, 0.0f, toPlayer.z);
+        if (glm::length(moveDir) > 0.001f) {
+          moveDir = glm::normalize(moveDir);
+        }
 
-      mummy.onGround = false;
-      if (mummy.position.y < enemyGround) {
-        mummy.position.y = enemyGround;
-        mummy.velocity.y = 0.0f;
-        mummy.onGround = true;
-      }
+        const float desiredDistance = 8.0f * kMapScale;
+        const float dist2D = glm::length(glm::vec2(toPlayer.x, toPlayer.z));
+        const float approach = glm::clamp((dist2D - desiredDistance) / 6.0f, -1.0f, 1.0f);
+        if (mummyStunTimer > 0.0f) {
+          mummy.velocity.x = 0.0f;
+          mummy.velocity.z = 0.0f;
+        } else {
+          mummy.velocity.x = moveDir.x * mummy.speed * enemySpeedScale * approach;
+          mummy.velocity.z = moveDir.z * mummy.speed * enemySpeedScale * approach;
+        }
+        mummy.velocity.y += gravity * kFixedStep;
+        mummy.position += mummy.velocity * kFixedStep;
+
+        mummy.onGround = false;
+        if (mummy.position.y < enemyGround) {
+          mummy.position.y = enemyGround;
+          mummy.velocity.y = 0.0f;
+          mummy.onGround = true;
+        }
 
-      for (size_t i = 1; i < platforms.size(); ++i) {
-        const Platform& platform = platforms[i];
-        const float platformTop = platform.position.y + platform.halfExtents.y;
-        const bool withinX = std::abs(mummy.position.x - platform.position.x) <= (platform.halfExtents.x + mummy.halfSize);
-        const bool withinZ = std::abs(mummy.position.z - platform.position.z) <= (platform.halfExtents.z + mummy.halfSize);
-        const bool falling = mummy.velocity.y <= 0.0f;
-        if (withinX && withinZ && falling) {
-          const float mummyBottom = mummy.position.y - mummy.halfSize;
-          if (mummyBottom < platformTop && mummy.position.y > platformTop - 0.6f) {
-            mummy.position.y = platformTop + mummy.halfSize;
-            mummy.velocity.y = 0.0f;
-            mummy.onGround = true;
+        for (const std::uint32_t i : platformGrid.Near(mummy.position)) {
+          const Platform& platform = platforms[i];
+          const float platformTop = platform.position.y + platform.halfExtents.y;
+          const bool withinX = std::abs(mummy.position.x - platform.position.x) <= (platform.halfExtents.x + mummy.halfSize);
+          const bool withinZ = std::abs(mummy.position.z - platform.position.z) <= (platform.halfExtents.z + mummy.halfSize);
+          const bool falling = mummy.velocity.y <= 0.0f;
+          if (withinX && withinZ && falling) {
+            const float mummyBottom = mummy.position.y - mummy.halfSize;
+            if (mummyBottom < platformTop && mummy.position.y > platformTop - 0.6f) {
+              mummy.position.y = platformTop + mummy.halfSize;
+              mummy.velocity.y = 0.0f;
+              mummy.onGround = true;
+            }
           }
         }
-      }
 
-      mummyThrowCooldown -= deltaTime;
-      if (mummyThrowCooldown <= (0.35f * enemyCooldownScale) && dist2D < 26.0f * kMapScale) {
-        mummyThrowTelegraph = glm::max(mummyThrowTelegraph, 0.25f);
-      }
-      mummyThrowTelegraph = glm::max(0.0f, mummyThrowTelegraph - deltaTime);
-      if (mummyThrowCooldown <= 0.0f && dist2D < 26.0f * kMapScale && mummyStunTimer <= 0.0f) {
-        for (Bomb& bomb : bombs) {
-          if (!bomb.active) {
-            bomb.active = true;
-            bomb.timer = 3.5f * enemyCooldownScale;
-            bomb.position = mummy.position + glm::vec3(0.0f, mummy.halfSize + 0.6f, 0.0f);
-            glm::vec3 throwDir = player.position - bomb.position;
+        mummyThrowCooldown -= kFixedStep;
+        if (mummyThrowCooldown <= (0.35f * enemyCooldownScale) && dist2D < 26.0f * kMapScale) {
+          mummyThrowTelegraph = glm::max(mummyThrowTelegraph, 0.25f);
+        }
+        mummyThrowTelegraph = glm::max(0.0f, mummyThrowTelegraph - kFixedStep);
+        if (mummyThrowCooldown <= 0.0f && dist2D < 26.0f * kMapScale && mummyStunTimer <= 0.0f) {
+          if (Bomb* bomb = bombs.Acquire()) {
+            bomb->timer = 3.5f * enemyCooldownScale;
+            bomb->position = mummy.position + glm::vec3(0.0f, mummy.halfSize + 0.6f, 0.0f);
+            glm::vec3 throwDir = player.position - bomb->position;
             throwDir.y = 0.0f;
             if (glm::length(throwDir) > 0.001f) {
               throwDir = glm::normalize(throwDir);
             }
-            bomb.velocity = throwDir * (7.5f + glm::clamp(dist2D / (16.0f * kMapScale), 0.0f, 1.2f)) * enemySpeedScale;
-            bomb.velocity.y = 6.2f * enemySpeedScale;
-            break;
+            bomb->velocity = throwDir * (7.5f + glm::clamp(dist2D / (16.0f * kMapScale), 0.0f, 1.2f)) * enemySpeedScale;
+            bomb->velocity.y = 6.2f * enemySpeedScale;
           }
+          const float rescuePressure = glm::clamp(static_cast<float>(collectedCount) / 20.0f, 0.0f, 1.0f);
+          mummyThrowCooldown = (1.1f - rescuePressure * 0.25f) * enemyCooldownScale;
         }
-        const float rescuePressure = glm::clamp(static_cast<float>(collectedCount) / 20.0f, 0.0f, 1.0f);
-        mummyThrowCooldown = (1.1f - rescuePressure * 0.25f) * enemyCooldownScale;
-      }
 
-      const float bombGravity = -16.0f;
-      const float blastRadius = 10.5f * blastRadiusScale;
-      const float groundTop = platforms[0].position.y + platforms[0].halfExtents.y;
+        const float bombGravity = -16.0f;
+        const float blastRadius = 10.5f * blastRadiusScale;
+        const float groundTop = platforms[0].position.y + platforms[0].halfExtents.y;
 
-      for (size_t i = 0; i < explosions.size();) {
-        explosions[i].age += deltaTime;
-        if (explosions[i].age >= explosions[i].duration) {
-          explosions[i] = explosions.back();
-          explosions.pop_back();
-        } else {
-          ++i;
-        }
-      }
+        explosions.ReleaseIf([&](Explosion& explosion) {
+          explosion.age += kFixedStep;
+          return explosion.age >= explosion.duration;
+        });
 
-      for (Bomb& bomb : bombs) {
-        if (!bomb.active) {
-          continue;
-        }
-        bomb.timer -= deltaTime;
-        bomb.velocity.y += bombGravity * deltaTime;
-        bomb.position += bomb.velocity * deltaTime;
-
-        bool exploded = false;
-        if (bomb.position.y <= groundTop + 0.25f) {
-          bomb.position.y = groundTop + 0.25f;
-          exploded = true;
-        }
-        if (bomb.timer <= 0.0f) {
-          exploded = true;
-        }
+        bombs.ReleaseIf([&](Bomb& bomb) {
+          bomb.velocity.y += bombGravity * kFixedStep;
+          bomb.position += bomb.velocity * kFixedStep;
+          bomb.timer -= kFixedStep;
 
-        if (exploded) {
-          Explosion explosion;
-          explosion.position = bomb.position;
-          explosion.age = 0.0f;
-          explosion.duration = 0.72f;
-          explosion.seed = bomb.position.x * 0.17f + bomb.position.z * 0.11f + currentTime * 0.9f;
-          explosions.push_back(explosion);
-          if (audio.ready) {
-            PlaySound(audio.explosion);
+          bool exploded = false;
+          if (bomb.position.y <= groundTop + 0.25f) {
+            bomb.position.y = groundTop + 0.25f;
+            exploded = true;
+          }
+          if (bomb.timer <= 0.0f) {
+            exploded = true;
           }
 
-          auto ApplyBlastImpulse = [&](glm::vec3& entityPos, glm::vec3& entityVel, float& blastTimer) {
-            const glm::vec3 delta = entityPos - bomb.position;
-            const float distance = glm::length(delta);
-            if (distance >= blastRadius) {
-              return false;
+          if (exploded) {
+            // A saturated explosion pool only drops the visual; the blast still lands.
+            if (Explosion* explosion = explosions.Acquire()) {
+              explosion->position = bomb.position;
+              explosion->duration = 0.72f;
+              explosion->seed = bomb.position.x * 0.17f + bomb.position.z * 0.11f + currentTime * 0.9f;
             }
-            glm::vec3 horizontal = glm::vec3(delta.x, 0.0f, delta.z);
-            float horizontalLen = glm::length(horizontal);
-            if (horizontalLen < 0.001f) {
-              horizontal = glm::vec3(1.0f, 0.0f, 0.35f);
-              horizontalLen = glm::length(horizontal);
+            if (audio.ready) {
+              PlaySoundAt(audio.explosion, bomb.position, audio.listener);
             }
-            horizontal /= horizontalLen;
-            const float falloff = glm::clamp(1.0f - (distance / blastRadius), 0.0f, 1.0f);
-            const float shaped = 0.45f + 0.55f * falloff;
-            const float horizontalImpulse = (52.0f * shaped + 18.0f) * blastImpulseScale;
-            const float verticalImpulse = (24.0f * shaped + 10.0f) * blastImpulseScale;
-            entityVel += horizontal * horizontalImpulse;
-            entityVel.y += verticalImpulse;
-            blastTimer = glm::max(blastTimer, 0.6f + falloff * 0.45f);
-            return true;
-          };
-
-          const bool playerBlasted = ApplyBlastImpulse(player.position, player.velocity, player.blastTimer);
-          if (playerBlasted) {
-            player.onGround = false;
-            LoseLife(false, true);
-          }
-          for (Dog& dog : dogs) {
-            const bool dogBlasted = ApplyBlastImpulse(dog.position, dog.velocity, dog.blastTimer);
-            if (dogBlasted) {
-              dog.onGround = false;
+
+            auto ApplyBlastImpulse = [&](const glm::vec3& entityPos, glm::vec3& entityVel, float& blastTimer) {
+              const glm::vec3 delta = entityPos - bomb.position;
+              const float distance = glm::length(delta);
+              if (distance >= blastRadius) {
+                return false;
+              }
+              glm::vec3 horizontal = glm::vec3(delta.x, 0.0f, delta.z);
+              float horizontalLen = glm::length(horizontal);
+              if (horizontalLen < 0.001f) {
+                horizontal = glm::vec3(1.0f, 0.0f, 0.35f);
+                horizontalLen = glm::length(horizontal);
+              }
+              horizontal /= horizontalLen;
+              const float falloff = glm::clamp(1.0f - (distance / blastRadius), 0.0f, 1.0f);
+              const float shaped = 0.45f + 0.55f * falloff;
+              const float horizontalImpulse = (52.0f * shaped + 18.0f) * blastImpulseScale;
+              const float verticalImpulse = (24.0f * shaped + 10.0f) * blastImpulseScale;
+              entityVel += horizontal * horizontalImpulse;
+              entityVel.y += verticalImpulse;
+              blastTimer = glm::max(blastTimer, 0.6f + falloff * 0.45f);
+              return true;
+            };
+
+            const bool playerBlasted = ApplyBlastImpulse(player.position, player.velocity, player.blastTimer);
+            if (playerBlasted) {
+              player.onGround = false;
+              LoseLife(false, true);
             }
+            entityGrid.ForEachNear(EntityGrid::Kind::Dog, bomb.position, blastRadius, [&](size_t dogIdx) {
+              Dog& dog = dogs[dogIdx];
+              glm::vec3 dogVelocity = dogBodies.Velocity(dogIdx);
+              const bool dogBlasted = ApplyBlastImpulse(dogBodies.Position(dogIdx), dogVelocity, dog.blastTimer);
+              if (dogBlasted) {
+                dogBodies.SetVelocity(dogIdx, dogVelocity);
+                dog.onGround = false;
+              }
+            });
           }
-          bomb.active = false;
-        }
-      }
-
-      } else {
-        mummy.velocity = glm::vec3(0.0f);
-        mummyThrowTelegraph = 0.0f;
-      }
+          return exploded;
+        });
 
-      const float dogRadius = 0.44f;
-      const float dogGround = platforms[0].position.y + platforms[0].halfExtents.y + dogRadius;
-      for (Dog& dog : dogs) {
-        if (dog.blastTimer > 0.0f) {
-          dog.blastTimer = glm::max(0.0f, dog.blastTimer - deltaTime);
-        }
-        dog.behaviorTimer -= deltaTime;
-        dog.velocity.y += gravity * deltaTime;
-
-        if (!dog.collected && glm::distance(player.position, dog.position) < 1.55f) {
-          dog.collected = true;
-          dog.behavior = Dog::Behavior::Following;
-          dog.behaviorTimer = 0.0f;
+        } else {
+          mummy.velocity = glm::vec3(0.0f);
+          mummyThrowTelegraph = 0.0f;
         }
 
-        glm::vec3 desiredVelocity(0.0f);
-        const float distToPlayer = glm::length(glm::vec2(player.position.x - dog.position.x,
-                                                          player.position.z - dog.position.z));
-
-        if (dog.collected) {
-          if (dog.behaviorTimer <= 0.0f || distToPlayer > 4.8f) {
-            const float angle = RandomFloat(dog.seed) * 6.28318f;
-            const float radius = (distToPlayer > 4.8f) ? 0.45f : (1.2f + RandomFloat(dog.seed) * 1.5f);
-            dog.wanderTarget = player.position + glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
-            dog.behaviorTimer = (distToPlayer > 4.8f) ? 0.35f : (0.9f + RandomFloat(dog.seed) * 1.4f);
-          }
-          const glm::vec3 toTarget = dog.wanderTarget - dog.position;
-          const float distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
-          if (distToTarget > 0.25f && !hasWon) {
-            const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
-            const float catchup = glm::clamp((distToPlayer - 2.0f) / 4.5f, 0.0f, 1.0f);
-            desiredVelocity = dir * dog.moveSpeed * (1.0f + catchup * 1.1f);
-            const float targetFacing = std::atan2(dir.x, dir.z);
-            float facingDiff = targetFacing - dog.facing;
-            while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
-            while (facingDiff < -3.14159f) facingDiff += 6.28318f;
-            dog.facing += facingDiff * dog.turnSpeed * deltaTime;
-          }
-        } else {
-          if (dog.behaviorTimer <= 0.0f) {
-            if (RandomFloat(dog.seed) < 0.45f) {
+        // Dogs follow the same split as cats: AI first, then a physics pass.
+        const float dogRadius = 0.44f;
+        const float dogGround = platforms[0].position.y + platforms[0].halfExtents.y + dogRadius;
+        // Dogs only read the player and their own state, so they split across jobs as they are.
+        auto UpdateDogAi = [&](size_t dogIdx) {
+          Dog& dog = dogs[dogIdx];
+          const glm::vec3 dogPosition = dogBodies.Position(dogIdx);
+          if (!dog.collected && !chunkStreamer.Awake(dogPosition)) {
+            if (!dog.asleep) {
+              dog.asleep = true;
               dog.behavior = Dog::Behavior::Idle;
-              dog.behaviorTimer = 0.8f + RandomFloat(dog.seed) * 1.6f;
-            } else {
-              dog.behavior = Dog::Behavior::Wandering;
-              const float angle = RandomFloat(dog.seed) * 6.28318f;
-              const float dist = 1.2f + RandomFloat(dog.seed) * 2.5f;
-              dog.wanderTarget = dog.position + glm::vec3(std::cos(angle) * dist, 0.0f, std::sin(angle) * dist);
-              dog.behaviorTimer = 1.0f + RandomFloat(dog.seed) * 2.0f;
+              dogBodies.SetVelocity(dogIdx, glm::vec3(0.0f));
             }
+            dogBodies.Sleep(dogIdx);
+            return;
+          }
+          dog.asleep = false;
+          if (dog.blastTimer > 0.0f) {
+            dog.blastTimer = glm::max(0.0f, dog.blastTimer - kFixedStep);
+          }
+          dog.behaviorTimer -= kFixedStep;
+
+          if (!dog.collected && glm::distance(player.position, dogPosition) < 1.55f) {
+            dog.collected = true;
+            dog.behavior = Dog::Behavior::Following;
+            dog.behaviorTimer = 0.0f;
           }
 
-          if (dog.behavior == Dog::Behavior::Wandering) {
-            const glm::vec3 toTarget = dog.wanderTarget - dog.position;
+          glm::vec3 desiredVelocity(0.0f);
+          const float distToPlayer = glm::length(glm::vec2(player.position.x - dogPosition.x,
+                                                            player.position.z - dogPosition.z));
+
+          if (dog.collected) {
+            if (dog.behaviorTimer <= 0.0f || distToPlayer > 4.8f) {
+              const float angle = RandomFloat(dog.seed) * 6.28318f;
+              const float radius = (distToPlayer > 4.8f) ? 0.45f : (1.2f + RandomFloat(dog.seed) * 1.5f);
+              dog.wanderTarget = player.position + glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
+              dog.behaviorTimer = (distToPlayer > 4.8f) ? 0.35f : (0.9f + RandomFloat(dog.seed) * 1.4f);
+            }
+            const glm::vec3 toTarget = dog.wanderTarget - dogPosition;
             const float distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
-            if (distToTarget > 0.35f) {
+            if (distToTarget > 0.25f && !hasWon) {
               const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
-              desiredVelocity = dir * (dog.moveSpeed * 0.5f);
+              const float catchup = glm::clamp((distToPlayer - 2.0f) / 4.5f, 0.0f, 1.0f);
+              desiredVelocity = dir * dog.moveSpeed * (1.0f + catchup * 1.1f);
               const float targetFacing = std::atan2(dir.x, dir.z);
               float facingDiff = targetFacing - dog.facing;
               while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
               while (facingDiff < -3.14159f) facingDiff += 6.28318f;
-              dog.facing += facingDiff * dog.turnSpeed * deltaTime;
+              dog.facing += facingDiff * dog.turnSpeed * kFixedStep;
+            }
+          } else {
+            if (dog.behaviorTimer <= 0.0f) {
+              if (RandomFloat(dog.seed) < 0.45f) {
+                dog.behavior = Dog::Behavior::Idle;
+                dog.behaviorTimer = 0.8f + RandomFloat(dog.seed) * 1.6f;
+              } else {
+                dog.behavior = Dog::Behavior::Wandering;
+                const float angle = RandomFloat(dog.seed) * 6.28318f;
+                const float dist = 1.2f + RandomFloat(dog.seed) * 2.5f;
+                dog.wanderTarget = dogPosition + glm::vec3(std::cos(angle) * dist, 0.0f, std::sin(angle) * dist);
+                dog.behaviorTimer = 1.0f + RandomFloat(dog.seed) * 2.0f;
+              }
             }
-          }
-        }
 
-        if (dog.blastTimer > 0.0f) {
-          desiredVelocity = glm::vec3(0.0f);
-        }
+            if (dog.behavior == Dog::Behavior::Wandering) {
+              const glm::vec3 toTarget = dog.wanderTarget - dogPosition;
+              const float distToTarget = glm::length(glm::vec2(toTarget.x, toTarget.z));
+              if (distToTarget > 0.35f) {
+                const glm::vec3 dir = glm::normalize(glm::vec3(toTarget.x, 0.0f, toTarget.z));
+                desiredVelocity = dir * (dog.moveSpeed * 0.5f);
+                const float targetFacing = std::atan2(dir.x, dir.z);
+                float facingDiff = targetFacing - dog.facing;
+                while (facingDiff > 3.14159f) facingDiff -= 6.28318f;
+                while (facingDiff < -3.14159f) facingDiff += 6.28318f;
+                dog.facing += facingDiff * dog.turnSpeed * kFixedStep;
+              }
+            }
+          }
 
-        const float dogAccel = (dog.collected ? 16.0f : 10.0f) * deltaTime;
-        dog.velocity.x = glm::mix(dog.velocity.x, desiredVelocity.x, glm::clamp(dogAccel, 0.0f, 1.0f));
-        dog.velocity.z = glm::mix(dog.velocity.z, desiredVelocity.z, glm::clamp(dogAccel, 0.0f, 1.0f));
+          if (dog.blastTimer > 0.0f) {
+            desiredVelocity = glm::vec3(0.0f);
+          }
 
-        dog.position += dog.velocity * deltaTime;
+          const float dogAccel = (dog.collected ? 16.0f : 10.0f) * kFixedStep;
+          dogBodies.Steer(dogIdx, desiredVelocity, glm::clamp(dogAccel, 0.0f, 1.0f), kFixedStep);
+        };
+        jobs.ParallelFor(dogAiCost, dogs.size(), [&](size_t begin, size_t end, size_t) {
+          for (size_t dogIdx = begin; dogIdx < end; ++dogIdx) {
+            UpdateDogAi(dogIdx);
+          }
+        });
+
+        // Split by Float4 groups like the cats; platform landings stay per dog.
+        jobs.ParallelFor(dogPhysicsCost, dogBodies.Lanes() / Float4::kWidth, [&](size_t begin, size_t end, size_t) {
+          const size_t first = begin * Float4::kWidth;
+          const size_t last = end * Float4::kWidth;
+          ApplyBodyGravity(dogBodies, first, last, gravity);
+          SteerAndIntegrateBodies(dogBodies, first, last, 3.2f);
+          for (size_t dogIdx = first; dogIdx < std::min(last, dogs.size()); ++dogIdx) {
+            Dog& dog = dogs[dogIdx];
+            if (dog.asleep) {
+              continue;
+            }
+            dog.onGround = ClampBodyToFloor(dogBodies, dogIdx, dogGround);
+            float& dogY = dogBodies.py[dogIdx];
+            for (const std::uint32_t i : platformGrid.Near(dogBodies.Position(dogIdx))) {
+              const Platform& platform = platforms[i];
+              const float platformTop = platform.position.y + platform.halfExtents.y;
+              const bool withinX = std::abs(dogBodies.px[dogIdx] - platform.position.x) <= (platform.halfExtents.x + dogRadius);
+              const bool withinZ = std::abs(dogBodies.pz[dogIdx] - platform.position.z) <= (platform.halfExtents.z + dogRadius);
+              const bool falling = dogBodies.vy[dogIdx] <= 0.0f;
+              if (withinX && withinZ && falling) {
+                const float dogBottom = dogY - dogRadius;
+                if (dogBottom < platformTop && dogY > platformTop - 0.6f) {
+                  dogY = platformTop + dogRadius;
+                  dogBodies.vy[dogIdx] = 0.0f;
+                  dog.onGround = true;
+                }
+              }
+            }
+          }
+        });
 
-        dog.onGround = false;
-        if (dog.position.y < dogGround) {
-          dog.position.y = dogGround;
-          dog.velocity.y = 0.0f;
-          dog.onGround = true;
+        collectedCount = 0;
+        for (const Dog& dog : dogs) {
+          if (dog.collected) {
+            collectedCount++;
+          }
         }
-        for (size_t i = 1; i < platforms.size(); ++i) {
-          const Platform& platform = platforms[i];
-          const float platformTop = platform.position.y + platform.halfExtents.y;
-          const bool withinX = std::abs(dog.position.x - platform.position.x) <= (platform.halfExtents.x + dogRadius);
-          const bool withinZ = std::abs(dog.position.z - platform.position.z) <= (platform.halfExtents.z + dogRadius);
-          const bool falling = dog.velocity.y <= 0.0f;
-          if (withinX && withinZ && falling) {
-            const float dogBottom = dog.position.y - dogRadius;
-            if (dogBottom < platformTop && dog.position.y > platformTop - 0.6f) {
-              dog.position.y = platformTop + dogRadius;
-              dog.velocity.y = 0.0f;
-              dog.onGround = true;
+
+        if (!hasWon && collectedCount >= 20 && glm::distance(player.position, carPositionLevel2) < 2.2f) {
+          hasWon = true;
+          if (!winAnnounced) {
+            winAnnounced = true;
+            const float clearTime = currentTime - levelStartTime;
+            if (clearTime <= 100.0f) {
+              levelMedal = "Gold";
+            } else if (clearTime <= 150.0f) {
+              levelMedal = "Silver";
+            } else {
+              levelMedal = "Bronze";
             }
+            SetWindowTitle("Vibe 3D - You Win!");
+            std::cout << "You rescued 20 dogs and escaped the mummy! Medal: " << levelMedal << "\n";
           }
         }
+      }
+      }
+    };
 
-        const float speed = glm::length(glm::vec2(dog.velocity.x, dog.velocity.z));
-        dog.walkCycle += speed * deltaTime * 3.2f;
+    const auto stepStart = std::chrono::steady_clock::now();
+    for (int simStep = 0; simStep < simSteps; ++simStep) {
+      ProfileScope simScope(profiler, ProfileZone::Sim);
+      StepSimulation();
+    }
+    if (headless && simSteps > 0) {
+      const double stepNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stepStart).count() /
+                            static_cast<double>(simSteps);
+      if (headlessStepNs.empty() || stepNs > slowestStepNs) {
+        slowestStepNs = stepNs;
+        slowestFrame = replaying ? replayCursor - 1 : headlessStepNs.size();
       }
+      headlessStepNs.push_back(stepNs);
+    }
 
-      collectedCount = 0;
-      for (const Dog& dog : dogs) {
-        if (dog.collected) {
-          collectedCount++;
+    const std::uint16_t localLevel = (currentLevel == GameLevel::Level1Cats) ? 1u : 2u;
+    const double localTickNow = static_cast<double>(simTick) + static_cast<double>(simulationAccumulator / kFixedStep);
+    {
+      ProfileScope netScope(profiler, ProfileZone::NetReceive);
+      PollMultiplayer(multiplayer, currentTime, localTickNow, kFixedStep);
+      SampleRemoteSnapshots(multiplayer, localTickNow, static_cast<float>(netPlayoutDelayMs) * 0.001f / kFixedStep,
+                            kFixedStep);
+    }
+
+    // Refresh the other players: each peer's own player and, on a client, the ones the
+    // host relays. Item-use animations come from the peers' commands or relayed use counts.
+    for (RemotePlayer& remote : remotePlayers) {
+      remote.wasOnline = remote.online;
+      remote.online = false;
+    }
+    bool anyFreshPeer = false;
+    for (std::size_t slot = 0; slot < multiplayer.peers.size(); ++slot) {
+      const NetPeer& peer = multiplayer.peers[slot];
+      if (!multiplayer.active || !PeerIsFresh(peer, currentTime)) {
+        continue;
+      }
+      anyFreshPeer = true;
+      const MultiplayerPacket& view = peer.interpolated;
+      RemotePlayer& remote = remotePlayers[multiplayer.host ? slot + 1 : 0];
+      remote.online = true;
+      remote.level = peer.latest.level;
+      remote.position = ReadVec3(view.pos);
+      remote.velocity = ReadVec3(view.vel);
+      remote.facing = view.facing;
+      remote.heldItem = static_cast<ItemType>(peer.latest.localHeldItemType);
+      remote.heldCharges = peer.latest.localHeldItemCharges;
+      for (const InputCommand& command : peer.newRemoteCommands) {
+        if ((command.actions & kInputActionUseItem) != 0u) {
+          remote.StartUseAnimation(static_cast<ItemType>(command.heldItem));
         }
       }
-
-      if (!hasWon && collectedCount >= 20 && glm::distance(player.position, carPositionLevel2) < 2.2f) {
-        hasWon = true;
-        if (!winAnnounced) {
-          winAnnounced = true;
-          const float clearTime = currentTime - levelStartTime;
-          if (clearTime <= 100.0f) {
-            levelMedal = "Gold";
-          } else if (clearTime <= 150.0f) {
-            levelMedal = "Silver";
-          } else {
-            levelMedal = "Bronze";
-          }
-          glfwSetWindowTitle(window, "Vibe 3D - You Win!");
-          std::cout << "You rescued 20 dogs and escaped the mummy! Medal: " << levelMedal << "\n";
+      for (const NetPlayerState& other : view.players) {
+        if (multiplayer.host || other.id == 0u || other.id >= kMaxSessionPlayers) {
+          continue;
+        }
+        RemotePlayer& relayed = remotePlayers[other.id];
+        if (relayed.wasOnline && other.useSerial != relayed.useSerial) {
+          relayed.StartUseAnimation(static_cast<ItemType>(other.useItem));
         }
+        relayed.useSerial = other.useSerial;
+        relayed.online = true;
+        relayed.level = peer.latest.level;
+        relayed.position = ReadVec3(other.pos);
+        relayed.velocity = ReadVec3(other.vel);
+        relayed.facing = other.facing;
+        relayed.heldItem = static_cast<ItemType>(other.heldItem);
+        relayed.heldCharges = other.heldCharges;
       }
     }
-    }
-
-    const std::uint16_t localLevel = (currentLevel == GameLevel::Level1Cats) ? 1u : 2u;
-    const std::uint32_t localCatsMask = BuildCollectedCatMask(cats);
-    const std::uint32_t localDogsMask = BuildCollectedDogMask(dogs);
-    PollMultiplayer(multiplayer, currentTime);
-
-    const bool freshRemoteState = multiplayer.active && multiplayer.hasRemote &&
-                                  (currentTime - multiplayer.lastReceiveTime) < 2.0f;
-    const bool remoteIsAuthority = freshRemoteState && ((multiplayer.latest.flags & kNetFlagAuthority) != 0u);
-    if (freshRemoteState) {
-      remoteHeldItem = static_cast<ItemType>(multiplayer.latest.localHeldItemType);
-      remoteHeldCharges = multiplayer.latest.localHeldItemCharges;
-      if ((multiplayer.latest.inputActions & kInputActionUseItem) != 0u) {
-        if (remoteHeldItem == ItemType::Boomerang) {
-          remoteBoomerangUseAnimTimer = 0.28f;
-        } else if (remoteHeldItem == ItemType::Shotgun) {
-          remoteShotgunUseAnimTimer = 0.22f;
-        } else if (remoteHeldItem == ItemType::Sword) {
-          remoteSwordUseAnimTimer = 0.32f;
+    // Our commands are done with once every live peer has acked them.
+    while (anyFreshPeer && !pendingInputCommands.empty()) {
+      const std::uint32_t oldest = pendingInputCommands.front().sequence;
+      bool ackedByAll = true;
+      for (const NetPeer& peer : multiplayer.peers) {
+        if (PeerIsFresh(peer, currentTime) && static_cast<std::int32_t>(oldest - peer.latest.ackedInputCommand) > 0) {
+          ackedByAll = false;
         }
       }
+      if (!ackedByAll) {
+        break;
+      }
+      pendingInputCommands.pop_front();
     }
-    if (freshRemoteState && multiplayerAuthority && !remoteIsAuthority) {
-      const glm::vec3 remotePos(multiplayer.latest.pos[0], multiplayer.latest.pos[1], multiplayer.latest.pos[2]);
-      const glm::vec3 remoteForward(std::sin(multiplayer.latest.facing), 0.0f, std::cos(multiplayer.latest.facing));
-      const std::uint32_t remoteActions = multiplayer.latest.inputActions;
 
-      if ((remoteActions & kInputActionDropItem) != 0u && remoteHeldItem != ItemType::None) {
-        WorldItem dropped;
-        dropped.type = remoteHeldItem;
-        dropped.active = true;
-        dropped.position = remotePos + remoteForward * 1.25f;
-        if (worldItems.size() < 16) {
-          worldItems.push_back(dropped);
-        }
+    for (NetPeer& peer : multiplayer.peers) {
+      if (!multiplayer.active || !PeerIsFresh(peer, currentTime)) {
+        continue;
       }
+      const bool remoteIsAuthority = (peer.latest.flags & kNetFlagAuthority) != 0u;
+      if (multiplayerAuthority && !remoteIsAuthority) {
+        // Each command is judged where the peer was when it acted, with the item it held then.
+        for (const InputCommand& command : peer.newRemoteCommands) {
+          const glm::vec3 remotePos = ReadVec3(command.pos);
+          const glm::vec3 remoteForward(std::sin(command.facing), 0.0f, std::cos(command.facing));
+          const std::uint32_t remoteActions = command.actions;
+          const ItemType commandItem = static_cast<ItemType>(command.heldItem);
+
+          if ((remoteActions & kInputActionDropItem) != 0u && commandItem != ItemType::None) {
+            WorldItem dropped;
+            dropped.type = commandItem;
+            dropped.active = true;
+            dropped.position = remotePos + remoteForward * 1.25f;
+            PlaceWorldItem(dropped);
+          }
 
-      if ((remoteActions & kInputActionUseItem) != 0u) {
-        auto KillEnemyByRemoteAction = [&]() {
-          if (currentLevel == GameLevel::Level1Cats && clownAlive) {
-            clownAlive = false;
-            clownRespawnTimer = 7.0f;
-            clownStunTimer = 0.0f;
-            clown.velocity = glm::vec3(0.0f);
-          } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
-            mummyAlive = false;
-            mummyRespawnTimer = 7.0f;
-            mummyStunTimer = 0.0f;
-            mummy.velocity = glm::vec3(0.0f);
-            for (Bomb& bomb : bombs) {
-              bomb.active = false;
+          if ((remoteActions & kInputActionUseItem) != 0u) {
+            auto KillEnemyByRemoteAction = [&]() {
+              if (currentLevel == GameLevel::Level1Cats && clownAlive) {
+                clownAlive = false;
+                clownRespawnTimer = 7.0f;
+                clownStunTimer = 0.0f;
+                clown.velocity = glm::vec3(0.0f);
+              } else if (currentLevel == GameLevel::Level2Dogs && mummyAlive) {
+                mummyAlive = false;
+                mummyRespawnTimer = 7.0f;
+                mummyStunTimer = 0.0f;
+                mummy.velocity = glm::vec3(0.0f);
+                bombs.Clear();
+              }
+            };
+
+            const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
+            const bool enemyAliveNow = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
+            if (enemyAliveNow) {
+              const float enemyDistance = glm::distance(remotePos, enemyPos);
+              glm::vec3 toEnemy(enemyPos.x - remotePos.x, 0.0f, enemyPos.z - remotePos.z);
+              float facingDot = 1.0f;
+              if (glm::length(toEnemy) > 0.001f) {
+                toEnemy = glm::normalize(toEnemy);
+                facingDot = glm::dot(glm::normalize(glm::vec3(remoteForward.x, 0.0f, remoteForward.z)), toEnemy);
+              }
+
+              if (commandItem == ItemType::Boomerang && enemyDistance < 18.0f) {
+                if (currentLevel == GameLevel::Level1Cats) {
+                  clownStunTimer = glm::max(clownStunTimer, 2.6f);
+                } else {
+                  mummyStunTimer = glm::max(mummyStunTimer, 2.6f);
+                }
+              } else if (commandItem == ItemType::Shotgun && enemyDistance < 10.0f && facingDot > 0.35f) {
+                KillEnemyByRemoteAction();
+              } else if (commandItem == ItemType::Sword && enemyDistance < 3.0f) {
+                KillEnemyByRemoteAction();
+              }
             }
           }
-        };
+        }
+      }
+      if (remoteIsAuthority && !multiplayerAuthority) {
+        const std::uint16_t remoteLevel = peer.latest.level;
+        if (remoteLevel >= 2u && currentLevel == GameLevel::Level1Cats) {
+          ResetLevel2();
+        }
+        if (remoteLevel <= 1u && currentLevel == GameLevel::Level2Dogs) {
+          ResetLevel1();
+        }
 
-        const glm::vec3 enemyPos = (currentLevel == GameLevel::Level1Cats) ? clown.position : mummy.position;
-        const bool enemyAliveNow = (currentLevel == GameLevel::Level1Cats) ? clownAlive : mummyAlive;
-        if (enemyAliveNow) {
-          const float enemyDistance = glm::distance(remotePos, enemyPos);
-          glm::vec3 toEnemy(enemyPos.x - remotePos.x, 0.0f, enemyPos.z - remotePos.z);
-          float facingDot = 1.0f;
-          if (glm::length(toEnemy) > 0.001f) {
-            toEnemy = glm::normalize(toEnemy);
-            facingDot = glm::dot(glm::normalize(glm::vec3(remoteForward.x, 0.0f, remoteForward.z)), toEnemy);
+        ApplyWorldEntities(peer.interpolated,
+                           clown,
+                           clownFacing,
+                           clownWalkCycle,
+                           mummy,
+                           mummyFacing,
+                           mummyWalkCycle,
+                           mummyThrowCooldown,
+                           cats,
+                           catBodies,
+                           dogs,
+                           dogBodies,
+                           bombs,
+                           explosions,
+                           worldItems,
+                           remotePlayers[0].heldItem,
+                           remotePlayers[0].heldCharges,
+                           clownAlive,
+                           clownRespawnTimer,
+                           clownStunTimer,
+                           mummyAlive,
+                           mummyRespawnTimer,
+                           mummyStunTimer);
+
+        // Reconcile: replay our own not-yet-acked hits and drops over the host snapshot
+        // instead of letting them pop back for a round trip. Acked ones defer to the host.
+        const std::uint32_t hostAckedCommand = peer.latest.ackedInputCommand;
+        auto ReapplyHit = [&](PredictedEnemyHit& hit, bool& alive, float& respawnTimer, float& stunTimer, Enemy& enemy) {
+          const float remaining = hit.duration - static_cast<float>(simTick - hit.tick) * kFixedStep;
+          if (hit.command == 0u || static_cast<std::int32_t>(hit.command - hostAckedCommand) <= 0 || remaining <= 0.0f) {
+            hit = PredictedEnemyHit{};
+            return false;
           }
-
-          if (remoteHeldItem == ItemType::Boomerang && enemyDistance < 18.0f) {
-            if (currentLevel == GameLevel::Level1Cats) {
-              clownStunTimer = glm::max(clownStunTimer, 2.6f);
-            } else {
-              mummyStunTimer = glm::max(mummyStunTimer, 2.6f);
-            }
-          } else if (remoteHeldItem == ItemType::Shotgun && enemyDistance < 10.0f && facingDot > 0.35f) {
-            KillEnemyByRemoteAction();
-          } else if (remoteHeldItem == ItemType::Sword && enemyDistance < 3.0f) {
-            KillEnemyByRemoteAction();
+          if (hit.kill) {
+            alive = false;
+            respawnTimer = glm::max(respawnTimer, remaining);
+            stunTimer = 0.0f;
+            enemy.velocity = glm::vec3(0.0f);
+          } else {
+            stunTimer = glm::max(stunTimer, remaining);
           }
+          return hit.kill;
+        };
+        ReapplyHit(predictedClownHit, clownAlive, clownRespawnTimer, clownStunTimer, clown);
+        if (ReapplyHit(predictedMummyHit, mummyAlive, mummyRespawnTimer, mummyStunTimer, mummy)) {
+          bombs.Clear();
+        }
+        predictedDrops.erase(std::remove_if(predictedDrops.begin(), predictedDrops.end(),
+                                            [&](const PredictedItemDrop& drop) {
+                                              return static_cast<std::int32_t>(drop.command - hostAckedCommand) <= 0 ||
+                                                     drop.index >= worldItems.size();
+                                            }),
+                             predictedDrops.end());
+        for (const PredictedItemDrop& drop : predictedDrops) {
+          worldItems[drop.index] = drop.item;
+        }
+
+        collectedCount = std::max(0, peer.latest.collected);
+        livesRemaining = std::max(0, peer.latest.lives);
+        isDead = (peer.latest.flags & kNetFlagDead) != 0u;
+        hasWon = (peer.latest.flags & kNetFlagWon) != 0u;
+      } else {
+        const int catsCollectedNow = ApplyCollectedCatFlags(cats, peer.latest.catsCollected);
+        const int dogsCollectedNow = ApplyCollectedDogFlags(dogs, peer.latest.dogsCollected);
+        collectedCount = (currentLevel == GameLevel::Level1Cats) ? catsCollectedNow : dogsCollectedNow;
+
+        const std::vector<bool>& remoteItemsActive = peer.latest.worldItemsActive;
+        for (std::size_t i = 0; i < worldItems.size() && i < remoteItemsActive.size(); ++i) {
+          worldItems[i].active = worldItems[i].active && remoteItemsActive[i];
+        }
+
+        if ((peer.latest.flags & kNetFlagDead) != 0u) {
+          isDead = true;
+        }
+        if ((peer.latest.flags & kNetFlagWon) != 0u) {
+          hasWon = true;
         }
       }
     }
-    if (remoteIsAuthority && !multiplayerAuthority) {
-      const std::uint16_t remoteLevel = multiplayer.latest.level;
-      if (remoteLevel >= 2u && currentLevel == GameLevel::Level1Cats) {
-        ResetLevel2();
-      }
-      if (remoteLevel <= 1u && currentLevel == GameLevel::Level2Dogs) {
-        ResetLevel1();
-      }
 
-      ApplyWorldEntities(multiplayer.latest,
-                         clown,
-                         clownFacing,
-                         clownWalkCycle,
-                         mummy,
-                         mummyFacing,
-                         mummyWalkCycle,
-                         mummyThrowCooldown,
-                         cats,
-                         dogs,
-                         bombs,
-                         explosions,
-                         worldItems,
-                         remoteHeldItem,
-                         remoteHeldCharges,
-                         clownAlive,
-                         clownRespawnTimer,
-                         clownStunTimer,
-                         mummyAlive,
-                         mummyRespawnTimer,
-                         mummyStunTimer);
-
-      collectedCount = std::max(0, multiplayer.latest.collected);
-      livesRemaining = std::max(0, multiplayer.latest.lives);
-      isDead = (multiplayer.latest.flags & kNetFlagDead) != 0u;
-      hasWon = (multiplayer.latest.flags & kNetFlagWon) != 0u;
-    } else if (freshRemoteState) {
-      const std::uint32_t mergedCatsMask = localCatsMask | multiplayer.latest.catsMask;
-      const std::uint32_t mergedDogsMask = localDogsMask | multiplayer.latest.dogsMask;
-      const int catsCollectedNow = ApplyCollectedCatMask(cats, mergedCatsMask);
-      const int dogsCollectedNow = ApplyCollectedDogMask(dogs, mergedDogsMask);
-      collectedCount = (currentLevel == GameLevel::Level1Cats) ? catsCollectedNow : dogsCollectedNow;
-
-      const std::uint32_t remoteWorldActiveMask = multiplayer.latest.worldItemActiveMask;
-      for (std::size_t i = 0; i < worldItems.size() && i < 16; ++i) {
-        const bool remoteActive = (remoteWorldActiveMask & (1u << static_cast<std::uint32_t>(i))) != 0u;
-        worldItems[i].active = worldItems[i].active && remoteActive;
-      }
-
-      if ((multiplayer.latest.flags & kNetFlagDead) != 0u) {
-        isDead = true;
-      }
-      if ((multiplayer.latest.flags & kNetFlagWon) != 0u) {
-        hasWon = true;
-      }
-    }
-
-    SendMultiplayerSnapshot(multiplayer,
-                player.position,
-                player.velocity,
-                playerFacing,
-                localInputActions,
-                localLevel,
-                multiplayerAuthority,
-                hasWon,
-                isDead,
-                BuildCollectedCatMask(cats),
-                BuildCollectedDogMask(dogs),
-                clown,
-                clownFacing,
-                clownWalkCycle,
-                mummy,
-                mummyFacing,
-                mummyWalkCycle,
-                mummyThrowCooldown,
-                cats,
-                dogs,
-                bombs,
-                explosions,
-                worldItems,
-                heldItem,
-                heldItemCharges,
-                clownAlive,
-                clownRespawnTimer,
-                clownStunTimer,
-                mummyAlive,
-                mummyRespawnTimer,
-                mummyStunTimer,
-                collectedCount,
-                livesRemaining);
+    // Snapshots go out on the network tick, counted in sim steps so the send rate is
+    // independent of the render rate. Unacked input commands ride every one.
+    netStepsSinceSend += simSteps;
+    const int stepsPerNetTick = glm::max(1, static_cast<int>(std::lround(1.0f / (kFixedStep * static_cast<float>(netTickRate)))));
+    if (netStepsSinceSend >= stepsPerNetTick) {
+      netStepsSinceSend = glm::min(netStepsSinceSend - stepsPerNetTick, stepsPerNetTick - 1);
+      ProfileScope netScope(profiler, ProfileZone::NetSend);
+      SendMultiplayerSnapshot(multiplayer,
+                  player.position,
+                  player.velocity,
+                  playerFacing,
+                  pendingInputCommands,
+                  simTick,
+                  localLevel,
+                  multiplayerAuthority,
+                  hasWon,
+                  isDead,
+                  clown,
+                  clownFacing,
+                  clownWalkCycle,
+                  mummy,
+                  mummyFacing,
+                  mummyWalkCycle,
+                  mummyThrowCooldown,
+                  cats,
+                  catBodies,
+                  dogs,
+                  dogBodies,
+                  bombs,
+                  explosions,
+                  worldItems,
+                  heldItem,
+                  heldItemCharges,
+                  clownAlive,
+                  clownRespawnTimer,
+                  clownStunTimer,
+                  mummyAlive,
+                  mummyRespawnTimer,
+                  mummyStunTimer,
+                  collectedCount,
+                  livesRemaining);
+    }
+    SampleNetStats(multiplayer, currentTime);
+
+    if (headless) {
+      // Restart on death or a win so every measured step simulates a live level. It goes
+      // through the action queue so a recorded run replays it from the log.
+      if (isDead || hasWon) {
+        queuedInputActions |= kInputActionRestartLevel;
+      }
+      profiler.EndFrame();
+      continue;
+    }
 
     const float boomerangKickNorm = glm::clamp(boomerangUseAnimTimer / 0.28f, 0.0f, 1.0f);
     const float shotgunKickNorm = glm::clamp(shotgunUseAnimTimer / 0.22f, 0.0f, 1.0f);
@@ -3287,9 +9093,22 @@ int main(int argc, char** argv) {
     const glm::vec3 cameraShake(std::sin(currentTime * 95.0f) * cameraShakeAmp,
                   std::abs(std::sin(currentTime * 123.0f)) * cameraShakeAmp * 0.55f,
                   std::cos(currentTime * 87.0f) * cameraShakeAmp);
+    // Blend between the last two sim states so motion stays smooth when the
+    // render rate drifts away from the fixed step rate.
+    const float renderAlpha = glm::clamp(simulationAccumulator / kFixedStep, 0.0f, 1.0f);
+    auto InterpolatePosition = [&](const glm::vec3& previous, const glm::vec3& current) -> glm::vec3 {
+      // Respawns, level loads and network corrections teleport; snap rather than sweep.
+      if (glm::distance(previous, current) > 4.0f) {
+        return current;
+      }
+      return glm::mix(previous, current, renderAlpha);
+    };
+    const glm::vec3 playerRenderPos = InterpolatePosition(previousPlayerPosition, player.position);
+    const glm::vec3 clownRenderPos = InterpolatePosition(previousClownPosition, clown.position);
+    const glm::vec3 mummyRenderPos = InterpolatePosition(previousMummyPosition, mummy.position);
     const glm::vec3 cameraOffset = cameraForward * -cameraDistance + glm::vec3(0.0f, 2.0f, 0.0f);
-    glm::vec3 cameraTarget = player.position + glm::vec3(0.0f, 0.9f, 0.0f);
-    glm::vec3 cameraPosTarget = player.position + cameraOffset;
+    glm::vec3 cameraTarget = playerRenderPos + glm::vec3(0.0f, 0.9f, 0.0f);
+    glm::vec3 cameraPosTarget = playerRenderPos + cameraOffset;
     cameraPosTarget += cameraShake - cameraForward * (shotgunKickNorm * 0.35f);
     cameraTarget += cameraForward * (swordKickNorm * 0.25f + boomerangKickNorm * 0.1f);
     const float smoothStrength = 10.0f;
@@ -3309,6 +9128,29 @@ int main(int argc, char** argv) {
     const float aspect = width > 0 ? static_cast<float>(width) / static_cast<float>(height) : 1.0f;
     const glm::mat4 proj = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 100.0f);
 
+    Frustum frustum;
+    frustum.Extract(proj * view);
+    CullStats cullStats;
+    // The *In forms count into the given stats, for model-building jobs that keep their own.
+    auto IsVisibleIn = [&](CullStats& stats, const glm::vec3& center, const glm::vec3& halfExtents) {
+      ++stats.tested;
+      if (frustum.IntersectsAabb(center, halfExtents)) {
+        return true;
+      }
+      ++stats.culled;
+      return false;
+    };
+    auto UseLodIn = [&](CullStats& stats, const glm::vec3& position) {
+      if (glm::distance(position, cameraPosSmooth) <= lodDistance) {
+        return false;
+      }
+      ++stats.lod;
+      return true;
+    };
+    auto IsVisible = [&](const glm::vec3& center, const glm::vec3& halfExtents) {
+      return IsVisibleIn(cullStats, center, halfExtents);
+    };
+
     const float sunsetPhase = 0.5f + 0.5f * std::sin(currentTime * 0.045f + 0.4f);
     const glm::vec3 skyCool(0.31f, 0.54f, 0.88f);
     const glm::vec3 skyWarm(0.96f, 0.56f, 0.36f);
@@ -3318,54 +9160,48 @@ int main(int argc, char** argv) {
     const glm::vec3 ambientColor = glm::mix(glm::vec3(0.24f, 0.31f, 0.42f), glm::vec3(0.38f, 0.3f, 0.36f), sunsetPhase);
     const glm::vec3 rimColor = glm::mix(glm::vec3(0.46f, 0.62f, 0.94f), glm::vec3(0.94f, 0.52f, 0.62f), sunsetPhase);
 
-    glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Shared by the cube and particle programs; expects the target program to be bound.
+    auto SetSceneUniforms = [&](const Shader& target) {
+      target.SetMat4("uView", view);
+      target.SetMat4("uProj", proj);
+      target.SetVec3("uViewPos", cameraPosSmooth);
+      target.SetVec3("uLightDir", lightDir);
+      target.SetVec3("uLightColor", lightColor);
+      target.SetVec3("uAmbient", ambientColor);
+      target.SetVec3("uRimColor", rimColor);
+      target.SetFloat("uRimPower", 2.0f);
+      target.SetFloat("uSpecPower", 32.0f);
+      target.SetFloat("uSpecIntensity", 0.35f);
+    };
+    chunkStreamer.Stream(chunkCenters, GatherChunkCenters(), staticScene);
 
-    shader.Use();
-    shader.SetMat4("uView", view);
-    shader.SetMat4("uProj", proj);
-    shader.SetVec3("uViewPos", cameraPosSmooth);
-    shader.SetVec3("uLightDir", glm::normalize(glm::vec3(-0.4f, -1.0f, -0.2f)));
-    shader.SetVec3("uLightColor", lightColor);
-    shader.SetVec3("uAmbient", ambientColor);
-    shader.SetVec3("uRimColor", rimColor);
-    glUniform1f(glGetUniformLocation(shader.id, "uRimPower"), 2.0f);
-    glUniform1f(glGetUniformLocation(shader.id, "uSpecPower"), 32.0f);
-    glUniform1f(glGetUniformLocation(shader.id, "uSpecIntensity"), 0.35f);
+    // The car stays put for a whole level, so it is drawn every frame but casts from the static map.
+    auto ForEachCarCube = [&](const auto& cube) {
+      const glm::vec3 carPos = (currentLevel == GameLevel::Level1Cats) ? carPositionLevel1 : carPositionLevel2;
+      cube(carPos + glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.2f, 0.5f, 2.0f), glm::vec3(0.4f, 0.6f, 0.9f));
+      cube(carPos + glm::vec3(0.0f, 1.0f, -0.2f), glm::vec3(0.8f, 0.35f, 1.0f), glm::vec3(0.7f, 0.8f, 0.9f));
+    };
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(vao);
+    // Entity cubes are pushed from the lambdas below, so this zone is closed explicitly
+    // after the instance upload rather than by a scope.
+    profiler.Begin(ProfileZone::EntityBuild);
 
-    auto DrawCube = [&](const glm::vec3& position, const glm::vec3& scale, const glm::vec3& tint, GLuint tex) {
-      glBindTexture(GL_TEXTURE_2D, tex);
-      glm::mat4 model(1.0f);
-      model = glm::translate(model, position);
-      model = glm::scale(model, scale);
-      shader.SetMat4("uModel", model);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-      shader.SetVec3("uTint", tint);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+    auto DrawCube = [&](const glm::vec3& position, const glm::vec3& scale, const glm::vec3& tint, TextureLayer tex) {
+      renderQueue.Push(JointTransform::At(position), scale, tint, tex);
     };
 
     auto DrawCubeRot = [&](const glm::vec3& position,
                            const glm::vec3& rotation,
                            const glm::vec3& scale,
                            const glm::vec3& tint,
-                           GLuint tex) {
-      glBindTexture(GL_TEXTURE_2D, tex);
-      glm::mat4 model(1.0f);
-      model = glm::translate(model, position);
-      model = glm::rotate(model, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-      model = glm::rotate(model, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-      model = glm::rotate(model, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
-      model = glm::scale(model, scale);
-      shader.SetMat4("uModel", model);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-      shader.SetVec3("uTint", tint);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+                           TextureLayer tex) {
+      renderQueue.Push(JointTransform::At(position).RotatedXYZ(rotation), scale, tint, tex);
     };
 
     for (const Platform& platform : platforms) {
+      if (!IsVisible(platform.position, platform.halfExtents)) {
+        continue;
+      }
       DrawCube(platform.position, platform.halfExtents * 2.0f, platform.tint, platformTexture);
     }
 
@@ -3386,142 +9222,10 @@ int main(int argc, char** argv) {
       const glm::vec3 cloudTint = glm::mix(glm::vec3(0.9f, 0.84f, 0.8f), glm::vec3(1.0f, 0.96f, 0.92f),
                                            0.35f + 0.65f * (0.5f + 0.5f * std::sin(currentTime * 0.03f + cloud.hueOffset)));
       for (const CloudPuff& puff : cloud.puffs) {
-        DrawCube(cloudCenter + puff.offset, puff.scale, cloudTint, cloudTexture);
-      }
-    }
-
-    // Environment beautification pass: hills, trees, structures, roads, props.
-    const std::vector<glm::vec3> hillCenters = {
-        {-20.0f, -0.2f, -20.0f}, {-10.0f, -0.25f, 18.0f}, {8.0f, -0.3f, -18.0f},
-        {20.0f, -0.2f, 12.0f}, {-22.0f, -0.22f, 4.0f}, {14.0f, -0.2f, 22.0f}};
-    for (std::size_t i = 0; i < hillCenters.size(); ++i) {
-      const float stretch = 4.0f + static_cast<float>(i % 3) * 1.8f;
-      const float depth = 3.5f + static_cast<float>((i + 1) % 3) * 1.7f;
-      DrawCube(hillCenters[i], glm::vec3(stretch, 0.95f, depth), glm::vec3(0.34f, 0.55f, 0.34f), platformTexture);
-      DrawCube(hillCenters[i] + glm::vec3(0.0f, 0.9f, 0.0f),
-               glm::vec3(stretch * 0.72f, 0.5f, depth * 0.72f),
-               glm::vec3(0.42f, 0.66f, 0.4f), platformTexture);
-    }
-
-    auto DrawTree = [&](const glm::vec3& pos, float trunkHeight, float crownScale, const glm::vec3& crownTint) {
-      DrawCube(pos + glm::vec3(0.0f, trunkHeight * 0.5f, 0.0f),
-               glm::vec3(0.22f, trunkHeight * 0.5f, 0.22f),
-               glm::vec3(0.5f, 0.35f, 0.2f), platformTexture);
-      DrawCube(pos + glm::vec3(0.0f, trunkHeight + crownScale * 0.45f, 0.0f),
-               glm::vec3(crownScale, crownScale * 0.6f, crownScale),
-               crownTint, catTexture);
-      DrawCube(pos + glm::vec3(0.0f, trunkHeight + crownScale * 0.9f, 0.0f),
-               glm::vec3(crownScale * 0.72f, crownScale * 0.45f, crownScale * 0.72f),
-               crownTint * glm::vec3(1.06f, 1.05f, 1.06f), catTexture);
-    };
-
-    const std::vector<glm::vec3> pineTrees = {
-        {-19.0f, 0.0f, -13.0f}, {-16.0f, 0.0f, -18.0f}, {-13.0f, 0.0f, -14.0f},
-        {16.0f, 0.0f, -14.0f}, {19.0f, 0.0f, -8.0f}, {21.0f, 0.0f, -13.0f},
-        {-18.0f, 0.0f, 16.0f}, {-21.0f, 0.0f, 10.0f}, {18.0f, 0.0f, 17.0f}};
-    for (std::size_t i = 0; i < pineTrees.size(); ++i) {
-      const float h = 1.7f + 0.35f * static_cast<float>((i * 7) % 3);
-      const float c = 0.8f + 0.18f * static_cast<float>(i % 2);
-      DrawTree(pineTrees[i], h, c, glm::vec3(0.2f, 0.45f, 0.25f));
-      DrawCube(pineTrees[i] + glm::vec3(0.0f, h + c * 1.38f, 0.0f),
-               glm::vec3(c * 0.6f, c * 0.35f, c * 0.6f), glm::vec3(0.18f, 0.38f, 0.22f), catTexture);
-    }
-
-    const std::vector<glm::vec3> blossomTrees = {
-        {-6.0f, 0.0f, 15.0f}, {-2.0f, 0.0f, 18.0f}, {6.0f, 0.0f, 17.0f},
-        {11.0f, 0.0f, 13.0f}, {-10.0f, 0.0f, 13.0f}};
-    for (std::size_t i = 0; i < blossomTrees.size(); ++i) {
-      const glm::vec3 tint = (i % 2 == 0) ? glm::vec3(0.7f, 0.9f, 0.62f) : glm::vec3(0.88f, 0.72f, 0.84f);
-      DrawTree(blossomTrees[i], 1.35f, 0.95f, tint);
-    }
-
-    // Cabins and utility structures.
-    auto DrawCabin = [&](const glm::vec3& base, const glm::vec3& tint) {
-      DrawCube(base + glm::vec3(0.0f, 0.8f, 0.0f), glm::vec3(1.6f, 0.8f, 1.2f), tint, platformTexture);
-      DrawCube(base + glm::vec3(0.0f, 1.6f, 0.0f), glm::vec3(1.9f, 0.25f, 1.35f), glm::vec3(0.34f, 0.24f, 0.18f), platformTexture);
-      DrawCube(base + glm::vec3(0.0f, 0.55f, 1.2f), glm::vec3(0.28f, 0.5f, 0.12f), glm::vec3(0.32f, 0.2f, 0.14f), platformTexture);
-      DrawCube(base + glm::vec3(-0.65f, 0.95f, 1.21f), glm::vec3(0.22f, 0.22f, 0.08f), glm::vec3(0.8f, 0.86f, 0.92f), cloudTexture);
-      DrawCube(base + glm::vec3(0.65f, 0.95f, 1.21f), glm::vec3(0.22f, 0.22f, 0.08f), glm::vec3(0.8f, 0.86f, 0.92f), cloudTexture);
-    };
-    DrawCabin(glm::vec3(-20.0f, 0.0f, 20.0f), glm::vec3(0.62f, 0.46f, 0.34f));
-    DrawCabin(glm::vec3(21.0f, 0.0f, -20.0f), glm::vec3(0.52f, 0.44f, 0.36f));
-
-    // Watchtower landmark.
-    const glm::vec3 towerBase(19.0f, 0.0f, 6.0f);
-    DrawCube(towerBase + glm::vec3(0.0f, 2.2f, 0.0f), glm::vec3(1.0f, 0.25f, 1.0f), glm::vec3(0.45f, 0.34f, 0.2f), platformTexture);
-    DrawCube(towerBase + glm::vec3(0.75f, 1.1f, 0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), platformTexture);
-    DrawCube(towerBase + glm::vec3(-0.75f, 1.1f, 0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), platformTexture);
-    DrawCube(towerBase + glm::vec3(0.75f, 1.1f, -0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), platformTexture);
-    DrawCube(towerBase + glm::vec3(-0.75f, 1.1f, -0.75f), glm::vec3(0.16f, 1.1f, 0.16f), glm::vec3(0.42f, 0.3f, 0.2f), platformTexture);
-    DrawCube(towerBase + glm::vec3(0.0f, 2.9f, 0.0f), glm::vec3(1.15f, 0.2f, 1.15f), glm::vec3(0.33f, 0.26f, 0.18f), platformTexture);
-
-    // Fence lines near key routes.
-    for (int i = -10; i <= 10; ++i) {
-      const float x = static_cast<float>(i) * 1.7f;
-      DrawCube(glm::vec3(x, 0.45f, -21.0f), glm::vec3(0.07f, 0.45f, 0.07f), glm::vec3(0.48f, 0.36f, 0.24f), platformTexture);
-      DrawCube(glm::vec3(x, 0.7f, -21.0f), glm::vec3(0.75f, 0.06f, 0.05f), glm::vec3(0.56f, 0.42f, 0.28f), platformTexture);
-      DrawCube(glm::vec3(x, 0.4f, -21.0f), glm::vec3(0.75f, 0.06f, 0.05f), glm::vec3(0.56f, 0.42f, 0.28f), platformTexture);
-    }
-
-    // Stone ruins and archway.
-    DrawCube(glm::vec3(-21.0f, 0.55f, -2.0f), glm::vec3(0.55f, 0.55f, 0.55f), glm::vec3(0.52f, 0.54f, 0.58f), knifeTexture);
-    DrawCube(glm::vec3(-18.0f, 0.55f, -2.0f), glm::vec3(0.55f, 0.55f, 0.55f), glm::vec3(0.52f, 0.54f, 0.58f), knifeTexture);
-    DrawCube(glm::vec3(-19.5f, 1.15f, -2.0f), glm::vec3(1.65f, 0.24f, 0.55f), glm::vec3(0.56f, 0.57f, 0.61f), knifeTexture);
-    DrawCube(glm::vec3(-16.7f, 0.42f, -4.4f), glm::vec3(0.62f, 0.42f, 0.62f), glm::vec3(0.5f, 0.52f, 0.56f), knifeTexture);
-    DrawCube(glm::vec3(-15.4f, 0.3f, -5.4f), glm::vec3(0.44f, 0.3f, 0.44f), glm::vec3(0.45f, 0.48f, 0.53f), knifeTexture);
-
-    // Dirt-road style path to objectives.
-    const glm::vec3 pathColor(0.48f, 0.38f, 0.27f);
-    for (int i = -8; i <= 10; ++i) {
-      const float t = static_cast<float>(i);
-      DrawCube(glm::vec3(t * 1.8f, -0.42f, 10.0f + std::sin(t * 0.45f) * 1.2f),
-               glm::vec3(0.95f, 0.08f, 1.2f), pathColor, platformTexture);
-    }
-    for (int i = -8; i <= 6; ++i) {
-      const float t = static_cast<float>(i);
-      DrawCube(glm::vec3(-8.0f + t * 1.5f, -0.42f, -10.0f + std::cos(t * 0.38f) * 1.5f),
-               glm::vec3(0.86f, 0.08f, 1.0f), glm::vec3(0.44f, 0.35f, 0.24f), platformTexture);
-    }
-
-    // Bridge/overpass style scenic structures.
-    DrawCube(glm::vec3(6.0f, 1.55f, -12.0f), glm::vec3(3.4f, 0.18f, 1.0f), glm::vec3(0.58f, 0.44f, 0.3f), platformTexture);
-    DrawCube(glm::vec3(3.0f, 0.85f, -12.0f), glm::vec3(0.2f, 0.85f, 0.2f), glm::vec3(0.45f, 0.33f, 0.22f), platformTexture);
-    DrawCube(glm::vec3(9.0f, 0.85f, -12.0f), glm::vec3(0.2f, 0.85f, 0.2f), glm::vec3(0.45f, 0.33f, 0.22f), platformTexture);
-
-    // Flower and shrub patches.
-    const std::vector<glm::vec3> shrubCenters = {
-        {-4.0f, 0.0f, -15.0f}, {2.0f, 0.0f, -14.0f}, {11.0f, 0.0f, -3.0f},
-        {-13.0f, 0.0f, 6.0f}, {-6.0f, 0.0f, 20.0f}, {8.0f, 0.0f, 20.0f}};
-    for (std::size_t i = 0; i < shrubCenters.size(); ++i) {
-      const glm::vec3 blossom = (i % 3 == 0) ? glm::vec3(0.92f, 0.58f, 0.66f)
-                           : ((i % 3 == 1) ? glm::vec3(0.86f, 0.82f, 0.42f) : glm::vec3(0.62f, 0.72f, 0.95f));
-      DrawCube(shrubCenters[i] + glm::vec3(0.0f, 0.22f, 0.0f), glm::vec3(0.5f, 0.22f, 0.5f), glm::vec3(0.29f, 0.56f, 0.28f), catTexture);
-      DrawCube(shrubCenters[i] + glm::vec3(0.0f, 0.46f, 0.0f), glm::vec3(0.2f, 0.12f, 0.2f), blossom, cloudTexture);
-    }
-
-    // Lantern posts for warm focal points.
-    const std::vector<glm::vec3> lanternPosts = {
-        {-2.0f, 0.0f, 8.0f}, {5.0f, 0.0f, 11.0f}, {-9.0f, 0.0f, 12.0f},
-        {15.0f, 0.0f, 2.0f}, {-15.0f, 0.0f, -10.0f}};
-    for (const glm::vec3& post : lanternPosts) {
-      DrawCube(post + glm::vec3(0.0f, 0.9f, 0.0f), glm::vec3(0.08f, 0.9f, 0.08f), glm::vec3(0.34f, 0.27f, 0.2f), platformTexture);
-      DrawCube(post + glm::vec3(0.0f, 1.85f, 0.0f), glm::vec3(0.19f, 0.19f, 0.19f), glm::vec3(1.0f, 0.82f, 0.45f), cloudTexture);
-      DrawCube(post + glm::vec3(0.0f, 1.85f, 0.0f), glm::vec3(0.12f, 0.12f, 0.12f), glm::vec3(1.0f, 0.95f, 0.7f), cloudTexture);
-    }
-
-    // Extra dense foliage scatter for the expanded map footprint.
-    for (int gx = -4; gx <= 4; ++gx) {
-      for (int gz = -4; gz <= 4; ++gz) {
-        const glm::vec3 tileOffset(static_cast<float>(gx) * 48.0f, 0.0f, static_cast<float>(gz) * 48.0f);
-        if (gx == 0 && gz == 0) {
+        if (!IsVisible(cloudCenter + puff.offset, puff.scale * 0.5f)) {
           continue;
         }
-        const glm::vec3 treeBase = tileOffset + glm::vec3(6.0f + static_cast<float>((gx * 13 + gz * 7) % 9), 0.0f,
-                                                           -5.0f + static_cast<float>((gx * 5 - gz * 11) % 9));
-        DrawTree(treeBase, 1.5f, 0.86f, glm::vec3(0.24f, 0.5f, 0.28f));
-        DrawTree(treeBase + glm::vec3(10.0f, 0.0f, 8.0f), 1.25f, 0.75f, glm::vec3(0.3f, 0.56f, 0.3f));
-        DrawCube(tileOffset + glm::vec3(-8.0f, 0.2f, 6.0f), glm::vec3(0.65f, 0.2f, 0.65f), glm::vec3(0.26f, 0.52f, 0.25f), catTexture);
-        DrawCube(tileOffset + glm::vec3(-8.0f, 0.43f, 6.0f), glm::vec3(0.16f, 0.1f, 0.16f), glm::vec3(0.86f, 0.76f, 0.56f), cloudTexture);
+        DrawCube(cloudCenter + puff.offset, puff.scale, cloudTint, cloudTexture);
       }
     }
 
@@ -3529,6 +9233,9 @@ int main(int argc, char** argv) {
       if (!item.active) {
         continue;
       }
+      if (!IsVisible(item.position + glm::vec3(0.0f, 0.6f, 0.0f), glm::vec3(0.6f, 0.6f, 0.6f))) {
+        continue;
+      }
       const glm::vec3 tint = ItemTypeTint(item.type);
       const float hover = 0.58f + 0.2f * std::sin(currentTime * 2.8f + item.position.x * 0.02f + item.position.z * 0.01f);
       const float spin = currentTime * 1.55f + item.position.x * 0.004f;
@@ -3570,20 +9277,47 @@ int main(int argc, char** argv) {
                  glm::vec3(size * 0.36f, size * 0.36f, 0.02f), glm::vec3(1.0f, 0.96f, 0.8f), knifeTexture);
     }
 
+    // Projectiles, animals, bombs and the characters below are the dynamic shadow casters.
+    renderQueue.BeginCasters();
     if (boomerangProjectile.active) {
       DrawCube(boomerangProjectile.position, glm::vec3(0.24f, 0.07f, 0.14f), glm::vec3(0.95f, 0.78f, 0.22f), knifeTexture);
     }
     for (const ShotProjectile& projectile : shotgunProjectiles) {
-      if (!projectile.active) {
-        continue;
-      }
       DrawCube(projectile.position, glm::vec3(0.05f, 0.05f, 0.12f), glm::vec3(1.0f, 0.92f, 0.52f), cloudTexture);
     }
 
+    // Animal models are the bulk of the frame's cubes; they build in parallel, one
+    // InstanceBatch per job, and are appended to the queue in job order.
+    auto BuildAnimalModels = [&](JobSystem::Cost& cost, size_t count, const auto& build) {
+      const size_t tasks = jobs.ParallelFor(cost, count, [&](size_t begin, size_t end, size_t task) {
+        InstanceBatch& out = modelBatches[task];
+        out.Clear();
+        for (size_t i = begin; i < end; ++i) {
+          build(i, out);
+        }
+      });
+      for (size_t task = 0; task < tasks; ++task) {
+        renderQueue.Append(modelBatches[task].entries);
+        cullStats.Add(modelBatches[task].stats);
+      }
+    };
+
     if (currentLevel == GameLevel::Level1Cats) {
-    int catIndex = 0;
-    for (const Cat& cat : cats) {
-      const float speed = glm::length(glm::vec2(cat.velocity.x, cat.velocity.z));
+    BuildAnimalModels(catModelCost, cats.size(), [&](size_t catIndex, InstanceBatch& out) {
+      const Cat& cat = cats[catIndex];
+      const glm::vec3 catRenderPos = InterpolatePosition(cat.previousPosition, catBodies.Position(catIndex));
+      const glm::vec3 catBoundsCenter = catRenderPos + glm::vec3(0.0f, Cat::kBoundsHalfHeight, 0.0f);
+      if (!IsVisibleIn(out.stats, catBoundsCenter,
+                       glm::vec3(Cat::kBoundsHalfWidth, Cat::kBoundsHalfHeight, Cat::kBoundsHalfWidth))) {
+        return;
+      }
+      if (UseLodIn(out.stats, catRenderPos)) {
+        out.Push(JointTransform::At(catRenderPos + glm::vec3(0.0f, 0.3f, 0.0f)).RotatedY(cat.facing),
+                 glm::vec3(0.36f, 0.5f, 0.7f), glm::vec3(1.0f, 0.87f, 0.95f), catTexture);
+        return;
+      }
+      const float speed = glm::length(glm::vec2(catBodies.vx[catIndex], catBodies.vz[catIndex]));
+      const float catWalkCycle = catBodies.walkCycle[catIndex];
       const float walkAmount = glm::clamp(speed / 3.0f, 0.0f, 1.0f);
       float groom = 0.0f;
       float loaf = 0.0f;
@@ -3610,11 +9344,11 @@ int main(int argc, char** argv) {
         groomed = 0.5f + 0.5f * std::sin(cat.idleAnimPhase * 1.4f);
       }
 
-      float catBob = std::sin(cat.walkCycle * 2.0f) * walkAmount * 0.05f;
+      float catBob = std::sin(catWalkCycle * 2.0f) * walkAmount * 0.05f;
       catBob *= (1.0f - loaf * 0.9f) * (1.0f - groom * 0.4f) * (1.0f - groomed * 0.4f);
-      float catWag = std::sin(cat.walkCycle * 1.6f) * 0.25f;
+      float catWag = std::sin(catWalkCycle * 1.6f) * 0.25f;
       catWag *= (1.0f - loaf * 0.7f) * (1.0f - groomed * 0.3f);
-      const float legSwing = std::sin(cat.walkCycle) * walkAmount * 0.18f;
+      const float legSwing = std::sin(catWalkCycle) * walkAmount * 0.18f;
       const float earWiggle = (1.0f - walkAmount) * 0.18f * std::sin(currentTime * 2.3f + catSeedOffset) +
               groom * 0.22f * std::sin(cat.idleAnimPhase * 3.2f);
       const float headTilt = (1.0f - walkAmount) * 0.12f * std::sin(currentTime * 1.4f + catSeedOffset) +
@@ -3622,7 +9356,7 @@ int main(int argc, char** argv) {
       const float blinkPhase = std::sin(currentTime * 1.8f + catSeedOffset);
       const float blink = glm::clamp((blinkPhase - 0.92f) / 0.08f, 0.0f, 1.0f);
       
-      glm::vec3 catPos = cat.position + glm::vec3(0.0f, catBob - loaf * 0.08f - groomed * 0.03f, 0.0f);
+      glm::vec3 catPos = catRenderPos + glm::vec3(0.0f, catBob - loaf * 0.08f - groomed * 0.03f, 0.0f);
       glm::vec3 bodyScale(0.36f, 0.22f, 0.48f);
       glm::vec3 headScale(0.26f, 0.26f, 0.26f);
       const glm::vec3 earScale(0.085f, 0.13f, 0.065f);
@@ -3638,37 +9372,15 @@ int main(int argc, char** argv) {
       const float groomedBob = groomed * 0.035f * std::sin(cat.idleAnimPhase * 2.2f);
       const float eyeScaleY = 0.05f * (1.0f - blink) + 0.012f * blink;
       
-      // Helper to draw oriented parts
+      // Every part hangs off the body root, which is built once per cat.
+      const JointTransform catRoot = JointTransform::At(catPos).RotatedY(cat.facing).RotatedZ(roll);
       auto DrawCatPart = [&](const glm::vec3& localPos, const glm::vec3& scale, const glm::vec3& tint) {
-        glBindTexture(GL_TEXTURE_2D, catTexture);
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, catPos);
-        model = glm::rotate(model, cat.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, roll, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::translate(model, localPos);
-        model = glm::scale(model, scale);
-        shader.SetMat4("uModel", model);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        shader.SetVec3("uTint", tint);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        out.Push(catRoot.Translated(localPos), scale, tint, catTexture);
       };
 
       auto DrawCatPartRot = [&](const glm::vec3& localPos, const glm::vec3& localRot,
                                 const glm::vec3& scale, const glm::vec3& tint) {
-        glBindTexture(GL_TEXTURE_2D, catTexture);
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, catPos);
-        model = glm::rotate(model, cat.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, roll, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::translate(model, localPos);
-        model = glm::rotate(model, localRot.x, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, localRot.y, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, localRot.z, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, scale);
-        shader.SetMat4("uModel", model);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        shader.SetVec3("uTint", tint);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        out.Push(catRoot.Translated(localPos).RotatedXYZ(localRot), scale, tint, catTexture);
       };
 
       DrawCatPart(glm::vec3(0.0f, 0.28f, 0.0f), bodyScale, glm::vec3(1.0f, 0.85f, 0.95f));
@@ -3715,74 +9427,47 @@ int main(int argc, char** argv) {
       DrawCatPart(glm::vec3(-0.12f, 0.03f, -0.18f + legSwing),
           glm::vec3(0.045f, 0.02f, 0.045f), glm::vec3(0.98f, 0.72f, 0.82f));
 
-      // Tail with wag
-      glm::mat4 tailModel(1.0f);
-      tailModel = glm::translate(tailModel, catPos);
-      tailModel = glm::rotate(tailModel, cat.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-      tailModel = glm::rotate(tailModel, roll, glm::vec3(0.0f, 0.0f, 1.0f));
-      tailModel = glm::translate(tailModel, glm::vec3(0.0f, 0.34f, -0.32f));
-      tailModel = glm::rotate(tailModel, catWag, glm::vec3(0.0f, 1.0f, 0.0f));
-      tailModel = glm::scale(tailModel, glm::vec3(0.08f, 0.08f, 0.35f));
-      shader.SetMat4("uModel", tailModel);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(tailModel))));
-      shader.SetVec3("uTint", glm::vec3(1.0f, 0.8f, 0.9f));
-      glBindTexture(GL_TEXTURE_2D, catTexture);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-
-      glm::mat4 tailTip = tailModel;
-      tailTip = glm::translate(tailTip, glm::vec3(0.0f, 0.0f, 0.9f));
-      tailTip = glm::scale(tailTip, glm::vec3(1.6f, 1.6f, 1.6f));
-      shader.SetMat4("uModel", tailTip);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(tailTip))));
-      shader.SetVec3("uTint", glm::vec3(1.0f, 0.9f, 0.95f));
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-
-      catIndex++;
-    }
+      // Tail with wag; the tip is offset in the tail's scaled space.
+      const JointTransform tail = catRoot.Translated(glm::vec3(0.0f, 0.34f, -0.32f)).RotatedY(catWag);
+      const glm::vec3 tailScale(0.08f, 0.08f, 0.35f);
+      out.Push(tail, tailScale, glm::vec3(1.0f, 0.8f, 0.9f), catTexture);
+      out.Push(tail.TranslatedScaled(tailScale, glm::vec3(0.0f, 0.0f, 0.9f)), tailScale * 1.6f,
+               glm::vec3(1.0f, 0.9f, 0.95f), catTexture);
+    });
     } else {
-      for (const Dog& dog : dogs) {
-        if (dog.collected) {
-          // Collected dogs still render and follow the player.
+      BuildAnimalModels(dogModelCost, dogs.size(), [&](size_t dogIndex, InstanceBatch& out) {
+        // Collected dogs still render and follow the player.
+        const Dog& dog = dogs[dogIndex];
+        const glm::vec3 dogRenderPos = InterpolatePosition(dog.previousPosition, dogBodies.Position(dogIndex));
+        if (!IsVisibleIn(out.stats, dogRenderPos + glm::vec3(0.0f, Dog::kBoundsHalfHeight, 0.0f),
+                         glm::vec3(Dog::kBoundsHalfWidth, Dog::kBoundsHalfHeight, Dog::kBoundsHalfWidth))) {
+          return;
+        }
+        if (UseLodIn(out.stats, dogRenderPos)) {
+          out.Push(JointTransform::At(dogRenderPos + glm::vec3(0.0f, 0.6f, 0.0f)).RotatedY(dog.facing),
+                   glm::vec3(0.76f, 0.9f, 1.9f), glm::vec3(0.42f, 0.27f, 0.16f), catTexture);
+          return;
         }
         const glm::vec3 coatDark(0.32f, 0.2f, 0.12f);
         const glm::vec3 coatMid(0.42f, 0.27f, 0.16f);
         const glm::vec3 coatLight(0.55f, 0.38f, 0.24f);
         const glm::vec3 noseTint(0.08f, 0.06f, 0.05f);
-        const float speed = glm::length(glm::vec2(dog.velocity.x, dog.velocity.z));
+        const float speed = glm::length(glm::vec2(dogBodies.vx[dogIndex], dogBodies.vz[dogIndex]));
         const float walk = glm::clamp(speed / 4.5f, 0.0f, 1.0f);
-        const float bob = (0.022f + walk * 0.032f) * std::sin(dog.walkCycle * 2.0f + dog.bobOffset);
-        const float legSwing = std::sin(dog.walkCycle) * walk * 0.16f;
-        const float tailWag = (0.1f + walk * 0.15f) * std::sin(dog.walkCycle * 1.45f + 1.7f);
-        const glm::vec3 dogPos = dog.position + glm::vec3(0.0f, bob, 0.0f);
+        const float dogWalkCycle = dogBodies.walkCycle[dogIndex];
+        const float bob = (0.022f + walk * 0.032f) * std::sin(dogWalkCycle * 2.0f + dog.bobOffset);
+        const float legSwing = std::sin(dogWalkCycle) * walk * 0.16f;
+        const float tailWag = (0.1f + walk * 0.15f) * std::sin(dogWalkCycle * 1.45f + 1.7f);
+        const glm::vec3 dogPos = dogRenderPos + glm::vec3(0.0f, bob, 0.0f);
 
+        const JointTransform dogRoot = JointTransform::At(dogPos).RotatedY(dog.facing);
         auto DrawDogPart = [&](const glm::vec3& localPos, const glm::vec3& scale, const glm::vec3& tint) {
-          glBindTexture(GL_TEXTURE_2D, catTexture);
-          glm::mat4 model(1.0f);
-          model = glm::translate(model, dogPos);
-          model = glm::rotate(model, dog.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-          model = glm::translate(model, localPos);
-          model = glm::scale(model, scale);
-          shader.SetMat4("uModel", model);
-          shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-          shader.SetVec3("uTint", tint);
-          glDrawArrays(GL_TRIANGLES, 0, 36);
+          out.Push(dogRoot.Translated(localPos), scale, tint, catTexture);
         };
 
         auto DrawDogPartRot = [&](const glm::vec3& localPos, const glm::vec3& localRot,
                                   const glm::vec3& scale, const glm::vec3& tint) {
-          glBindTexture(GL_TEXTURE_2D, catTexture);
-          glm::mat4 model(1.0f);
-          model = glm::translate(model, dogPos);
-          model = glm::rotate(model, dog.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-          model = glm::translate(model, localPos);
-          model = glm::rotate(model, localRot.x, glm::vec3(1.0f, 0.0f, 0.0f));
-          model = glm::rotate(model, localRot.y, glm::vec3(0.0f, 1.0f, 0.0f));
-          model = glm::rotate(model, localRot.z, glm::vec3(0.0f, 0.0f, 1.0f));
-          model = glm::scale(model, scale);
-          shader.SetMat4("uModel", model);
-          shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-          shader.SetVec3("uTint", tint);
-          glDrawArrays(GL_TRIANGLES, 0, 36);
+          out.Push(dogRoot.Translated(localPos).RotatedXYZ(localRot), scale, tint, catTexture);
         };
 
         DrawDogPart(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.76f, 0.38f, 1.14f), coatMid);
@@ -3797,22 +9482,12 @@ int main(int argc, char** argv) {
         DrawDogPart(glm::vec3(0.28f, 0.24f, -0.34f - legSwing), glm::vec3(0.15f, 0.5f, 0.15f), coatDark);
         DrawDogPart(glm::vec3(-0.28f, 0.24f, -0.34f + legSwing), glm::vec3(0.15f, 0.5f, 0.15f), coatDark);
 
-        glBindTexture(GL_TEXTURE_2D, catTexture);
-        glm::mat4 tailModel(1.0f);
-        tailModel = glm::translate(tailModel, dogPos);
-        tailModel = glm::rotate(tailModel, dog.facing, glm::vec3(0.0f, 1.0f, 0.0f));
-        tailModel = glm::translate(tailModel, glm::vec3(0.0f, 0.58f, -0.82f));
-        tailModel = glm::rotate(tailModel, -0.45f, glm::vec3(1.0f, 0.0f, 0.0f));
-        tailModel = glm::rotate(tailModel, tailWag, glm::vec3(0.0f, 1.0f, 0.0f));
-        tailModel = glm::scale(tailModel, glm::vec3(0.13f, 0.13f, 0.5f));
-        shader.SetMat4("uModel", tailModel);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(tailModel))));
-        shader.SetVec3("uTint", coatDark);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-      }
+        out.Push(dogRoot.Translated(glm::vec3(0.0f, 0.58f, -0.82f)).RotatedX(-0.45f).RotatedY(tailWag),
+                 glm::vec3(0.13f, 0.13f, 0.5f), coatDark, catTexture);
+      });
 
       for (const Bomb& bomb : bombs) {
-        if (!bomb.active) {
+        if (!IsVisible(bomb.position, glm::vec3(0.11f, 0.11f, 0.11f))) {
           continue;
         }
         DrawCube(bomb.position, glm::vec3(0.22f, 0.22f, 0.22f), glm::vec3(0.22f, 0.22f, 0.25f), knifeTexture);
@@ -3821,35 +9496,25 @@ int main(int argc, char** argv) {
       for (const Explosion& explosion : explosions) {
         const float t = glm::clamp(explosion.age / explosion.duration, 0.0f, 1.0f);
         const float grow = 0.45f + t * 3.5f;
-        const float fade = 1.0f - t;
-        DrawCube(explosion.position + glm::vec3(0.0f, 0.2f, 0.0f),
-                 glm::vec3(grow * 1.1f, grow * 0.7f, grow * 1.1f),
-                 glm::vec3(1.0f, 0.42f + fade * 0.25f, 0.1f + fade * 0.1f), knifeTexture);
-        DrawCube(explosion.position + glm::vec3(0.0f, 0.25f, 0.0f),
-                 glm::vec3(grow * 0.7f, grow * 0.5f, grow * 0.7f),
-                 glm::vec3(1.0f, 0.84f, 0.38f), cloudTexture);
-
-        for (int spark = 0; spark < 8; ++spark) {
-          const float angle = explosion.seed + static_cast<float>(spark) * 0.785398f;
-          const float ring = (1.0f + static_cast<float>(spark) * 0.11f) * (0.6f + t * 2.8f);
-          const glm::vec3 offset(std::cos(angle) * ring,
-                                 0.2f + (0.35f + 0.06f * static_cast<float>(spark)) * t * 3.1f,
-                                 std::sin(angle) * ring);
-          const float sparkScale = glm::max(0.04f, 0.18f * (1.0f - t));
-          DrawCube(explosion.position + offset,
-                   glm::vec3(sparkScale, sparkScale, sparkScale * 1.5f),
-                   glm::vec3(1.0f, 0.74f, 0.2f), knifeTexture);
+        // Outermost spark ring (spark 7) bounds the whole effect.
+        const float reach = glm::max(1.77f * (0.6f + t * 2.8f) + 0.3f, grow * 0.55f);
+        if (!IsVisible(explosion.position + glm::vec3(0.0f, 0.8f, 0.0f), glm::vec3(reach, 2.1f, reach))) {
+          continue;
         }
+        particles.Emit(explosion.position, explosion.seed, explosion.age, explosion.duration);
       }
     }
 
-    const glm::vec3 activeCarPos = (currentLevel == GameLevel::Level1Cats) ? carPositionLevel1 : carPositionLevel2;
-    DrawCube(activeCarPos + glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.2f, 0.5f, 2.0f), glm::vec3(0.4f, 0.6f, 0.9f), carTexture);
-    DrawCube(activeCarPos + glm::vec3(0.0f, 1.0f, -0.2f), glm::vec3(0.8f, 0.35f, 1.0f), glm::vec3(0.7f, 0.8f, 0.9f), carTexture);
+    renderQueue.EndCasters();
+
+    ForEachCarCube([&](const glm::vec3& position, const glm::vec3& scale, const glm::vec3& tint) {
+      DrawCube(position, scale, tint, carTexture);
+    });
+    renderQueue.BeginCasters();
 
     auto DrawHumanoid = [&](const glm::vec3& basePos, float size, const glm::vec3& bodyTint,
                             const glm::vec3& skinTint, const glm::vec3& accentTint,
-                            GLuint bodyTex, GLuint skinTex, GLuint accentTex,
+                            TextureLayer bodyTex, TextureLayer skinTex, TextureLayer accentTex,
                             float walkPhase, float walkAmount, float faceYaw) {
       const float torsoHeight = size * 1.2f;
       const float torsoWidth = size * 0.75f;
@@ -3868,33 +9533,16 @@ int main(int argc, char** argv) {
       const float idleBreath = std::sin(walkPhase * 0.6f) * (1.0f - walkAmount) * size * 0.03f;
       const glm::vec3 rootPos = basePos + glm::vec3(0.0f, bob + idleBreath, 0.0f);
 
-      auto DrawPart = [&](const glm::vec3& localPos, const glm::vec3& scale, const glm::vec3& tint, GLuint tex) {
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, rootPos);
-        model = glm::rotate(model, faceYaw, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, localPos);
-        model = glm::scale(model, scale);
-        shader.SetMat4("uModel", model);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        shader.SetVec3("uTint", tint);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+      const JointTransform root = JointTransform::At(rootPos).RotatedY(faceYaw);
+      auto DrawPart = [&](const glm::vec3& localPos, const glm::vec3& scale, const glm::vec3& tint, TextureLayer tex) {
+        renderQueue.Push(root.Translated(localPos), scale, tint, tex);
       };
 
+      // Limbs pivot at the joint (shoulder or hip) and hang half their length below it.
       auto DrawLimb = [&](const glm::vec3& jointPos, float length, float width, float depth,
-                          const glm::vec3& tint, GLuint tex, float rotAngle) {
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, rootPos);
-        model = glm::rotate(model, faceYaw, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::translate(model, jointPos);
-        model = glm::rotate(model, rotAngle, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(0.0f, -length * 0.5f, 0.0f));
-        model = glm::scale(model, glm::vec3(width, length, depth));
-        shader.SetMat4("uModel", model);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        shader.SetVec3("uTint", tint);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+                          const glm::vec3& tint, TextureLayer tex, float rotAngle) {
+        const JointTransform joint = root.Translated(jointPos).RotatedX(rotAngle);
+        renderQueue.Push(joint.Translated(glm::vec3(0.0f, -length * 0.5f, 0.0f)), glm::vec3(width, length, depth), tint, tex);
       };
 
       DrawLimb(glm::vec3(legWidth * 1.2f, legHeight, legSwing),
@@ -3948,12 +9596,11 @@ int main(int argc, char** argv) {
                                 legHeight + torsoHeight * 0.58f + holdBob,
                                 armSwing + torsoSway + size * 0.18f - shotgunKick * size * 0.12f);
 
-      glm::mat4 handTransform(1.0f);
-      handTransform = glm::translate(handTransform, basePos);
-      handTransform = glm::rotate(handTransform, faceYaw, glm::vec3(0.0f, 1.0f, 0.0f));
-      handTransform = glm::translate(handTransform, handLocal);
-      handTransform = glm::rotate(handTransform, holdPitch + swordSwing * 0.65f, glm::vec3(1.0f, 0.0f, 0.0f));
-      handTransform = glm::rotate(handTransform, -shotgunKick * 0.38f + boomerangFlick * 0.55f, glm::vec3(0.0f, 0.0f, 1.0f));
+      const JointTransform hand = JointTransform::At(basePos)
+                                      .RotatedY(faceYaw)
+                                      .Translated(handLocal)
+                                      .RotatedX(holdPitch + swordSwing * 0.65f)
+                                      .RotatedZ(-shotgunKick * 0.38f + boomerangFlick * 0.55f);
 
       const glm::vec3 tint = ItemTypeTint(itemType);
       const float idleSpin = currentTime * 1.6f;
@@ -3961,64 +9608,21 @@ int main(int argc, char** argv) {
         return;
       }
       if (itemType == ItemType::Boomerang) {
-        glm::mat4 modelA = handTransform;
-        modelA = glm::rotate(modelA, idleSpin + boomerangFlick * 8.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-        modelA = glm::rotate(modelA, glm::radians(22.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        modelA = glm::scale(modelA, glm::vec3(0.34f, 0.05f, 0.12f));
-        shader.SetMat4("uModel", modelA);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(modelA))));
-        shader.SetVec3("uTint", tint);
-        glBindTexture(GL_TEXTURE_2D, knifeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glm::mat4 modelB = handTransform;
-        modelB = glm::rotate(modelB, idleSpin + boomerangFlick * 8.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-        modelB = glm::rotate(modelB, glm::radians(-22.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        modelB = glm::scale(modelB, glm::vec3(0.34f, 0.05f, 0.12f));
-        shader.SetMat4("uModel", modelB);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(modelB))));
-        shader.SetVec3("uTint", tint * glm::vec3(1.06f, 1.04f, 0.95f));
-        glBindTexture(GL_TEXTURE_2D, knifeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        const JointTransform spin = hand.RotatedY(idleSpin + boomerangFlick * 8.0f);
+        const glm::vec3 wingScale(0.34f, 0.05f, 0.12f);
+        renderQueue.Push(spin.RotatedZ(glm::radians(22.0f)), wingScale, tint, knifeTexture);
+        renderQueue.Push(spin.RotatedZ(glm::radians(-22.0f)), wingScale, tint * glm::vec3(1.06f, 1.04f, 0.95f), knifeTexture);
       } else if (itemType == ItemType::SpeedBoots) {
-        glm::mat4 modelL = handTransform;
-        modelL = glm::rotate(modelL, idleSpin, glm::vec3(0.0f, 1.0f, 0.0f));
-        modelL = glm::translate(modelL, glm::vec3(0.11f, 0.0f, 0.0f));
-        modelL = glm::scale(modelL, glm::vec3(0.12f, 0.13f, 0.2f));
-        shader.SetMat4("uModel", modelL);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(modelL))));
-        shader.SetVec3("uTint", tint);
-        glBindTexture(GL_TEXTURE_2D, cloudTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glm::mat4 modelR = handTransform;
-        modelR = glm::rotate(modelR, idleSpin, glm::vec3(0.0f, 1.0f, 0.0f));
-        modelR = glm::translate(modelR, glm::vec3(-0.11f, 0.0f, 0.0f));
-        modelR = glm::scale(modelR, glm::vec3(0.12f, 0.13f, 0.2f));
-        shader.SetMat4("uModel", modelR);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(modelR))));
-        shader.SetVec3("uTint", tint);
-        glBindTexture(GL_TEXTURE_2D, cloudTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        const JointTransform spin = hand.RotatedY(idleSpin);
+        const glm::vec3 bootScale(0.12f, 0.13f, 0.2f);
+        renderQueue.Push(spin.Translated(glm::vec3(0.11f, 0.0f, 0.0f)), bootScale, tint, cloudTexture);
+        renderQueue.Push(spin.Translated(glm::vec3(-0.11f, 0.0f, 0.0f)), bootScale, tint, cloudTexture);
       } else if (itemType == ItemType::Shotgun) {
-        glm::mat4 model = handTransform;
-        model = glm::rotate(model, glm::radians(80.0f) - shotgunKick * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.46f, 0.08f, 0.08f));
-        shader.SetMat4("uModel", model);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-        shader.SetVec3("uTint", glm::vec3(0.5f, 0.52f, 0.58f));
-        glBindTexture(GL_TEXTURE_2D, knifeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        renderQueue.Push(hand.RotatedY(glm::radians(80.0f) - shotgunKick * 0.5f), glm::vec3(0.46f, 0.08f, 0.08f),
+                         glm::vec3(0.5f, 0.52f, 0.58f), knifeTexture);
       } else if (itemType == ItemType::Sword) {
-        glm::mat4 blade = handTransform;
-        blade = glm::rotate(blade, glm::radians(22.0f) + swordSwing * 1.1f, glm::vec3(0.0f, 0.0f, 1.0f));
-        blade = glm::translate(blade, glm::vec3(0.0f, 0.2f, 0.0f));
-        blade = glm::scale(blade, glm::vec3(0.05f, 0.45f, 0.05f));
-        shader.SetMat4("uModel", blade);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(blade))));
-        shader.SetVec3("uTint", glm::vec3(0.85f, 0.88f, 0.96f));
-        glBindTexture(GL_TEXTURE_2D, knifeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        renderQueue.Push(hand.RotatedZ(glm::radians(22.0f) + swordSwing * 1.1f).Translated(glm::vec3(0.0f, 0.2f, 0.0f)),
+                         glm::vec3(0.05f, 0.45f, 0.05f), glm::vec3(0.85f, 0.88f, 0.96f), knifeTexture);
       }
     };
 
@@ -4037,43 +9641,19 @@ int main(int argc, char** argv) {
       const float idleBreath = std::sin(walkPhase * 0.6f) * (1.0f - walkAmount) * size * 0.03f;
       const glm::vec3 rootPos = basePos + glm::vec3(0.0f, bob + idleBreath, 0.0f);
 
+      const JointTransform root = JointTransform::At(rootPos).RotatedY(faceYaw);
       auto DrawBoot = [&](float sideSign) {
         const float jointZ = sideSign * legSwing;
         const float jointRot = sideSign * legRot;
-
-        glm::mat4 footRoot(1.0f);
-        footRoot = glm::translate(footRoot, rootPos);
-        footRoot = glm::rotate(footRoot, faceYaw, glm::vec3(0.0f, 1.0f, 0.0f));
-        footRoot = glm::translate(footRoot, glm::vec3(sideSign * legWidth * 1.2f, legHeight, jointZ));
-        footRoot = glm::rotate(footRoot, jointRot, glm::vec3(1.0f, 0.0f, 0.0f));
-        footRoot = glm::translate(footRoot, glm::vec3(0.0f, -legHeight, 0.0f));
-
-        glm::mat4 upper = footRoot;
-        upper = glm::translate(upper, glm::vec3(0.0f, 0.11f, 0.02f));
-        upper = glm::scale(upper, glm::vec3(0.18f, 0.14f, 0.25f));
-        shader.SetMat4("uModel", upper);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(upper))));
-        shader.SetVec3("uTint", tint);
-        glBindTexture(GL_TEXTURE_2D, cloudTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glm::mat4 sole = footRoot;
-        sole = glm::translate(sole, glm::vec3(0.0f, 0.02f, 0.005f));
-        sole = glm::scale(sole, glm::vec3(0.2f, 0.05f, 0.3f));
-        shader.SetMat4("uModel", sole);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(sole))));
-        shader.SetVec3("uTint", glm::vec3(0.16f, 0.2f, 0.24f));
-        glBindTexture(GL_TEXTURE_2D, knifeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glm::mat4 toe = footRoot;
-        toe = glm::translate(toe, glm::vec3(0.0f, 0.06f, 0.1f));
-        toe = glm::scale(toe, glm::vec3(0.17f, 0.08f, 0.12f));
-        shader.SetMat4("uModel", toe);
-        shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(toe))));
-        shader.SetVec3("uTint", tint * glm::vec3(1.08f, 1.08f, 1.1f));
-        glBindTexture(GL_TEXTURE_2D, cloudTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        // Same hip joint as DrawHumanoid's legs, then down to the sole.
+        const JointTransform foot = root.Translated(glm::vec3(sideSign * legWidth * 1.2f, legHeight, jointZ))
+                                        .RotatedX(jointRot)
+                                        .Translated(glm::vec3(0.0f, -legHeight, 0.0f));
+        renderQueue.Push(foot.Translated(glm::vec3(0.0f, 0.11f, 0.02f)), glm::vec3(0.18f, 0.14f, 0.25f), tint, cloudTexture);
+        renderQueue.Push(foot.Translated(glm::vec3(0.0f, 0.02f, 0.005f)), glm::vec3(0.2f, 0.05f, 0.3f),
+                         glm::vec3(0.16f, 0.2f, 0.24f), knifeTexture);
+        renderQueue.Push(foot.Translated(glm::vec3(0.0f, 0.06f, 0.1f)), glm::vec3(0.17f, 0.08f, 0.12f),
+                         tint * glm::vec3(1.08f, 1.08f, 1.1f), cloudTexture);
       };
 
       DrawBoot(1.0f);
@@ -4097,14 +9677,14 @@ int main(int argc, char** argv) {
         const glm::vec3 playerBodyTint = glm::mix(glm::vec3(0.35f, 0.55f, 0.9f), glm::vec3(0.95f, 0.22f, 0.22f), hurtFlash);
         const glm::vec3 playerSkinTint = glm::mix(glm::vec3(0.95f, 0.85f, 0.75f), glm::vec3(1.0f, 0.45f, 0.45f), hurtFlash * 0.75f);
         const glm::vec3 playerAccentTint = glm::mix(glm::vec3(0.2f, 0.2f, 0.25f), glm::vec3(0.5f, 0.12f, 0.12f), hurtFlash * 0.8f);
-        DrawHumanoid(player.position + hurtOffset, playerSize,
+        DrawHumanoid(playerRenderPos + hurtOffset, playerSize,
           playerBodyTint,
           playerSkinTint,
           playerAccentTint,
            playerTexture, playerSkinTexture, playerTexture,
                  playerWalkCycle, playerWalk, playerFacing);
         const bool localWearBoots = (playerWalk > 0.55f) && ((heldItem == ItemType::SpeedBoots) || (speedBootTimer > 0.0f));
-        DrawHeldItemModel(player.position + hurtOffset,
+        DrawHeldItemModel(playerRenderPos + hurtOffset,
                           playerSize,
                           playerWalkCycle,
                           playerWalk,
@@ -4115,11 +9695,11 @@ int main(int argc, char** argv) {
                           swordUseAnimTimer,
                           localWearBoots);
         if (localWearBoots) {
-          DrawBootsWorn(player.position + hurtOffset, playerSize, playerWalkCycle, playerWalk, playerFacing, ItemTypeTint(ItemType::SpeedBoots));
+          DrawBootsWorn(playerRenderPos + hurtOffset, playerSize, playerWalkCycle, playerWalk, playerFacing, ItemTypeTint(ItemType::SpeedBoots));
         }
 
         const glm::vec3 localForward(std::sin(playerFacing), 0.0f, std::cos(playerFacing));
-        const glm::vec3 localHandFxPos = player.position + hurtOffset + localForward * 0.65f + glm::vec3(0.0f, 1.25f, 0.0f);
+        const glm::vec3 localHandFxPos = playerRenderPos + hurtOffset + localForward * 0.65f + glm::vec3(0.0f, 1.25f, 0.0f);
         if (boomerangUseAnimTimer > 0.0f) {
           const float t = glm::clamp(boomerangUseAnimTimer / 0.28f, 0.0f, 1.0f);
           const float ring = 0.18f + (1.0f - t) * 0.95f;
@@ -4137,78 +9717,68 @@ int main(int argc, char** argv) {
           const float t = glm::clamp(swordUseAnimTimer / 0.32f, 0.0f, 1.0f);
           const float arc = (1.0f - t) * 2.1f - 0.9f;
           const glm::vec3 slashOffset = glm::vec3(std::sin(playerFacing + arc), 0.0f, std::cos(playerFacing + arc)) * 1.05f;
-          DrawCube(player.position + hurtOffset + slashOffset + glm::vec3(0.0f, 1.05f, 0.0f),
+          DrawCube(playerRenderPos + hurtOffset + slashOffset + glm::vec3(0.0f, 1.05f, 0.0f),
                    glm::vec3(0.08f, 0.45f, 0.08f),
                    ItemTypeTint(ItemType::Sword),
                    knifeTexture);
         }
 
-    const bool remoteOnline = multiplayer.active && multiplayer.hasRemote &&
-                              (currentTime - multiplayer.lastReceiveTime) < 2.0f;
-    if (remoteOnline && multiplayer.latest.level == localLevel) {
-      const glm::vec3 remoteVel(multiplayer.latest.vel[0], multiplayer.latest.vel[1], multiplayer.latest.vel[2]);
-      const float extrapolation = glm::clamp(currentTime - multiplayer.lastReceiveTime, 0.0f, 0.12f);
-      const glm::vec3 remoteTarget(multiplayer.latest.pos[0], multiplayer.latest.pos[1], multiplayer.latest.pos[2]);
-      const glm::vec3 remotePos = remoteTarget + remoteVel * extrapolation;
-      if (!remoteRenderInitialized) {
-        remoteRenderPos = remotePos;
-        remoteRenderInitialized = true;
-      }
-      remoteRenderPos = glm::mix(remoteRenderPos, remotePos, glm::clamp(deltaTime * 12.0f, 0.0f, 1.0f));
-      const float remoteSpeed = glm::length(glm::vec2(remoteVel.x, remoteVel.z));
+    for (RemotePlayer& remote : remotePlayers) {
+      if (!remote.online || remote.level != localLevel) {
+        continue;
+      }
+      const float remoteSpeed = glm::length(glm::vec2(remote.velocity.x, remote.velocity.z));
       const float remoteWalk = glm::clamp(remoteSpeed / moveSpeed, 0.0f, 1.0f);
-      remotePlayerWalkCycle += remoteWalk * (2.5f + remoteWalk * 6.0f) * deltaTime;
+      remote.walkCycle += remoteWalk * (2.5f + remoteWalk * 6.0f) * deltaTime;
       const glm::vec3 remoteBodyTint(0.34f, 0.95f, 0.62f);
       const glm::vec3 remoteSkinTint(0.88f, 0.92f, 0.78f);
       const glm::vec3 remoteAccentTint(0.12f, 0.34f, 0.2f);
-      DrawHumanoid(remoteRenderPos, playerSize,
+      DrawHumanoid(remote.position, playerSize,
                    remoteBodyTint,
                    remoteSkinTint,
                    remoteAccentTint,
                    playerTexture, playerSkinTexture, playerTexture,
-                   remotePlayerWalkCycle, remoteWalk, multiplayer.latest.facing);
-      const bool remoteWearBoots = (remoteWalk > 0.55f) && (remoteHeldItem == ItemType::SpeedBoots);
-      DrawHeldItemModel(remoteRenderPos,
+                   remote.walkCycle, remoteWalk, remote.facing);
+      const bool remoteWearBoots = (remoteWalk > 0.55f) && (remote.heldItem == ItemType::SpeedBoots);
+      DrawHeldItemModel(remote.position,
                         playerSize,
-                        remotePlayerWalkCycle,
+                        remote.walkCycle,
                         remoteWalk,
-                        multiplayer.latest.facing,
-                        remoteHeldItem,
-                        remoteBoomerangUseAnimTimer,
-                        remoteShotgunUseAnimTimer,
-                        remoteSwordUseAnimTimer,
+                        remote.facing,
+                        remote.heldItem,
+                        remote.boomerangUseAnimTimer,
+                        remote.shotgunUseAnimTimer,
+                        remote.swordUseAnimTimer,
                         remoteWearBoots);
       if (remoteWearBoots) {
-        DrawBootsWorn(remoteRenderPos, playerSize, remotePlayerWalkCycle, remoteWalk, multiplayer.latest.facing, ItemTypeTint(ItemType::SpeedBoots));
+        DrawBootsWorn(remote.position, playerSize, remote.walkCycle, remoteWalk, remote.facing, ItemTypeTint(ItemType::SpeedBoots));
       }
 
-      const glm::vec3 remoteForward(std::sin(multiplayer.latest.facing), 0.0f, std::cos(multiplayer.latest.facing));
-      const glm::vec3 remoteHandFxPos = remoteRenderPos + remoteForward * 0.65f + glm::vec3(0.0f, 1.25f, 0.0f);
-      if (remoteBoomerangUseAnimTimer > 0.0f) {
-        const float t = glm::clamp(remoteBoomerangUseAnimTimer / 0.28f, 0.0f, 1.0f);
+      const glm::vec3 remoteForward(std::sin(remote.facing), 0.0f, std::cos(remote.facing));
+      const glm::vec3 remoteHandFxPos = remote.position + remoteForward * 0.65f + glm::vec3(0.0f, 1.25f, 0.0f);
+      if (remote.boomerangUseAnimTimer > 0.0f) {
+        const float t = glm::clamp(remote.boomerangUseAnimTimer / 0.28f, 0.0f, 1.0f);
         const float ring = 0.18f + (1.0f - t) * 0.95f;
         DrawCube(remoteHandFxPos, glm::vec3(ring, 0.03f, ring), ItemTypeTint(ItemType::Boomerang), cloudTexture);
       }
-      if (remoteShotgunUseAnimTimer > 0.0f) {
-        const float t = glm::clamp(remoteShotgunUseAnimTimer / 0.22f, 0.0f, 1.0f);
+      if (remote.shotgunUseAnimTimer > 0.0f) {
+        const float t = glm::clamp(remote.shotgunUseAnimTimer / 0.22f, 0.0f, 1.0f);
         const float flash = 0.08f + (1.0f - t) * 0.42f;
         DrawCube(remoteHandFxPos + remoteForward * (0.8f + (1.0f - t) * 0.35f),
                  glm::vec3(flash, flash * 0.7f, flash),
                  glm::vec3(1.0f, 0.92f, 0.58f),
                  cloudTexture);
       }
-      if (remoteSwordUseAnimTimer > 0.0f) {
-        const float t = glm::clamp(remoteSwordUseAnimTimer / 0.32f, 0.0f, 1.0f);
+      if (remote.swordUseAnimTimer > 0.0f) {
+        const float t = glm::clamp(remote.swordUseAnimTimer / 0.32f, 0.0f, 1.0f);
         const float arc = (1.0f - t) * 2.1f - 0.9f;
-        const glm::vec3 slashOffset = glm::vec3(std::sin(multiplayer.latest.facing + arc), 0.0f,
-                                                std::cos(multiplayer.latest.facing + arc)) * 1.05f;
-        DrawCube(remoteRenderPos + slashOffset + glm::vec3(0.0f, 1.05f, 0.0f),
+        const glm::vec3 slashOffset = glm::vec3(std::sin(remote.facing + arc), 0.0f,
+                                                std::cos(remote.facing + arc)) * 1.05f;
+        DrawCube(remote.position + slashOffset + glm::vec3(0.0f, 1.05f, 0.0f),
                  glm::vec3(0.08f, 0.45f, 0.08f),
                  ItemTypeTint(ItemType::Sword),
                  knifeTexture);
       }
-    } else {
-      remoteRenderInitialized = false;
     }
 
     if (currentLevel == GameLevel::Level1Cats) {
@@ -4220,7 +9790,7 @@ int main(int argc, char** argv) {
       if (clownSpeed > 0.05f) {
         clownFacing = std::atan2(clown.velocity.x, clown.velocity.z);
       }
-      DrawHumanoid(clown.position, clownSize,
+      DrawHumanoid(clownRenderPos, clownSize,
              glm::vec3(0.95f, 0.2f, 0.2f),
              glm::vec3(1.0f, 0.9f, 0.85f),
              glm::vec3(0.2f, 0.2f, 0.2f),
@@ -4229,7 +9799,7 @@ int main(int argc, char** argv) {
 
       if (clownAiState == ClownAiState::Windup) {
         const float pulse = 0.65f + 0.35f * std::sin(currentTime * 25.0f);
-        DrawCube(clown.position + glm::vec3(0.0f, clownSize * 1.75f, 0.0f),
+        DrawCube(clownRenderPos + glm::vec3(0.0f, clownSize * 1.75f, 0.0f),
              glm::vec3(0.18f, 0.18f, 0.18f),
              glm::vec3(1.0f, 0.2f + pulse * 0.5f, 0.2f), knifeTexture);
       }
@@ -4242,22 +9812,17 @@ int main(int argc, char** argv) {
       const float clownArmHeight = clownSize * 0.75f;
       const float clownArmSwing = -clownSwing * clownSize * 0.22f;
       const float clownTorsoSway = clownSwing * clownSize * 0.08f;
-      const glm::vec3 clownRoot = clown.position;
-
-      glm::mat4 handModel(1.0f);
-      handModel = glm::translate(handModel, clownRoot);
-      handModel = glm::rotate(handModel, clownFacing, glm::vec3(0.0f, 1.0f, 0.0f));
-      handModel = glm::translate(handModel, glm::vec3(clownTorsoWidth * 0.85f,
-                              clownLegHeight + clownTorsoHeight * 0.95f,
-                              clownArmSwing + clownTorsoSway));
-      handModel = glm::rotate(handModel, clownArmRot, glm::vec3(1.0f, 0.0f, 0.0f));
-      handModel = glm::translate(handModel, glm::vec3(0.0f, -clownArmHeight * 0.9f, 0.0f));
-      handModel = glm::scale(handModel, glm::vec3(clownSize * 0.15f, clownSize * 0.35f, clownSize * 0.6f));
-      shader.SetMat4("uModel", handModel);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(handModel))));
-      shader.SetVec3("uTint", glm::vec3(0.85f, 0.85f, 0.9f));
-      glBindTexture(GL_TEXTURE_2D, knifeTexture);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+      const glm::vec3 clownRoot = clownRenderPos;
+
+      const JointTransform clownHand = JointTransform::At(clownRoot)
+                                           .RotatedY(clownFacing)
+                                           .Translated(glm::vec3(clownTorsoWidth * 0.85f,
+                                                                 clownLegHeight + clownTorsoHeight * 0.95f,
+                                                                 clownArmSwing + clownTorsoSway))
+                                           .RotatedX(clownArmRot)
+                                           .Translated(glm::vec3(0.0f, -clownArmHeight * 0.9f, 0.0f));
+      renderQueue.Push(clownHand, glm::vec3(clownSize * 0.15f, clownSize * 0.35f, clownSize * 0.6f),
+                       glm::vec3(0.85f, 0.85f, 0.9f), knifeTexture);
       }
     } else {
       if (mummyAlive) {
@@ -4268,7 +9833,7 @@ int main(int argc, char** argv) {
       if (mummySpeed > 0.05f) {
         mummyFacing = std::atan2(mummy.velocity.x, mummy.velocity.z);
       }
-      DrawHumanoid(mummy.position, mummySize,
+      DrawHumanoid(mummyRenderPos, mummySize,
              glm::vec3(0.84f, 0.82f, 0.74f),
              glm::vec3(0.88f, 0.83f, 0.73f),
              glm::vec3(0.75f, 0.72f, 0.66f),
@@ -4278,26 +9843,92 @@ int main(int argc, char** argv) {
       if (mummyThrowTelegraph > 0.0f) {
         const float t = glm::clamp(mummyThrowTelegraph / 0.25f, 0.0f, 1.0f);
         const float ring = 0.25f + (1.0f - t) * 0.5f;
-        DrawCube(mummy.position + glm::vec3(0.0f, mummySize * 1.6f, 0.0f),
+        DrawCube(mummyRenderPos + glm::vec3(0.0f, mummySize * 1.6f, 0.0f),
              glm::vec3(ring, 0.08f, ring),
              glm::vec3(1.0f, 0.68f, 0.24f), cloudTexture);
       }
 
-      glm::mat4 bombHand(1.0f);
-      bombHand = glm::translate(bombHand, mummy.position);
-      bombHand = glm::rotate(bombHand, mummyFacing, glm::vec3(0.0f, 1.0f, 0.0f));
-      bombHand = glm::translate(bombHand, glm::vec3(0.42f, mummySize * 1.5f, 0.1f));
-      bombHand = glm::scale(bombHand, glm::vec3(mummySize * 0.2f, mummySize * 0.2f, mummySize * 0.2f));
-      shader.SetMat4("uModel", bombHand);
-      shader.SetMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(bombHand))));
-      shader.SetVec3("uTint", glm::vec3(0.22f, 0.22f, 0.24f));
-      glBindTexture(GL_TEXTURE_2D, knifeTexture);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+      const JointTransform bombHand =
+          JointTransform::At(mummyRenderPos).RotatedY(mummyFacing).Translated(glm::vec3(0.42f, mummySize * 1.5f, 0.1f));
+      renderQueue.Push(bombHand, glm::vec3(mummySize * 0.2f), glm::vec3(0.22f, 0.22f, 0.24f), knifeTexture);
       }
     }
 
-    glBindVertexArray(0);
+    renderQueue.EndCasters();
+    renderQueue.Upload();
+    profiler.End(ProfileZone::EntityBuild);
+
+    if (shadows) {
+      ProfileScope shadowScope(profiler, ProfileZone::Shadows);
+      if (shadowMaps.NeedsStaticBake(static_cast<int>(currentLevel), playerRenderPos)) {
+        const glm::vec2 center = ShadowMaps::StaticCenter(playerRenderPos);
+        const glm::vec2 regionMin = center - glm::vec2(ShadowMaps::kStaticHalfExtent);
+        const glm::vec2 regionMax = center + glm::vec2(ShadowMaps::kStaticHalfExtent);
+        auto NearRegion = [&](const glm::vec3& casterMin, const glm::vec3& casterMax) {
+          return casterMax.x >= regionMin.x - ShadowMaps::kStaticMargin && casterMin.x <= regionMax.x + ShadowMaps::kStaticMargin &&
+                 casterMax.z >= regionMin.y - ShadowMaps::kStaticMargin && casterMin.z <= regionMax.y + ShadowMaps::kStaticMargin;
+        };
+        std::vector<CubeInstance> staticCasters;
+        std::vector<ShadowMaps::BackdropRange> backdropRanges;
+        glm::vec3 boundsMin(regionMin.x, std::numeric_limits<float>::max(), regionMin.y);
+        glm::vec3 boundsMax(regionMax.x, -std::numeric_limits<float>::max(), regionMax.y);
+        auto AddStaticCaster = [&](const glm::vec3& position, const glm::vec3& scale, const glm::vec3& tint) {
+          if (!NearRegion(position - scale * 0.5f, position + scale * 0.5f)) {
+            return;
+          }
+          staticCasters.push_back(MakeCubeInstance(JointTransform::At(position), scale, tint, platformTexture));
+          boundsMin.y = glm::min(boundsMin.y, position.y - scale.y * 0.5f);
+          boundsMax.y = glm::max(boundsMax.y, position.y + scale.y * 0.5f);
+        };
+        for (const Platform& platform : platforms) {
+          AddStaticCaster(platform.position, platform.halfExtents * 2.0f, platform.tint);
+        }
+        ForEachCarCube(AddStaticCaster);
+        for (const WorldChunk& chunk : world.chunks) {
+          if (chunk.vertexCount > 0u && NearRegion(chunk.boundsMin, chunk.boundsMax)) {
+            backdropRanges.push_back({chunk.firstVertex, chunk.vertexCount});
+            boundsMin.y = glm::min(boundsMin.y, chunk.boundsMin.y);
+            boundsMax.y = glm::max(boundsMax.y, chunk.boundsMax.y);
+          }
+        }
+        if (boundsMin.y > boundsMax.y) {
+          boundsMin.y = 0.0f;
+          boundsMax.y = 1.0f;
+        }
+        shadowMaps.FitStatic(boundsMin, boundsMax);
+        shadowMaps.BakeStatic(staticCasters, world.staticMesh.data, backdropRanges, static_cast<int>(currentLevel), center);
+      }
+      shadowMaps.DrawDynamic(renderQueue, playerRenderPos);
+      glViewport(0, 0, width, height);
+    }
 
+    {
+      ProfileScope worldScope(profiler, ProfileZone::WorldRender);
+      glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      shader.Use();
+      SetSceneUniforms(shader);
+      shadowMaps.Apply(shader, shadows);
+
+      // Every material below is a layer of this array; units 1 and 2 hold the shadow maps.
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, textures.id);
+      staticScene.Draw(shader, [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+        return frustum.IntersectsAabb((boundsMin + boundsMax) * 0.5f, (boundsMax - boundsMin) * 0.5f);
+      });
+
+      glBindVertexArray(vao);
+      renderQueue.Draw(shader);
+      glBindVertexArray(0);
+
+      if (!particles.emitters.empty()) {
+        particles.shader.Use();
+        SetSceneUniforms(particles.shader);
+      }
+      particles.Flush(knifeTexture, cloudTexture);
+    }
+
+    profiler.Begin(ProfileZone::Ui);
     if (audio.ready) {
       const float threatDistance = (currentLevel == GameLevel::Level1Cats)
                                        ? glm::distance(player.position, clown.position)
@@ -4305,12 +9936,13 @@ int main(int argc, char** argv) {
       const float threatNorm = 1.0f - glm::clamp(threatDistance / 12.0f, 0.0f, 1.0f);
       const float dangerDuck = (livesRemaining <= 1) ? 0.78f : 1.0f;
       ma_sound_set_volume(&audio.ambient.sound, musicVolume * dangerDuck);
-      ma_sound_set_volume(&audio.footstep.sound, 0.45f * sfxVolume);
-      ma_sound_set_volume(&audio.jump.sound, 0.5f * sfxVolume);
-      ma_sound_set_volume(&audio.land.sound, 0.5f * sfxVolume);
-      ma_sound_set_volume(&audio.chase.sound, (0.28f + threatNorm * 0.6f) * sfxVolume);
-      ma_sound_set_volume(&audio.explosion.sound, 0.72f * sfxVolume);
-      ma_sound_set_volume(&audio.hurt.sound, 0.65f * sfxVolume);
+      ma_sound_group_set_volume(&audio.sfx, sfxVolume);
+      ma_sound_set_volume(&audio.chase.sound, 0.28f + threatNorm * 0.6f);
+      // The listener is the camera; plays during the next sim steps are placed against it.
+      audio.listener = cameraPosSmooth;
+      const glm::vec3 listenerForward = glm::normalize(cameraTargetSmooth - cameraPosSmooth);
+      ma_engine_listener_set_position(&audio.engine, 0, audio.listener.x, audio.listener.y, audio.listener.z);
+      ma_engine_listener_set_direction(&audio.engine, 0, listenerForward.x, listenerForward.y, listenerForward.z);
     }
 
     ImGuiWindowFlags hudFlags = ImGuiWindowFlags_NoDecoration |
@@ -4336,8 +9968,15 @@ int main(int argc, char** argv) {
       ImGui::Text("Medal: %s", levelMedal.c_str());
     }
     if (multiplayer.active) {
-      const bool peerConnected = multiplayer.hasRemote && (currentTime - multiplayer.lastReceiveTime) < 2.0f;
-      ImGui::Text("Online: %s", peerConnected ? "Connected" : "Waiting for peer...");
+      int peersConnected = 0;
+      for (const NetPeer& peer : multiplayer.peers) {
+        peersConnected += PeerIsFresh(peer, currentTime) ? 1 : 0;
+      }
+      if (peersConnected > 0) {
+        ImGui::Text("Online: %d other player(s)", peersConnected);
+      } else {
+        ImGui::Text("Online: %s", multiplayer.host ? "Waiting for players..." : "Waiting for host...");
+      }
     }
     const float staminaBarWidth = ImGui::GetContentRegionAvail().x;
     ImGui::ProgressBar(stamina, ImVec2(staminaBarWidth, 0.0f), "Stamina");
@@ -4390,11 +10029,14 @@ int main(int argc, char** argv) {
       ImGui::SetNextWindowBgAlpha(0.58f);
       ImGui::Begin("Multiplayer", &showMultiplayerWindow,
                    ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize);
-      ImGui::TextWrapped("Connect two players and keep one shared progression state (level, collectibles, win/death, lives).");
+      ImGui::TextWrapped("Host a session for up to %d players, or join one, and keep one shared progression state (level, collectibles, win/death, lives).",
+                         kMaxSessionPlayers);
       ImGui::InputInt("Local UDP Port", &mpUiLocalPort);
       ImGui::InputText("Peer IP", mpUiPeerIp, static_cast<int>(sizeof(mpUiPeerIp)));
       ImGui::InputInt("Peer UDP Port", &mpUiPeerPort);
-      ImGui::Checkbox("Authoritative Host", &multiplayerAuthority);
+      ImGui::Checkbox("Host Session", &mpUiHost);
+      ImGui::SliderInt("Network Tick (Hz)", &netTickRate, 10, 120);
+      ImGui::SliderInt("Min Playout Delay (ms)", &netPlayoutDelayMs, 0, 500);
       mpUiLocalPort = std::max(1, mpUiLocalPort);
       mpUiPeerPort = std::max(1, mpUiPeerPort);
 
@@ -4404,9 +10046,11 @@ int main(int argc, char** argv) {
         nextConfig.localPort = mpUiLocalPort;
         nextConfig.peerIp = mpUiPeerIp;
         nextConfig.peerPort = mpUiPeerPort;
+        nextConfig.host = mpUiHost;
         ShutdownMultiplayer(multiplayer);
         if (InitMultiplayer(nextConfig, multiplayer)) {
           multiplayerConfig = nextConfig;
+          multiplayerAuthority = multiplayer.host;
           mpUiStatus = "Connected.";
         } else {
           mpUiStatus = "Connect failed. Verify IP/ports and firewall.";
@@ -4419,12 +10063,56 @@ int main(int argc, char** argv) {
         mpUiStatus = "Disconnected.";
       }
 
-      const bool peerConnected = multiplayer.active && multiplayer.hasRemote &&
-                                 (currentTime - multiplayer.lastReceiveTime) < 2.0f;
       ImGui::Separator();
       ImGui::Text("Session: %s", multiplayer.active ? "Online" : "Offline");
       ImGui::Text("Role: %s", multiplayerAuthority ? "Host (authoritative)" : "Client (mirrors host)");
-      ImGui::Text("Peer: %s", peerConnected ? "Connected" : "Waiting...");
+      if (multiplayer.active) {
+        ImGui::Text("World snapshot: %zu B full  Unacked commands dropped: %llu", multiplayer.lastFullSnapshotBytes,
+                    static_cast<unsigned long long>(multiplayer.stats.totals.inputCommandsDropped));
+        for (const NetPeer& peer : multiplayer.peers) {
+          if (peer.seenGeneration == 0u) {
+            continue;
+          }
+          char address[INET_ADDRSTRLEN] = "?";
+          inet_ntop(AF_INET, &peer.addr.sin_addr, address, sizeof(address));
+          ImGui::Text("Peer %s:%u: %s", address, static_cast<unsigned>(ntohs(peer.addr.sin_port)),
+                      PeerIsFresh(peer, currentTime) ? "Connected" : "Waiting...");
+          ImGui::Text("  Snapshot: %zu B in %zu fragment(s), %zu entities culled", peer.lastSnapshotBytes,
+                      peer.lastSnapshotFragments, peer.lastCulledEntities);
+          const std::uint32_t expected = peer.receivedCount + peer.lostCount;
+          ImGui::Text("  Loss: %.1f%%  Jitter: %.1f ms",
+                      expected > 0u ? 100.0f * static_cast<float>(peer.lostCount) / static_cast<float>(expected) : 0.0f,
+                      peer.jitterTicks * kFixedStep * 1000.0f);
+          if (peer.hasRtt) {
+            ImGui::Text("  RTT: %.1f ms  Buffer: %zu snapshots, %.0f ms playout delay", peer.rttMs,
+                        peer.samples.Size(), peer.playoutDelayTicks * kFixedStep * 1000.0f);
+          } else {
+            ImGui::Text("  RTT: --  Buffer: %zu snapshots, %.0f ms playout delay",
+                        peer.samples.Size(), peer.playoutDelayTicks * kFixedStep * 1000.0f);
+          }
+        }
+        if (!multiplayer.stats.history.Empty()) {
+          const NetStatsSample& net = multiplayer.stats.history.Back();
+          ImGui::Text("Sent: %.0f pkt/s, %.1f KiB/s  Recv: %.0f pkt/s, %.1f KiB/s", net.packetsSent, net.sentKiB,
+                      net.packetsReceived, net.receivedKiB);
+          if (net.rttMs > 0.0f) {
+            ImGui::Text("Worst RTT: %.1f ms  Out of order: %.0f/s  Inbox drops: %u", net.rttMs, net.outOfOrder,
+                        multiplayer.droppedPackets.load(std::memory_order_relaxed));
+          } else {
+            ImGui::Text("RTT: --  Out of order: %.0f/s  Inbox drops: %u", net.outOfOrder,
+                        multiplayer.droppedPackets.load(std::memory_order_relaxed));
+          }
+          if (ImGui::CollapsingHeader("Bytes per snapshot section")) {
+            for (int section = 0; section < kNetSectionCount; ++section) {
+              ImGui::Text("%-11s %8.1f B", kNetSectionNames[section], net.sectionBytes[section]);
+            }
+          }
+        }
+        if (ImGui::Button("Export CSV", ImVec2(120.0f, 0.0f))) {
+          mpUiStatus = WriteNetStatsCsv(multiplayer.stats) ? "Wrote network stats to vibe3d_netstats.csv."
+                                                           : "Failed to write vibe3d_netstats.csv.";
+        }
+      }
       ImGui::TextWrapped("%s", mpUiStatus.c_str());
       ImGui::End();
     }
@@ -4434,9 +10122,10 @@ int main(int argc, char** argv) {
       ImGui::SetNextWindowBgAlpha(highContrastHud ? 0.72f : 0.45f);
       ImGui::Begin("Debug", nullptr, hudFlags);
       ImGui::Text("Player: (%.2f, %.2f, %.2f)", player.position.x, player.position.y, player.position.z);
-      if (multiplayer.active && multiplayer.hasRemote) {
-        ImGui::Text("Peer:   (%.2f, %.2f, %.2f)",
-                    multiplayer.latest.pos[0], multiplayer.latest.pos[1], multiplayer.latest.pos[2]);
+      for (const RemotePlayer& remote : remotePlayers) {
+        if (remote.online) {
+          ImGui::Text("Peer:   (%.2f, %.2f, %.2f)", remote.position.x, remote.position.y, remote.position.z);
+        }
       }
       if (currentLevel == GameLevel::Level1Cats) {
         ImGui::Text("Clown:  (%.2f, %.2f, %.2f)", clown.position.x, clown.position.y, clown.position.z);
@@ -4445,9 +10134,126 @@ int main(int argc, char** argv) {
       }
       ImGui::Text("Camera yaw/pitch: %.2f / %.2f", yaw, pitch);
       ImGui::Text("Frame: %.2f ms (%.1f FPS)", perfHistory.emaFrameMs, 1000.0f / glm::max(0.001f, perfHistory.emaFrameMs));
-      if (!perfHistory.frameMs.empty()) {
-        std::vector<float> frameData(perfHistory.frameMs.begin(), perfHistory.frameMs.end());
-        ImGui::PlotLines("Frame Time (ms)", frameData.data(), static_cast<int>(frameData.size()), 0, nullptr, 0.0f, 40.0f, ImVec2(220.0f, 60.0f));
+      ImGui::Text("Draw calls: %d (%d cubes) + %d static (%d cubes)", renderQueue.lastDrawCalls,
+                  renderQueue.lastInstanceCount, staticScene.lastDrawCalls, staticScene.lastCubeCount);
+      ImGui::Text("Chunks: %d awake, %d meshes loaded, %d loading (%dx%d)",
+                  static_cast<int>(chunkStreamer.awakeChunks.size()), static_cast<int>(staticScene.loaded.size()),
+                  chunkStreamer.LoadsInFlight(), chunkStreamer.width, chunkStreamer.depth);
+      ImGui::Text("Particles: %d emitters in %d draw", particles.lastEmitterCount,
+                  particles.lastEmitterCount > 0 ? 1 : 0);
+      if (shadows) {
+        ImGui::Text("Shadows: %d dynamic casters in %d draws; static map baked %d times (%d cubes, %d backdrop vertices)",
+                    shadowMaps.lastCasterInstances, shadowMaps.lastCasterRanges, shadowMaps.staticBakes,
+                    shadowMaps.lastStaticInstances, shadowMaps.lastBackdropVertices);
+      } else {
+        ImGui::Text("Shadows: off");
+      }
+      if (audio.ready) {
+        int playing = 0;
+        int stolen = 0;
+        int culled = 0;
+        for (const SoundPool* pool : {&audio.footstep, &audio.jump, &audio.land, &audio.explosion, &audio.hurt}) {
+          playing += PlayingVoices(*pool);
+          stolen += pool->stolen;
+          culled += pool->culled;
+        }
+        ImGui::Text("Audio: %d effect voices playing, %d stolen, %d culled", playing, stolen, culled);
+      }
+      ImGui::Text("Culled: %d / %d objects, %d animals at LOD (%.0f m)", cullStats.culled, cullStats.tested,
+                  cullStats.lod, lodDistance);
+      ImGui::Text("Jobs: %d threads, %llu steals", static_cast<int>(jobs.ThreadCount()),
+                  static_cast<unsigned long long>(jobs.steals.load(std::memory_order_relaxed)));
+      // Tasks each pass split into last time and its measured cost per animal.
+      auto JobText = [](const char* label, const JobSystem::Cost& cost) {
+        ImGui::Text("  %-12s %2d tasks, %.2f us/item", label, static_cast<int>(cost.lastTasks), cost.nsPerItem * 0.001);
+      };
+      if (currentLevel == GameLevel::Level1Cats) {
+        JobText("Cat AI:", catAiCost);
+        JobText("Cat physics:", catPhysicsCost);
+        JobText("Cat models:", catModelCost);
+      } else {
+        JobText("Dog AI:", dogAiCost);
+        JobText("Dog physics:", dogPhysicsCost);
+        JobText("Dog models:", dogModelCost);
+      }
+      ImGui::Text("Broad-phase: %dx%d platform cells, %d entities in %dx%d cells", platformGrid.width,
+                  platformGrid.depth, static_cast<int>(entityGrid.entries.size()), entityGrid.width, entityGrid.depth);
+      auto PoolText = [](const char* label, std::size_t live, std::size_t capacity, std::size_t peak) {
+        ImGui::Text("%-11s %2d / %2d live, peak %2d", label, static_cast<int>(live), static_cast<int>(capacity),
+                    static_cast<int>(peak));
+      };
+      PoolText("Bombs:", bombs.Size(), bombs.Capacity(), bombs.highWater);
+      PoolText("Pellets:", shotgunProjectiles.Size(), shotgunProjectiles.Capacity(), shotgunProjectiles.highWater);
+      PoolText("Explosions:", explosions.Size(), explosions.Capacity(), explosions.highWater);
+      PoolText("Sprites:", collectSprites.Size(), collectSprites.Capacity(), collectSprites.highWater);
+      if (!perfHistory.frameMs.Empty()) {
+        ImGui::PlotLines("Frame Time (ms)", perfHistory.frameMs.Data(), static_cast<int>(perfHistory.frameMs.Size()),
+                         static_cast<int>(perfHistory.frameMs.Offset()), nullptr, 0.0f, 40.0f, ImVec2(220.0f, 60.0f));
+      }
+      if (multiplayer.active && !multiplayer.stats.history.Empty()) {
+        // One sample per second, plotted straight out of the ring with the sample stride.
+        const NetStatsSample* netHistory = multiplayer.stats.history.Data();
+        const int netCount = static_cast<int>(multiplayer.stats.history.Size());
+        const int netOffset = static_cast<int>(multiplayer.stats.history.Offset());
+        const int netStride = static_cast<int>(sizeof(NetStatsSample));
+        const float autoScale = std::numeric_limits<float>::max();
+        ImGui::PlotLines("Net Sent (KiB/s)", &netHistory->sentKiB, netCount, netOffset, nullptr, 0.0f, autoScale,
+                         ImVec2(220.0f, 40.0f), netStride);
+        ImGui::PlotLines("Net Recv (KiB/s)", &netHistory->receivedKiB, netCount, netOffset, nullptr, 0.0f, autoScale,
+                         ImVec2(220.0f, 40.0f), netStride);
+        ImGui::PlotLines("Net RTT (ms)", &netHistory->rttMs, netCount, netOffset, nullptr, 0.0f, autoScale,
+                         ImVec2(220.0f, 40.0f), netStride);
+      }
+      const std::uint32_t* allocationHistory = perfHistory.frameAllocations.Data();
+      const std::uint32_t peakAllocations =
+          *std::max_element(allocationHistory, allocationHistory + perfHistory.frameAllocations.Size());
+      ImGui::Text("Heap allocs: %u last frame, %u peak (%d frames)", perfHistory.frameAllocations.Back(),
+                  peakAllocations, static_cast<int>(perfHistory.frameAllocations.Size()));
+      ImGui::Text("Frame arena: %.1f / %.1f KiB (peak %.1f)", frameArena.used / 1024.0f,
+                  frameArena.block.size() / 1024.0f, frameArena.peak / 1024.0f);
+      if (ImGui::CollapsingHeader("Profiler")) {
+        ImGui::Text("%-14s %6s %6s %6s | %6s %6s %6s", "ms/frame", "p50", "p95", "p99", "gpu50", "gpu95", "gpu99");
+        const ProfilePercentiles frame = profiler.FramePercentiles(frameArena);
+        ImGui::Text("%-14s %6.2f %6.2f %6.2f |", "Frame", frame.p50, frame.p95, frame.p99);
+        for (int zone = 0; zone < kProfileZoneCount; ++zone) {
+          const ProfilePercentiles cpu = profiler.CpuPercentiles(frameArena, zone);
+          if (kProfileZoneGpu[zone] && profiler.gpuTimers) {
+            const ProfilePercentiles gpu = profiler.GpuPercentiles(frameArena, zone);
+            ImGui::Text("%-14s %6.2f %6.2f %6.2f | %6.2f %6.2f %6.2f", kProfileZoneNames[zone], cpu.p50, cpu.p95,
+                        cpu.p99, gpu.p50, gpu.p95, gpu.p99);
+          } else {
+            ImGui::Text("%-14s %6.2f %6.2f %6.2f |", kProfileZoneNames[zone], cpu.p50, cpu.p95, cpu.p99);
+          }
+        }
+        ImGui::SliderInt("Trace frames", &traceFrames, 10, 1200);
+        if (profiler.Capturing()) {
+          ImGui::Text("Capturing trace: %d frames left", profiler.captureFramesLeft);
+        } else if (ImGui::Button("Capture Trace")) {
+          profiler.StartCapture(traceFrames);
+        }
+        if (profiler.lastTraceFrames > 0) {
+          ImGui::Text("Last trace: %d frames in %s", profiler.lastTraceFrames, kTraceFile);
+        }
+      }
+      // Recompiles the level file if it changed and restarts the current level on it. Not offered
+      // online or while recording/replaying, where both sides must keep running the same world.
+      ImGui::Text("World: %s (%d platforms)", worldPath.c_str(), static_cast<int>(platforms.size()));
+      if (!multiplayer.active && !recorder.Active() && !replaying && ImGui::Button("Reload World")) {
+        // The new world loads beside the old one, which keeps running if the load fails. The
+        // binary is replaced by rename, so the old mapping stays readable until it is dropped;
+        // the streamer reads it in place and lets go first.
+        WorldFile reloaded;
+        if (reloaded.Load(worldPath, cubeVertices, 36)) {
+          chunkStreamer.Detach(staticScene);
+          world = std::move(reloaded);
+          ApplyWorld();
+          multiplayer.positionRange = NetPositionRangeForWorld(world);
+          if (currentLevel == GameLevel::Level1Cats) {
+            ResetLevel1();
+          } else {
+            ResetLevel2();
+          }
+        }
       }
       ImGui::End();
     }
@@ -4466,11 +10272,16 @@ int main(int argc, char** argv) {
       ImGui::SliderFloat("GUI Scale", &uiScale, 0.85f, 2.8f, "%.2fx");
       ImGui::SliderFloat("Mouse Sensitivity", &mouseSensitivity, 0.0015f, 0.02f, "%.4f");
       ImGui::SliderFloat("Camera Distance", &cameraDistance, 3.0f, 10.0f);
+      ImGui::SliderFloat("Animal Detail Distance", &lodDistance, 10.0f, 90.0f, "%.0f m");
       if (ImGui::Combo("Difficulty", &difficultyIndex, kDifficultyLabels, kDifficultyCount)) {
         livesRemaining = glm::min(livesRemaining, kDifficultyLives[difficultyIndex]);
       }
       ImGui::Checkbox("Invert Look Y", &invertLookY);
       ImGui::Checkbox("High Contrast HUD", &highContrastHud);
+      if (ImGui::Checkbox("VSync", &vsync)) {
+        glfwSwapInterval(vsync ? 1 : 0);
+      }
+      ImGui::Checkbox("Shadows", &shadows);
       ImGui::Checkbox("Show Debug HUD", &showDebugHud);
       ImGui::Checkbox("Show Multiplayer Window", &showMultiplayerWindow);
       ImGui::Separator();
@@ -4484,26 +10295,15 @@ int main(int argc, char** argv) {
       ImGui::InputInt("Pause Key 1", &bindings.pauseA);
       ImGui::InputInt("Pause Key 2", &bindings.pauseB);
       if (ImGui::Button("Save Settings", ImVec2(-1.0f, 0.0f))) {
-        settings.uiScale = uiScale;
-        settings.mouseSensitivity = mouseSensitivity;
-        settings.musicVolume = musicVolume;
-        settings.sfxVolume = sfxVolume;
-        settings.cameraDistance = cameraDistance;
-        settings.difficulty = difficultyIndex;
-        settings.invertLookY = invertLookY;
-        settings.showDebugHud = showDebugHud;
-        settings.showMultiplayerWindow = showMultiplayerWindow;
-        settings.highContrastHud = highContrastHud;
-        settings.keys = bindings;
-        SaveSettings(settings);
+        StoreSettings();
+        settingsWriter.Save(settings);
       }
       ImGui::Separator();
       if (ImGui::Button("Resume", ImVec2(-1.0f, 0.0f))) {
-        isPaused = false;
+        queuedInputActions |= kInputActionResume;
       }
       if (ImGui::Button("Reset Player", ImVec2(-1.0f, 0.0f))) {
-        player.position = (currentLevel == GameLevel::Level1Cats) ? levelOneSpawn : levelTwoSpawn;
-        player.velocity = glm::vec3(0.0f);
+        queuedInputActions |= kInputActionResetPlayer;
       }
       if (ImGui::Button("Quit Game", ImVec2(-1.0f, 0.0f))) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -4527,11 +10327,7 @@ int main(int argc, char** argv) {
       ImGui::Text("Level will reset to 5 lives.");
       ImGui::Separator();
       if (ImGui::Button("Restart Level", ImVec2(-1.0f, 0.0f))) {
-        if (currentLevel == GameLevel::Level1Cats) {
-          ResetLevel1();
-        } else {
-          ResetLevel2();
-        }
+        queuedInputActions |= kInputActionRestartLevel;
       }
       if (ImGui::Button("Quit Game", ImVec2(-1.0f, 0.0f))) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -4557,48 +10353,75 @@ int main(int argc, char** argv) {
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    profiler.End(ProfileZone::Ui);
 
-    glfwSwapBuffers(window);
+    {
+      ProfileScope presentScope(profiler, ProfileZone::Present);
+      glfwSwapBuffers(window);
+    }
+    profiler.EndFrame();
   }
 
-  settings.uiScale = uiScale;
-  settings.mouseSensitivity = mouseSensitivity;
-  settings.musicVolume = musicVolume;
-  settings.sfxVolume = sfxVolume;
-  settings.cameraDistance = cameraDistance;
-  settings.difficulty = difficultyIndex;
-  settings.invertLookY = invertLookY;
-  settings.showDebugHud = showDebugHud;
-  settings.showMultiplayerWindow = showMultiplayerWindow;
-  settings.highContrastHud = highContrastHud;
-  settings.keys = bindings;
-  SaveSettings(settings);
-
+  StoreSettings();
+  if (headless || replaying) {
+    // FNV-1a over the state every step feeds into; equal across identical runs.
+    std::uint64_t stateHash = 1469598103934665603ull;
+    auto HashBytes = [&](const void* data, std::size_t bytes) {
+      const unsigned char* byte = static_cast<const unsigned char*>(data);
+      for (std::size_t i = 0; i < bytes; ++i) {
+        stateHash = (stateHash ^ byte[i]) * 1099511628211ull;
+      }
+    };
+    HashBytes(&player.position, sizeof(player.position));
+    HashBytes(&clown.position, sizeof(clown.position));
+    HashBytes(&mummy.position, sizeof(mummy.position));
+    for (size_t i = 0; i < cats.size(); ++i) {
+      const glm::vec3 position = catBodies.Position(i);
+      HashBytes(&position, sizeof(position));
+    }
+    for (size_t i = 0; i < dogs.size(); ++i) {
+      const glm::vec3 position = dogBodies.Position(i);
+      HashBytes(&position, sizeof(position));
+    }
+    for (const Bomb& bomb : bombs) {
+      HashBytes(&bomb.position, sizeof(bomb.position));
+    }
+    HashBytes(&collectedCount, sizeof(collectedCount));
+    HashBytes(&livesRemaining, sizeof(livesRemaining));
+    if (headless) {
+      ReportHeadlessRun(headlessConfig, headlessStepNs, cats.size(), dogs.size(), stateHash, levelRestarts, slowestFrame);
+      ImGui::DestroyContext();
+      return 0;
+    }
+    char line[96];
+    std::snprintf(line, sizeof(line), "Replayed %zu of %zu frames, state %016llx", replayCursor, replayFrames.size(),
+                  static_cast<unsigned long long>(stateHash));
+    std::cout << line << "\n";
+  }
+  // A replay runs with the log's difficulty, which should not leak into the saved profile.
+  if (!replaying) {
+    settingsWriter.Save(settings);
+  }
+  settingsWriter.Shutdown();
+
+  renderQueue.Shutdown();
+  chunkStreamer.Shutdown();
+  staticScene.Clear();
+  particles.Shutdown();
+  shadowMaps.Shutdown();
+  profiler.Shutdown();
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
-  glDeleteTextures(1, &platformTexture);
-  glDeleteTextures(1, &playerTexture);
-  glDeleteTextures(1, &playerSkinTexture);
-  glDeleteTextures(1, &clownTexture);
-  glDeleteTextures(1, &clownSkinTexture);
-  glDeleteTextures(1, &clownAccentTexture);
-  glDeleteTextures(1, &knifeTexture);
-  glDeleteTextures(1, &cloudTexture);
+  textures.Shutdown();
   if (audio.ready) {
-    ma_sound_uninit(&audio.footstep.sound);
-    ma_sound_uninit(&audio.jump.sound);
-    ma_sound_uninit(&audio.land.sound);
+    for (SoundPool* pool : {&audio.footstep, &audio.jump, &audio.land, &audio.explosion, &audio.hurt}) {
+      DestroySoundPool(*pool);
+    }
     ma_sound_uninit(&audio.ambient.sound);
     ma_sound_uninit(&audio.chase.sound);
-    ma_sound_uninit(&audio.explosion.sound);
-    ma_sound_uninit(&audio.hurt.sound);
-    ma_audio_buffer_uninit(&audio.footstep.buffer);
-    ma_audio_buffer_uninit(&audio.jump.buffer);
-    ma_audio_buffer_uninit(&audio.land.buffer);
     ma_audio_buffer_uninit(&audio.ambient.buffer);
     ma_audio_buffer_uninit(&audio.chase.buffer);
-    ma_audio_buffer_uninit(&audio.explosion.buffer);
-    ma_audio_buffer_uninit(&audio.hurt.buffer);
+    ma_sound_group_uninit(&audio.sfx);
     ma_engine_uninit(&audio.engine);
   }
   ImGui_ImplOpenGL3_Shutdown();
@@ -4608,3 +10431,32 @@ int main(int argc, char** argv) {
   ShutdownMultiplayer(multiplayer);
   return 0;
 }
+
+#ifdef VIBE3D_BENCH
+// Fixed headless scenarios for tracking sim cost between builds. Extra arguments (for
+// example --steps 20000 or --seed 7) are appended to every scenario.
+int main(int argc, char** argv) {
+  const std::vector<std::vector<std::string>> scenarios = {
+      {"--level", "1"},
+      {"--level", "1", "--cats", "200"},
+      {"--level", "2"},
+      {"--level", "2", "--dogs", "500", "--bombs", "50"},
+  };
+  int result = 0;
+  for (const std::vector<std::string>& scenario : scenarios) {
+    std::vector<std::string> args = {argv[0], "--headless", "--steps", "3000"};
+    args.insert(args.end(), scenario.begin(), scenario.end());
+    for (int i = 1; i < argc; ++i) {
+      args.push_back(argv[i]);
+    }
+    std::vector<char*> argPointers;
+    for (std::string& arg : args) {
+      argPointers.push_back(&arg[0]);
+    }
+    result |= RunGame(static_cast<int>(argPointers.size()), argPointers.data());
+  }
+  return result;
+}
+#else
+int main(int argc, char** argv) { return RunGame(argc, argv); }
+#endif